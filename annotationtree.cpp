@@ -0,0 +1,439 @@
+#include "annotationtree.h"
+#include <QFile>
+#include <QList>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace {
+
+constexpr int kWriteChunk = 1024 * 1024;
+
+QByteArray escapeLabel(const QString &label)
+{
+    const QByteArray utf8 = label.toUtf8();
+    QByteArray out;
+    out.reserve(utf8.size());
+    for (const char c : utf8) {
+        switch (c) {
+        case '\\': out += "\\\\"; break;
+        case '\t': out += "\\t"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        default: out += c; break;
+        }
+    }
+    return out;
+}
+
+QString unescapeLabel(const QByteArray &text)
+{
+    QByteArray out;
+    out.reserve(text.size());
+    for (int i = 0; i < text.size(); ++i) {
+        const char c = text.at(i);
+        if (c != '\\' || i + 1 == text.size()) {
+            out += c;
+            continue;
+        }
+        const char next = text.at(++i);
+        out += next == 't' ? '\t' : next == 'n' ? '\n' : next == 'r' ? '\r' : next;
+    }
+    return QString::fromUtf8(out);
+}
+
+bool parseOffset(const QByteArray &text, qint64 *value)
+{
+    bool ok = false;
+    const QByteArray trimmed = text.trimmed();
+    if (trimmed.startsWith("0x") || trimmed.startsWith("0X")) *value = trimmed.mid(2).toLongLong(&ok, 16);
+    else *value = trimmed.toLongLong(&ok, 10);
+    return ok && *value >= 0;
+}
+
+bool parseColor(const QByteArray &text, quint32 *color)
+{
+    const QByteArray trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        *color = 0;
+        return true;
+    }
+    if (!trimmed.startsWith('#') || trimmed.size() != 7) return false;
+    bool ok = false;
+    *color = trimmed.mid(1).toUInt(&ok, 16);
+    return ok;
+}
+
+}
+
+QString AnnotationTree::sidecarPath(const QString &filePath)
+{
+    return filePath + ".annotations";
+}
+
+void AnnotationTree::shift(int t, qint64 delta)
+{
+    if (t < 0) return;
+    Node &n = nodes[t];
+    n.start += delta;
+    n.end += delta;
+    n.maxEnd += delta;
+    n.pending += delta;
+}
+
+void AnnotationTree::push(int t)
+{
+    Node &n = nodes[t];
+    if (!n.pending) return;
+    shift(n.left, n.pending);
+    shift(n.right, n.pending);
+    n.pending = 0;
+}
+
+void AnnotationTree::pull(int t)
+{
+    Node &n = nodes[t];
+    n.maxEnd = n.end;
+    for (const int child : { n.left, n.right }) {
+        if (child < 0) continue;
+        n.maxEnd = std::max(n.maxEnd, nodes[child].maxEnd);
+        nodes[child].parent = t;
+    }
+}
+
+// Ranges starting before at go left, the rest right.
+void AnnotationTree::split(int t, qint64 at, int *left, int *right)
+{
+    if (t < 0) {
+        *left = *right = -1;
+        return;
+    }
+    push(t);
+    int a = -1;
+    int b = -1;
+    if (nodes[t].start < at) {
+        split(nodes[t].right, at, &a, &b);
+        nodes[t].right = a;
+        *left = t;
+        *right = b;
+    } else {
+        split(nodes[t].left, at, &a, &b);
+        nodes[t].left = b;
+        *left = a;
+        *right = t;
+    }
+    pull(t);
+}
+
+// Every range in a starts no later than every range in b.
+int AnnotationTree::merge(int a, int b)
+{
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (nodes[a].priority > nodes[b].priority) {
+        push(a);
+        const int right = merge(nodes[a].right, b);
+        nodes[a].right = right;
+        pull(a);
+        return a;
+    }
+    push(b);
+    const int left = merge(a, nodes[b].left);
+    nodes[b].left = left;
+    pull(b);
+    return b;
+}
+
+void AnnotationTree::setRoot(int t)
+{
+    root = t;
+    if (root >= 0) nodes[root].parent = -1;
+}
+
+int AnnotationTree::add(qint64 start, qint64 end, const QString &label, quint32 color)
+{
+    if (end < start) std::swap(start, end);
+    start = std::max<qint64>(start, 0);
+    end = std::max(end, start + 1);
+
+    int id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    } else {
+        id = int(nodes.size());
+        nodes.emplace_back();
+    }
+    // xorshift32: priorities only need to look random to keep the depth
+    // logarithmic.
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    Node &n = nodes[id];
+    n = Node();
+    n.start = start;
+    n.end = end;
+    n.maxEnd = end;
+    n.priority = seed;
+    n.color = color;
+    n.used = true;
+    n.label = label;
+
+    int left = -1;
+    int right = -1;
+    split(root, start, &left, &right);
+    setRoot(merge(merge(left, id), right));
+    ++live;
+    return id;
+}
+
+bool AnnotationTree::remove(int id)
+{
+    if (id < 0 || id >= int(nodes.size()) || !nodes[id].used) return false;
+
+    // Shifts pending above the node belong to its children too.
+    std::vector<int> path;
+    for (int a = nodes[id].parent; a >= 0; a = nodes[a].parent) path.push_back(a);
+    for (auto it = path.rbegin(); it != path.rend(); ++it) push(*it);
+    push(id);
+
+    const int up = nodes[id].parent;
+    const int joined = merge(nodes[id].left, nodes[id].right);
+    if (up < 0) {
+        setRoot(joined);
+    } else {
+        if (nodes[up].left == id) nodes[up].left = joined;
+        else nodes[up].right = joined;
+        for (const int a : path) pull(a);
+    }
+
+    nodes[id] = Node();
+    freeIds.push_back(id);
+    --live;
+    return true;
+}
+
+void AnnotationTree::clear()
+{
+    nodes.clear();
+    freeIds.clear();
+    root = -1;
+    live = 0;
+}
+
+AnnotationTree::Annotation AnnotationTree::make(int t, qint64 acc) const
+{
+    const Node &n = nodes[t];
+    Annotation a;
+    a.id = t;
+    a.start = n.start + acc;
+    a.end = n.end + acc;
+    a.color = n.color;
+    a.label = n.label;
+    return a;
+}
+
+AnnotationTree::Annotation AnnotationTree::annotation(int id) const
+{
+    if (id < 0 || id >= int(nodes.size()) || !nodes[id].used) return Annotation();
+    qint64 acc = 0;
+    for (int a = nodes[id].parent; a >= 0; a = nodes[a].parent) acc += nodes[a].pending;
+    return make(id, acc);
+}
+
+// acc is the shift pending from t's ancestors.
+void AnnotationTree::collect(int t, qint64 acc, qint64 begin, qint64 end, QVector<Annotation> *out) const
+{
+    if (t < 0) return;
+    const Node &n = nodes[t];
+    if (n.maxEnd + acc <= begin) return;
+    const qint64 below = acc + n.pending;
+    collect(n.left, below, begin, end, out);
+    if (n.start + acc >= end) return;
+    if (n.end + acc > begin) out->append(make(t, acc));
+    collect(n.right, below, begin, end, out);
+}
+
+QVector<AnnotationTree::Annotation> AnnotationTree::overlapping(qint64 begin, qint64 end) const
+{
+    QVector<Annotation> out;
+    if (begin < end) collect(root, 0, begin, end, &out);
+    return out;
+}
+
+AnnotationTree::Annotation AnnotationTree::next(qint64 offset) const
+{
+    int best = -1;
+    qint64 bestAcc = 0;
+    qint64 acc = 0;
+    for (int t = root; t >= 0;) {
+        const Node &n = nodes[t];
+        if (n.start + acc > offset) {
+            best = t;
+            bestAcc = acc;
+            t = n.left;
+        } else {
+            t = n.right;
+        }
+        acc += n.pending;
+    }
+    return best < 0 ? Annotation() : make(best, bestAcc);
+}
+
+AnnotationTree::Annotation AnnotationTree::previous(qint64 offset) const
+{
+    int best = -1;
+    qint64 bestAcc = 0;
+    qint64 acc = 0;
+    for (int t = root; t >= 0;) {
+        const Node &n = nodes[t];
+        if (n.start + acc < offset) {
+            best = t;
+            bestAcc = acc;
+            t = n.right;
+        } else {
+            t = n.left;
+        }
+        acc += n.pending;
+    }
+    return best < 0 ? Annotation() : make(best, bestAcc);
+}
+
+void AnnotationTree::visit(int t, qint64 acc, const std::function<void(const Annotation &)> &fn) const
+{
+    if (t < 0) return;
+    const Node &n = nodes[t];
+    visit(n.left, acc + n.pending, fn);
+    fn(make(t, acc));
+    visit(n.right, acc + n.pending, fn);
+}
+
+void AnnotationTree::forEach(const std::function<void(const Annotation &)> &visit) const
+{
+    this->visit(root, 0, visit);
+}
+
+// Moves the ends past at by delta, no lower than at, in ranges starting
+// before at. Subtrees ending at or before at are skipped whole.
+void AnnotationTree::clipEnds(int t, qint64 at, qint64 delta)
+{
+    if (t < 0 || nodes[t].maxEnd <= at) return;
+    push(t);
+    clipEnds(nodes[t].left, at, delta);
+    clipEnds(nodes[t].right, at, delta);
+    Node &n = nodes[t];
+    if (n.end > at) n.end = std::max(at, n.end + delta);
+    pull(t);
+}
+
+// Ranges starting inside a deleted span now start where it was.
+void AnnotationTree::collapse(int t, qint64 at, qint64 length, std::vector<int> *emptied)
+{
+    if (t < 0) return;
+    push(t);
+    collapse(nodes[t].left, at, length, emptied);
+    collapse(nodes[t].right, at, length, emptied);
+    Node &n = nodes[t];
+    n.start = at;
+    n.end = std::max(at, n.end - length);
+    if (n.end == n.start) emptied->push_back(t);
+    pull(t);
+}
+
+void AnnotationTree::insertBytes(qint64 offset, qint64 length)
+{
+    if (length <= 0 || root < 0) return;
+    int left = -1;
+    int right = -1;
+    split(root, offset, &left, &right);
+    shift(right, length);
+    clipEnds(left, offset, length);
+    setRoot(merge(left, right));
+}
+
+void AnnotationTree::removeBytes(qint64 offset, qint64 length)
+{
+    if (length <= 0 || root < 0) return;
+    int left = -1;
+    int rest = -1;
+    int inside = -1;
+    int right = -1;
+    split(root, offset, &left, &rest);
+    split(rest, offset + length, &inside, &right);
+    shift(right, -length);
+    clipEnds(left, offset, -length);
+    std::vector<int> emptied;
+    collapse(inside, offset, length, &emptied);
+    setRoot(merge(merge(left, inside), right));
+    for (const int id : emptied) remove(id);
+}
+
+bool AnnotationTree::addFromFile(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    int lineNumber = 0;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        ++lineNumber;
+        while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+        if (line.trimmed().isEmpty() || line.startsWith('#')) continue;
+
+        const QList<QByteArray> fields = line.split('\t');
+        qint64 start = 0;
+        qint64 end = 0;
+        quint32 color = 0;
+        if (fields.size() < 2 || !parseOffset(fields.at(0), &start) || !parseOffset(fields.at(1), &end)
+            || (fields.size() > 2 && !parseColor(fields.at(2), &color))) {
+            if (error) *error = QString("%1: bad range on line %2").arg(path).arg(lineNumber);
+            return false;
+        }
+        // Tabs in labels are written escaped; stray ones still belong to it.
+        add(start, end, fields.size() > 3 ? unescapeLabel(fields.mid(3).join('\t')) : QString(), color);
+    }
+    return true;
+}
+
+bool AnnotationTree::saveToFile(const QString &path, QString *error) const
+{
+    if (isEmpty()) {
+        if (!QFile::exists(path) || QFile::remove(path)) return true;
+        if (error) *error = "Cannot remove " + path;
+        return false;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    QByteArray chunk = "# start\tend\tcolor\tlabel\n";
+    bool written = true;
+    forEach([&](const Annotation &a) {
+        chunk += "0x";
+        chunk += QByteArray::number(a.start, 16).toUpper();
+        chunk += "\t0x";
+        chunk += QByteArray::number(a.end, 16).toUpper();
+        chunk += '\t';
+        if (a.color) {
+            chunk += '#';
+            chunk += QByteArray::number(a.color & 0xFFFFFF, 16).rightJustified(6, '0').toUpper();
+        }
+        chunk += '\t';
+        chunk += escapeLabel(a.label);
+        chunk += '\n';
+        if (chunk.size() >= kWriteChunk) {
+            written = written && file.write(chunk) == chunk.size();
+            chunk.clear();
+        }
+    });
+    written = written && file.write(chunk) == chunk.size();
+    if (!written || !file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef ANNOTATIONTREE_H
+#define ANNOTATIONTREE_H
+
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <vector>
+
+// Labelled byte ranges (bookmarks, annotations, imported scan results) of one
+// file. They are kept in a treap ordered by start offset whose nodes also
+// hold the largest end in their subtree, so the ranges overlapping the rows
+// on screen are found in O(log n + k) however many there are. Inserting or
+// deleting bytes splits the treap at the edit and leaves a pending shift on
+// the part after it instead of touching every range there.
+class AnnotationTree
+{
+public:
+    struct Annotation {
+        int id = -1;
+        qint64 start = 0;
+        // Exclusive; ranges are never empty.
+        qint64 end = 0;
+        // 0xRRGGBB, or 0 for the default colour.
+        quint32 color = 0;
+        QString label;
+    };
+
+    // Sidecar file the annotations of filePath are kept in.
+    static QString sidecarPath(const QString &filePath);
+
+    // Returns the new range's id, valid until it is removed.
+    int add(qint64 start, qint64 end, const QString &label = QString(), quint32 color = 0);
+    bool remove(int id);
+    void clear();
+    int count() const { return live; }
+    bool isEmpty() const { return live == 0; }
+    // id is -1 in the result when there is no such range.
+    Annotation annotation(int id) const;
+
+    // Ranges overlapping [begin, end), in start order.
+    QVector<Annotation> overlapping(qint64 begin, qint64 end) const;
+    // The nearest range starting after, or before, offset.
+    Annotation next(qint64 offset) const;
+    Annotation previous(qint64 offset) const;
+    // All ranges in start order.
+    void forEach(const std::function<void(const Annotation &)> &visit) const;
+
+    // length bytes were inserted at offset: ranges from there on move up,
+    // ranges across it grow.
+    void insertBytes(qint64 offset, qint64 length);
+    // [offset, offset + length) was deleted: ranges after it move down,
+    // ranges across it shrink, ranges inside it go.
+    void removeBytes(qint64 offset, qint64 length);
+
+    // One range per line, tab separated: start, end (exclusive), colour as
+    // #RRGGBB or empty, label. Offsets are decimal or 0x hex. Lines starting
+    // with # are skipped. Adds to the ranges already here.
+    bool addFromFile(const QString &path, QString *error = nullptr);
+    // Writes every range in the same format; an empty tree removes the file.
+    bool saveToFile(const QString &path, QString *error = nullptr) const;
+
+private:
+    struct Node {
+        qint64 start = 0;
+        qint64 end = 0;
+        qint64 maxEnd = 0;
+        // Shift not yet applied to the children's subtrees.
+        qint64 pending = 0;
+        int left = -1;
+        int right = -1;
+        int parent = -1;
+        quint32 priority = 0;
+        quint32 color = 0;
+        bool used = false;
+        QString label;
+    };
+
+    void shift(int t, qint64 delta);
+    void push(int t);
+    void pull(int t);
+    void split(int t, qint64 at, int *left, int *right);
+    int merge(int a, int b);
+    void clipEnds(int t, qint64 at, qint64 delta);
+    void collapse(int t, qint64 at, qint64 length, std::vector<int> *emptied);
+    void setRoot(int t);
+    Annotation make(int t, qint64 acc) const;
+    void collect(int t, qint64 acc, qint64 begin, qint64 end, QVector<Annotation> *out) const;
+    void visit(int t, qint64 acc, const std::function<void(const Annotation &)> &fn) const;
+
+    std::vector<Node> nodes;
+    std::vector<int> freeIds;
+    int root = -1;
+    int live = 0;
+    quint32 seed = 0x9E3779B9u;
+};
+
+#endif
@@ -0,0 +1,621 @@
+#include "asyncreader.h"
+#include "trace.h"
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ASYNCREADER_URING
+#endif
+#endif
+#endif
+
+namespace {
+
+typedef decltype(QByteArray().size()) ByteCount;
+
+constexpr int kReaderThreads = 8;
+constexpr qint64 kMaxStreamBytesInFlight = 32 * 1024 * 1024;
+constexpr qint64 kMaxReadLength = 1 << 30;
+
+struct OpenFile {
+    QString path;
+    int fd = -1;
+    bool regular = false;
+    qint64 size = 0;
+    QString error;
+
+    OpenFile() = default;
+    OpenFile(OpenFile &&other) noexcept
+        : path(other.path), fd(other.fd), regular(other.regular), size(other.size), error(other.error)
+    {
+        other.fd = -1;
+    }
+    ~OpenFile()
+    {
+#ifdef Q_OS_UNIX
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+private:
+    OpenFile(const OpenFile &) = delete;
+    OpenFile &operator=(const OpenFile &) = delete;
+};
+
+OpenFile openFile(const QString &path)
+{
+    OpenFile file;
+    file.path = path;
+#ifdef Q_OS_UNIX
+    file.fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (file.fd < 0 || ::fstat(file.fd, &st) != 0) {
+        file.error = "Cannot open file: " + path;
+        return file;
+    }
+    file.regular = S_ISREG(st.st_mode);
+    file.size = file.regular ? qint64(st.st_size) : 0;
+#else
+    const QFileInfo info(path);
+    QFile probe(path);
+    if (!probe.open(QIODevice::ReadOnly)) {
+        file.error = "Cannot open file: " + path;
+        return file;
+    }
+    file.regular = info.isFile() && !probe.isSequential();
+    file.size = file.regular ? info.size() : 0;
+#endif
+    return file;
+}
+
+struct ReadOp {
+    quint64 tag = 0;
+    const OpenFile *file = nullptr;
+    qint64 offset = 0;
+    char *dest = nullptr;
+    qint64 length = 0;
+};
+
+// result is the byte count, or -errno.
+struct Completion {
+    quint64 tag;
+    qint64 result;
+};
+
+class ReadQueue
+{
+public:
+    virtual ~ReadQueue() {}
+    virtual void submit(const ReadOp &op) = 0;
+    // Completions so far, blocking for at least one when wait is set.
+    // Returns -errno when the queue itself has failed.
+    virtual int reap(Completion *out, int max, bool wait) = 0;
+};
+
+qint64 positionedRead(const ReadOp &op)
+{
+#ifdef Q_OS_UNIX
+    for (;;) {
+        const ssize_t n = ::pread(op.file->fd, op.dest, size_t(op.length), off_t(op.offset));
+        if (n >= 0) return n;
+        if (errno != EINTR) return -errno;
+    }
+#else
+    QFile file(op.file->path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(op.offset)) return -EIO;
+    const qint64 n = file.read(op.dest, op.length);
+    return n < 0 ? -EIO : n;
+#endif
+}
+
+class ThreadQueue : public ReadQueue
+{
+public:
+    explicit ThreadQueue(int threads)
+    {
+        for (int i = 0; i < threads; ++i) {
+            workers.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ThreadQueue() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workReady.notify_all();
+        for (std::thread &worker : workers) worker.join();
+    }
+
+    void submit(const ReadOp &op) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            work.push_back(op);
+        }
+        workReady.notify_one();
+    }
+
+    int reap(Completion *out, int max, bool wait) override
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (wait) doneReady.wait(lock, [this]() { return !done.empty(); });
+        int n = 0;
+        while (n < max && !done.empty()) {
+            out[n++] = done.front();
+            done.pop_front();
+        }
+        return n;
+    }
+
+private:
+    void run()
+    {
+        for (;;) {
+            ReadOp op;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                workReady.wait(lock, [this]() { return stopping || !work.empty(); });
+                if (stopping) return;
+                op = work.front();
+                work.pop_front();
+            }
+            const qint64 result = positionedRead(op);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.push_back({ op.tag, result });
+            }
+            doneReady.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable doneReady;
+    std::deque<ReadOp> work;
+    std::deque<Completion> done;
+    bool stopping = false;
+};
+
+#ifdef ASYNCREADER_URING
+// A bare io_uring: one mapping for both rings (IORING_FEAT_SINGLE_MMAP) and
+// one for the submission entries. Only this thread touches the SQ tail and
+// the CQ head; the kernel side is synchronised with acquire/release.
+class UringQueue : public ReadQueue
+{
+public:
+    static std::unique_ptr<UringQueue> create(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        const int fd = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return nullptr;
+
+        // IORING_OP_READ arrived in 5.6 together with RW_CUR_POS.
+        const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_RW_CUR_POS;
+        if ((params.features & required) != required) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        std::unique_ptr<UringQueue> queue(new UringQueue());
+        queue->ringFd = fd;
+        queue->ringBytes = qMax<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        void *ring = mmap(nullptr, queue->ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED) return nullptr;
+        queue->ring = static_cast<char *>(ring);
+
+        queue->sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, queue->sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return nullptr;
+        queue->sqes = static_cast<io_uring_sqe *>(sqes);
+
+        char *base = queue->ring;
+        queue->sqTail = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+        queue->sqMask = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+        queue->sqArray = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+        queue->cqHead = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+        queue->cqTail = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+        queue->cqMask = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+        queue->cqes = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+        return queue;
+    }
+
+    ~UringQueue() override
+    {
+        if (sqes) munmap(sqes, sqeBytes);
+        if (ring) munmap(ring, ringBytes);
+        if (ringFd >= 0) ::close(ringFd);
+    }
+
+    void submit(const ReadOp &op) override
+    {
+        const unsigned tail = *sqTail;
+        const unsigned index = tail & sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = op.file->fd;
+        sqe->off = quint64(op.offset);
+        sqe->addr = quint64(reinterpret_cast<quintptr>(op.dest));
+        sqe->len = unsigned(op.length);
+        sqe->user_data = op.tag;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted;
+    }
+
+    int reap(Completion *out, int max, bool wait) override
+    {
+        for (;;) {
+            if (unsubmitted > 0 || wait) {
+                const long entered = syscall(__NR_io_uring_enter, ringFd, unsubmitted, wait ? 1 : 0,
+                                             wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                if (entered < 0) {
+                    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return -errno;
+                } else {
+                    unsubmitted -= unsigned(entered);
+                }
+            }
+
+            unsigned head = *cqHead;
+            const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            int n = 0;
+            while (head != tail && n < max) {
+                const io_uring_cqe &cqe = cqes[head & cqMask];
+                out[n++] = { quint64(cqe.user_data), qint64(cqe.res) };
+                ++head;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            if (n > 0 || !wait) return n;
+        }
+    }
+
+private:
+    UringQueue() = default;
+
+    int ringFd = -1;
+    char *ring = nullptr;
+    size_t ringBytes = 0;
+    io_uring_sqe *sqes = nullptr;
+    size_t sqeBytes = 0;
+    unsigned *sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+    unsigned unsubmitted = 0;
+};
+#endif
+
+std::unique_ptr<ReadQueue> makeQueue()
+{
+#ifdef ASYNCREADER_URING
+    // Seccomp filters in containers and the io_uring_disabled sysctl both
+    // make setup fail; the threads work everywhere.
+    if (std::unique_ptr<UringQueue> uring = UringQueue::create(AsyncReader::queueDepth)) {
+        return uring;
+    }
+#endif
+    return std::unique_ptr<ReadQueue>(new ThreadQueue(kReaderThreads));
+}
+
+// Runs reads on a queue until each is complete. Short reads are continued
+// from where they stopped, so a read only comes back short at end of file.
+class ReadScheduler
+{
+public:
+    ReadScheduler() : queue(makeQueue()) {}
+    ~ReadScheduler() { drain(); }
+
+    void start(const ReadOp &op)
+    {
+        active.emplace(op.tag, Active{ op, 0 });
+        queue->submit(op);
+    }
+
+    int inFlight() const { return int(active.size()); }
+
+    // Waits for the next read to finish. bytes is how many were read, or -errno.
+    void next(quint64 *tag, qint64 *bytes)
+    {
+        while (finished.empty()) {
+            Completion batch[AsyncReader::queueDepth];
+            const int n = queue->reap(batch, AsyncReader::queueDepth, true);
+            if (n < 0) {
+                failAll(n);
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                complete(batch[i]);
+            }
+        }
+        *tag = finished.front().tag;
+        *bytes = finished.front().result;
+        finished.pop_front();
+    }
+
+    // Buffers handed to start() must outlive every read still in flight.
+    void drain()
+    {
+        quint64 tag;
+        qint64 bytes;
+        while (!active.empty() || !finished.empty()) next(&tag, &bytes);
+    }
+
+private:
+    struct Active {
+        ReadOp op;
+        qint64 done;
+    };
+
+    void complete(const Completion &c)
+    {
+        auto it = active.find(c.tag);
+        if (it == active.end()) return;
+        Active &a = it->second;
+        if (c.result == -EINTR || c.result == -EAGAIN || (c.result > 0 && a.done + c.result < a.op.length)) {
+            a.done += qMax<qint64>(0, c.result);
+            ReadOp rest = a.op;
+            rest.offset += a.done;
+            rest.dest += a.done;
+            rest.length -= a.done;
+            queue->submit(rest);
+            return;
+        }
+        finished.push_back({ c.tag, c.result < 0 ? c.result : a.done + c.result });
+        active.erase(it);
+    }
+
+    void failAll(qint64 error)
+    {
+        for (const auto &entry : active) {
+            finished.push_back({ entry.first, error });
+        }
+        active.clear();
+    }
+
+    std::unique_ptr<ReadQueue> queue;
+    std::unordered_map<quint64, Active> active;
+    std::deque<Completion> finished;
+};
+
+bool readSequential(const QString &path, qint64 offset, qint64 length, const AsyncReader::BlockSink &sink,
+                    qint64 blockBytes, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Cannot open file: " + path;
+        return false;
+    }
+    // Pipes and character devices cannot seek; skip by reading.
+    if (offset > 0 && !file.seek(offset)) {
+        while (offset > 0) {
+            const QByteArray skipped = file.read(qMin(offset, blockBytes));
+            if (skipped.isEmpty()) return true;
+            offset -= skipped.size();
+        }
+    }
+    QByteArray buffer(ByteCount(blockBytes), Qt::Uninitialized);
+    while (length != 0) {
+        const qint64 want = (length < 0) ? blockBytes : qMin(length, blockBytes);
+        const qint64 n = file.read(buffer.data(), want);
+        if (n < 0) {
+            if (error) *error = "Cannot read file: " + path;
+            return false;
+        }
+        if (n == 0) break;
+        if (!sink(buffer.constData(), n)) return false;
+        if (length > 0) length -= n;
+    }
+    return true;
+}
+
+}
+
+QByteArray AsyncReader::readFile(const QString &path, QString *error)
+{
+    QVector<ReadResult> results = readFiles(QStringList{ path });
+    if (error) *error = results.first().error;
+    return results.first().data;
+}
+
+QVector<ReadResult> AsyncReader::readFiles(const QStringList &paths, qint64 maxFileSize)
+{
+    TRACE_SCOPE("AsyncReader::readFiles");
+    QVector<ReadResult> results(paths.size());
+    std::vector<OpenFile> files;
+    files.reserve(size_t(paths.size()));
+
+    struct Block {
+        int file;
+        qint64 offset;
+        qint64 length;
+    };
+    std::vector<Block> blocks;
+    std::vector<qint64> valid(size_t(paths.size()), 0);
+
+    for (int i = 0; i < paths.size(); ++i) {
+        ReadResult &result = results[i];
+        result.path = paths.at(i);
+        files.push_back(openFile(result.path));
+        const OpenFile &file = files.back();
+        if (!file.error.isEmpty()) {
+            result.error = file.error;
+            continue;
+        }
+
+        if (!file.regular) {
+            QFile stream(result.path);
+            if (stream.open(QIODevice::ReadOnly)) result.data = stream.readAll();
+            else result.error = "Cannot open file: " + result.path;
+            continue;
+        }
+        if ((maxFileSize >= 0 && file.size > maxFileSize) || file.size > std::numeric_limits<ByteCount>::max()) {
+            result.error = "File too large: " + result.path;
+            continue;
+        }
+
+        result.data = QByteArray(ByteCount(file.size), Qt::Uninitialized);
+        valid[size_t(i)] = file.size;
+        for (qint64 offset = 0; offset < file.size; offset += blockSize) {
+            blocks.push_back({ i, offset, qMin(blockSize, file.size - offset) });
+        }
+    }
+
+    ReadScheduler scheduler;
+    size_t nextBlock = 0;
+    while (nextBlock < blocks.size() || scheduler.inFlight() > 0) {
+        while (nextBlock < blocks.size() && scheduler.inFlight() < queueDepth) {
+            const Block &b = blocks[nextBlock];
+            ReadOp op;
+            op.tag = nextBlock;
+            op.file = &files[size_t(b.file)];
+            op.offset = b.offset;
+            op.dest = results[b.file].data.data() + b.offset;
+            op.length = b.length;
+            scheduler.start(op);
+            ++nextBlock;
+        }
+
+        quint64 tag;
+        qint64 bytes;
+        scheduler.next(&tag, &bytes);
+        const Block &b = blocks[size_t(tag)];
+        if (bytes < 0) {
+            results[b.file].error = "Cannot read file: " + results[b.file].path;
+        } else if (bytes < b.length) {
+            // The file shrank after it was measured.
+            valid[size_t(b.file)] = qMin(valid[size_t(b.file)], b.offset + bytes);
+        }
+    }
+
+    for (int i = 0; i < results.size(); ++i) {
+        ReadResult &result = results[i];
+        if (!result.error.isEmpty()) {
+            result.data.clear();
+        } else if (files[size_t(i)].regular && valid[size_t(i)] < result.data.size()) {
+            result.data.truncate(ByteCount(valid[size_t(i)]));
+        }
+    }
+    return results;
+}
+
+bool AsyncReader::streamFile(const QString &path, qint64 offset, qint64 length, const BlockSink &sink,
+                             qint64 blockBytes, QString *error)
+{
+    TRACE_SCOPE("AsyncReader::streamFile");
+    if (error) error->clear();
+    blockBytes = qBound<qint64>(4096, blockBytes, kMaxReadLength);
+
+    const OpenFile file = openFile(path);
+    if (!file.error.isEmpty()) {
+        if (error) *error = file.error;
+        return false;
+    }
+    if (!file.regular) {
+        return readSequential(path, offset, length, sink, blockBytes, error);
+    }
+
+    const qint64 end = (length < 0) ? file.size : qMin(file.size, offset + length);
+    if (offset >= end) return true;
+
+    const qint64 blockCount = (end - offset + blockBytes - 1) / blockBytes;
+    const int depth = int(qBound<qint64>(2, kMaxStreamBytesInFlight / blockBytes, queueDepth));
+    const int slots = int(qMin<qint64>(depth, blockCount));
+    std::unique_ptr<char[]> buffer(new char[size_t(slots) * size_t(blockBytes)]);
+    std::vector<qint64> slotBytes(size_t(slots), 0);
+    std::vector<char> slotDone(size_t(slots), 0);
+
+    ReadScheduler scheduler;
+    qint64 nextBlock = 0;
+    auto startBlock = [&]() {
+        ReadOp op;
+        op.tag = quint64(nextBlock);
+        op.file = &file;
+        op.offset = offset + nextBlock * blockBytes;
+        op.length = qMin(blockBytes, end - op.offset);
+        op.dest = buffer.get() + size_t(nextBlock % slots) * size_t(blockBytes);
+        scheduler.start(op);
+        ++nextBlock;
+    };
+    while (nextBlock < slots) startBlock();
+
+    // Blocks can finish in any order; hand them to the sink in file order and
+    // reuse each slot for the block `slots` further on.
+    bool ok = true;
+    bool finished = false;
+    qint64 delivered = 0;
+    while (!finished && delivered < blockCount) {
+        quint64 tag;
+        qint64 bytes;
+        scheduler.next(&tag, &bytes);
+        slotBytes[size_t(tag % quint64(slots))] = bytes;
+        slotDone[size_t(tag % quint64(slots))] = 1;
+
+        while (!finished && delivered < blockCount && slotDone[size_t(delivered % slots)]) {
+            const size_t slot = size_t(delivered % slots);
+            const qint64 got = slotBytes[slot];
+            slotDone[slot] = 0;
+            if (got < 0) {
+                if (error) *error = "Cannot read file: " + path;
+                ok = false;
+                finished = true;
+                break;
+            }
+            if (got > 0 && !sink(buffer.get() + slot * size_t(blockBytes), got)) {
+                ok = false;
+                finished = true;
+                break;
+            }
+            const qint64 expected = qMin(blockBytes, end - (offset + delivered * blockBytes));
+            ++delivered;
+            if (got < expected) {
+                // The file shrank while it was being read.
+                finished = true;
+                break;
+            }
+            if (nextBlock < blockCount) startBlock();
+        }
+    }
+    scheduler.drain();
+    return ok;
+}
+
+QString AsyncReader::backendName()
+{
+#ifdef ASYNCREADER_URING
+    static const bool uring = UringQueue::create(queueDepth) != nullptr;
+    if (uring) return "io_uring";
+#endif
+    return "threads";
+}
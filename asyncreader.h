@@ -0,0 +1,45 @@
+#ifndef ASYNCREADER_H
+#define ASYNCREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+struct ReadResult {
+    QString path;
+    QByteArray data;
+    QString error;
+};
+
+// Bulk file reads with many requests in flight, so scans of big files or of
+// many files keep the drive's queue full instead of waiting on one read at a
+// time. Linux uses io_uring through the raw system calls (no liburing
+// needed). Other systems, and kernels that refuse to create a ring, get a
+// small pool of threads issuing positioned reads.
+class AsyncReader
+{
+public:
+    static constexpr int queueDepth = 32;
+    static constexpr qint64 blockSize = 1024 * 1024;
+
+    // Gets consecutive blocks in file order; returning false stops the read.
+    typedef std::function<bool(const char *data, qint64 size)> BlockSink;
+
+    static QByteArray readFile(const QString &path, QString *error = nullptr);
+
+    // Whole files, all of them read together; results follow the order of
+    // paths. Files over maxFileSize (-1 for no limit) get an error instead.
+    static QVector<ReadResult> readFiles(const QStringList &paths, qint64 maxFileSize = -1);
+
+    // [offset, offset + length) of a file, length -1 meaning to the end. The
+    // following blocks are already being read while sink handles one.
+    static bool streamFile(const QString &path, qint64 offset, qint64 length, const BlockSink &sink,
+                           qint64 blockBytes = 4 * 1024 * 1024, QString *error = nullptr);
+
+    // "io_uring" or "threads".
+    static QString backendName();
+};
+
+#endif
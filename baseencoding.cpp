@@ -0,0 +1,454 @@
+#include "baseencoding.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BASEENCODING_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef decltype(QByteArray().size()) ByteCount;
+
+// The same limit as the text converters: the longest QByteArray, leaving
+// room for the container header.
+bool fitsResult(qint64 size, QString *error)
+{
+    if (size <= qint64(std::numeric_limits<ByteCount>::max()) - 64) return true;
+    if (error) *error = QString("Output of %1 bytes is too large to hold in memory; convert in chunks instead.").arg(size);
+    return false;
+}
+
+const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char kBase64UrlAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+const char kBase32Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+// Character value per byte for each decoder, -1 for bytes it skips.
+struct DecodeTables {
+    signed char base64[256];
+    signed char base32[256];
+    signed char ascii85[256];
+
+    DecodeTables() {
+        std::memset(base64, -1, sizeof(base64));
+        std::memset(base32, -1, sizeof(base32));
+        std::memset(ascii85, -1, sizeof(ascii85));
+        for (int i = 0; i < 64; ++i) {
+            base64[uchar(kBase64Alphabet[i])] = char(i);
+            base64[uchar(kBase64UrlAlphabet[i])] = char(i);
+        }
+        for (int i = 0; i < 32; ++i) {
+            base32[uchar(kBase32Alphabet[i])] = char(i);
+            base32[uchar(kBase32Alphabet[i] | 0x20)] = char(i);
+        }
+        for (int i = 0; i < 85; ++i) ascii85['!' + i] = char(i);
+    }
+};
+
+const DecodeTables decodeTables;
+
+#ifdef BASEENCODING_X86
+
+bool hasSsse3()
+{
+    static const bool ssse3 = []() {
+        unsigned a = 0, b = 0, c = 0, d = 0;
+        return __get_cpuid(1, &a, &b, &c, &d) && (c & (1u << 9));
+    }();
+    return ssse3;
+}
+
+// Wojciech Muła's SSSE3 encoder: each 32-bit lane gets three input bytes,
+// the multiplies move the four 6-bit fields into separate bytes, and a
+// 16-entry shuffle table turns the 0-63 values into the alphabet. Reads 16
+// bytes for every 12 it encodes, so at least 16 must be readable.
+__attribute__((target("ssse3")))
+qint64 encodeBase64Ssse3(const uchar *in, qint64 size, char *out, bool urlSafe)
+{
+    const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i maskAc = _mm_set1_epi32(0x0FC0FC00);
+    const __m128i shiftAc = _mm_set1_epi32(0x04000040);
+    const __m128i maskBd = _mm_set1_epi32(0x003F03F0);
+    const __m128i shiftBd = _mm_set1_epi32(0x01000010);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          char((urlSafe ? '-' : '+') - 62), char((urlSafe ? '_' : '/') - 63),
+                                          'A', 0, 0);
+    qint64 done = 0;
+    for (; size - done >= 16; done += 12) {
+        const __m128i bytes = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done)), spread);
+        const __m128i ac = _mm_mulhi_epu16(_mm_and_si128(bytes, maskAc), shiftAc);
+        const __m128i bd = _mm_mullo_epi16(_mm_and_si128(bytes, maskBd), shiftBd);
+        const __m128i values = _mm_or_si128(ac, bd);
+
+        // 0-25 -> 13, 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, 63 -> 12.
+        __m128i slot = _mm_subs_epu8(values, _mm_set1_epi8(51));
+        slot = _mm_or_si128(slot, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), values), _mm_set1_epi8(13)));
+        const __m128i chars = _mm_add_epi8(values, _mm_shuffle_epi8(offsets, slot));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + done / 3 * 4), chars);
+    }
+    return done;
+}
+
+// Decodes whole blocks of 16 characters while every one of them is in the
+// alphabet (either Base64 variant); returns the characters consumed. A block
+// with anything else (a line break, padding) is left to the scalar loop.
+// Writes 16 bytes for every 12 it decodes.
+__attribute__((target("ssse3")))
+qint64 decodeBase64Ssse3(const uchar *in, qint64 size, uchar *out)
+{
+    const auto inRange = [](__m128i v, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(char(lo - 1))),
+                             _mm_cmplt_epi8(v, _mm_set1_epi8(char(hi + 1))));
+    };
+    const auto select = [](__m128i mask, __m128i a, __m128i b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    };
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    qint64 done = 0;
+    for (; size - done >= 16; done += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done));
+        const __m128i upper = inRange(v, 'A', 'Z');
+        const __m128i lower = inRange(v, 'a', 'z');
+        const __m128i digit = inRange(v, '0', '9');
+        const __m128i plus = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')), _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+        const __m128i slash = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+        if (_mm_movemask_epi8(valid) != 0xFFFF) break;
+
+        __m128i shift = select(upper, _mm_set1_epi8(-'A'), _mm_set1_epi8(char(26 - 'a')));
+        shift = select(digit, _mm_set1_epi8(char(52 - '0')), shift);
+        __m128i values = _mm_add_epi8(v, shift);
+        values = select(plus, _mm_set1_epi8(62), values);
+        values = select(slash, _mm_set1_epi8(63), values);
+
+        // [a b c d] -> (a << 6 | b, c << 6 | d) -> a << 18 | b << 12 | c << 6 | d.
+        const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        const __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + done / 4 * 3), _mm_shuffle_epi8(words, pack));
+    }
+    return done;
+}
+
+#endif
+
+// Encodes whole groups; size must be a multiple of the group size.
+char *encodeGroups(const uchar *in, qint64 size, char *out, BaseEncoding::Kind kind)
+{
+    switch (kind) {
+    case BaseEncoding::Base64:
+    case BaseEncoding::Base64Url: {
+        const bool urlSafe = kind == BaseEncoding::Base64Url;
+        const char *alphabet = urlSafe ? kBase64UrlAlphabet : kBase64Alphabet;
+        qint64 i = 0;
+#ifdef BASEENCODING_X86
+        if (hasSsse3()) {
+            i = encodeBase64Ssse3(in, size, out, urlSafe);
+            out += i / 3 * 4;
+        }
+#endif
+        for (; i < size; i += 3) {
+            const quint32 v = quint32(in[i]) << 16 | quint32(in[i + 1]) << 8 | in[i + 2];
+            *out++ = alphabet[v >> 18];
+            *out++ = alphabet[(v >> 12) & 0x3F];
+            *out++ = alphabet[(v >> 6) & 0x3F];
+            *out++ = alphabet[v & 0x3F];
+        }
+        return out;
+    }
+    case BaseEncoding::Base32:
+        for (qint64 i = 0; i < size; i += 5) {
+            const quint64 v = quint64(in[i]) << 32 | quint64(in[i + 1]) << 24 | quint64(in[i + 2]) << 16
+                              | quint64(in[i + 3]) << 8 | in[i + 4];
+            for (int shift = 35; shift >= 0; shift -= 5) *out++ = kBase32Alphabet[(v >> shift) & 0x1F];
+        }
+        return out;
+    case BaseEncoding::Ascii85:
+        for (qint64 i = 0; i < size; i += 4) {
+            quint32 v = quint32(in[i]) << 24 | quint32(in[i + 1]) << 16 | quint32(in[i + 2]) << 8 | in[i + 3];
+            for (int k = 4; k >= 0; --k) {
+                out[k] = char('!' + v % 85);
+                v /= 85;
+            }
+            out += 5;
+        }
+        return out;
+    }
+    return out;
+}
+
+// Encodes the last, short group (size below the group size).
+char *encodeTail(const uchar *in, int size, char *out, BaseEncoding::Kind kind)
+{
+    if (size == 0) return out;
+    const int group = BaseEncoding::groupBytes(kind);
+    uchar padded[5] = {};
+    std::memcpy(padded, in, size_t(size));
+    char chars[8];
+    encodeGroups(padded, group, chars, kind);
+
+    if (kind == BaseEncoding::Ascii85) {
+        std::memcpy(out, chars, size_t(size + 1));
+        return out + size + 1;
+    }
+    const int bitsPerChar = kind == BaseEncoding::Base32 ? 5 : 6;
+    const int used = (size * 8 + bitsPerChar - 1) / bitsPerChar;
+    const int total = BaseEncoding::groupChars(kind);
+    std::memcpy(out, chars, size_t(used));
+    std::memset(out + used, '=', size_t(total - used));
+    return out + total;
+}
+
+}
+
+bool BaseEncoding::parseKind(const QString &name, Kind *kind)
+{
+    const QString key = name.trimmed().toLower();
+    if (key == "base64") *kind = Base64;
+    else if (key == "base64url") *kind = Base64Url;
+    else if (key == "base32") *kind = Base32;
+    else if (key == "ascii85" || key == "base85") *kind = Ascii85;
+    else return false;
+    return true;
+}
+
+QString BaseEncoding::kindName(Kind kind)
+{
+    switch (kind) {
+    case Base64: return "base64";
+    case Base64Url: return "base64url";
+    case Base32: return "base32";
+    case Ascii85: return "ascii85";
+    }
+    return QString();
+}
+
+int BaseEncoding::groupBytes(Kind kind)
+{
+    return kind == Base32 ? 5 : kind == Ascii85 ? 4 : 3;
+}
+
+int BaseEncoding::groupChars(Kind kind)
+{
+    return kind == Base32 ? 8 : kind == Ascii85 ? 5 : 4;
+}
+
+qint64 BaseEncoding::encodedSize(qint64 size, Kind kind)
+{
+    const qint64 group = groupBytes(kind);
+    const qint64 rest = size % group;
+    if (kind == Ascii85) return size / group * 5 + (rest ? rest + 1 : 0);
+    return (size + group - 1) / group * groupChars(kind);
+}
+
+qint64 BaseEncoding::charOffset(qint64 byteOffset, Kind kind, bool roundUp)
+{
+    const qint64 group = groupBytes(kind);
+    const qint64 chars = groupChars(kind);
+    const qint64 rest = byteOffset % group;
+    return byteOffset / group * chars + (rest * chars + (roundUp ? group - 1 : 0)) / group;
+}
+
+qint64 BaseEncoding::byteOffset(qint64 charOffset, Kind kind)
+{
+    const qint64 chars = groupChars(kind);
+    return charOffset / chars * groupBytes(kind) + charOffset % chars * groupBytes(kind) / chars;
+}
+
+QByteArray BaseEncoding::encode(const QByteArray &data, Kind kind, QString *error)
+{
+    TRACE_SCOPE("BaseEncoding::encode");
+    const qint64 size = encodedSize(data.size(), kind);
+    if (!fitsResult(size, error)) return QByteArray();
+    QByteArray result(ByteCount(size), Qt::Uninitialized);
+    const uchar *in = reinterpret_cast<const uchar *>(data.constData());
+    const qint64 whole = data.size() / groupBytes(kind) * groupBytes(kind);
+    char *out = encodeGroups(in, whole, result.data(), kind);
+    encodeTail(in + whole, int(data.size() - whole), out, kind);
+    return result;
+}
+
+QByteArray BaseEncoding::decode(const QByteArray &text, Kind kind, QString *error)
+{
+    TRACE_SCOPE("BaseEncoding::decode");
+    // A refused feed leaves the decoder empty, so finish() adds nothing.
+    BaseDecoder decoder(kind);
+    QByteArray result = decoder.feed(text.constData(), text.size(), error);
+    result += decoder.finish();
+    return result;
+}
+
+BaseEncoder::BaseEncoder(BaseEncoding::Kind kind) : kind(kind) {}
+
+QByteArray BaseEncoder::feed(const char *data, qint64 size, QString *error)
+{
+    const int group = BaseEncoding::groupBytes(kind);
+    const qint64 capacity = BaseEncoding::encodedSize(carry.size() + size, kind);
+    if (!fitsResult(capacity, error)) return QByteArray();
+    QByteArray result;
+    result.reserve(ByteCount(capacity));
+
+    // Complete the group left over from the previous chunk first.
+    if (!carry.isEmpty()) {
+        const qint64 take = qMin<qint64>(group - carry.size(), size);
+        carry.append(data, int(take));
+        data += take;
+        size -= take;
+        if (carry.size() < group) return result;
+        result.resize(BaseEncoding::groupChars(kind));
+        encodeGroups(reinterpret_cast<const uchar *>(carry.constData()), group, result.data(), kind);
+        carry.clear();
+    }
+
+    const qint64 whole = size / group * group;
+    const ByteCount start = result.size();
+    result.resize(start + ByteCount(whole / group * BaseEncoding::groupChars(kind)));
+    encodeGroups(reinterpret_cast<const uchar *>(data), whole, result.data() + start, kind);
+    carry = QByteArray(data + whole, int(size - whole));
+    return result;
+}
+
+QByteArray BaseEncoder::finish()
+{
+    QByteArray result(int(BaseEncoding::encodedSize(carry.size(), kind)), Qt::Uninitialized);
+    encodeTail(reinterpret_cast<const uchar *>(carry.constData()), carry.size(), result.data(), kind);
+    carry.clear();
+    return result;
+}
+
+BaseDecoder::BaseDecoder(BaseEncoding::Kind kind) : kind(kind) {}
+
+QByteArray BaseDecoder::feed(const char *text, qint64 size, QString *error)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(text);
+    const uchar *end = p + size;
+    // Only Ascii85 can grow, four bytes for every 'z'; the slack covers the
+    // SIMD path writing 16 bytes for 12.
+    const qint64 zeros = kind == BaseEncoding::Ascii85 ? std::count(p, end, uchar('z')) : 0;
+    const qint64 capacity = size + zeros * 3 + 16;
+    if (!fitsResult(capacity, error)) return QByteArray();
+    QByteArray result(ByteCount(capacity), Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(result.data());
+
+    switch (kind) {
+    case BaseEncoding::Base64:
+    case BaseEncoding::Base64Url:
+        while (p < end) {
+#ifdef BASEENCODING_X86
+            if (count == 0 && end - p >= 16 && hasSsse3()) {
+                const qint64 used = decodeBase64Ssse3(p, end - p, out);
+                p += used;
+                out += used / 4 * 3;
+                if (p == end) break;
+            }
+#endif
+            const int v = decodeTables.base64[*p++];
+            if (v < 0) continue;
+            value = value << 6 | quint64(v);
+            if (++count == 4) {
+                *out++ = uchar(value >> 16);
+                *out++ = uchar(value >> 8);
+                *out++ = uchar(value);
+                value = 0;
+                count = 0;
+            }
+        }
+        break;
+    case BaseEncoding::Base32:
+        while (p < end) {
+            const int v = decodeTables.base32[*p++];
+            if (v < 0) continue;
+            value = value << 5 | quint64(v);
+            if (++count == 8) {
+                for (int shift = 32; shift >= 0; shift -= 8) *out++ = uchar(value >> shift);
+                value = 0;
+                count = 0;
+            }
+        }
+        break;
+    case BaseEncoding::Ascii85:
+        while (p < end && !ended) {
+            uchar c = *p++;
+            if (heldAngle) {
+                heldAngle = false;
+                if (c == '~') continue;
+                --p;
+                c = '<';
+            } else if (!started) {
+                if (c == ' ' || (c >= '\t' && c <= '\r')) continue;
+                started = true;
+                if (c == '<') {
+                    heldAngle = true;
+                    continue;
+                }
+            }
+            if (c == '~') {
+                ended = true;
+                break;
+            }
+            if (c == 'z' && count == 0) {
+                std::memset(out, 0, 4);
+                out += 4;
+                continue;
+            }
+            const int v = decodeTables.ascii85[c];
+            if (v < 0) continue;
+            value = value * 85 + quint64(v);
+            if (++count == 5) {
+                for (int shift = 24; shift >= 0; shift -= 8) *out++ = uchar(value >> shift);
+                value = 0;
+                count = 0;
+            }
+        }
+        break;
+    }
+
+    result.truncate(ByteCount(out - reinterpret_cast<uchar *>(result.data())));
+    return result;
+}
+
+QByteArray BaseDecoder::finish()
+{
+    QByteArray result;
+    if (kind == BaseEncoding::Ascii85 && heldAngle) {
+        // A lone '<' at the very end is data after all.
+        heldAngle = false;
+        result = feed("<", 1);
+    }
+
+    // A short group carries whole bytes for every 8 bits; the rest is padding.
+    int bytes = 0;
+    quint64 bits = 0;
+    switch (kind) {
+    case BaseEncoding::Base64:
+    case BaseEncoding::Base64Url:
+        bytes = count * 6 / 8;
+        bits = value << (6 * (4 - count));
+        for (int i = 0; i < bytes; ++i) result += char(bits >> (16 - 8 * i));
+        break;
+    case BaseEncoding::Base32:
+        bytes = count * 5 / 8;
+        bits = value << (5 * (8 - count));
+        for (int i = 0; i < bytes; ++i) result += char(bits >> (32 - 8 * i));
+        break;
+    case BaseEncoding::Ascii85:
+        if (count >= 2) {
+            // Padded with the highest digit, as the encoder padded with zeros.
+            bits = value;
+            for (int i = count; i < 5; ++i) bits = bits * 85 + 84;
+            for (int i = 0; i < count - 1; ++i) result += char(bits >> (24 - 8 * i));
+        }
+        break;
+    }
+
+    value = 0;
+    count = 0;
+    started = false;
+    ended = false;
+    return result;
+}
@@ -0,0 +1,76 @@
+#ifndef BASEENCODING_H
+#define BASEENCODING_H
+
+#include <QByteArray>
+#include <QString>
+
+// Base64 (RFC 4648, standard or URL-safe alphabet), Base32 (RFC 4648) and
+// Ascii85 (btoa / PostScript). Base64 and Base32 are padded with '='.
+// Ascii85 is written without the <~ ~> delimiters and without the 'z'
+// shorthand, so a group of bytes is always the same number of characters and
+// offsets convert both ways. Decoders skip anything outside the alphabet
+// (whitespace, line breaks, padding), take either Base64 alphabet, lowercase
+// Base32, and the <~ ~> and 'z' forms of Ascii85. Base64 is encoded and
+// decoded 12 bytes / 16 characters at a time with SSSE3 when the CPU has it.
+// Functions that take an error set it and return nothing when the result
+// would not fit in one QByteArray.
+class BaseEncoding
+{
+public:
+    enum Kind { Base64, Base64Url, Base32, Ascii85 };
+
+    // "base64", "base64url", "base32" or "ascii85".
+    static bool parseKind(const QString &name, Kind *kind);
+    static QString kindName(Kind kind);
+
+    static QByteArray encode(const QByteArray &data, Kind kind, QString *error = nullptr);
+    static QByteArray decode(const QByteArray &text, Kind kind, QString *error = nullptr);
+    static qint64 encodedSize(qint64 size, Kind kind);
+
+    // Bytes in a group and the characters they encode to: 3/4, 5/8 or 4/5.
+    static int groupBytes(Kind kind);
+    static int groupChars(Kind kind);
+    // Offset of the first character holding bits of the byte at byteOffset;
+    // with roundUp, the end of the characters covering the bytes before it.
+    static qint64 charOffset(qint64 byteOffset, Kind kind, bool roundUp = false);
+    // The first byte the character at charOffset holds bits of.
+    static qint64 byteOffset(qint64 charOffset, Kind kind);
+};
+
+// Encodes input fed in pieces of any size; bytes short of a group wait for
+// the next feed() or finish().
+class BaseEncoder
+{
+public:
+    explicit BaseEncoder(BaseEncoding::Kind kind);
+
+    QByteArray feed(const char *data, qint64 size, QString *error = nullptr);
+    QByteArray finish();
+
+private:
+    BaseEncoding::Kind kind;
+    QByteArray carry;
+};
+
+// Decodes input fed in pieces of any size; the characters of an unfinished
+// group are kept as bits, so nothing is rescanned.
+class BaseDecoder
+{
+public:
+    explicit BaseDecoder(BaseEncoding::Kind kind);
+
+    QByteArray feed(const char *text, qint64 size, QString *error = nullptr);
+    QByteArray finish();
+
+private:
+    BaseEncoding::Kind kind;
+    quint64 value = 0;
+    int count = 0;
+    // Ascii85: whether a leading "<~" was looked for, a '<' that may start
+    // it, and whether "~>" ended the data.
+    bool started = false;
+    bool heldAngle = false;
+    bool ended = false;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "batchconverter.h"
+#include "runnabletask.h"
+#include "streamconverter.h"
+#include "trace.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+
+namespace {
+
+constexpr qint64 kChunkSize = 1 << 20;
+
+}
+
+BatchConverter::BatchConverter(const QString &to, const QString &from)
+    : to(to), from(from)
+{
+}
+
+void BatchConverter::setMaxJobs(int jobs)
+{
+    maxJobs = jobs;
+}
+
+QVector<BatchResult> BatchConverter::run(const QVector<BatchJob> &jobs) const
+{
+    QVector<BatchResult> results(jobs.size());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(maxJobs > 0 ? maxJobs : QThread::idealThreadCount());
+    for (int i = 0; i < jobs.size(); ++i) {
+        // Each task owns its own result slot, so no locking is needed.
+        BatchResult *slot = &results[i];
+        const BatchJob job = jobs.at(i);
+        pool.start(new RunnableTask([this, slot, job]() { *slot = convertFile(job); }));
+    }
+    pool.waitForDone();
+
+    return results;
+}
+
+BatchResult BatchConverter::convertFile(const BatchJob &job) const
+{
+    TRACE_SCOPE("BatchConverter::convertFile");
+    BatchResult result;
+    result.inputPath = job.inputPath;
+    result.outputPath = job.outputPath;
+
+    StreamConverter converter(to, from);
+    if (!converter.isValid()) {
+        result.error = "Unsupported conversion target: " + to;
+        return result;
+    }
+
+    QFile input(job.inputPath);
+    if (!input.open(QIODevice::ReadOnly)) {
+        result.error = "Cannot open input file";
+        return result;
+    }
+
+    QDir().mkpath(QFileInfo(job.outputPath).absolutePath());
+    QFile output(job.outputPath);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        result.error = "Cannot write output file";
+        return result;
+    }
+
+    while (!input.atEnd()) {
+        const QByteArray chunk = input.read(kChunkSize);
+        if (chunk.isEmpty() && input.error() != QFileDevice::NoError) {
+            result.error = "Read error: " + input.errorString();
+            return result;
+        }
+        result.bytesIn += chunk.size();
+
+        const QByteArray converted = converter.feed(chunk);
+        if (!converter.errorString().isEmpty()) {
+            result.error = converter.errorString();
+            return result;
+        }
+        if (output.write(converted) != converted.size()) {
+            result.error = "Write error: " + output.errorString();
+            return result;
+        }
+        result.bytesOut += converted.size();
+    }
+
+    const QByteArray rest = converter.finish();
+    if (!converter.errorString().isEmpty()) {
+        result.error = converter.errorString();
+        return result;
+    }
+    if (output.write(rest) != rest.size()) {
+        result.error = "Write error: " + output.errorString();
+        return result;
+    }
+    result.bytesOut += rest.size();
+    result.ok = true;
+    return result;
+}
+
+QStringList BatchConverter::collectInputs(const QStringList &files, const QStringList &dirs,
+                                          const QString &listFile, bool recursive, QStringList *subdirs,
+                                          QString *error)
+{
+    QStringList inputs = files;
+    QStringList found;
+
+    for (const QString &dir : dirs) {
+        if (!QFileInfo(dir).isDir()) {
+            if (error) *error = "Not a directory: " + dir;
+            return {};
+        }
+
+        const QDir root(dir);
+        QStringList inDir;
+        QDirIterator it(dir, QDir::Files | QDir::NoDotAndDotDot,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext()) {
+            inDir << it.next();
+        }
+        inDir.sort();
+        for (const QString &path : inDir) {
+            const QString subdir = QFileInfo(root.relativeFilePath(path)).path();
+            found << (subdir == "." ? QString() : subdir);
+        }
+        inputs << inDir;
+    }
+
+    if (!listFile.isEmpty()) {
+        QFile list(listFile);
+        if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            if (error) *error = "Cannot open input list: " + listFile;
+            return {};
+        }
+
+        while (!list.atEnd()) {
+            const QString line = QString::fromUtf8(list.readLine()).trimmed();
+            if (!line.isEmpty() && !line.startsWith('#')) {
+                inputs << line;
+                found << QString();
+            }
+        }
+    }
+
+    if (subdirs) {
+        // Files named directly come first and keep no subdirectory.
+        subdirs->clear();
+        for (int i = 0; i < files.size(); ++i) {
+            subdirs->append(QString());
+        }
+        subdirs->append(found);
+    }
+    return inputs;
+}
+
+QString BatchConverter::outputPathFor(const QString &outputTemplate, const QString &outputDir,
+                                      const QString &inputPath, const QString &subdir, const QString &to,
+                                      int index)
+{
+    const QFileInfo info(inputPath);
+    QString path = outputTemplate.isEmpty() ? QString("{file}.{to}") : outputTemplate;
+    path.replace("{file}", info.fileName());
+    path.replace("{name}", info.completeBaseName());
+    path.replace("{ext}", info.suffix());
+    path.replace("{dir}", info.path());
+    path.replace("{to}", to);
+    path.replace("{index}", QString::number(index));
+
+    if (!outputDir.isEmpty() && QFileInfo(path).isRelative()) {
+        path = QDir(outputDir).filePath(subdir.isEmpty() ? path : subdir + '/' + path);
+    }
+    return path;
+}
+
+QString BatchConverter::duplicateOutput(const QVector<BatchJob> &jobs)
+{
+    QSet<QString> seen;
+    for (const BatchJob &job : jobs) {
+        const QString path = QDir::cleanPath(QFileInfo(job.outputPath).absoluteFilePath());
+        if (seen.contains(path)) return job.outputPath;
+        seen.insert(path);
+    }
+    return QString();
+}
@@ -0,0 +1,53 @@
+#ifndef BATCHCONVERTER_H
+#define BATCHCONVERTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct BatchJob {
+    QString inputPath;
+    QString outputPath;
+};
+
+struct BatchResult {
+    QString inputPath;
+    QString outputPath;
+    bool ok = false;
+    QString error;
+    qint64 bytesIn = 0;
+    qint64 bytesOut = 0;
+};
+
+// Runs StreamConverter over many files on a bounded thread pool. Every file is
+// read and written in fixed size chunks, so memory stays at roughly
+// jobs * chunk size regardless of how large the inputs are.
+class BatchConverter
+{
+public:
+    BatchConverter(const QString &to, const QString &from);
+
+    void setMaxJobs(int jobs);
+    QVector<BatchResult> run(const QVector<BatchJob> &jobs) const;
+
+    // subdirs gets, per input, the directory it was found in relative to the
+    // --input-dir it came from ("" for files named directly), so outputs
+    // under an output directory keep the tree they were read from.
+    static QStringList collectInputs(const QStringList &files, const QStringList &dirs,
+                                     const QString &listFile, bool recursive, QStringList *subdirs,
+                                     QString *error);
+    static QString outputPathFor(const QString &outputTemplate, const QString &outputDir,
+                                 const QString &inputPath, const QString &subdir, const QString &to,
+                                 int index);
+    // The first output path more than one job would write, or "" if none.
+    static QString duplicateOutput(const QVector<BatchJob> &jobs);
+
+private:
+    BatchResult convertFile(const BatchJob &job) const;
+
+    QString to;
+    QString from;
+    int maxJobs = 0;
+};
+
+#endif
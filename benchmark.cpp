@@ -0,0 +1,428 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <new>
+#include "codeeditor.h"
+#include "textanalyzer.h"
+#include "textconverter.h"
+
+namespace {
+
+std::atomic<qint64> heapAllocations{0};
+
+}
+
+// Counts heap allocations so each case can report how many one iteration
+// makes. With glibc the executable's malloc, calloc and realloc replace the C
+// library's for Qt too, so implicitly shared containers and operator new are
+// both counted; elsewhere only operator new is.
+#if defined(__GLIBC__)
+extern "C" {
+
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *p, std::size_t size);
+
+void *malloc(std::size_t size) noexcept
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size) noexcept
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, std::size_t size) noexcept
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+}
+#else
+void *operator new(std::size_t size)
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+namespace {
+
+struct BenchResult {
+    QString name;
+    qint64 inputBytes = 0;
+    int iterations = 0;
+    double minMs = 0;
+    double medianMs = 0;
+    double p95Ms = 0;
+    double meanMs = 0;
+    double mbPerSec = 0;
+    double allocations = 0;
+};
+
+struct BenchConfig {
+    QVector<qint64> sizes;
+    qint64 maxEditorSize = 4 * 1024 * 1024;
+    double minTimeMs = 200;
+    int maxIterations = 1000;
+    QString filter;
+};
+
+qint64 parseSize(const QString &value, bool *ok)
+{
+    QString v = value.trimmed().toUpper();
+    qint64 multiplier = 1;
+    if (v.endsWith("B")) v.chop(1);
+    if (v.endsWith("K")) { multiplier = 1024; v.chop(1); }
+    else if (v.endsWith("M")) { multiplier = 1024 * 1024; v.chop(1); }
+    else if (v.endsWith("G")) { multiplier = 1024LL * 1024 * 1024; v.chop(1); }
+
+    const qint64 n = v.toLongLong(ok);
+    return n * multiplier;
+}
+
+QString formatSize(qint64 bytes)
+{
+    if (bytes >= 1024LL * 1024 * 1024 && bytes % (1024LL * 1024 * 1024) == 0)
+        return QString("%1G").arg(bytes / (1024LL * 1024 * 1024));
+    if (bytes >= 1024 * 1024 && bytes % (1024 * 1024) == 0)
+        return QString("%1M").arg(bytes / (1024 * 1024));
+    if (bytes >= 1024 && bytes % 1024 == 0)
+        return QString("%1K").arg(bytes / 1024);
+    return QString::number(bytes);
+}
+
+// Mostly printable ASCII with a sprinkling of Persian letters, so the
+// converters see multi-byte UTF-8 the way they do on real files.
+QString makeText(qint64 utf8Bytes, quint32 seed)
+{
+    static const char16_t persian[] = { 0x0628, 0x06CC, 0x06A9, 0x0647, 0x0627, 0x0633 };
+    QRandomGenerator rng(seed);
+
+    QString text;
+    text.reserve(static_cast<int>(qMin<qint64>(utf8Bytes, INT_MAX / 2)));
+    qint64 produced = 0;
+    while (produced < utf8Bytes) {
+        const quint32 r = rng.bounded(100);
+        if (r < 4 && produced + 2 <= utf8Bytes) {
+            text += QChar(persian[rng.bounded(6)]);
+            produced += 2;
+        } else if (r < 8) {
+            text += QLatin1Char(r < 6 ? ' ' : '\n');
+            ++produced;
+        } else {
+            text += QLatin1Char(static_cast<char>('!' + rng.bounded(94)));
+            ++produced;
+        }
+    }
+    return text;
+}
+
+BenchResult runCase(const QString &name, qint64 inputBytes, const BenchConfig &config,
+                    const std::function<void()> &body)
+{
+    body();
+
+    QVector<double> samples;
+    const qint64 allocationsBefore = heapAllocations.load(std::memory_order_relaxed);
+    QElapsedTimer total;
+    total.start();
+    while (samples.size() < config.maxIterations
+           && (samples.isEmpty() || total.nsecsElapsed() / 1e6 < config.minTimeMs)) {
+        QElapsedTimer t;
+        t.start();
+        body();
+        samples.append(t.nsecsElapsed() / 1e6);
+    }
+    const qint64 allocations = heapAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double s : qAsConst(samples)) sum += s;
+
+    BenchResult r;
+    r.name = name;
+    r.inputBytes = inputBytes;
+    r.iterations = samples.size();
+    r.minMs = samples.first();
+    r.medianMs = samples.at(samples.size() / 2);
+    r.p95Ms = samples.at(qMin(samples.size() - 1, (samples.size() * 95) / 100));
+    r.meanMs = sum / samples.size();
+    r.mbPerSec = r.medianMs > 0 ? (inputBytes / (1024.0 * 1024.0)) / (r.medianMs / 1000.0) : 0;
+    r.allocations = double(allocations) / samples.size();
+    return r;
+}
+
+bool selected(const BenchConfig &config, const QString &name)
+{
+    return config.filter.isEmpty() || name.contains(config.filter, Qt::CaseInsensitive);
+}
+
+// Largest --sizes value: toBinary turns every UTF-8 byte into nine
+// characters, the most any case produces, and that has to fit in one QString.
+qint64 maxBenchSize()
+{
+    typedef decltype(QString().size()) CharCount;
+    return (qint64(std::numeric_limits<CharCount>::max()) / 2 - 64) / 9;
+}
+
+void runSize(qint64 size, const BenchConfig &config, QVector<BenchResult> &results, QTextStream &err)
+{
+    const QString suffix = "/" + formatSize(size);
+    const QStringList names = { "toHex", "fromHex", "toBinary", "fromBinary", "toUnicode", "fromUnicode",
+                                "detectType.text", "detectType.hex", "search.text", "search.hex",
+                                "keystrokeToSync.hex" };
+    auto wanted = [&](const QString &name) { return selected(config, name + suffix); };
+    if (std::none_of(names.begin(), names.end(), wanted)) return;
+
+    // Each converted input is built only for the cases that read it and is
+    // freed before the next one, so at most one of them is alive at a time.
+    const QString text = makeText(size, static_cast<quint32>(size));
+    volatile int sink = 0;
+
+    auto add = [&](const QString &name, qint64 bytes, const std::function<void()> &body) {
+        const QString fullName = name + suffix;
+        if (!selected(config, fullName)) return;
+        err << "running " << fullName << Qt::endl;
+        results.append(runCase(fullName, bytes, config, body));
+    };
+
+    add("toHex", size, [&]() { sink = sink + TextConverter::toHex(text, 1).size(); });
+    add("toBinary", size, [&]() { sink = sink + TextConverter::toBinary(text).size(); });
+    add("toUnicode", size, [&]() { sink = sink + TextConverter::toUnicode(text).size(); });
+    add("detectType.text", size, [&]() { sink = sink + TextAnalyzer::detectType(text); });
+
+    if (wanted("fromHex") || wanted("detectType.hex")) {
+        const QString hex = TextConverter::toHex(text, 1);
+        add("fromHex", hex.size(), [&]() { sink = sink + TextConverter::fromHex(hex).size(); });
+        add("detectType.hex", hex.size(), [&]() { sink = sink + TextAnalyzer::detectType(hex); });
+    }
+    if (wanted("fromBinary")) {
+        const QString binary = TextConverter::toBinary(text);
+        add("fromBinary", binary.size(), [&]() { sink = sink + TextConverter::fromBinary(binary).size(); });
+    }
+    if (wanted("fromUnicode")) {
+        const QString unicode = TextConverter::toUnicode(text);
+        add("fromUnicode", unicode.size(), [&]() { sink = sink + TextConverter::fromUnicode(unicode).size(); });
+    }
+
+    if (size > config.maxEditorSize) {
+        return;
+    }
+
+    const QString query = text.mid(text.size() / 2, 4);
+
+    CodeEditor editor;
+    editor.setPlainText(text);
+    add("search.text", size, [&]() {
+        editor.setSearchText(query);
+        sink = sink + editor.searchMatchCount();
+        editor.setSearchText(QString());
+    });
+
+    const QString hex = TextConverter::toHex(text, 1);
+    CodeEditor hexEditor;
+    hexEditor.setByteGroupingMode(CodeEditor::GroupingHex);
+    hexEditor.setPlainText(hex);
+    const QString hexQuery = TextConverter::toHex(query, 1);
+    add("search.hex", hex.size(), [&]() {
+        hexEditor.setSearchText(hexQuery);
+        sink = sink + hexEditor.searchMatchCount();
+        hexEditor.setSearchText(QString());
+    });
+
+    // Mirrors Home::syncTextEditors for a single keystroke in the text pane:
+    // the edit, the full-text conversion and the relayout of the hex pane.
+    add("keystrokeToSync.hex", size, [&]() {
+        QTextCursor cursor = editor.textCursor();
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText("x");
+        hexEditor.setPlainText(TextConverter::toHex(editor.toPlainText(), 1));
+        cursor.deletePreviousChar();
+    });
+}
+
+QByteArray toJson(const QVector<BenchResult> &results)
+{
+    QJsonArray rows;
+    for (const BenchResult &r : results) {
+        QJsonObject row;
+        row["name"] = r.name;
+        row["inputBytes"] = r.inputBytes;
+        row["iterations"] = r.iterations;
+        row["minMs"] = r.minMs;
+        row["medianMs"] = r.medianMs;
+        row["p95Ms"] = r.p95Ms;
+        row["meanMs"] = r.meanMs;
+        row["mbPerSec"] = r.mbPerSec;
+        row["allocations"] = r.allocations;
+        rows.append(row);
+    }
+
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["qtVersion"] = QString(qVersion());
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["threads"] = QThread::idealThreadCount();
+    root["results"] = rows;
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+QByteArray toCsv(const QVector<BenchResult> &results)
+{
+    QByteArray csv = "name,inputBytes,iterations,minMs,medianMs,p95Ms,meanMs,mbPerSec,allocations\n";
+    for (const BenchResult &r : results) {
+        csv += QString("%1,%2,%3,%4,%5,%6,%7,%8,%9\n")
+                   .arg(r.name)
+                   .arg(r.inputBytes)
+                   .arg(r.iterations)
+                   .arg(r.minMs, 0, 'f', 4)
+                   .arg(r.medianMs, 0, 'f', 4)
+                   .arg(r.p95Ms, 0, 'f', 4)
+                   .arg(r.meanMs, 0, 'f', 4)
+                   .arg(r.mbPerSec, 0, 'f', 2)
+                   .arg(r.allocations, 0, 'f', 1)
+                   .toUtf8();
+    }
+    return csv;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Hex Editor microbenchmarks");
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption(
+        "sizes",
+        "Comma separated input sizes, e.g. 1K,64K,1M,16M,64M.",
+        "list",
+        "1K,64K,1M,16M");
+    QCommandLineOption editorSizeOption(
+        "max-editor-size",
+        "Largest input fed to CodeEditor based cases (search, keystroke sync).",
+        "size",
+        "4M");
+    QCommandLineOption minTimeOption(
+        "min-time",
+        "Minimum measuring time per case in milliseconds.",
+        "ms",
+        "200");
+    QCommandLineOption filterOption(
+        "filter",
+        "Only run cases whose name contains this text.",
+        "text");
+    QCommandLineOption formatOption(
+        "format",
+        "Output format: json | csv.",
+        "format",
+        "json");
+    QCommandLineOption outputOption(
+        "output",
+        "Write results to file instead of stdout.",
+        "path");
+
+    parser.addOption(sizesOption);
+    parser.addOption(editorSizeOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(filterOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    BenchConfig config;
+    for (const QString &s : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const qint64 size = parseSize(s, &ok);
+        if (!ok || size <= 0) {
+            err << "Invalid size: " << s << Qt::endl;
+            return 1;
+        }
+        if (size > maxBenchSize()) {
+            err << "Size " << s << " is too large: the converter outputs would not fit in one QString."
+                << " The largest size on this build is " << maxBenchSize() << " bytes." << Qt::endl;
+            return 1;
+        }
+        config.sizes.append(size);
+    }
+
+    bool ok = false;
+    config.maxEditorSize = parseSize(parser.value(editorSizeOption), &ok);
+    if (!ok) {
+        err << "Invalid --max-editor-size." << Qt::endl;
+        return 1;
+    }
+    config.minTimeMs = parser.value(minTimeOption).toDouble();
+    config.filter = parser.value(filterOption);
+
+    const QString format = parser.value(formatOption).trimmed().toLower();
+    if (format != "json" && format != "csv") {
+        err << "Unsupported --format: " << format << ". Use json or csv." << Qt::endl;
+        return 1;
+    }
+
+    QVector<BenchResult> results;
+    for (qint64 size : qAsConst(config.sizes)) {
+        runSize(size, config, results, err);
+    }
+
+    const QByteArray report = (format == "csv") ? toCsv(results) : toJson(results);
+    const QString outputPath = parser.value(outputOption);
+    if (outputPath.isEmpty()) {
+        out << report;
+        out.flush();
+        return 0;
+    }
+
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err << "Cannot write output file: " << outputPath << Qt::endl;
+        return 1;
+    }
+    file.write(report);
+    return 0;
+}
@@ -0,0 +1,388 @@
+#include "binarydiff.h"
+#include "trace.h"
+#include <QFile>
+#include <QThread>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr qint64 kChunkSize = 4 * 1024 * 1024;
+constexpr qint64 kSuffixStep = 64 * 1024;
+constexpr qint64 kMergeGap = 8;               // shorter equal runs do not split a range
+constexpr int kMinBlockSize = 32;
+constexpr qint64 kMaxIndexedBlocks = 8 * 1024 * 1024;
+constexpr int kFilterBits = 24;
+constexpr quint64 kHashBase = 0x100000001B3ULL;
+
+// Appends a range, folding it into the previous one when only a few equal
+// bytes separate them. Returns false once maxRanges is reached.
+bool appendRange(QVector<DiffRange> &ranges, const DiffRange &range)
+{
+    if (!ranges.isEmpty()) {
+        DiffRange &last = ranges.last();
+        const qint64 gapA = range.offsetA - (last.offsetA + last.lengthA);
+        const qint64 gapB = range.offsetB - (last.offsetB + last.lengthB);
+        if (gapA >= 0 && gapA == gapB && gapA < kMergeGap) {
+            last.lengthA = range.offsetA + range.lengthA - last.offsetA;
+            last.lengthB = range.offsetB + range.lengthB - last.offsetB;
+            return true;
+        }
+    }
+
+    if (ranges.size() >= BinaryDiff::maxRanges) return false;
+    ranges.append(range);
+    return true;
+}
+
+// Overwrites between a and b over [begin, end), both at the same offsets.
+bool diffAligned(const uchar *a, const uchar *b, qint64 begin, qint64 end, QVector<DiffRange> &out)
+{
+    qint64 i = begin;
+    while (i < end) {
+        i += BinaryDiff::mismatch(a + i, b + i, end - i);
+        if (i >= end) break;
+
+        qint64 j = i + 1;
+        while (j < end && a[j] != b[j]) ++j;
+        if (!appendRange(out, DiffRange{i, j - i, i, j - i})) return false;
+        i = j;
+    }
+    return true;
+}
+
+// Equal sizes: each worker compares a contiguous span, so the per-worker
+// lists concatenate in offset order.
+void compareAligned(const uchar *a, const uchar *b, qint64 size, DiffResult &result)
+{
+    const qint64 chunks = (size + kChunkSize - 1) / kChunkSize;
+    if (chunks == 0) return;
+
+    const int workers = int(qBound<qint64>(1, QThread::idealThreadCount(), chunks));
+    const qint64 chunksPerWorker = (chunks + workers - 1) / workers;
+    std::vector<QVector<DiffRange>> found(workers);
+    std::vector<char> complete(workers, 1);
+    std::vector<std::thread> threads;
+
+    for (int w = 0; w < workers; ++w) {
+        const qint64 begin = qMin(size, w * chunksPerWorker * kChunkSize);
+        const qint64 end = qMin(size, (w + 1) * chunksPerWorker * kChunkSize);
+        if (begin >= end) continue;
+        threads.emplace_back([&, w, begin, end]() {
+            complete[w] = diffAligned(a, b, begin, end, found[w]);
+        });
+    }
+    for (std::thread &t : threads) t.join();
+
+    for (int w = 0; w < workers; ++w) {
+        for (const DiffRange &range : found[w]) {
+            if (!appendRange(result.ranges, range)) {
+                result.truncated = true;
+                return;
+            }
+        }
+        if (!complete[w]) {
+            result.truncated = true;
+            return;
+        }
+    }
+}
+
+// Length of the common prefix. Workers claim chunks in order and stop
+// claiming once a mismatch before the next chunk is known.
+qint64 commonPrefix(const uchar *a, const uchar *b, qint64 size)
+{
+    std::atomic<qint64> nextChunk{0};
+    std::atomic<qint64> first{size};
+
+    auto worker = [&]() {
+        for (;;) {
+            const qint64 begin = nextChunk.fetch_add(1) * kChunkSize;
+            if (begin >= size || begin >= first.load()) return;
+
+            const qint64 n = qMin(kChunkSize, size - begin);
+            const qint64 k = BinaryDiff::mismatch(a + begin, b + begin, n);
+            if (k < n) {
+                qint64 current = first.load();
+                while (begin + k < current && !first.compare_exchange_weak(current, begin + k)) {}
+                return;
+            }
+        }
+    };
+
+    const int workers = int(qBound<qint64>(1, QThread::idealThreadCount(), (size + kChunkSize - 1) / kChunkSize));
+    std::vector<std::thread> threads;
+    for (int w = 1; w < workers; ++w) threads.emplace_back(worker);
+    worker();
+    for (std::thread &t : threads) t.join();
+    return first.load();
+}
+
+// Length of the common suffix, at most limit bytes.
+qint64 commonSuffix(const uchar *a, qint64 sizeA, const uchar *b, qint64 sizeB, qint64 limit)
+{
+    qint64 n = 0;
+    while (n < limit) {
+        const qint64 step = qMin(kSuffixStep, limit - n);
+        const uchar *pa = a + sizeA - n - step;
+        const uchar *pb = b + sizeB - n - step;
+        if (std::memcmp(pa, pb, size_t(step)) == 0) {
+            n += step;
+            continue;
+        }
+
+        qint64 k = step;
+        while (k > 0 && pa[k - 1] == pb[k - 1]) --k;
+        return n + (step - k);
+    }
+    return n;
+}
+
+quint64 blockHash(const uchar *p, int block)
+{
+    quint64 h = 0;
+    for (int k = 0; k < block; ++k) h = h * kHashBase + p[k];
+    return h;
+}
+
+// Block hashes of b, sorted by (hash, offset) so the first candidate at or
+// after the current position is a binary search away. A bit filter in front
+// keeps the common "not there" case to one memory access.
+class BlockIndex
+{
+public:
+    BlockIndex(const uchar *b, qint64 begin, qint64 end, int block)
+        : filter((quint64(1) << kFilterBits) / 64, 0)
+    {
+        entries.reserve(size_t((end - begin) / block));
+        for (qint64 o = begin; o + block <= end; o += block) {
+            const quint64 h = blockHash(b + o, block);
+            entries.emplace_back(h, o);
+            const quint64 bit = h >> (64 - kFilterBits);
+            filter[bit / 64] |= quint64(1) << (bit % 64);
+        }
+        std::sort(entries.begin(), entries.end());
+    }
+
+    // Offset of a block at or after minOffset equal to p, or -1.
+    qint64 find(quint64 h, const uchar *p, const uchar *b, int block, qint64 minOffset) const
+    {
+        const quint64 bit = h >> (64 - kFilterBits);
+        if (!(filter[bit / 64] & (quint64(1) << (bit % 64)))) return -1;
+
+        auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(h, minOffset));
+        for (int tries = 0; tries < 8 && it != entries.end() && it->first == h; ++tries, ++it) {
+            if (std::memcmp(p, b + it->second, size_t(block)) == 0) return it->second;
+        }
+        return -1;
+    }
+
+private:
+    std::vector<std::pair<quint64, qint64>> entries;
+    std::vector<quint64> filter;
+};
+
+// a[aBegin, aEnd) against b[bBegin, bEnd) where insertions may have shifted
+// one side. Slides a rolling hash over a; a window that matches a block of b
+// ahead of the current position resynchronises both sides, and the equal run
+// from there is skipped with mismatch().
+bool diffShifted(const uchar *a, qint64 aBegin, qint64 aEnd,
+                 const uchar *b, qint64 bBegin, qint64 bEnd, QVector<DiffRange> &out)
+{
+    const qint64 bLength = bEnd - bBegin;
+    int block = kMinBlockSize;
+    while (bLength / block > kMaxIndexedBlocks) block *= 2;
+
+    if (aEnd - aBegin < block || bLength < block) {
+        if (aEnd == aBegin && bEnd == bBegin) return true;
+        return appendRange(out, DiffRange{aBegin, aEnd - aBegin, bBegin, bLength});
+    }
+
+    const BlockIndex index(b, bBegin, bEnd, block);
+    quint64 topPower = 1;
+    for (int k = 1; k < block; ++k) topPower *= kHashBase;
+
+    qint64 aPos = aBegin;
+    qint64 bPos = bBegin;
+    qint64 i = aBegin;
+    quint64 h = blockHash(a + i, block);
+
+    while (i + block <= aEnd) {
+        // Overwrites keep the alignment; try that before the index.
+        qint64 j = bPos + (i - aPos);
+        if (j + block > bEnd || std::memcmp(a + i, b + j, size_t(block)) != 0) {
+            j = index.find(h, a + i, b, block, bPos);
+        }
+
+        if (j < 0) {
+            if (i + block < aEnd) h = (h - a[i] * topPower) * kHashBase + a[i + block];
+            ++i;
+            continue;
+        }
+
+        qint64 matchA = i;
+        qint64 matchB = j;
+        while (matchA > aPos && matchB > bPos && a[matchA - 1] == b[matchB - 1]) {
+            --matchA;
+            --matchB;
+        }
+        if ((matchA > aPos || matchB > bPos)
+            && !appendRange(out, DiffRange{aPos, matchA - aPos, bPos, matchB - bPos})) {
+            return false;
+        }
+
+        const qint64 run = block + BinaryDiff::mismatch(a + i + block, b + j + block,
+                                                        qMin(aEnd - i - block, bEnd - j - block));
+        aPos = i + run;
+        bPos = j + run;
+        i = aPos;
+        if (i + block <= aEnd) h = blockHash(a + i, block);
+    }
+
+    if (aPos < aEnd || bPos < bEnd) {
+        return appendRange(out, DiffRange{aPos, aEnd - aPos, bPos, bEnd - bPos});
+    }
+    return true;
+}
+
+DiffResult compareData(const uchar *a, qint64 sizeA, const uchar *b, qint64 sizeB)
+{
+    TRACE_SCOPE("BinaryDiff::compare");
+    DiffResult result;
+    result.sizeA = sizeA;
+    result.sizeB = sizeB;
+
+    if (sizeA == sizeB) {
+        compareAligned(a, b, sizeA, result);
+        return result;
+    }
+
+    const qint64 common = qMin(sizeA, sizeB);
+    const qint64 prefix = commonPrefix(a, b, common);
+    const qint64 suffix = commonSuffix(a, sizeA, b, sizeB, common - prefix);
+    result.truncated = !diffShifted(a, prefix, sizeA - suffix, b, prefix, sizeB - suffix, result.ranges);
+    return result;
+}
+
+// Whole file mapped read-only, or read into memory where mapping fails.
+struct MappedInput {
+    QFile file;
+    QByteArray buffer;
+    const uchar *data = nullptr;
+    qint64 size = 0;
+
+    bool open(const QString &path, QString *error)
+    {
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *error = "Cannot open file: " + path;
+            return false;
+        }
+
+        size = file.size();
+        if (size == 0) return true;
+
+        data = file.map(0, size);
+        if (!data) {
+            buffer = file.readAll();
+            if (buffer.size() != size) {
+                *error = "Cannot read file: " + path;
+                return false;
+            }
+            data = reinterpret_cast<const uchar *>(buffer.constData());
+        }
+        return true;
+    }
+};
+
+}
+
+qint64 BinaryDiff::mismatch(const uchar *a, const uchar *b, qint64 size)
+{
+    qint64 i = 0;
+#ifdef __SSE2__
+    while (size - i >= 64) {
+        const __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+        const __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 16)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 16)));
+        const __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 32)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 32)));
+        const __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 48)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 48)));
+        const __m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+        if (_mm_movemask_epi8(all) != 0xFFFF) break;
+        i += 64;
+    }
+    while (size - i >= 16) {
+        const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+        const uint mask = uint(_mm_movemask_epi8(eq)) ^ 0xFFFFu;
+        if (mask) return i + qCountTrailingZeroBits(mask);
+        i += 16;
+    }
+#else
+    while (size - i >= 8) {
+        quint64 wa;
+        quint64 wb;
+        std::memcpy(&wa, a + i, 8);
+        std::memcpy(&wb, b + i, 8);
+        if (wa != wb) break;
+        i += 8;
+    }
+#endif
+    while (i < size && a[i] == b[i]) ++i;
+    return i;
+}
+
+DiffResult BinaryDiff::compareBytes(const QByteArray &a, const QByteArray &b)
+{
+    return compareData(reinterpret_cast<const uchar *>(a.constData()), a.size(),
+                       reinterpret_cast<const uchar *>(b.constData()), b.size());
+}
+
+DiffResult BinaryDiff::compareFiles(const QString &pathA, const QString &pathB)
+{
+    TRACE_SCOPE("BinaryDiff::compareFiles");
+    MappedInput a;
+    MappedInput b;
+    DiffResult result;
+    if (!a.open(pathA, &result.error) || !b.open(pathB, &result.error)) {
+        return result;
+    }
+
+    static const uchar empty = 0;
+    return compareData(a.data ? a.data : &empty, a.size, b.data ? b.data : &empty, b.size);
+}
+
+qint64 BinaryDiff::mapOffset(const DiffResult &result, qint64 offset, bool fromA)
+{
+    const QVector<DiffRange> &ranges = result.ranges;
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), offset,
+                               [fromA](qint64 value, const DiffRange &r) {
+                                   return value < (fromA ? r.offsetA : r.offsetB);
+                               });
+
+    qint64 mapped = offset;
+    if (it != ranges.begin()) {
+        const DiffRange &r = *(it - 1);
+        const qint64 from = fromA ? r.offsetA : r.offsetB;
+        const qint64 fromLength = fromA ? r.lengthA : r.lengthB;
+        const qint64 to = fromA ? r.offsetB : r.offsetA;
+        const qint64 toLength = fromA ? r.lengthB : r.lengthA;
+        const qint64 delta = offset - from;
+        mapped = delta < fromLength ? to + qMin(delta, qMax<qint64>(0, toLength - 1))
+                                    : to + toLength + (delta - fromLength);
+    }
+
+    const qint64 otherSize = fromA ? result.sizeB : result.sizeA;
+    return qBound<qint64>(0, mapped, qMax<qint64>(0, otherSize - 1));
+}
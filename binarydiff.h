@@ -0,0 +1,49 @@
+#ifndef BINARYDIFF_H
+#define BINARYDIFF_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// One differing region: bytes [offsetA, offsetA + lengthA) of the first input
+// correspond to [offsetB, offsetB + lengthB) of the second. Equal lengths are
+// overwrites, unequal ones insertions or deletions.
+struct DiffRange {
+    qint64 offsetA = 0;
+    qint64 lengthA = 0;
+    qint64 offsetB = 0;
+    qint64 lengthB = 0;
+};
+
+struct DiffResult {
+    qint64 sizeA = 0;
+    qint64 sizeB = 0;
+    QVector<DiffRange> ranges;
+    bool truncated = false;     // stopped after maxRanges differences
+    QString error;
+
+    bool isIdentical() const { return error.isEmpty() && sizeA == sizeB && ranges.isEmpty(); }
+};
+
+// Byte level comparison of two inputs. Inputs of equal length are compared
+// in parallel chunks with SSE2; otherwise the common prefix and suffix are
+// skipped the same way and the middle is resynchronised with a rolling hash
+// over fixed-size blocks of the second input (the rsync approach), so an
+// insertion costs time proportional to the bytes around it, not the file.
+class BinaryDiff
+{
+public:
+    static const int maxRanges = 1000000;
+
+    static DiffResult compareFiles(const QString &pathA, const QString &pathB);
+    static DiffResult compareBytes(const QByteArray &a, const QByteArray &b);
+
+    // Offset in the other input that lines up with offset, for lock-step
+    // scrolling. fromA selects which side offset belongs to.
+    static qint64 mapOffset(const DiffResult &result, qint64 offset, bool fromA = true);
+
+    // Index of the first differing byte, or size when the buffers are equal.
+    static qint64 mismatch(const uchar *a, const uchar *b, qint64 size);
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef BYTEDECODERS_H
+#define BYTEDECODERS_H
+
+#include <QDateTime>
+#include <QString>
+#include <QtGlobal>
+#include <cstring>
+#include <type_traits>
+
+// Decoders used by the data inspector. Each ByteDecoder<T, E> specialization
+// knows its width and formats the value at a raw byte pointer, so every row is
+// a fixed amount of work no matter how large the file is.
+
+enum class Endian { Little, Big };
+
+struct UnixTime32 {};
+struct UnixTime64 {};
+struct Guid {};
+struct VarUInt {};
+struct VarSInt {};
+
+namespace ByteDecoderDetail {
+
+template <int Size> struct UIntOfSize;
+template <> struct UIntOfSize<1> { using type = quint8; };
+template <> struct UIntOfSize<2> { using type = quint16; };
+template <> struct UIntOfSize<4> { using type = quint32; };
+template <> struct UIntOfSize<8> { using type = quint64; };
+
+template <typename T, Endian E>
+inline T load(const uchar *p)
+{
+    using U = typename UIntOfSize<sizeof(T)>::type;
+    U raw = 0;
+    for (int i = 0; i < int(sizeof(T)); ++i) {
+        const int shift = (E == Endian::Little) ? i * 8 : (int(sizeof(T)) - 1 - i) * 8;
+        raw |= U(p[i]) << shift;
+    }
+    T value;
+    std::memcpy(&value, &raw, sizeof(T));
+    return value;
+}
+
+// LEB128: returns the number of bytes consumed, 0 if the value is truncated or
+// longer than 10 bytes.
+inline int readVarint(const uchar *p, int available, quint64 *value)
+{
+    quint64 result = 0;
+    for (int i = 0; i < available && i < 10; ++i) {
+        result |= quint64(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+inline QString formatUnixTime(qint64 seconds)
+{
+    if (seconds < -62135596800LL || seconds > 253402300799LL) {
+        return QStringLiteral("out of range");
+    }
+    return QDateTime::fromSecsSinceEpoch(seconds, Qt::UTC).toString(Qt::ISODate);
+}
+
+}
+
+template <typename T, Endian E>
+struct ByteDecoder
+{
+    static_assert(std::is_arithmetic<T>::value, "ByteDecoder needs a specialization for this type");
+    static constexpr int size = sizeof(T);
+
+    static QString format(const uchar *p, int)
+    {
+        const T value = ByteDecoderDetail::load<T, E>(p);
+        if constexpr (std::is_floating_point<T>::value) {
+            return QString::number(value, 'g', std::is_same<T, float>::value ? 9 : 17);
+        } else if constexpr (sizeof(T) == 1) {
+            return QString::number(int(value));
+        } else {
+            return QString::number(value);
+        }
+    }
+};
+
+template <Endian E>
+struct ByteDecoder<UnixTime32, E>
+{
+    static constexpr int size = 4;
+    static QString format(const uchar *p, int)
+    {
+        return ByteDecoderDetail::formatUnixTime(ByteDecoderDetail::load<quint32, E>(p));
+    }
+};
+
+template <Endian E>
+struct ByteDecoder<UnixTime64, E>
+{
+    static constexpr int size = 8;
+    static QString format(const uchar *p, int)
+    {
+        return ByteDecoderDetail::formatUnixTime(ByteDecoderDetail::load<qint64, E>(p));
+    }
+};
+
+// Little endian is the Windows in-memory GUID layout (first three fields
+// byte-swapped); big endian is RFC 4122 network order.
+template <Endian E>
+struct ByteDecoder<Guid, E>
+{
+    static constexpr int size = 16;
+    static QString format(const uchar *p, int)
+    {
+        const quint32 d1 = ByteDecoderDetail::load<quint32, E>(p);
+        const quint16 d2 = ByteDecoderDetail::load<quint16, E>(p + 4);
+        const quint16 d3 = ByteDecoderDetail::load<quint16, E>(p + 6);
+        QString tail;
+        for (int i = 8; i < 16; ++i) {
+            if (i == 10) tail += QLatin1Char('-');
+            tail += QString("%1").arg(uint(p[i]), 2, 16, QLatin1Char('0'));
+        }
+        return QString("{%1-%2-%3-%4}")
+            .arg(d1, 8, 16, QLatin1Char('0'))
+            .arg(uint(d2), 4, 16, QLatin1Char('0'))
+            .arg(uint(d3), 4, 16, QLatin1Char('0'))
+            .arg(tail)
+            .toUpper();
+    }
+};
+
+template <Endian E>
+struct ByteDecoder<VarUInt, E>
+{
+    static constexpr int size = 1;
+    static QString format(const uchar *p, int available)
+    {
+        quint64 value = 0;
+        const int used = ByteDecoderDetail::readVarint(p, available, &value);
+        if (!used) return QStringLiteral("invalid");
+        return QString("%1 (%2 bytes)").arg(value).arg(used);
+    }
+};
+
+template <Endian E>
+struct ByteDecoder<VarSInt, E>
+{
+    static constexpr int size = 1;
+    static QString format(const uchar *p, int available)
+    {
+        quint64 value = 0;
+        const int used = ByteDecoderDetail::readVarint(p, available, &value);
+        if (!used) return QStringLiteral("invalid");
+        const qint64 decoded = qint64(value >> 1) ^ -qint64(value & 1);
+        return QString("%1 (%2 bytes)").arg(decoded).arg(used);
+    }
+};
+
+#endif
@@ -0,0 +1,788 @@
+#include "byteregex.h"
+#include "trace.h"
+#include <QThread>
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+typedef std::bitset<256> ByteSet;
+
+constexpr int kMaxRepeat = 1000;
+constexpr int kMaxNfaStates = 50000;
+constexpr size_t kDfaCacheBytes = 8 * 1024 * 1024;
+constexpr qint64 kMinParallelSlice = 4 * 1024 * 1024;
+
+struct Ast {
+    enum Kind { Bytes, Concat, Alternate, Repeat };
+
+    explicit Ast(Kind kind) : kind(kind) {}
+
+    Kind kind;
+    ByteSet set;
+    std::vector<std::unique_ptr<Ast>> children;
+    int min = 0;
+    int max = -1;  // -1: unbounded
+    bool greedy = true;
+};
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool isNullable(const Ast &node)
+{
+    switch (node.kind) {
+    case Ast::Bytes:
+        return false;
+    case Ast::Concat:
+        for (const auto &child : node.children) {
+            if (!isNullable(*child)) return false;
+        }
+        return true;
+    case Ast::Alternate:
+        for (const auto &child : node.children) {
+            if (isNullable(*child)) return true;
+        }
+        return false;
+    case Ast::Repeat:
+        return node.min == 0 || isNullable(*node.children.front());
+    }
+    return false;
+}
+
+class Parser
+{
+public:
+    Parser(const QByteArray &pattern, bool caseInsensitive)
+        : pattern(pattern), caseInsensitive(caseInsensitive) {}
+
+    std::unique_ptr<Ast> parse(QString *error)
+    {
+        std::unique_ptr<Ast> root = parseAlternate();
+        if (message.isEmpty() && pos < pattern.size()) {
+            fail(pattern.at(pos) == ')' ? "Unmatched )" : "Unexpected character");
+        }
+        if (!message.isEmpty()) {
+            *error = QString("%1 at position %2").arg(message).arg(pos);
+            return nullptr;
+        }
+        return root;
+    }
+
+private:
+    bool atEnd() const { return pos >= pattern.size(); }
+    char peek() const { return pattern.at(pos); }
+
+    std::unique_ptr<Ast> fail(const QString &text)
+    {
+        if (message.isEmpty()) message = text;
+        return nullptr;
+    }
+
+    std::unique_ptr<Ast> bytes(const ByteSet &set)
+    {
+        std::unique_ptr<Ast> node(new Ast(Ast::Bytes));
+        node->set = set;
+        return node;
+    }
+
+    ByteSet folded(ByteSet set) const
+    {
+        if (!caseInsensitive) return set;
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            if (set[c] || set[c + 32]) set.set(c).set(c + 32);
+        }
+        return set;
+    }
+
+    std::unique_ptr<Ast> parseAlternate()
+    {
+        std::unique_ptr<Ast> first = parseConcat();
+        if (atEnd() || peek() != '|') return first;
+
+        std::unique_ptr<Ast> node(new Ast(Ast::Alternate));
+        node->children.push_back(std::move(first));
+        while (message.isEmpty() && !atEnd() && peek() == '|') {
+            ++pos;
+            node->children.push_back(parseConcat());
+        }
+        return node;
+    }
+
+    std::unique_ptr<Ast> parseConcat()
+    {
+        std::unique_ptr<Ast> node(new Ast(Ast::Concat));
+        while (message.isEmpty() && !atEnd() && peek() != '|' && peek() != ')') {
+            std::unique_ptr<Ast> item = parseRepeat();
+            if (!item) return nullptr;
+            node->children.push_back(std::move(item));
+        }
+        if (node->children.size() == 1) return std::move(node->children.front());
+        return node;
+    }
+
+    std::unique_ptr<Ast> parseRepeat()
+    {
+        std::unique_ptr<Ast> atom = parseAtom();
+        while (atom && !atEnd()) {
+            int min = 0;
+            int max = -1;
+            const char c = peek();
+            if (c == '*') {
+                ++pos;
+            } else if (c == '+') {
+                min = 1;
+                ++pos;
+            } else if (c == '?') {
+                max = 1;
+                ++pos;
+            } else if (c != '{' || !parseCounts(&min, &max)) {
+                break;
+            }
+
+            std::unique_ptr<Ast> node(new Ast(Ast::Repeat));
+            node->min = min;
+            node->max = max;
+            if (!atEnd() && peek() == '?') {
+                node->greedy = false;
+                ++pos;
+            }
+            node->children.push_back(std::move(atom));
+            atom = std::move(node);
+        }
+        return atom;
+    }
+
+    // {n}, {n,} or {n,m}. Anything else leaves '{' to be read as a literal.
+    bool parseCounts(int *min, int *max)
+    {
+        int p = pos + 1;
+        auto number = [&](int *value) {
+            const int begin = p;
+            qint64 n = 0;
+            while (p < pattern.size() && pattern.at(p) >= '0' && pattern.at(p) <= '9') {
+                n = qMin<qint64>(n * 10 + (pattern.at(p) - '0'), kMaxRepeat + 1);
+                ++p;
+            }
+            *value = int(n);
+            return p > begin;
+        };
+
+        if (!number(min)) return false;
+        *max = *min;
+        if (p < pattern.size() && pattern.at(p) == ',') {
+            ++p;
+            if (!number(max)) *max = -1;
+        }
+        if (p >= pattern.size() || pattern.at(p) != '}') return false;
+        pos = p + 1;
+
+        if (*min > kMaxRepeat || *max > kMaxRepeat) {
+            fail(QString("Repeat count over %1").arg(kMaxRepeat));
+        } else if (*max >= 0 && *max < *min) {
+            fail("Repeat range is reversed");
+        }
+        return true;
+    }
+
+    std::unique_ptr<Ast> parseAtom()
+    {
+        if (++depth > 200) return fail("Pattern is nested too deeply");
+        struct DepthGuard {
+            int &depth;
+            ~DepthGuard() { --depth; }
+        } guard{ depth };
+
+        const char c = peek();
+        switch (c) {
+        case '(': {
+            ++pos;
+            if (pos + 1 < pattern.size() && peek() == '?') {
+                if (pattern.at(pos + 1) != ':') return fail("Unsupported group type");
+                pos += 2;
+            }
+            std::unique_ptr<Ast> inner = parseAlternate();
+            if (!inner) return nullptr;
+            if (atEnd() || peek() != ')') return fail("Missing )");
+            ++pos;
+            return inner;
+        }
+        case '[':
+            return parseClass();
+        case '.':
+            ++pos;
+            return bytes(ByteSet().set());
+        case '\\': {
+            ++pos;
+            ByteSet set;
+            if (!parseEscape(&set)) return nullptr;
+            return bytes(set);
+        }
+        case '*':
+        case '+':
+        case '?':
+            return fail("Nothing to repeat");
+        case '^':
+        case '$':
+            return fail("Anchors are not supported");
+        default:
+            ++pos;
+            return bytes(folded(ByteSet().set(uchar(c))));
+        }
+    }
+
+    bool parseEscape(ByteSet *set)
+    {
+        if (atEnd()) {
+            fail("Trailing backslash");
+            return false;
+        }
+
+        auto range = [set](int from, int to) {
+            for (int b = from; b <= to; ++b) set->set(size_t(b));
+        };
+        const char c = pattern.at(pos++);
+        switch (c) {
+        case 'x': {
+            int value = 0;
+            for (int i = 0; i < 2; ++i) {
+                const int digit = (pos < pattern.size()) ? hexValue(pattern.at(pos)) : -1;
+                if (digit < 0) {
+                    fail("\\x needs two hex digits");
+                    return false;
+                }
+                value = value * 16 + digit;
+                ++pos;
+            }
+            set->set(size_t(value));
+            return true;
+        }
+        case 'd': case 'D':
+            range('0', '9');
+            break;
+        case 'w': case 'W':
+            range('0', '9');
+            range('A', 'Z');
+            range('a', 'z');
+            set->set('_');
+            break;
+        case 's': case 'S':
+            for (char s : { ' ', '\t', '\n', '\r', '\f', '\v' }) set->set(uchar(s));
+            break;
+        case 'n': set->set('\n'); return true;
+        case 'r': set->set('\r'); return true;
+        case 't': set->set('\t'); return true;
+        case 'f': set->set('\f'); return true;
+        case 'v': set->set('\v'); return true;
+        case '0': set->set(0); return true;
+        default:
+            if (std::isalnum(uchar(c))) {
+                fail(QString("Unsupported escape \\%1").arg(QLatin1Char(c)));
+                return false;
+            }
+            *set = folded(ByteSet().set(uchar(c)));
+            return true;
+        }
+        if (std::isupper(uchar(c))) set->flip();
+        return true;
+    }
+
+    std::unique_ptr<Ast> parseClass()
+    {
+        ++pos;
+        bool negated = false;
+        if (!atEnd() && peek() == '^') {
+            negated = true;
+            ++pos;
+        }
+
+        ByteSet set;
+        bool first = true;
+        while (!atEnd() && (peek() != ']' || first)) {
+            first = false;
+            int low = -1;
+            if (peek() == '\\') {
+                ++pos;
+                ByteSet escaped;
+                if (!parseEscape(&escaped)) return nullptr;
+                if (escaped.count() != 1) {
+                    set |= escaped;
+                    continue;
+                }
+                for (int b = 0; b < 256; ++b) {
+                    if (escaped[size_t(b)]) low = b;
+                }
+            } else {
+                low = uchar(pattern.at(pos++));
+            }
+
+            int high = low;
+            if (pos + 1 < pattern.size() && peek() == '-' && pattern.at(pos + 1) != ']') {
+                ++pos;
+                if (peek() == '\\') {
+                    ++pos;
+                    ByteSet escaped;
+                    if (!parseEscape(&escaped)) return nullptr;
+                    if (escaped.count() != 1) return fail("Invalid class range");
+                    for (int b = 0; b < 256; ++b) {
+                        if (escaped[size_t(b)]) high = b;
+                    }
+                } else {
+                    high = uchar(pattern.at(pos++));
+                }
+                if (high < low) return fail("Invalid class range");
+            }
+            for (int b = low; b <= high; ++b) set.set(size_t(b));
+        }
+        if (atEnd()) return fail("Missing ]");
+        ++pos;
+
+        set = folded(set);
+        if (negated) set.flip();
+        return bytes(set);
+    }
+
+    const QByteArray pattern;
+    const bool caseInsensitive;
+    int pos = 0;
+    int depth = 0;
+    QString message;
+};
+
+struct NfaState {
+    enum Kind { Bytes, Split, Match };
+    Kind kind;
+    int set;   // Bytes: index into Program::sets
+    int out;
+    int out1;  // Split: the lower priority branch
+};
+
+}
+
+struct ByteRegex::Program {
+    std::vector<NfaState> states;
+    std::vector<ByteSet> sets;
+    int forwardStart = 0;
+    int reverseStart = 0;
+    // The any-byte state of the unanchored loop in front of the forward
+    // program; dropping it stops new matches from starting.
+    int prefixState = 0;
+
+    // Bytes no set tells apart share a column in the DFA tables.
+    uchar classOf[256];
+    int classCount = 0;
+
+    int add(NfaState state)
+    {
+        states.push_back(state);
+        return int(states.size()) - 1;
+    }
+
+    int addSplit(int out, int out1) { return add({ NfaState::Split, -1, out, out1 }); }
+
+    // Builds back to front: the result is the entry of node, which continues
+    // at next. The reverse program reads the same language right to left.
+    int compile(const Ast &node, int next, bool reverse)
+    {
+        if (int(states.size()) > kMaxNfaStates) return next;
+
+        switch (node.kind) {
+        case Ast::Bytes: {
+            auto found = std::find(sets.begin(), sets.end(), node.set);
+            if (found == sets.end()) found = sets.insert(sets.end(), node.set);
+            return add({ NfaState::Bytes, int(found - sets.begin()), next, -1 });
+        }
+        case Ast::Concat:
+            if (reverse) {
+                for (const auto &child : node.children) next = compile(*child, next, reverse);
+            } else {
+                for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                    next = compile(**it, next, reverse);
+                }
+            }
+            return next;
+        case Ast::Alternate: {
+            int entry = compile(*node.children.back(), next, reverse);
+            for (int i = int(node.children.size()) - 2; i >= 0; --i) {
+                entry = addSplit(compile(*node.children[size_t(i)], next, reverse), entry);
+            }
+            return entry;
+        }
+        case Ast::Repeat: {
+            const Ast &child = *node.children.front();
+            int entry = next;
+            if (node.max < 0) {
+                const int loop = addSplit(-1, -1);
+                const int body = compile(child, loop, reverse);
+                states[size_t(loop)].out = node.greedy ? body : next;
+                states[size_t(loop)].out1 = node.greedy ? next : body;
+                entry = loop;
+            } else {
+                // x{0,3} is (x(x(x)?)?)?: skipping always skips the rest.
+                for (int i = node.min; i < node.max; ++i) {
+                    const int body = compile(child, entry, reverse);
+                    entry = node.greedy ? addSplit(body, next) : addSplit(next, body);
+                }
+            }
+            for (int i = 0; i < node.min; ++i) entry = compile(child, entry, reverse);
+            return entry;
+        }
+        }
+        return next;
+    }
+
+    void buildByteClasses()
+    {
+        int cls = 0;
+        for (int b = 0; b < 256; ++b) {
+            if (b > 0) {
+                for (const ByteSet &set : sets) {
+                    if (set[size_t(b)] != set[size_t(b - 1)]) {
+                        ++cls;
+                        break;
+                    }
+                }
+            }
+            classOf[b] = uchar(cls);
+        }
+        classCount = cls + 1;
+    }
+};
+
+namespace {
+
+// Lazily built DFA over one of the programs. A DFA state is the ordered list
+// of NFA states reached so far, highest priority first. With leftmostFirst
+// a match drops every lower priority thread, which is how the forward scan
+// stops taking new starts once it has found the leftmost match. Built states
+// are cached; when the cache fills up it is thrown away and rebuilt on demand,
+// so memory stays bounded and every byte still costs at most one state build.
+//
+// A state is named by the offset of its row in the transition table, and a
+// transition into a match state carries MatchFlag, so the inner loop is one
+// load per byte.
+class Dfa
+{
+public:
+    enum { Dead = 0, Unknown = -1, MatchFlag = 1 << 30 };
+
+    Dfa(const ByteRegex::Program &program, int entry, bool leftmostFirst)
+        : p(program), entry(entry), leftmostFirst(leftmostFirst), marks(program.states.size(), 0)
+    {
+        reset();
+    }
+
+    int start()
+    {
+        const auto found = ids.find(startKey);
+        return (found != ids.end() ? found->second : intern(startList)) & ~MatchFlag;
+    }
+
+    // Reads data[begin, end) from state and returns where it ends up, stopping
+    // early at Dead. *lastMatch becomes i + 1 for every byte i read into a
+    // match state.
+    int scanForward(int state, const uchar *data, qint64 begin, qint64 end, qint64 *lastMatch)
+    {
+        const int *table = transitions.data();
+        for (qint64 i = begin; i < end; ++i) {
+            int next = table[state + p.classOf[data[i]]];
+            if (next < 0) {
+                next = build(state, data[i]);
+                table = transitions.data();
+            }
+            if (next & MatchFlag) {
+                next &= ~MatchFlag;
+                *lastMatch = i + 1;
+            }
+            state = next;
+            if (state == Dead) break;
+        }
+        return state;
+    }
+
+    // The same going down from data[end - 1] to data[begin]; *lastMatch
+    // becomes i for every byte i read into a match state.
+    int scanBackward(int state, const uchar *data, qint64 begin, qint64 end, qint64 *lastMatch)
+    {
+        const int *table = transitions.data();
+        for (qint64 i = end - 1; i >= begin; --i) {
+            int next = table[state + p.classOf[data[i]]];
+            if (next < 0) {
+                next = build(state, data[i]);
+                table = transitions.data();
+            }
+            if (next & MatchFlag) {
+                next &= ~MatchFlag;
+                *lastMatch = i;
+            }
+            state = next;
+            if (state == Dead) break;
+        }
+        return state;
+    }
+
+    // The same threads without the unanchored prefix.
+    int withoutPrefix(int state)
+    {
+        std::vector<int> list = lists[size_t(state / p.classCount)];
+        list.erase(std::remove(list.begin(), list.end(), p.prefixState), list.end());
+        return intern(list) & ~MatchFlag;
+    }
+
+private:
+    void reset()
+    {
+        ++resets;
+        lists.clear();
+        transitions.clear();
+        ids.clear();
+        cachedBytes = 0;
+        intern(std::vector<int>());
+
+        startList.clear();
+        ++generation;
+        bool matched = false;
+        addClosure(entry, startList, matched);
+        startKey = keyOf(startList);
+    }
+
+    static std::string keyOf(const std::vector<int> &list)
+    {
+        return std::string(reinterpret_cast<const char *>(list.data()), list.size() * sizeof(int));
+    }
+
+    // Row offset of the state for list, with MatchFlag if it is a match state.
+    int intern(const std::vector<int> &list)
+    {
+        std::string key = keyOf(list);
+        const auto found = ids.find(key);
+        if (found != ids.end()) return found->second;
+
+        const size_t bytes = size_t(p.classCount) * sizeof(int) + key.size() * 2 + 64;
+        if (cachedBytes + bytes > kDfaCacheBytes) {
+            reset();
+            const auto again = ids.find(key);
+            if (again != ids.end()) return again->second;
+        }
+        cachedBytes += bytes;
+
+        int handle = int(transitions.size());
+        for (int s : list) {
+            if (p.states[size_t(s)].kind == NfaState::Match) handle |= MatchFlag;
+        }
+        lists.push_back(list);
+        transitions.resize(transitions.size() + size_t(p.classCount), Unknown);
+        ids.emplace(std::move(key), handle);
+        return handle;
+    }
+
+    void addClosure(int s, std::vector<int> &list, bool &matched)
+    {
+        stack.clear();
+        stack.push_back(s);
+        while (!stack.empty()) {
+            const int x = stack.back();
+            stack.pop_back();
+            if (marks[size_t(x)] == generation) continue;
+            marks[size_t(x)] = generation;
+
+            const NfaState &state = p.states[size_t(x)];
+            if (state.kind == NfaState::Split) {
+                stack.push_back(state.out1);
+                stack.push_back(state.out);
+                continue;
+            }
+            list.push_back(x);
+            if (state.kind == NfaState::Match && leftmostFirst) {
+                matched = true;
+                return;
+            }
+        }
+    }
+
+    int build(int state, uchar byte)
+    {
+        const std::vector<int> current = lists[size_t(state / p.classCount)];
+        const size_t resetsBefore = resets;
+        std::vector<int> next;
+        ++generation;
+        bool matched = false;
+        for (int s : current) {
+            const NfaState &nfa = p.states[size_t(s)];
+            if (nfa.kind == NfaState::Bytes && p.sets[size_t(nfa.set)][byte]) {
+                addClosure(nfa.out, next, matched);
+                if (matched) break;
+            }
+        }
+
+        const int handle = intern(next);
+        // After a cache reset the old row belongs to some other state.
+        if (resets == resetsBefore) {
+            transitions[size_t(state) + p.classOf[byte]] = handle;
+        }
+        return handle;
+    }
+
+    const ByteRegex::Program &p;
+    const int entry;
+    const bool leftmostFirst;
+
+    std::vector<std::vector<int>> lists;
+    std::vector<int> transitions;
+    std::unordered_map<std::string, int> ids;
+    size_t cachedBytes = 0;
+    std::vector<int> startList;
+    std::string startKey;
+
+    std::vector<unsigned> marks;
+    unsigned generation = 0;
+    size_t resets = 0;
+    std::vector<int> stack;
+};
+
+struct Matcher {
+    explicit Matcher(const ByteRegex::Program &program)
+        : forward(program, program.forwardStart, true), reverse(program, program.reverseStart, false) {}
+
+    // The leftmost-first match that starts in [from, startLimit).
+    bool findNext(const uchar *data, qint64 size, qint64 from, qint64 startLimit, ByteMatch *match)
+    {
+        // A thread started at i + 1 appears when byte i is read, so the
+        // prefix has to go before reading byte startLimit - 1.
+        const qint64 openEnd = qMin(size, qMax(from, startLimit - 1));
+        qint64 end = -1;
+        int state = forward.scanForward(forward.start(), data, from, openEnd, &end);
+        if (state != Dfa::Dead) {
+            state = forward.withoutPrefix(state);
+            forward.scanForward(state, data, openEnd, size, &end);
+        }
+        if (end < 0) return false;
+
+        // Walk back from the end for the earliest start. No match can begin
+        // before the leftmost one, so this finds exactly its start.
+        qint64 start = end;
+        reverse.scanBackward(reverse.start(), data, from, end, &start);
+        match->offset = start;
+        match->length = end - start;
+        return true;
+    }
+
+    Dfa forward;
+    Dfa reverse;
+};
+
+void searchRange(const ByteRegex::Program &program, const uchar *data, qint64 size, qint64 begin, qint64 limit,
+                 int maxMatches, QVector<ByteMatch> *out)
+{
+    Matcher matcher(program);
+    ByteMatch match;
+    qint64 pos = begin;
+    while (pos < limit && (maxMatches < 0 || out->size() < maxMatches)
+           && matcher.findNext(data, size, pos, limit, &match)) {
+        out->append(match);
+        pos = match.offset + match.length;
+    }
+}
+
+}
+
+ByteRegex::ByteRegex(const QByteArray &pattern, bool caseInsensitive)
+{
+    if (pattern.isEmpty()) {
+        error = "Empty pattern";
+        return;
+    }
+
+    std::unique_ptr<Ast> root = Parser(pattern, caseInsensitive).parse(&error);
+    if (!root) return;
+    if (isNullable(*root)) {
+        error = "Pattern can match empty input";
+        return;
+    }
+
+    std::shared_ptr<Program> built = std::make_shared<Program>();
+    const int match = built->add({ NfaState::Match, -1, -1, -1 });
+    built->sets.push_back(ByteSet().set());
+    built->prefixState = built->add({ NfaState::Bytes, 0, -1, -1 });
+    const int entry = built->compile(*root, match, false);
+    built->forwardStart = built->addSplit(entry, built->prefixState);
+    built->states[size_t(built->prefixState)].out = built->forwardStart;
+    built->reverseStart = built->compile(*root, match, true);
+    if (int(built->states.size()) > kMaxNfaStates) {
+        error = "Pattern is too large";
+        return;
+    }
+    built->buildByteClasses();
+    program = built;
+}
+
+QVector<ByteMatch> ByteRegex::findAll(const QByteArray &data, int maxMatches) const
+{
+    return findAll(data.constData(), data.size(), maxMatches);
+}
+
+QVector<ByteMatch> ByteRegex::findAll(const char *data, qint64 size, int maxMatches) const
+{
+    TRACE_SCOPE("ByteRegex::findAll");
+    QVector<ByteMatch> matches;
+    if (!program || size <= 0 || maxMatches == 0) return matches;
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+
+    // A match limit usually means an early stop, which one thread reaches
+    // soonest.
+    const int slices = (maxMatches < 0) ? int(qBound<qint64>(1, size / kMinParallelSlice, QThread::idealThreadCount()))
+                                        : 1;
+    if (slices == 1) {
+        searchRange(*program, bytes, size, 0, size, maxMatches, &matches);
+        return matches;
+    }
+
+    std::vector<qint64> bounds(size_t(slices) + 1);
+    for (int i = 0; i <= slices; ++i) bounds[size_t(i)] = size * i / slices;
+    std::vector<QVector<ByteMatch>> found(static_cast<size_t>(slices));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < slices; ++i) {
+        workers.emplace_back([&, i]() {
+            searchRange(*program, bytes, size, bounds[size_t(i)], bounds[size_t(i) + 1], -1, &found[size_t(i)]);
+        });
+    }
+    for (std::thread &worker : workers) worker.join();
+
+    // Each slice searched from its own first byte. Where a match from the
+    // previous slice ends inside this one, rescan from that end until the
+    // scan lands on a match the slice also found; from there on both agree.
+    Matcher matcher(*program);
+    qint64 pos = 0;
+    for (int i = 0; i < slices; ++i) {
+        const QVector<ByteMatch> &slice = found[size_t(i)];
+        const qint64 limit = bounds[size_t(i) + 1];
+        while (pos < limit) {
+            const auto next = std::lower_bound(slice.begin(), slice.end(), pos,
+                                               [](const ByteMatch &m, qint64 offset) { return m.offset < offset; });
+            const bool inStep = (next == slice.begin()) || (next - 1)->offset + (next - 1)->length <= pos;
+            if (inStep) {
+                for (auto it = next; it != slice.end(); ++it) matches.append(*it);
+                if (!slice.isEmpty()) pos = qMax(pos, slice.last().offset + slice.last().length);
+                break;
+            }
+
+            ByteMatch match;
+            if (!matcher.findNext(bytes, size, pos, limit, &match)) break;
+            matches.append(match);
+            pos = match.offset + match.length;
+        }
+        // No match starts between pos and the end of the slice.
+        pos = qMax(pos, limit);
+    }
+    return matches;
+}
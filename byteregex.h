@@ -0,0 +1,41 @@
+#ifndef BYTEREGEX_H
+#define BYTEREGEX_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+struct ByteMatch {
+    qint64 offset = 0;
+    qint64 length = 0;
+};
+
+// Regular expressions over raw bytes, run on a DFA that is built lazily
+// while scanning, so finding a match takes time linear in the input whatever
+// the pattern (no backtracking). Supported: literals, ".", [...] classes,
+// \xHH, \d \w \s and their negations, \n \r \t \f \v \0, ( ) and (?: ),
+// |, and * + ? {n} {n,} {n,m} with lazy "?" forms. "." matches any byte,
+// newline included. Matches are leftmost-first as in Perl, never empty and
+// never overlapping.
+class ByteRegex
+{
+public:
+    explicit ByteRegex(const QByteArray &pattern, bool caseInsensitive = false);
+
+    bool isValid() const { return program != nullptr; }
+    QString errorString() const { return error; }
+
+    // Large inputs are split into slices searched on several threads; a
+    // match running past the end of a slice is followed into the next one.
+    QVector<ByteMatch> findAll(const char *data, qint64 size, int maxMatches = -1) const;
+    QVector<ByteMatch> findAll(const QByteArray &data, int maxMatches = -1) const;
+
+    struct Program;
+
+private:
+    std::shared_ptr<const Program> program;
+    QString error;
+};
+
+#endif
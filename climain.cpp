@@ -0,0 +1,14 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "terminalmode.h"
+
+// Widgets-free entry point for scripts: same options as `Hex_Editor_V01 --terminal`
+// without loading QtGui/QtWidgets at all.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    TerminalMode::setupParser(parser);
+    parser.process(app);
+    return TerminalMode::run(parser);
+}
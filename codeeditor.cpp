@@ -1,10 +1,15 @@
 #include "codeeditor.h"
+#include "searchengine.h"
+#include "trace.h"
 #include <QPainter>
 #include <QTextBlock>
 #include <QTextDocument>
-#include <QRegularExpression>
 #include <QKeyEvent>
 #include <QTextLayout>
+#include <QHelpEvent>
+#include <QStringList>
+#include <QToolTip>
+#include <algorithm>
 
 CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent) {
     lineNumberArea = new LineNumberArea(this);
@@ -12,6 +17,19 @@ CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent) {
     connect(this, &CodeEditor::blockCountChanged, this, &CodeEditor::updateLineNumberAreaWidth);
     connect(this, &CodeEditor::updateRequest, this, &CodeEditor::updateLineNumberArea);
     connect(this, &CodeEditor::cursorPositionChanged, this, &CodeEditor::highlightCurrentLine);
+    connect(document(), &QTextDocument::contentsChange, this, [this](int position, int removed, int added) {
+        foldedUpTo = qMin(foldedUpTo, position);
+        shownFrom = -1;
+        // Text appended at the end (follow mode) keeps the matches found so
+        // far; only the new tail is searched on the next lookup.
+        const bool appended = removed == 0 && added > 0 && position + added >= document()->characterCount() - 1;
+        if (matchesValid && appended) {
+            if (appendedFrom < 0 || position < appendedFrom) appendedFrom = position;
+        } else {
+            matchesValid = false;
+            appendedFrom = -1;
+        }
+    });
 
     updateLineNumberAreaWidth(0);
     highlightCurrentLine();
@@ -60,12 +78,34 @@ bool CodeEditor::isValidTokenCharacter(const QChar &ch) const {
                || (ch >= QLatin1Char('0') && ch <= QLatin1Char('9'))
                || (ch >= QLatin1Char('A') && ch <= QLatin1Char('F'))
                || (ch >= QLatin1Char('a') && ch <= QLatin1Char('f'));
+    case GroupingBase64:
+    case GroupingBase64Url: {
+        const bool url = groupingMode == GroupingBase64Url;
+        return (ch >= QLatin1Char('A') && ch <= QLatin1Char('Z'))
+               || (ch >= QLatin1Char('a') && ch <= QLatin1Char('z'))
+               || (ch >= QLatin1Char('0') && ch <= QLatin1Char('9'))
+               || ch == QLatin1Char(url ? '-' : '+')
+               || ch == QLatin1Char(url ? '_' : '/')
+               || ch == QLatin1Char('=');
+    }
+    case GroupingBase32:
+        return (ch >= QLatin1Char('A') && ch <= QLatin1Char('Z'))
+               || (ch >= QLatin1Char('a') && ch <= QLatin1Char('z'))
+               || (ch >= QLatin1Char('2') && ch <= QLatin1Char('7'))
+               || ch == QLatin1Char('=');
+    case GroupingAscii85:
+        return ch >= QLatin1Char('!') && ch <= QLatin1Char('u');
     case GroupingText:
     default:
         return true;
     }
 }
 
+bool CodeEditor::isEncodedGrouping() const {
+    return groupingMode == GroupingBase64 || groupingMode == GroupingBase64Url
+           || groupingMode == GroupingBase32 || groupingMode == GroupingAscii85;
+}
+
 void CodeEditor::keyPressEvent(QKeyEvent *event) {
 
     const int tokenLength = expectedTokenLength();
@@ -77,6 +117,21 @@ void CodeEditor::keyPressEvent(QKeyEvent *event) {
         return;
     }
 
+    // Encoded text has no token boundaries to keep; only characters outside
+    // the alphabet are refused. Line breaks are skipped by the decoder.
+    if (isEncodedGrouping()) {
+        if (!enteredText.isEmpty() && enteredText.at(0).isPrint()
+            && !isValidTokenCharacter(enteredText.at(0))) {
+            return;
+        }
+        if (groupingMode == GroupingBase32 && enteredText.size() == 1 && enteredText.at(0).isLower()) {
+            cursor.insertText(enteredText.toUpper());
+            return;
+        }
+        QPlainTextEdit::keyPressEvent(event);
+        return;
+    }
+
     if (event->key() == Qt::Key_Backspace || event->key() == Qt::Key_Delete) {
 
         int step = (groupingMode == GroupingUnicode) ? 6 : (tokenLength + 1);
@@ -196,11 +251,28 @@ int CodeEditor::lineNumberAreaWidth() {
 
 void CodeEditor::updateLineNumberAreaWidth(int ) {
     const int width = lineNumberAreaWidth();
+    const int stripWidth = minimapWidget ? minimapWidget->width() : 0;
     if (layoutDirection() == Qt::RightToLeft) {
-        setViewportMargins(0, 0, width, 0);
+        setViewportMargins(stripWidth, 0, width, 0);
     } else {
-        setViewportMargins(width, 0, 0, 0);
+        setViewportMargins(width, 0, stripWidth, 0);
+    }
+    if (minimapWidget) layoutSideWidgets();
+}
+
+void CodeEditor::setMinimap(QWidget *widget) {
+    if (minimapWidget == widget) return;
+    delete minimapWidget;
+    minimapWidget = widget;
+    if (minimapWidget) {
+        minimapWidget->setParent(this);
+        minimapWidget->show();
     }
+    updateLineNumberAreaWidth(0);
+}
+
+QWidget *CodeEditor::minimap() const {
+    return minimapWidget;
 }
 
 void CodeEditor::updateLineNumberArea(const QRect &rect, int dy) {
@@ -211,14 +283,59 @@ void CodeEditor::updateLineNumberArea(const QRect &rect, int dy) {
 
     if (rect.contains(viewport()->rect()))
         updateLineNumberAreaWidth(0);
+    checkVisibleRange();
 }
 
 void CodeEditor::resizeEvent(QResizeEvent *e) {
     QPlainTextEdit::resizeEvent(e);
+    layoutSideWidgets();
+    checkVisibleRange();
+}
+
+void CodeEditor::visibleRange(int *from, int *to) const {
+    *from = cursorForPosition(QPoint(0, 0)).position();
+    QTextCursor last = cursorForPosition(QPoint(viewport()->width() - 1, viewport()->height() - 1));
+    last.movePosition(QTextCursor::EndOfLine);
+    *to = qMax(*from, last.position() + 1);
+}
+
+void CodeEditor::checkVisibleRange() {
+    int from = 0;
+    int to = 0;
+    visibleRange(&from, &to);
+    if (from == shownFrom && to == shownTo) return;
+    shownFrom = from;
+    shownTo = to;
+    emit visibleRangeChanged(from, to);
+}
+
+bool CodeEditor::viewportEvent(QEvent *event) {
+    if (event->type() != QEvent::ToolTip || annotations.isEmpty()) {
+        return QPlainTextEdit::viewportEvent(event);
+    }
+    QHelpEvent *help = static_cast<QHelpEvent *>(event);
+    const int pos = cursorForPosition(help->pos()).position();
+    QStringList labels;
+    for (const Annotation &a : qAsConst(annotations)) {
+        if (pos >= a.start && pos < a.start + a.length && !a.label.isEmpty()) labels.append(a.label);
+    }
+    if (labels.isEmpty()) QToolTip::hideText();
+    else QToolTip::showText(help->globalPos(), labels.join('\n'), viewport());
+    return true;
+}
+
+void CodeEditor::layoutSideWidgets() {
     QRect cr = contentsRect();
     const int width = lineNumberAreaWidth();
     const int x = (layoutDirection() == Qt::RightToLeft) ? (cr.right() - width + 1) : cr.left();
     lineNumberArea->setGeometry(QRect(x, cr.top(), width, cr.height()));
+
+    if (minimapWidget) {
+        const QRect vp = viewport()->geometry();
+        const int stripWidth = minimapWidget->width();
+        const int stripX = (layoutDirection() == Qt::RightToLeft) ? (vp.left() - stripWidth) : (vp.right() + 1);
+        minimapWidget->setGeometry(QRect(stripX, vp.top(), stripWidth, vp.height()));
+    }
 }
 
 void CodeEditor::highlightCurrentLine() {
@@ -227,137 +344,206 @@ void CodeEditor::highlightCurrentLine() {
 
 void CodeEditor::setSearchText(const QString &query) {
     searchQuery = query;
+    foldedQuery = SearchEngine::foldForSearch(query, searchCase);
+    if (query.isEmpty()) {
+        foldedShadow.clear();
+        foldedUpTo = 0;
+    }
+    matchesValid = false;
+    appendedFrom = -1;
+    updateSelections();
+}
+
+void CodeEditor::setSearchCaseSensitivity(Qt::CaseSensitivity cs) {
+    if (cs == searchCase) return;
+    searchCase = cs;
+    // The shadow copy was folded for the other mode.
+    foldedQuery = SearchEngine::foldForSearch(searchQuery, cs);
+    foldedShadow.clear();
+    foldedUpTo = 0;
+    if (!searchQuery.isEmpty()) {
+        matchesValid = false;
+        appendedFrom = -1;
+    }
+}
+
+void CodeEditor::setSearchMatches(const QVector<SearchMatch> &matches) {
+    searchQuery.clear();
+    foldedQuery.clear();
+    foldedShadow.clear();
+    foldedUpTo = 0;
+    cachedMatches = matches;
+    matchesValid = true;
+    appendedFrom = -1;
     updateSelections();
 }
 
 int CodeEditor::searchMatchCount() const {
-    return buildSearchSelections().size();
+    return searchMatches().size();
 }
 
 int CodeEditor::currentSearchMatchIndex() const {
-    if (searchQuery.isEmpty()) {
+    const QVector<SearchMatch> &matches = searchMatches();
+    if (matches.isEmpty()) {
         return 0;
     }
 
-    const QList<QTextEdit::ExtraSelection> selections = buildSearchSelections();
-    if (selections.isEmpty()) {
-        return 0;
-    }
-
-    return findCurrentMatchIndex(selections);
+    return findCurrentMatchIndex(matches);
 }
 
 bool CodeEditor::jumpToNextSearchMatch() {
-    const auto selections = buildSearchSelections();
-    if (selections.isEmpty()) return false;
+    const QVector<SearchMatch> &matches = searchMatches();
+    if (matches.isEmpty()) return false;
 
-    int currentIndex = findCurrentMatchIndex(selections);
-    int nextIndex = (currentIndex + 1) % selections.size();
+    int currentIndex = findCurrentMatchIndex(matches);
+    int nextIndex = (currentIndex + 1) % matches.size();
 
-    setTextCursor(selections[nextIndex].cursor);
-    centerCursor();
+    selectMatch(matches.at(nextIndex));
     return true;
 }
 
 bool CodeEditor::jumpToPreviousSearchMatch() {
-    const auto selections = buildSearchSelections();
-    if (selections.isEmpty()) return false;
+    const QVector<SearchMatch> &matches = searchMatches();
+    if (matches.isEmpty()) return false;
 
-    int currentIndex = findCurrentMatchIndex(selections);
-    int prevIndex = (currentIndex - 1 + selections.size()) % selections.size();
+    int currentIndex = findCurrentMatchIndex(matches);
+    int prevIndex = (currentIndex - 1 + matches.size()) % matches.size();
 
-    setTextCursor(selections[prevIndex].cursor);
-    centerCursor();
+    selectMatch(matches.at(prevIndex));
     return true;
 }
 
-QString CodeEditor::buildFlexibleSearchPattern(const QString &query) const {
-    QString pattern;
-    pattern.reserve(query.size() * 6);
-
-    for (const QChar ch : query) {
-        switch (ch.unicode()) {
-        case 0x064A:
-        case 0x06CC:
-            pattern += "[\\x{064A}\\x{06CC}]";
-            break;
-        case 0x0643:
-        case 0x06A9:
-            pattern += "[\\x{0643}\\x{06A9}]";
-            break;
-        case 0x0629:
-        case 0x0647:
-            pattern += "[\\x{0629}\\x{0647}]";
-            break;
-        case 0x0623:
-        case 0x0625:
-        case 0x0622:
-        case 0x0627:
-            pattern += "[\\x{0623}\\x{0625}\\x{0622}\\x{0627}]";
-            break;
-        default:
-            pattern += QRegularExpression::escape(QString(ch));
-            break;
-        }
+void CodeEditor::refreshSearchHighlights() {
+    updateSelections();
+}
+
+void CodeEditor::selectMatch(const SearchMatch &match) {
+    QTextCursor cursor(document());
+    cursor.setPosition(match.start);
+    cursor.setPosition(match.start + match.length, QTextCursor::KeepAnchor);
+    setTextCursor(cursor);
+    centerCursor();
+}
+
+const QString &CodeEditor::foldedText() const {
+    const int length = document()->characterCount() - 1;
+    if (foldedUpTo == 0) {
+        foldedShadow = SearchEngine::foldForSearch(toPlainText(), searchCase);
+    } else if (foldedUpTo < length || foldedShadow.size() != length) {
+        // Text before the first edit is unchanged; refold only the rest.
+        QTextCursor tail(document());
+        tail.setPosition(foldedUpTo);
+        tail.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+        const QString text = tail.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n'))
+                                            .replace(QChar::Nbsp, QLatin1Char(' '));
+        foldedShadow.truncate(foldedUpTo);
+        foldedShadow += SearchEngine::foldForSearch(text, searchCase);
     }
+    foldedUpTo = length;
+    return foldedShadow;
+}
 
-    return pattern;
+const QVector<SearchMatch> &CodeEditor::searchMatches() const {
+    if (!matchesValid) {
+        cachedMatches = searchQuery.isEmpty() ? QVector<SearchMatch>()
+                                              : SearchEngine::findAllFolded(foldedText(), foldedQuery);
+        matchesValid = true;
+        appendedFrom = -1;
+    } else if (appendedFrom >= 0) {
+        // Every match is as long as the query, so scanning can resume where
+        // the last match ended or where one could first reach the new text.
+        int from = qMax(0, appendedFrom - searchQuery.size() + 1);
+        if (!cachedMatches.isEmpty()) {
+            from = qMax(from, cachedMatches.last().start + cachedMatches.last().length);
+        }
+        appendedFrom = -1;
+
+        if (!searchQuery.isEmpty()) {
+            cachedMatches += SearchEngine::findAllFolded(foldedText(), foldedQuery, from);
+        }
+    }
+    return cachedMatches;
 }
 
 QList<QTextEdit::ExtraSelection> CodeEditor::buildSearchSelections() const {
+    TRACE_SCOPE("CodeEditor::buildSearchSelections");
     QList<QTextEdit::ExtraSelection> selections;
-    if (searchQuery.isEmpty()) {
+    const QVector<SearchMatch> &matches = searchMatches();
+    if (matches.isEmpty()) {
         return selections;
     }
 
-    QTextCursor cursor(document());
     QTextCharFormat format;
     format.setBackground(QColor(255, 235, 59));
     format.setForeground(Qt::black);
 
-    const QString flexiblePattern = buildFlexibleSearchPattern(searchQuery);
-    QRegularExpression queryExpression(
-        flexiblePattern,
-        QRegularExpression::CaseInsensitiveOption | QRegularExpression::UseUnicodePropertiesOption
-        );
-
-    while (!cursor.isNull() && !cursor.atEnd()) {
-        cursor = document()->find(queryExpression, cursor);
-        if (!cursor.isNull()) {
-            QTextEdit::ExtraSelection selection;
-            selection.cursor = cursor;
-            selection.format = format;
-            selections.append(selection);
-        }
+    selections.reserve(matches.size());
+    for (const SearchMatch &match : matches) {
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = QTextCursor(document());
+        selection.cursor.setPosition(match.start);
+        selection.cursor.setPosition(match.start + match.length, QTextCursor::KeepAnchor);
+        selection.format = format;
+        selections.append(selection);
     }
 
     return selections;
 }
 
-int CodeEditor::findCurrentMatchIndex(const QList<QTextEdit::ExtraSelection> &selections) const {
-    if (selections.isEmpty())
+// Matches are sorted and never overlap: the first one ending at or after the
+// cursor either contains it or is the next one after it.
+int CodeEditor::findCurrentMatchIndex(const QVector<SearchMatch> &matches) const {
+    if (matches.isEmpty())
         return -1;
 
-    const QTextCursor current = textCursor();
-    const int curPos = current.position();
+    const int curPos = textCursor().position();
+    auto it = std::lower_bound(matches.begin(), matches.end(), curPos,
+                               [](const SearchMatch &m, int pos) { return m.start + m.length < pos; });
+    return it == matches.end() ? 0 : int(it - matches.begin());
+}
 
-    for (int i = 0; i < selections.size(); ++i) {
-        const QTextCursor selCursor = selections[i].cursor;
-        if (selCursor.selectionStart() <= curPos && curPos <= selCursor.selectionEnd()) {
-            return i;
-        }
-    }
+void CodeEditor::setMarkedRanges(const QVector<SearchMatch> &ranges) {
+    markedRanges = ranges;
+    updateSelections();
+}
 
+void CodeEditor::setAnnotations(const QVector<Annotation> &list) {
+    if (list.isEmpty() && annotations.isEmpty()) return;
+    annotations = list;
+    updateSelections();
+}
 
-    for (int i = 0; i < selections.size(); ++i) {
-        if (selections[i].cursor.selectionStart() > curPos)
-            return i;
+void CodeEditor::updateSelections() {
+    QList<QTextEdit::ExtraSelection> extraSelections;
+
+    // Ranges set before an edit may run past the end until the owner
+    // answers visibleRangeChanged().
+    const int maxPos = qMax(0, document()->characterCount() - 1);
+    for (const Annotation &a : qAsConst(annotations)) {
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = QTextCursor(document());
+        selection.cursor.setPosition(qBound(0, a.start, maxPos));
+        selection.cursor.setPosition(qBound(0, a.start + a.length, maxPos), QTextCursor::KeepAnchor);
+        selection.format.setBackground(a.color);
+        selection.format.setForeground(a.color.lightness() > 140 ? Qt::black : Qt::white);
+        extraSelections.append(selection);
     }
 
-    return 0;
-}
-void CodeEditor::updateSelections() {
-    QList<QTextEdit::ExtraSelection> extraSelections = buildSearchSelections();
+    if (!markedRanges.isEmpty()) {
+        QTextCharFormat format;
+        format.setBackground(QColor(0x8b, 0x2e, 0x2e));
+        format.setForeground(Qt::white);
+        for (const SearchMatch &range : qAsConst(markedRanges)) {
+            QTextEdit::ExtraSelection selection;
+            selection.cursor = QTextCursor(document());
+            selection.cursor.setPosition(range.start);
+            selection.cursor.setPosition(range.start + range.length, QTextCursor::KeepAnchor);
+            selection.format = format;
+            extraSelections.append(selection);
+        }
+    }
+
+    extraSelections.append(buildSearchSelections());
 
     if (!isReadOnly()) {
         QTextEdit::ExtraSelection currentLineSelection;
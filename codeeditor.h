@@ -1,9 +1,12 @@
 #ifndef CODEEDITOR_H
 #define CODEEDITOR_H
 
+#include <QColor>
 #include <QPlainTextEdit>
 #include <QWidget>
 #include <QList>
+#include <QVector>
+#include "searchengine.h"
 
 class LineNumberArea;
 
@@ -14,28 +17,69 @@ public:
         GroupingText,
         GroupingHex,
         GroupingBinary,
-        GroupingUnicode
+        GroupingUnicode,
+        GroupingBase64,
+        GroupingBase64Url,
+        GroupingBase32,
+        GroupingAscii85
     };
 
     CodeEditor(QWidget *parent = nullptr);
     void setByteGroupingMode(ByteGroupingMode mode);
     ByteGroupingMode byteGroupingMode() const;
+    // Base64, Base32 or Ascii85 text rather than one token per byte.
+    bool isEncodedGrouping() const;
 
     void highlightBinary();
     void highlightHex();
     void highlightUnicode();
 
+    // Narrow widget (e.g. an entropy minimap) kept between the text and the
+    // vertical scrollbar. The editor takes ownership.
+    void setMinimap(QWidget *widget);
+    QWidget *minimap() const;
+
+    // Character ranges painted behind the text, e.g. differing bytes in a
+    // compare view. Kept separate from search highlights.
+    void setMarkedRanges(const QVector<SearchMatch> &ranges);
+
+    // A bookmark or annotation: characters painted in its colour, with the
+    // label as their tooltip.
+    struct Annotation {
+        int start;
+        int length;
+        QColor color;
+        QString label;
+    };
+    // Only the annotations on screen are expected; new ones are asked for
+    // with visibleRangeChanged().
+    void setAnnotations(const QVector<Annotation> &annotations);
+    // First visible character and the one after the last.
+    void visibleRange(int *from, int *to) const;
+
     void lineNumberAreaPaintEvent(QPaintEvent *event);
     int lineNumberAreaWidth();
     void setSearchText(const QString &query);
+    // Case-insensitive unless set otherwise; takes effect on the next search.
+    void setSearchCaseSensitivity(Qt::CaseSensitivity cs);
+    // Matches found elsewhere, e.g. by a byte regex over the file; kept until
+    // the next setSearchText() or edit.
+    void setSearchMatches(const QVector<SearchMatch> &matches);
     int searchMatchCount() const;
     int currentSearchMatchIndex() const;
     bool jumpToNextSearchMatch();
     bool jumpToPreviousSearchMatch();
+    // Repaints search hits after text was added without a cursor move.
+    void refreshSearchHighlights();
+
+signals:
+    // Scrolling, resizing or an edit changed the characters on screen.
+    void visibleRangeChanged(int from, int to);
 
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
 
 private slots:
     void updateLineNumberAreaWidth(int newBlockCount);
@@ -44,13 +88,34 @@ private slots:
 
 private:
     int visibleLineCount() const;
+    void layoutSideWidgets();
     void updateSelections();
+    void checkVisibleRange();
     QList<QTextEdit::ExtraSelection> buildSearchSelections() const;
-    QString buildFlexibleSearchPattern(const QString &query) const;
-    int findCurrentMatchIndex(const QList<QTextEdit::ExtraSelection> &selections) const;
+    const QVector<SearchMatch> &searchMatches() const;
+    const QString &foldedText() const;
+    int findCurrentMatchIndex(const QVector<SearchMatch> &matches) const;
+    void selectMatch(const SearchMatch &match);
 
     QWidget *lineNumberArea;
+    QWidget *minimapWidget = nullptr;
     QString searchQuery;
+    QString foldedQuery;
+    Qt::CaseSensitivity searchCase = Qt::CaseInsensitive;
+    // The text run through SearchEngine::foldForSearch(), kept while a query
+    // is set. Only the part from foldedUpTo on is stale after an edit.
+    mutable QString foldedShadow;
+    mutable int foldedUpTo = 0;
+    // Matches of searchQuery, reused until the text or the query changes.
+    mutable QVector<SearchMatch> cachedMatches;
+    mutable bool matchesValid = false;
+    // Start of text appended since the matches were found, or -1.
+    mutable int appendedFrom = -1;
+    QVector<SearchMatch> markedRanges;
+    QVector<Annotation> annotations;
+    // Range last reported by visibleRangeChanged(); -1 after an edit.
+    int shownFrom = -1;
+    int shownTo = -1;
     ByteGroupingMode groupingMode = GroupingText;
 
     int expectedTokenLength() const;
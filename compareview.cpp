@@ -0,0 +1,245 @@
+#include "compareview.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QSplitter>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+
+constexpr int kBytesPerRow = 16;
+constexpr qint64 kWindowBytes = 256 * 1024;
+constexpr int kMaxListedDifferences = 10000;
+constexpr int kMaxMarkedRanges = 4096;
+
+// One row per 16 bytes. Every byte takes three characters ("XX " or "XX\n"),
+// so byte k of the window starts at column k * 3 like in the main hex pane.
+QString formatRows(const QByteArray &bytes)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    QString text(qMax(0, bytes.size() * 3 - 1), Qt::Uninitialized);
+    QChar *out = text.data();
+    for (int i = 0; i < bytes.size(); ++i) {
+        const uchar b = uchar(bytes.at(i));
+        *out++ = QLatin1Char(digits[b >> 4]);
+        *out++ = QLatin1Char(digits[b & 0x0F]);
+        if (i + 1 < bytes.size()) {
+            *out++ = QLatin1Char((i + 1) % kBytesPerRow == 0 ? '\n' : ' ');
+        }
+    }
+    return text;
+}
+
+QString describeRange(qint64 offset, qint64 length)
+{
+    return QString("0x%1 +%2").arg(offset, 8, 16, QLatin1Char('0')).arg(length);
+}
+
+}
+
+CompareView::CompareView(const QString &pathA, const QString &pathB, const DiffResult &result,
+                         QWidget *parent)
+    : QWidget(parent), diff(result)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(4);
+
+    QHBoxLayout *header = new QHBoxLayout();
+    header->setContentsMargins(8, 4, 8, 0);
+    summary = new QLabel(this);
+    summary->setObjectName("compareSummary");
+    header->addWidget(summary, 1);
+    QPushButton *prevButton = new QPushButton("Previous", this);
+    QPushButton *nextButton = new QPushButton("Next", this);
+    header->addWidget(prevButton);
+    header->addWidget(nextButton);
+    layout->addLayout(header);
+
+    QSplitter *panes = new QSplitter(Qt::Horizontal, this);
+    sides[0].path = pathA;
+    sides[1].path = pathB;
+    sides[0].size = diff.sizeA;
+    sides[1].size = diff.sizeB;
+    for (int side = 0; side < 2; ++side) {
+        CodeEditor *editor = new CodeEditor();
+        editor->setReadOnly(true);
+        editor->setLineWrapMode(QPlainTextEdit::NoWrap);
+        editor->setByteGroupingMode(CodeEditor::GroupingHex);
+        editor->setToolTip(sides[side].path);
+        sides[side].editor = editor;
+        panes->addWidget(editor);
+        connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, this, [this, side]() {
+            followScroll(side);
+        });
+    }
+    layout->addWidget(panes, 1);
+
+    differences = new QListWidget(this);
+    differences->setMaximumHeight(160);
+    differences->setObjectName("compareDifferences");
+    layout->addWidget(differences);
+
+    const int listed = qMin(diff.ranges.size(), kMaxListedDifferences);
+    for (int i = 0; i < listed; ++i) {
+        const DiffRange &r = diff.ranges.at(i);
+        const QString kind = r.lengthA == 0 ? "inserted" : (r.lengthB == 0 ? "deleted" : "changed");
+        differences->addItem(QString("%1. %2  <->  %3  %4")
+                                 .arg(i + 1)
+                                 .arg(describeRange(r.offsetA, r.lengthA))
+                                 .arg(describeRange(r.offsetB, r.lengthB))
+                                 .arg(kind));
+    }
+
+    QString text = diff.isIdentical()
+                       ? QString("Files are identical")
+                       : QString("%1 difference(s)").arg(diff.ranges.size());
+    if (diff.truncated) text += " (stopped early)";
+    if (diff.ranges.size() > listed) text += QString(", first %1 listed").arg(listed);
+    text += QString("  |  %1: %2 bytes  |  %3: %4 bytes")
+                .arg(QFileInfo(pathA).fileName()).arg(diff.sizeA)
+                .arg(QFileInfo(pathB).fileName()).arg(diff.sizeB);
+    summary->setText(text);
+
+    connect(differences, &QListWidget::currentRowChanged, this, &CompareView::jumpToDifference);
+    connect(prevButton, &QPushButton::clicked, this, [this]() {
+        if (differences->count() == 0) return;
+        differences->setCurrentRow(qMax(0, differences->currentRow() - 1));
+    });
+    connect(nextButton, &QPushButton::clicked, this, [this]() {
+        if (differences->count() == 0) return;
+        differences->setCurrentRow(qMin(differences->count() - 1, differences->currentRow() + 1));
+    });
+
+    loadWindow(0, 0);
+    loadWindow(1, 0);
+    if (differences->count() > 0) {
+        differences->setCurrentRow(0);
+    }
+}
+
+void CompareView::loadWindow(int side, qint64 offset)
+{
+    Side &s = sides[side];
+    const qint64 start = qMax<qint64>(0, offset - kWindowBytes / 4) / kBytesPerRow * kBytesPerRow;
+
+    QByteArray bytes;
+    QFile file(s.path);
+    if (file.open(QIODevice::ReadOnly) && file.seek(start)) {
+        bytes = file.read(kWindowBytes);
+    }
+
+    s.windowStart = start;
+    s.windowBytes = bytes.size();
+
+    const bool wasSyncing = syncing;
+    syncing = true;
+    s.editor->setPlainText(formatRows(bytes));
+    markDifferences(side);
+    syncing = wasSyncing;
+}
+
+void CompareView::markDifferences(int side)
+{
+    const Side &s = sides[side];
+    const qint64 windowEnd = s.windowStart + s.windowBytes;
+    const bool isA = (side == 0);
+
+    // Ranges are ordered on both sides; skip to the first that can overlap.
+    auto first = std::lower_bound(diff.ranges.begin(), diff.ranges.end(), s.windowStart,
+                                  [isA](const DiffRange &r, qint64 value) {
+                                      return (isA ? r.offsetA + r.lengthA : r.offsetB + r.lengthB) <= value;
+                                  });
+
+    QVector<SearchMatch> marks;
+    for (auto it = first; it != diff.ranges.end() && marks.size() < kMaxMarkedRanges; ++it) {
+        const qint64 offset = isA ? it->offsetA : it->offsetB;
+        const qint64 length = isA ? it->lengthA : it->lengthB;
+        if (offset >= windowEnd) break;
+
+        const qint64 begin = qMax(offset, s.windowStart);
+        const qint64 end = qMin(offset + length, windowEnd);
+        if (end <= begin) continue;
+
+        SearchMatch mark;
+        mark.start = int((begin - s.windowStart) * 3);
+        mark.length = int((end - begin) * 3 - 1);
+        marks.append(mark);
+    }
+    s.editor->setMarkedRanges(marks);
+}
+
+qint64 CompareView::offsetAtTop(int side) const
+{
+    const Side &s = sides[side];
+    return s.windowStart + qint64(s.editor->verticalScrollBar()->value()) * kBytesPerRow;
+}
+
+void CompareView::scrollToOffset(int side, qint64 offset)
+{
+    Side &s = sides[side];
+    offset = qBound<qint64>(0, offset, qMax<qint64>(0, s.size - 1));
+    if (offset < s.windowStart || offset >= s.windowStart + s.windowBytes) {
+        loadWindow(side, offset);
+    }
+
+    const bool wasSyncing = syncing;
+    syncing = true;
+    s.editor->verticalScrollBar()->setValue(int((offset - s.windowStart) / kBytesPerRow));
+    syncing = wasSyncing;
+}
+
+void CompareView::followScroll(int side)
+{
+    if (syncing) return;
+
+    Side &s = sides[side];
+    const QScrollBar *bar = s.editor->verticalScrollBar();
+    const qint64 offset = offsetAtTop(side);
+
+    // Slide the window when the user scrolls into either edge of it.
+    const bool atTop = bar->value() == bar->minimum() && s.windowStart > 0;
+    const bool atBottom = bar->value() == bar->maximum() && s.windowStart + s.windowBytes < s.size;
+    if (atTop || atBottom) {
+        loadWindow(side, offset);
+        scrollToOffset(side, offset);
+    }
+
+    scrollToOffset(1 - side, BinaryDiff::mapOffset(diff, offset, side == 0));
+}
+
+void CompareView::jumpToDifference(int row)
+{
+    if (row < 0 || row >= diff.ranges.size()) return;
+    const DiffRange &r = diff.ranges.at(row);
+    const qint64 offsets[2] = { r.offsetA, r.offsetB };
+    const qint64 lengths[2] = { r.lengthA, r.lengthB };
+
+    // Keep a few rows of context above the difference.
+    const qint64 context = 4 * kBytesPerRow;
+    for (int side = 0; side < 2; ++side) {
+        Side &s = sides[side];
+        if (offsets[side] < s.windowStart || offsets[side] >= s.windowStart + s.windowBytes) {
+            loadWindow(side, offsets[side]);
+        }
+
+        const qint64 begin = qBound<qint64>(0, offsets[side] - s.windowStart, s.windowBytes);
+        const qint64 end = qMin<qint64>(s.windowBytes, begin + qMax<qint64>(1, lengths[side]));
+        const int last = qMax(0, s.editor->document()->characterCount() - 1);
+
+        const bool wasSyncing = syncing;
+        syncing = true;
+        QTextCursor cursor = s.editor->textCursor();
+        cursor.setPosition(int(qMin<qint64>(begin * 3, last)));
+        if (end > begin) {
+            cursor.setPosition(int(qMin<qint64>(end * 3 - 1, last)), QTextCursor::KeepAnchor);
+        }
+        s.editor->setTextCursor(cursor);
+        syncing = wasSyncing;
+
+        scrollToOffset(side, qMax<qint64>(0, offsets[side] - context));
+    }
+}
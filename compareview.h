@@ -0,0 +1,43 @@
+#ifndef COMPAREVIEW_H
+#define COMPAREVIEW_H
+
+#include <QLabel>
+#include <QListWidget>
+#include <QWidget>
+#include "binarydiff.h"
+#include "codeeditor.h"
+
+// Two read-only hex panes and the list of differences from a BinaryDiff.
+// Each pane shows a window of its file, so multi-GB inputs are never loaded
+// whole; scrolling one pane scrolls the other to the matching byte offset.
+class CompareView : public QWidget
+{
+    Q_OBJECT
+public:
+    CompareView(const QString &pathA, const QString &pathB, const DiffResult &result,
+                QWidget *parent = nullptr);
+
+private:
+    struct Side {
+        QString path;
+        qint64 size = 0;
+        qint64 windowStart = 0;
+        qint64 windowBytes = 0;
+        CodeEditor *editor = nullptr;
+    };
+
+    void loadWindow(int side, qint64 offset);
+    void scrollToOffset(int side, qint64 offset);
+    void followScroll(int side);
+    void markDifferences(int side);
+    void jumpToDifference(int row);
+    qint64 offsetAtTop(int side) const;
+
+    DiffResult diff;
+    Side sides[2];
+    QLabel *summary;
+    QListWidget *differences;
+    bool syncing = false;
+};
+
+#endif
@@ -0,0 +1,263 @@
+#include "conversionserver.h"
+#include "runnabletask.h"
+#include "searchengine.h"
+#include "streamconverter.h"
+#include "textconverter.h"
+#include "trace.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QThread>
+
+namespace {
+
+constexpr qint64 kMaxRequestSize = 64 * 1024 * 1024;
+constexpr int kDefaultResultLimit = 1000;
+constexpr int kProbeTimeoutMs = 1000;
+
+bool loadInput(const QJsonObject &request, QByteArray *input, QString *error)
+{
+    if (request.contains("text")) {
+        *input = request.value("text").toString().toUtf8();
+        return true;
+    }
+
+    const QString path = request.value("path").toString();
+    if (path.isEmpty()) {
+        *error = "Request needs \"text\" or \"path\".";
+        return false;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = "Cannot open file: " + path;
+        return false;
+    }
+    *input = file.readAll();
+    return true;
+}
+
+QJsonObject failure(QJsonObject response, const QString &error)
+{
+    response["ok"] = false;
+    response["error"] = error;
+    return response;
+}
+
+QByteArray toLine(const QJsonObject &object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+}
+
+ConversionServer::ConversionServer(QObject *parent)
+    : QObject(parent), server(new QLocalServer(this))
+{
+    maxInFlight = pool.maxThreadCount() * 4;
+    connect(server, &QLocalServer::newConnection, this, &ConversionServer::onNewConnection);
+}
+
+void ConversionServer::setThreadCount(int threads)
+{
+    if (threads > 0) {
+        pool.setMaxThreadCount(threads);
+    }
+}
+
+void ConversionServer::setMaxInFlight(int requests)
+{
+    if (requests > 0) {
+        maxInFlight = requests;
+    }
+}
+
+bool ConversionServer::listen(const QString &name)
+{
+    // A socket file left by a server that crashed makes listen() fail, but
+    // removing one that is still served would take it over. Only a socket
+    // nobody answers on is removed.
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(kProbeTimeoutMs) || probe.error() == QLocalSocket::SocketTimeoutError) {
+        listenError = "server already running";
+        return false;
+    }
+    if (probe.error() == QLocalSocket::ConnectionRefusedError) {
+        QLocalServer::removeServer(name);
+    }
+
+    listenError.clear();
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    return server->listen(name);
+}
+
+QString ConversionServer::errorString() const
+{
+    return listenError.isEmpty() ? server->errorString() : listenError;
+}
+
+QJsonObject ConversionServer::handleRequest(const QJsonObject &request)
+{
+    TRACE_SCOPE("ConversionServer::handleRequest");
+    QJsonObject response;
+    response["id"] = request.value("id");
+
+    const QString op = request.value("op").toString().toLower();
+    if (op == "ping") {
+        response["ok"] = true;
+        return response;
+    }
+
+    QByteArray input;
+    QString error;
+    if (!loadInput(request, &input, &error)) {
+        return failure(response, error);
+    }
+
+    const int limit = request.value("limit").toInt(kDefaultResultLimit);
+
+    if (op == "convert") {
+        StreamConverter converter(request.value("to").toString().toLower(),
+                                  request.value("from").toString().toLower());
+        if (!converter.isValid()) {
+            return failure(response, "Unsupported conversion target: " + request.value("to").toString());
+        }
+
+        const QByteArray output = converter.feed(input) + converter.finish();
+        if (!converter.errorString().isEmpty()) {
+            return failure(response, converter.errorString());
+        }
+        response["ok"] = true;
+        if (request.value("base64").toBool()) {
+            response["result"] = QString::fromLatin1(output.toBase64());
+        } else {
+            response["result"] = QString::fromUtf8(output);
+        }
+        return response;
+    }
+
+    if (op == "search") {
+        const QString query = request.value("query").toString();
+        if (query.isEmpty()) {
+            return failure(response, "search needs \"query\".");
+        }
+
+        const QVector<SearchMatch> matches = SearchEngine::findAll(QString::fromUtf8(input), query);
+        QJsonArray list;
+        for (int i = 0; i < matches.size() && i < limit; ++i) {
+            list.append(QJsonArray{ matches.at(i).start, matches.at(i).length });
+        }
+        response["ok"] = true;
+        response["count"] = matches.size();
+        response["matches"] = list;
+        return response;
+    }
+
+    if (op == "scan") {
+        const QByteArray needle = request.contains("hex")
+                                      ? TextConverter::hexToBytes(request.value("hex").toString().toLatin1())
+                                      : request.value("query").toString().toUtf8();
+        if (needle.isEmpty()) {
+            return failure(response, "scan needs \"hex\" or \"query\".");
+        }
+
+        QJsonArray offsets;
+        int count = 0;
+        int pos = 0;
+        while ((pos = input.indexOf(needle, pos)) != -1) {
+            if (count < limit) offsets.append(pos);
+            ++count;
+            pos += needle.size();
+        }
+        response["ok"] = true;
+        response["count"] = count;
+        response["offsets"] = offsets;
+        return response;
+    }
+
+    return failure(response, "Unsupported op: " + op + ". Use convert, search, scan or ping.");
+}
+
+void ConversionServer::onNewConnection()
+{
+    while (server->hasPendingConnections()) {
+        QLocalSocket *socket = server->nextPendingConnection();
+        socket->setReadBufferSize(kMaxRequestSize);
+        sockets.append(socket);
+        connect(socket, &QLocalSocket::readyRead, this, &ConversionServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &ConversionServer::onDisconnected);
+        processSocket(socket);
+    }
+}
+
+void ConversionServer::onReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (socket) {
+        processSocket(socket);
+    }
+}
+
+void ConversionServer::onDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!socket) {
+        return;
+    }
+
+    sockets.removeAll(socket);
+    socket->deleteLater();
+}
+
+void ConversionServer::processPending()
+{
+    const QList<QLocalSocket *> current = sockets;
+    for (QLocalSocket *socket : current) {
+        if (inFlight >= maxInFlight) {
+            return;
+        }
+        processSocket(socket);
+    }
+}
+
+void ConversionServer::processSocket(QLocalSocket *socket)
+{
+    while (inFlight < maxInFlight && socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (!line.isEmpty()) {
+            dispatch(socket, line);
+        }
+    }
+
+    if (!socket->canReadLine() && socket->bytesAvailable() >= kMaxRequestSize) {
+        socket->write(toLine(failure(QJsonObject(), "Request exceeds the maximum size.")));
+        socket->disconnectFromServer();
+    }
+}
+
+void ConversionServer::dispatch(QLocalSocket *socket, const QByteArray &line)
+{
+    ++inFlight;
+    const QPointer<QLocalSocket> guard(socket);
+    pool.start(new RunnableTask([this, guard, line]() {
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+        const QByteArray response = doc.isObject()
+                                        ? toLine(handleRequest(doc.object()))
+                                        : toLine(failure(QJsonObject(), "Invalid JSON: " + parseError.errorString()));
+
+        QMetaObject::invokeMethod(this, [this, guard, response]() {
+            finishRequest(guard, response);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void ConversionServer::finishRequest(const QPointer<QLocalSocket> &socket, const QByteArray &response)
+{
+    --inFlight;
+    if (socket && socket->state() == QLocalSocket::ConnectedState) {
+        socket->write(response);
+    }
+    processPending();
+}
@@ -0,0 +1,53 @@
+#ifndef CONVERSIONSERVER_H
+#define CONVERSIONSERVER_H
+
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+
+// Keeps the conversion engine warm behind a local (Unix domain) socket.
+//
+// Protocol: one JSON object per line in each direction. Every request carries
+// an "id" that is echoed in its response; responses may arrive out of order.
+//   {"id":1,"op":"convert","to":"hex","text":"hi"}
+//   {"id":2,"op":"search","path":"dump.bin","query":"abc"}
+//   {"id":3,"op":"scan","path":"dump.bin","hex":"DEADBEEF"}
+// Requests run on a thread pool. Once maxInFlight requests are queued the
+// server stops reading from its sockets until work drains, so a fast client
+// is throttled by the kernel socket buffer instead of growing server memory.
+class ConversionServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConversionServer(QObject *parent = nullptr);
+
+    void setThreadCount(int threads);
+    void setMaxInFlight(int requests);
+    bool listen(const QString &name);
+    QString errorString() const;
+
+    static QJsonObject handleRequest(const QJsonObject &request);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    void processPending();
+    void processSocket(QLocalSocket *socket);
+    void dispatch(QLocalSocket *socket, const QByteArray &line);
+    void finishRequest(const QPointer<QLocalSocket> &socket, const QByteArray &response);
+
+    QLocalServer *server;
+    QThreadPool pool;
+    QList<QLocalSocket *> sockets;
+    QString listenError;
+    int inFlight = 0;
+    int maxInFlight = 0;
+};
+
+#endif
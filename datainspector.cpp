@@ -0,0 +1,90 @@
+#include "datainspector.h"
+#include "bytedecoders.h"
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+DataInspector::DataInspector(QWidget *parent) : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+
+    offsetLabel = new QLabel("Offset: -", this);
+    offsetLabel->setObjectName("inspectorOffsetLabel");
+    layout->addWidget(offsetLabel);
+
+    view = new QTreeWidget(this);
+    view->setColumnCount(3);
+    view->setHeaderLabels({ "Type", "Little endian", "Big endian" });
+    view->setRootIsDecorated(false);
+    view->setUniformRowHeights(true);
+    view->setAlternatingRowColors(true);
+    view->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    layout->addWidget(view);
+
+    addRow<qint8>("int8");
+    addRow<quint8>("uint8");
+    addRow<qint16>("int16");
+    addRow<quint16>("uint16");
+    addRow<qint32>("int32");
+    addRow<quint32>("uint32");
+    addRow<qint64>("int64");
+    addRow<quint64>("uint64");
+    addRow<float>("float");
+    addRow<double>("double");
+    addRow<UnixTime32>("time_t (32)");
+    addRow<UnixTime64>("time_t (64)");
+    addRow<Guid>("GUID");
+    addUnorderedRow<VarUInt>("varint");
+    addUnorderedRow<VarSInt>("zigzag varint");
+
+    clear();
+}
+
+template <typename T>
+void DataInspector::addRow(const QString &name)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem(view, QStringList{ name });
+    rows.append({ item, ByteDecoder<T, Endian::Little>::size,
+                  &ByteDecoder<T, Endian::Little>::format,
+                  &ByteDecoder<T, Endian::Big>::format });
+}
+
+template <typename T>
+void DataInspector::addUnorderedRow(const QString &name)
+{
+    QTreeWidgetItem *item = new QTreeWidgetItem(view, QStringList{ name });
+    rows.append({ item, ByteDecoder<T, Endian::Little>::size,
+                  &ByteDecoder<T, Endian::Little>::format,
+                  nullptr });
+}
+
+void DataInspector::inspect(const QByteArray &bytes, qint64 offset)
+{
+    if (offset < 0 || offset >= bytes.size()) {
+        clear();
+        return;
+    }
+
+    offsetLabel->setText(QString("Offset: %1 (0x%2)").arg(offset).arg(QString::number(offset, 16).toUpper()));
+
+    const uchar *data = reinterpret_cast<const uchar *>(bytes.constData()) + offset;
+    const int available = static_cast<int>(qMin<qint64>(bytes.size() - offset, 16));
+    for (const Row &row : qAsConst(rows)) {
+        if (available < row.size) {
+            row.item->setText(1, "-");
+            row.item->setText(2, row.big ? "-" : QString());
+            continue;
+        }
+        row.item->setText(1, row.little(data, available));
+        row.item->setText(2, row.big ? row.big(data, available) : QString());
+    }
+}
+
+void DataInspector::clear()
+{
+    offsetLabel->setText("Offset: -");
+    for (const Row &row : qAsConst(rows)) {
+        row.item->setText(1, "-");
+        row.item->setText(2, row.big ? "-" : QString());
+    }
+}
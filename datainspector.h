@@ -0,0 +1,39 @@
+#ifndef DATAINSPECTOR_H
+#define DATAINSPECTOR_H
+
+#include <QByteArray>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QVector>
+#include <QWidget>
+
+class DataInspector : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DataInspector(QWidget *parent = nullptr);
+
+    void inspect(const QByteArray &bytes, qint64 offset);
+    void clear();
+
+private:
+    typedef QString (*Formatter)(const uchar *data, int available);
+
+    struct Row {
+        QTreeWidgetItem *item;
+        int size;
+        Formatter little;
+        Formatter big;
+    };
+
+    template <typename T>
+    void addRow(const QString &name);
+    template <typename T>
+    void addUnorderedRow(const QString &name);
+
+    QLabel *offsetLabel;
+    QTreeWidget *view;
+    QVector<Row> rows;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "decodedtext.h"
+#include "trace.h"
+#include <algorithm>
+
+namespace {
+
+// Length of the UTF-8 sequence at p, at most left bytes long, with its code
+// point in code; -1 when p does not start a valid, shortest-form sequence.
+inline int sequenceAt(const uchar *p, qint64 left, uint *code) {
+    const uchar c = p[0];
+    if (c < 0x80) {
+        *code = c;
+        return 1;
+    }
+
+    int length = 0;
+    uchar low = 0x80;
+    uchar high = 0xBF;
+    uint value = 0;
+    if (c >= 0xC2 && c <= 0xDF) {
+        length = 2;
+        value = c & 0x1F;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        length = 3;
+        value = c & 0x0F;
+        if (c == 0xE0) low = 0xA0;
+        else if (c == 0xED) high = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        length = 4;
+        value = c & 0x07;
+        if (c == 0xF0) low = 0x90;
+        else if (c == 0xF4) high = 0x8F;
+    } else {
+        return -1;
+    }
+
+    if (left < length || p[1] < low || p[1] > high) return -1;
+    value = (value << 6) | (p[1] & 0x3F);
+    for (int i = 2; i < length; ++i) {
+        if ((p[i] & 0xC0) != 0x80) return -1;
+        value = (value << 6) | (p[i] & 0x3F);
+    }
+    *code = value;
+    return length;
+}
+
+// As sequenceAt, with an invalid byte taken as one U+FFFD.
+inline int characterAt(const uchar *p, qint64 left, uint *code) {
+    const int length = sequenceAt(p, left, code);
+    if (length > 0) return length;
+    *code = 0xFFFD;
+    return 1;
+}
+
+// Characters QTextCursor::insertText turns into block breaks; "\r\n" is one.
+inline bool isBlockBreak(uint code) {
+    return code == '\n' || code == '\r' || code == 0x2029 || code == 0xFDD0 || code == 0xFDD1;
+}
+
+}
+
+QString DecodedText::decode(const QByteArray &bytes) {
+    TRACE_SCOPE("DecodedText::decode");
+    // Never more units than bytes: only four-byte sequences take two.
+    QString text(bytes.size(), Qt::Uninitialized);
+    ushort *out = reinterpret_cast<ushort *>(text.data());
+    const ushort *begin = out;
+    const uchar *p = reinterpret_cast<const uchar *>(bytes.constData());
+    const qint64 n = bytes.size();
+    for (qint64 i = 0; i < n;) {
+        if (p[i] < 0x80) {
+            *out++ = p[i++];
+            continue;
+        }
+        uint code = 0;
+        i += characterAt(p + i, n - i, &code);
+        if (code > 0xFFFF) {
+            *out++ = QChar::highSurrogate(code);
+            *out++ = QChar::lowSurrogate(code);
+        } else {
+            *out++ = ushort(code);
+        }
+    }
+    text.truncate(int(out - begin));
+    return text;
+}
+
+DecodedText::DecodedText(const QByteArray &data)
+    : bytes(data)
+{
+    TRACE_SCOPE("DecodedText::build");
+    const uchar *p = reinterpret_cast<const uchar *>(bytes.constData());
+    const qint64 n = bytes.size();
+    blocks.append(0);
+    checkpointUnit.append(0);
+    checkpointByte.append(0);
+
+    qint64 unit = 0;
+    qint64 nextCheckpoint = checkpointUnits;
+    for (qint64 i = 0; i < n;) {
+        // A pair can straddle the mark; the checkpoint goes after it.
+        if (unit >= nextCheckpoint) {
+            checkpointUnit.append(unit);
+            checkpointByte.append(i);
+            nextCheckpoint = (unit / checkpointUnits + 1) * checkpointUnits;
+        }
+        uint code = 0;
+        i += characterAt(p + i, n - i, &code);
+        unit += code > 0xFFFF ? 2 : 1;
+        if (code == '\r' && i < n && p[i] == '\n') {
+            ++i;
+            ++unit;
+        }
+        if (isBlockBreak(code)) blocks.append(unit);
+    }
+    units = unit;
+}
+
+qint64 DecodedText::blockStart(int block) const {
+    if (block <= 0) return 0;
+    return block < blocks.size() ? blocks.at(block) : units;
+}
+
+int DecodedText::blockOf(qint64 unit) const {
+    const int block = int(std::upper_bound(blocks.constBegin(), blocks.constEnd(), unit) - blocks.constBegin()) - 1;
+    return qMax(0, block);
+}
+
+qint64 DecodedText::byteOffset(qint64 unit) const {
+    if (unit <= 0) return 0;
+    if (unit >= units) return bytes.size();
+
+    const int k = int(std::upper_bound(checkpointUnit.constBegin(), checkpointUnit.constEnd(), unit)
+                      - checkpointUnit.constBegin()) - 1;
+    const uchar *p = reinterpret_cast<const uchar *>(bytes.constData());
+    const qint64 n = bytes.size();
+    qint64 u = checkpointUnit.at(k);
+    qint64 i = checkpointByte.at(k);
+    while (i < n) {
+        uint code = 0;
+        const int length = characterAt(p + i, n - i, &code);
+        const int width = code > 0xFFFF ? 2 : 1;
+        if (u + width > unit) break;
+        u += width;
+        i += length;
+    }
+    return i;
+}
+
+qint64 DecodedText::unitAt(qint64 byte) const {
+    if (byte <= 0) return 0;
+    if (byte >= bytes.size()) return units;
+
+    const int k = int(std::upper_bound(checkpointByte.constBegin(), checkpointByte.constEnd(), byte)
+                      - checkpointByte.constBegin()) - 1;
+    const uchar *p = reinterpret_cast<const uchar *>(bytes.constData());
+    const qint64 n = bytes.size();
+    qint64 u = checkpointUnit.at(k);
+    qint64 i = checkpointByte.at(k);
+    while (i < n) {
+        uint code = 0;
+        const int length = characterAt(p + i, n - i, &code);
+        if (i + length > byte) break;
+        u += code > 0xFFFF ? 2 : 1;
+        i += length;
+    }
+    return u;
+}
@@ -0,0 +1,48 @@
+#ifndef DECODEDTEXT_H
+#define DECODEDTEXT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Bytes shown as UTF-8 text in an editor pane. Every byte that is not part of
+// a valid sequence decodes to a U+FFFD of its own, so each character of the
+// text comes from a known run of bytes. The layout built from the same bytes
+// maps UTF-16 units of that text to byte offsets and to the blocks
+// QTextDocument::setPlainText splits it into, so a pane position finds its
+// byte without reading the document back: the first unit of every block and
+// the byte offset of every checkpointUnits-th unit are kept.
+class DecodedText
+{
+public:
+    static const int checkpointUnits = 1024;
+
+    static QString decode(const QByteArray &bytes);
+
+    explicit DecodedText(const QByteArray &data = QByteArray());
+
+    // Whether this layout was built from this very buffer; a changed copy of
+    // it never is, because the layout keeps the old one shared.
+    bool isBuiltFrom(const QByteArray &data) const { return data.constData() == bytes.constData(); }
+
+    qint64 unitCount() const { return units; }
+    int blockCount() const { return blocks.size(); }
+    // First unit of a block; unitCount() past the last one.
+    qint64 blockStart(int block) const;
+    // Block holding a unit.
+    int blockOf(qint64 unit) const;
+
+    // Where the character holding unit starts; unitCount() maps to the end.
+    qint64 byteOffset(qint64 unit) const;
+    // First unit of the character holding byte.
+    qint64 unitAt(qint64 byte) const;
+
+private:
+    QByteArray bytes;
+    QVector<qint64> blocks;
+    QVector<qint64> checkpointUnit;
+    QVector<qint64> checkpointByte;
+    qint64 units = 0;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include "entropyanalyzer.h"
+#include "trace.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int kTargetBlocks = 4096;
+constexpr qint64 kMinBlockSize = 4096;
+
+struct CacheEntry {
+    qint64 size = 0;
+    qint64 modified = 0;
+    EntropyProfile profile;
+};
+
+QMutex cacheMutex;
+QHash<QString, CacheEntry> cache;
+
+// Entropy for blocks [firstBlock, lastBlock) of data that starts at the first
+// of those blocks.
+void analyzeBlocks(const uchar *data, qint64 dataSize, qint64 blockSize, int firstBlock, int lastBlock,
+                   EntropyProfile *profile, quint64 *histogram)
+{
+    quint64 counts[256];
+    for (int block = firstBlock; block < lastBlock; ++block) {
+        const qint64 begin = qint64(block - firstBlock) * blockSize;
+        const qint64 size = qMin(blockSize, dataSize - begin);
+        std::memset(counts, 0, sizeof(counts));
+        EntropyAnalyzer::countBytes(data + begin, size, counts);
+
+        profile->entropy[block] = EntropyAnalyzer::shannonEntropy(counts, quint64(size));
+        profile->zeroRatio[block] = size > 0 ? float(double(counts[0]) / size) : 0.0f;
+        for (int i = 0; i < 256; ++i) histogram[i] += counts[i];
+    }
+}
+
+// Runs body(first, last) for contiguous block ranges on all cores, then folds
+// the per-worker histograms into the profile.
+void runParallel(EntropyProfile &profile,
+                 const std::function<void(int, int, quint64 *)> &body)
+{
+    const int blocks = profile.entropy.size();
+    const int workers = qBound(1, QThread::idealThreadCount(), blocks);
+    std::vector<std::array<quint64, 256>> histograms(workers);
+    std::vector<std::thread> threads;
+
+    const int perWorker = (blocks + workers - 1) / workers;
+    for (int w = 0; w < workers; ++w) {
+        const int first = w * perWorker;
+        const int last = qMin(blocks, first + perWorker);
+        histograms[w].fill(0);
+        if (first >= last) continue;
+        threads.emplace_back([&, w, first, last]() { body(first, last, histograms[w].data()); });
+    }
+    for (std::thread &t : threads) t.join();
+
+    for (const auto &h : histograms) {
+        for (int i = 0; i < 256; ++i) profile.histogram[i] += h[i];
+    }
+}
+
+EntropyProfile emptyProfile(qint64 dataSize, qint64 blockSize)
+{
+    EntropyProfile profile;
+    profile.dataSize = dataSize;
+    profile.blockSize = blockSize > 0 ? blockSize : EntropyAnalyzer::defaultBlockSize(dataSize);
+    const int blocks = dataSize > 0 ? int((dataSize + profile.blockSize - 1) / profile.blockSize) : 0;
+    profile.entropy.resize(blocks);
+    profile.zeroRatio.resize(blocks);
+    return profile;
+}
+
+}
+
+int EntropyProfile::blockForOffset(qint64 offset) const
+{
+    if (blockSize <= 0 || entropy.isEmpty()) return -1;
+    return int(qBound<qint64>(0, offset / blockSize, entropy.size() - 1));
+}
+
+qint64 EntropyAnalyzer::defaultBlockSize(qint64 dataSize)
+{
+    qint64 blockSize = kMinBlockSize;
+    while (dataSize / blockSize > kTargetBlocks) {
+        blockSize *= 2;
+    }
+    return blockSize;
+}
+
+void EntropyAnalyzer::countBytes(const uchar *data, qint64 size, quint64 *counts)
+{
+    // Four interleaved tables break the store-to-load dependency a single
+    // table has on runs of the same byte. 32-bit counters are flushed before
+    // they can overflow.
+    quint32 c[4][256];
+    const qint64 flushEvery = qint64(1) << 30;
+
+    qint64 done = 0;
+    while (done < size) {
+        std::memset(c, 0, sizeof(c));
+        const qint64 n = qMin(flushEvery, size - done);
+        const uchar *p = data + done;
+        const uchar *end = p + n;
+        quint64 zeroRun = 0;
+
+        while (end - p >= 64) {
+#ifdef __SSE2__
+            // Zero-filled regions are common in disk images; count them a
+            // cache line at a time.
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 32));
+            const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 48));
+            const __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(d, e));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) == 0xFFFF) {
+                zeroRun += 64;
+                p += 64;
+                continue;
+            }
+#endif
+            for (int i = 0; i < 64; i += 8) {
+                quint64 w;
+                std::memcpy(&w, p + i, 8);
+                ++c[0][w & 0xFF];
+                ++c[1][(w >> 8) & 0xFF];
+                ++c[2][(w >> 16) & 0xFF];
+                ++c[3][(w >> 24) & 0xFF];
+                ++c[0][(w >> 32) & 0xFF];
+                ++c[1][(w >> 40) & 0xFF];
+                ++c[2][(w >> 48) & 0xFF];
+                ++c[3][w >> 56];
+            }
+            p += 64;
+        }
+        while (p < end) {
+            ++c[0][*p++];
+        }
+
+        for (int i = 0; i < 256; ++i) {
+            counts[i] += quint64(c[0][i]) + c[1][i] + c[2][i] + c[3][i];
+        }
+        counts[0] += zeroRun;
+        done += n;
+    }
+}
+
+float EntropyAnalyzer::shannonEntropy(const quint64 *counts, quint64 total)
+{
+    if (total == 0) return 0.0f;
+
+    double h = 0.0;
+    const double inv = 1.0 / double(total);
+    for (int i = 0; i < 256; ++i) {
+        if (!counts[i]) continue;
+        const double p = double(counts[i]) * inv;
+        h -= p * std::log2(p);
+    }
+    return float(h);
+}
+
+EntropyProfile EntropyAnalyzer::analyzeBytes(const QByteArray &data, qint64 blockSize)
+{
+    TRACE_SCOPE("EntropyAnalyzer::analyzeBytes");
+    EntropyProfile profile = emptyProfile(data.size(), blockSize);
+    if (profile.entropy.isEmpty()) return profile;
+
+    const uchar *base = reinterpret_cast<const uchar *>(data.constData());
+    runParallel(profile, [&](int first, int last, quint64 *histogram) {
+        analyzeBlocks(base + qint64(first) * profile.blockSize, profile.dataSize - qint64(first) * profile.blockSize,
+                      profile.blockSize, first, last, &profile, histogram);
+    });
+    return profile;
+}
+
+EntropyProfile EntropyAnalyzer::analyzeFile(const QString &path, qint64 blockSize)
+{
+    TRACE_SCOPE("EntropyAnalyzer::analyzeFile");
+    EntropyProfile profile = emptyProfile(QFileInfo(path).size(), blockSize);
+    if (profile.entropy.isEmpty()) return profile;
+
+    runParallel(profile, [&](int first, int last, quint64 *histogram) {
+        const qint64 begin = qint64(first) * profile.blockSize;
+        const qint64 length = qMin(profile.dataSize, qint64(last) * profile.blockSize) - begin;
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return;
+
+        uchar *mapped = file.map(begin, length);
+        if (mapped) {
+            analyzeBlocks(mapped, length, profile.blockSize, first, last, &profile, histogram);
+            file.unmap(mapped);
+            return;
+        }
+
+        // Not mappable (pipes, some network filesystems): read block by block.
+        file.seek(begin);
+        for (int block = first; block < last; ++block) {
+            const QByteArray chunk = file.read(profile.blockSize);
+            analyzeBlocks(reinterpret_cast<const uchar *>(chunk.constData()), chunk.size(),
+                          profile.blockSize, block, block + 1, &profile, histogram);
+        }
+    });
+    return profile;
+}
+
+EntropyProfile EntropyAnalyzer::cachedAnalyzeFile(const QString &path)
+{
+    const QFileInfo info(path);
+    const QString key = info.canonicalFilePath();
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        const auto it = cache.constFind(key);
+        if (it != cache.constEnd() && it->size == info.size() && it->modified == modified) {
+            return it->profile;
+        }
+    }
+
+    CacheEntry entry;
+    entry.size = info.size();
+    entry.modified = modified;
+    entry.profile = analyzeFile(path);
+
+    QMutexLocker locker(&cacheMutex);
+    cache.insert(key, entry);
+    return entry.profile;
+}
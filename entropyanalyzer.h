@@ -0,0 +1,39 @@
+#ifndef ENTROPYANALYZER_H
+#define ENTROPYANALYZER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <array>
+
+struct EntropyProfile {
+    qint64 dataSize = 0;
+    qint64 blockSize = 0;
+    QVector<float> entropy;      // Shannon entropy per block, 0..8 bits per byte
+    QVector<float> zeroRatio;    // fraction of 0x00 bytes per block
+    std::array<quint64, 256> histogram{};
+
+    bool isEmpty() const { return entropy.isEmpty(); }
+    int blockForOffset(qint64 offset) const;
+};
+
+// Per-block entropy and byte histograms. Blocks are split across all cores;
+// files are memory mapped, one mapping per worker, so a multi-GB image is
+// never copied into memory.
+class EntropyAnalyzer
+{
+public:
+    static qint64 defaultBlockSize(qint64 dataSize);
+
+    static EntropyProfile analyzeBytes(const QByteArray &data, qint64 blockSize = 0);
+    static EntropyProfile analyzeFile(const QString &path, qint64 blockSize = 0);
+
+    // Returns the cached profile when the file's size and mtime are
+    // unchanged, otherwise analyses and caches it.
+    static EntropyProfile cachedAnalyzeFile(const QString &path);
+
+    static void countBytes(const uchar *data, qint64 size, quint64 *counts);
+    static float shannonEntropy(const quint64 *counts, quint64 total);
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "entropyminimap.h"
+#include <QMouseEvent>
+#include <QPainter>
+
+EntropyMinimap::EntropyMinimap(QWidget *parent) : QWidget(parent)
+{
+    setFixedWidth(14);
+    setCursor(Qt::PointingHandCursor);
+    setToolTip("Entropy map: click to jump");
+}
+
+QSize EntropyMinimap::sizeHint() const
+{
+    return QSize(14, 0);
+}
+
+void EntropyMinimap::setProfile(const EntropyProfile &newProfile)
+{
+    profile = newProfile;
+    update();
+}
+
+void EntropyMinimap::setVisibleRange(double startFraction, double endFraction)
+{
+    visibleStart = startFraction;
+    visibleEnd = endFraction;
+    update();
+}
+
+QColor EntropyMinimap::colorFor(float entropy, float zeroRatio)
+{
+    if (zeroRatio > 0.98f) {
+        return QColor(0, 0, 0);
+    }
+
+    // 0 bits -> blue, 4 bits -> green, 8 bits -> red.
+    const double t = qBound(0.0, entropy / 8.0, 1.0);
+    if (t < 0.5) {
+        const double k = t * 2.0;
+        return QColor(0, int(200 * k), int(220 * (1.0 - k) + 40 * k));
+    }
+    const double k = (t - 0.5) * 2.0;
+    return QColor(int(230 * k), int(200 * (1.0 - k)), 40);
+}
+
+void EntropyMinimap::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(0x1a, 0x24, 0x30));
+
+    const int blocks = profile.entropy.size();
+    const int h = height();
+    if (blocks == 0 || h <= 0) {
+        return;
+    }
+
+    // Each pixel row shows the most "interesting" block it covers: the one
+    // with the highest entropy, so a small encrypted island never disappears.
+    for (int y = 0; y < h; ++y) {
+        const int first = int(qint64(y) * blocks / h);
+        const int last = qMax(first + 1, int(qint64(y + 1) * blocks / h));
+        float entropy = 0.0f;
+        float zero = 1.0f;
+        for (int b = first; b < last && b < blocks; ++b) {
+            entropy = qMax(entropy, profile.entropy.at(b));
+            zero = qMin(zero, profile.zeroRatio.at(b));
+        }
+        painter.setPen(colorFor(entropy, zero));
+        painter.drawLine(0, y, width() - 1, y);
+    }
+
+    if (visibleEnd > visibleStart) {
+        const int top = int(visibleStart * h);
+        const int bottom = qMax(top + 2, int(visibleEnd * h));
+        painter.setPen(QColor(255, 255, 255, 200));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(0, top, width() - 1, bottom - top);
+    }
+}
+
+void EntropyMinimap::mousePressEvent(QMouseEvent *event)
+{
+    requestOffsetAt(event->pos().y());
+}
+
+void EntropyMinimap::mouseMoveEvent(QMouseEvent *event)
+{
+    if (event->buttons() & Qt::LeftButton) {
+        requestOffsetAt(event->pos().y());
+    }
+}
+
+void EntropyMinimap::requestOffsetAt(int y)
+{
+    if (profile.dataSize <= 0 || height() <= 0) {
+        return;
+    }
+
+    const double fraction = qBound(0.0, double(y) / height(), 1.0);
+    emit offsetRequested(qMin(profile.dataSize - 1, qint64(fraction * profile.dataSize)));
+}
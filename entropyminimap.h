@@ -0,0 +1,37 @@
+#ifndef ENTROPYMINIMAP_H
+#define ENTROPYMINIMAP_H
+
+#include <QWidget>
+#include "entropyanalyzer.h"
+
+// Vertical strip drawn next to an editor's scrollbar: one colour per row of
+// blocks (black = zero filled, blue = low entropy, red = compressed or
+// encrypted). Clicking or dragging requests a jump to that offset.
+class EntropyMinimap : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit EntropyMinimap(QWidget *parent = nullptr);
+
+    void setProfile(const EntropyProfile &profile);
+    void setVisibleRange(double startFraction, double endFraction);
+    QSize sizeHint() const override;
+
+signals:
+    void offsetRequested(qint64 offset);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    void requestOffsetAt(int y);
+    static QColor colorFor(float entropy, float zeroRatio);
+
+    EntropyProfile profile;
+    double visibleStart = 0;
+    double visibleEnd = 0;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "exportwriter.h"
+#include "trace.h"
+#include <QBuffer>
+#include <QIODevice>
+#include <cstring>
+
+namespace {
+
+// A multiple of 3 (base64) and of every line length below.
+constexpr qint64 kBlockSize = 48 * 1024;
+
+const char kHexDigits[] = "0123456789ABCDEF";
+
+struct LineStyle {
+    int bytesPerLine;
+    const char *prefix;     // before the first byte of a line
+    const char *item;       // before each byte's two hex digits
+    const char *separator;  // after each byte but the last of a line
+    const char *suffix;     // after the last byte of a line
+};
+
+const LineStyle kCStyle = { 12, "    ", "0x", ", ", ",\n" };
+const LineStyle kGoStyle = { 12, "\t", "0x", ", ", ",\n" };
+const LineStyle kPythonStyle = { 16, "    b\"", "\\x", "", "\"\n" };
+
+const LineStyle *lineStyle(ExportWriter::Format format)
+{
+    switch (format) {
+    case ExportWriter::CArray: return &kCStyle;
+    case ExportWriter::GoSlice: return &kGoStyle;
+    case ExportWriter::PythonBytes: return &kPythonStyle;
+    default: return nullptr;
+    }
+}
+
+QByteArray header(ExportWriter::Format format, qint64 size)
+{
+    switch (format) {
+    case ExportWriter::CArray: return "unsigned char data[" + QByteArray::number(size) + "] = {\n";
+    case ExportWriter::GoSlice: return "data := []byte{\n";
+    case ExportWriter::PythonBytes: return size == 0 ? "data = b\"\"\n" : "data = (\n";
+    default: return QByteArray();
+    }
+}
+
+QByteArray footer(ExportWriter::Format format, qint64 size)
+{
+    switch (format) {
+    case ExportWriter::CArray: return "};\n";
+    case ExportWriter::GoSlice: return "}\n";
+    case ExportWriter::PythonBytes: return size == 0 ? QByteArray() : QByteArray(")\n");
+    default: return QByteArray();
+    }
+}
+
+void appendHex(QByteArray &out, const uchar *data, qint64 size)
+{
+    const int start = out.size();
+    out.resize(start + int(size * 2));
+    char *dst = out.data() + start;
+    for (qint64 i = 0; i < size; ++i) {
+        *dst++ = kHexDigits[data[i] >> 4];
+        *dst++ = kHexDigits[data[i] & 0xF];
+    }
+}
+
+qint64 linesSize(qint64 size, const LineStyle &style)
+{
+    const qint64 lines = (size + style.bytesPerLine - 1) / style.bytesPerLine;
+    const qint64 perByte = qint64(qstrlen(style.item)) + 2 + qint64(qstrlen(style.separator));
+    const qint64 perLine = qint64(qstrlen(style.prefix)) + qint64(qstrlen(style.suffix))
+                           - qint64(qstrlen(style.separator));
+    return size * perByte + lines * perLine;
+}
+
+void appendLines(QByteArray &out, const uchar *data, qint64 size, const LineStyle &style)
+{
+    const size_t prefixLength = qstrlen(style.prefix);
+    const size_t itemLength = qstrlen(style.item);
+    const size_t separatorLength = qstrlen(style.separator);
+    const size_t suffixLength = qstrlen(style.suffix);
+    const int start = out.size();
+    out.resize(start + int(linesSize(size, style)));
+    char *dst = out.data() + start;
+    const auto put = [&dst](const char *text, size_t length) {
+        std::memcpy(dst, text, length);
+        dst += length;
+    };
+
+    for (qint64 line = 0; line < size; line += style.bytesPerLine) {
+        const qint64 end = qMin(size, line + style.bytesPerLine);
+        put(style.prefix, prefixLength);
+        for (qint64 i = line; i < end; ++i) {
+            put(style.item, itemLength);
+            *dst++ = kHexDigits[data[i] >> 4];
+            *dst++ = kHexDigits[data[i] & 0xF];
+            if (i + 1 < end) {
+                put(style.separator, separatorLength);
+            } else {
+                put(style.suffix, suffixLength);
+            }
+        }
+    }
+}
+
+}
+
+QStringList ExportWriter::formatNames()
+{
+    return { "Hex String", "C Array", "Python Bytes", "Base64", "Go Slice" };
+}
+
+int ExportWriter::parseFormat(const QString &name)
+{
+    const QStringList names = formatNames();
+    for (int i = 0; i < names.size(); ++i) {
+        if (names.at(i).compare(name, Qt::CaseInsensitive) == 0) return i;
+    }
+    return -1;
+}
+
+qint64 ExportWriter::outputSize(qint64 size, Format format)
+{
+    const qint64 fixed = header(format, size).size() + footer(format, size).size();
+    if (const LineStyle *style = lineStyle(format)) {
+        return fixed + linesSize(size, *style);
+    }
+    return fixed + (format == Base64 ? (size + 2) / 3 * 4 : size * 2);
+}
+
+bool ExportWriter::write(const char *data, qint64 size, Format format, QIODevice *out,
+                         const Progress &progress, QString *error)
+{
+    TRACE_SCOPE("ExportWriter::write");
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    const LineStyle *style = lineStyle(format);
+    QByteArray buffer = header(format, size);
+    buffer.reserve(int(outputSize(kBlockSize, format)));
+
+    for (qint64 offset = 0; offset < size; offset += kBlockSize) {
+        const qint64 length = qMin(kBlockSize, size - offset);
+        if (style) {
+            appendLines(buffer, bytes + offset, length, *style);
+        } else if (format == Base64) {
+            buffer += QByteArray::fromRawData(data + offset, int(length)).toBase64();
+        } else {
+            appendHex(buffer, bytes + offset, length);
+        }
+
+        if (out->write(buffer) != buffer.size()) {
+            if (error) *error = out->errorString();
+            return false;
+        }
+        buffer.resize(0);
+        if (progress && !progress(offset + length, size)) {
+            if (error) *error = "Cancelled";
+            return false;
+        }
+    }
+
+    buffer += footer(format, size);
+    if (!buffer.isEmpty() && out->write(buffer) != buffer.size()) {
+        if (error) *error = out->errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray ExportWriter::toByteArray(const char *data, qint64 size, Format format, const Progress &progress)
+{
+    QByteArray result;
+    result.reserve(int(outputSize(size, format)));
+    QBuffer buffer(&result);
+    buffer.open(QIODevice::WriteOnly);
+    if (!write(data, size, format, &buffer, progress)) {
+        return QByteArray();
+    }
+    return result;
+}
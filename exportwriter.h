@@ -0,0 +1,35 @@
+#ifndef EXPORTWRITER_H
+#define EXPORTWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class QIODevice;
+
+// Renders bytes as source text or an encoding for "Copy As" / "Export
+// Selection". Output is produced a block at a time and written as it goes,
+// so exporting a large selection to a file needs one block of memory.
+class ExportWriter
+{
+public:
+    enum Format { HexString, CArray, PythonBytes, Base64, GoSlice };
+
+    // Called with bytes done and total; returning false cancels.
+    typedef std::function<bool(qint64 done, qint64 total)> Progress;
+
+    // Names in Format order, as shown to the user.
+    static QStringList formatNames();
+    // Index into formatNames(), or -1.
+    static int parseFormat(const QString &name);
+    // Output size in bytes, for deciding whether the clipboard is sensible.
+    static qint64 outputSize(qint64 size, Format format);
+
+    static bool write(const char *data, qint64 size, Format format, QIODevice *out,
+                      const Progress &progress = Progress(), QString *error = nullptr);
+    static QByteArray toByteArray(const char *data, qint64 size, Format format,
+                                  const Progress &progress = Progress());
+};
+
+#endif
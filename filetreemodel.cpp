@@ -0,0 +1,245 @@
+#include "filetreemodel.h"
+#include "runnabletask.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileIconProvider>
+#include <QFileInfo>
+#include <QLocale>
+#include <QPointer>
+#include <algorithm>
+
+namespace {
+
+constexpr int kStatBatch = 2048;
+
+}
+
+FileTreeModel::FileTreeModel(QObject *parent)
+    : QAbstractItemModel(parent), cancelled(std::make_shared<std::atomic<bool>>(false))
+{
+    // Listing one huge folder should not hold up another.
+    pool.setMaxThreadCount(2);
+
+    QFileIconProvider icons;
+    folderIcon = icons.icon(QFileIconProvider::Folder);
+    fileIcon = icons.icon(QFileIconProvider::File);
+    setRootPath(QString());
+}
+
+FileTreeModel::~FileTreeModel()
+{
+    cancelled->store(true);
+    pool.waitForDone();
+}
+
+void FileTreeModel::setRootPath(const QString &path)
+{
+    beginResetModel();
+    cancelled->store(true);
+    cancelled = std::make_shared<std::atomic<bool>>(false);
+    ++generation;
+
+    root.reset(new Node());
+    root->path = path;
+    root->isDir = true;
+    if (path.isEmpty()) {
+        // A handful of entries, known without touching the disk.
+        for (const QFileInfo &drive : QDir::drives()) {
+            std::unique_ptr<Node> child(new Node());
+            child->path = drive.absoluteFilePath();
+            child->name = QDir::toNativeSeparators(child->path);
+            child->parent = root.get();
+            child->row = int(root->children.size());
+            child->isDir = true;
+            root->children.push_back(std::move(child));
+        }
+        root->state = Loaded;
+    }
+    endResetModel();
+}
+
+QString FileTreeModel::filePath(const QModelIndex &index) const
+{
+    const Node *node = nodeFor(index);
+    return node == root.get() ? QString() : node->path;
+}
+
+bool FileTreeModel::isDir(const QModelIndex &index) const
+{
+    return nodeFor(index)->isDir;
+}
+
+FileTreeModel::Node *FileTreeModel::nodeFor(const QModelIndex &index) const
+{
+    return index.isValid() ? static_cast<Node *>(index.internalPointer()) : root.get();
+}
+
+QModelIndex FileTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const Node *node = nodeFor(parent);
+    if (row < 0 || row >= int(node->children.size()) || column < 0 || column >= ColumnCount) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, node->children[size_t(row)].get());
+}
+
+QModelIndex FileTreeModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid()) return QModelIndex();
+    Node *parentNode = nodeFor(index)->parent;
+    if (!parentNode || parentNode == root.get()) return QModelIndex();
+    return createIndex(parentNode->row, 0, parentNode);
+}
+
+int FileTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) return 0;
+    return int(nodeFor(parent)->children.size());
+}
+
+int FileTreeModel::columnCount(const QModelIndex &) const
+{
+    return ColumnCount;
+}
+
+bool FileTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) return false;
+    const Node *node = nodeFor(parent);
+    // Unlisted folders get an expander; listing them decides for real.
+    return node->state == Loaded ? !node->children.empty() : node->isDir;
+}
+
+bool FileTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) return false;
+    const Node *node = nodeFor(parent);
+    return node->isDir && node->state == NotLoaded;
+}
+
+void FileTreeModel::fetchMore(const QModelIndex &parent)
+{
+    Node *node = nodeFor(parent);
+    if (!node->isDir || node->state != NotLoaded) return;
+    node->state = Loading;
+
+    const QString path = node->path;
+    const quint64 gen = generation;
+    const std::shared_ptr<std::atomic<bool>> stop = cancelled;
+    QPointer<FileTreeModel> guard(this);
+    pool.start(new RunnableTask([path, gen, stop, guard, node]() {
+        TRACE_SCOPE("FileTreeModel::list");
+        QVector<Entry> entries;
+        QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+        while (it.hasNext() && !stop->load()) {
+            it.next();
+            entries.append(Entry{ it.fileName(), it.fileInfo().isDir() });
+        }
+        if (stop->load()) return;
+
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            if (a.isDir != b.isDir) return a.isDir;
+            return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
+        });
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, gen, node, entries]() {
+            if (guard && guard->generation == gen) guard->insertEntries(node, entries);
+        }, Qt::QueuedConnection);
+
+        // Sizes need a stat per entry; send them in slices so a big folder
+        // fills in progressively.
+        const QDir dir(path);
+        const int total = int(entries.size());
+        for (int first = 0; first < total && !stop->load(); first += kStatBatch) {
+            const int count = qMin(kStatBatch, total - first);
+            QVector<qint64> sizes(count, -1);
+            for (int i = 0; i < count; ++i) {
+                const Entry &entry = entries.at(first + i);
+                if (!entry.isDir) sizes[i] = QFileInfo(dir.filePath(entry.name)).size();
+            }
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, gen, node, first, sizes]() {
+                if (guard && guard->generation == gen) guard->updateSizes(node, first, sizes);
+            }, Qt::QueuedConnection);
+        }
+    }));
+}
+
+void FileTreeModel::insertEntries(Node *node, const QVector<Entry> &entries)
+{
+    TRACE_SCOPE("FileTreeModel::insertEntries");
+    const QModelIndex parentIndex = (node == root.get()) ? QModelIndex() : createIndex(node->row, 0, node);
+    node->state = Loaded;
+    if (entries.isEmpty()) {
+        // Drops the expander that hasChildren() promised.
+        if (parentIndex.isValid()) emit dataChanged(parentIndex, parentIndex);
+        return;
+    }
+
+    const QDir dir(node->path);
+    beginInsertRows(parentIndex, 0, int(entries.size()) - 1);
+    node->children.reserve(size_t(entries.size()));
+    for (const Entry &entry : entries) {
+        std::unique_ptr<Node> child(new Node());
+        child->name = entry.name;
+        child->path = dir.filePath(entry.name);
+        child->parent = node;
+        child->row = int(node->children.size());
+        child->isDir = entry.isDir;
+        node->children.push_back(std::move(child));
+    }
+    endInsertRows();
+}
+
+void FileTreeModel::updateSizes(Node *node, int firstRow, const QVector<qint64> &sizes)
+{
+    const int count = int(sizes.size());
+    if (count == 0 || firstRow + count > int(node->children.size())) return;
+    for (int i = 0; i < count; ++i) {
+        node->children[size_t(firstRow + i)]->size = sizes.at(i);
+    }
+    Node *first = node->children[size_t(firstRow)].get();
+    Node *last = node->children[size_t(firstRow + count - 1)].get();
+    emit dataChanged(createIndex(first->row, SizeColumn, first), createIndex(last->row, SizeColumn, last),
+                     { Qt::DisplayRole });
+}
+
+QVariant FileTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) return QVariant();
+    const Node *node = nodeFor(index);
+
+    if (role == Qt::ToolTipRole) return QDir::toNativeSeparators(node->path);
+    if (role == Qt::DecorationRole && index.column() == NameColumn) {
+        return node->isDir ? folderIcon : fileIcon;
+    }
+    if (role == Qt::TextAlignmentRole && index.column() == SizeColumn) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole) return QVariant();
+
+    switch (index.column()) {
+    case NameColumn:
+        return node->name;
+    case SizeColumn:
+        if (node->isDir || node->size < 0) return QString();
+        return QLocale().formattedDataSize(node->size);
+    case TypeColumn: {
+        if (node->isDir) return QString("Folder");
+        const QString suffix = QFileInfo(node->name).suffix();
+        return suffix.isEmpty() ? QString("File") : suffix.toUpper() + " File";
+    }
+    }
+    return QVariant();
+}
+
+QVariant FileTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    switch (section) {
+    case NameColumn: return QString("Name");
+    case SizeColumn: return QString("Size");
+    case TypeColumn: return QString("Type");
+    }
+    return QVariant();
+}
@@ -0,0 +1,75 @@
+#ifndef FILETREEMODEL_H
+#define FILETREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QIcon>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Directory tree for the side panel. A folder is listed the first time it is
+// expanded, on a background thread; its rows appear as soon as the names are
+// known and sizes fill in while the entries are stat'ed. Nothing is watched,
+// so a folder shows what it held when it was opened.
+class FileTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum Column { NameColumn, SizeColumn, TypeColumn, ColumnCount };
+
+    explicit FileTreeModel(QObject *parent = nullptr);
+    ~FileTreeModel() override;
+
+    // Shows the contents of path at the top level; an empty path lists the
+    // filesystem roots (drives on Windows).
+    void setRootPath(const QString &path);
+    QString rootPath() const { return root ? root->path : QString(); }
+
+    QString filePath(const QModelIndex &index) const;
+    bool isDir(const QModelIndex &index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    enum LoadState { NotLoaded, Loading, Loaded };
+
+    struct Node {
+        QString name;
+        QString path;
+        Node *parent = nullptr;
+        int row = 0;
+        bool isDir = false;
+        qint64 size = -1;  // -1 until stat'ed
+        LoadState state = NotLoaded;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    struct Entry {
+        QString name;
+        bool isDir;
+    };
+
+    Node *nodeFor(const QModelIndex &index) const;
+    void insertEntries(Node *node, const QVector<Entry> &entries);
+    void updateSizes(Node *node, int firstRow, const QVector<qint64> &sizes);
+
+    std::unique_ptr<Node> root;
+    // Bumped on every reset so late results for deleted nodes are dropped.
+    quint64 generation = 0;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    QThreadPool pool;
+    QIcon folderIcon;
+    QIcon fileIcon;
+};
+
+#endif
@@ -0,0 +1,312 @@
+#include "gzipindex.h"
+#include "trace.h"
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#ifdef HEXEDITOR_QT_ZLIB
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace {
+
+// Deflate looks back at most this far.
+constexpr int kWindowSize = 32768;
+constexpr int kOutputChunk = 256 * 1024;
+constexpr qint64 kInputChunk = 256 * 1024;
+constexpr qint64 kScanBlock = 1024 * 1024;
+// Window bits for inflateInit2: 15 plus 32 detects gzip or zlib headers.
+constexpr int kAutoHeader = 15 + 32;
+constexpr int kRawDeflate = -15;
+
+// inflateEnd on every way out.
+struct Inflater {
+    z_stream z;
+    bool open = false;
+
+    Inflater() { std::memset(&z, 0, sizeof(z)); }
+    ~Inflater() { if (open) inflateEnd(&z); }
+    bool init(int windowBits) { open = inflateInit2(&z, windowBits) == Z_OK; return open; }
+};
+
+bool isGzipHeader(const uchar *p, qint64 size)
+{
+    return size >= 2 && p[0] == 0x1f && p[1] == 0x8b;
+}
+
+// CM 8 with a 32 KB window and no preset dictionary. The check bits leave
+// one in 31 two-byte prefixes passing, so callers also try to inflate.
+bool isZlibHeader(const uchar *p, qint64 size)
+{
+    return size >= 2 && p[0] == 0x78 && !(p[1] & 0x20) && ((p[0] << 8) | p[1]) % 31 == 0;
+}
+
+}
+
+bool GzipIndex::isCompressedFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QByteArray head = file.read(kInputChunk);
+    const uchar *p = reinterpret_cast<const uchar *>(head.constData());
+    if (!isGzipHeader(p, head.size()) && !isZlibHeader(p, head.size())) return false;
+
+    // The header alone can be chance; the first deflate blocks have to
+    // decode too.
+    Inflater inflater;
+    if (!inflater.init(kAutoHeader)) return false;
+    QByteArray out(kOutputChunk, Qt::Uninitialized);
+    inflater.z.next_in = reinterpret_cast<Bytef *>(head.data());
+    inflater.z.avail_in = uInt(head.size());
+    for (;;) {
+        inflater.z.next_out = reinterpret_cast<Bytef *>(out.data());
+        inflater.z.avail_out = uInt(out.size());
+        const int ret = inflate(&inflater.z, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) return true;
+        if (ret != Z_OK && ret != Z_BUF_ERROR) return false;
+        if (inflater.z.avail_in == 0 || inflater.z.avail_out != 0) return true;
+    }
+}
+
+bool GzipIndex::inflateFile(const QString &path, const AsyncReader::BlockSink &sink, QString *error)
+{
+    GzipIndex index;
+    return index.scan(path, 0, sink, Progress(), error);
+}
+
+bool GzipIndex::build(const QString &filePath, qint64 span, const Progress &progress, QString *error)
+{
+    TRACE_SCOPE("GzipIndex::build");
+    return scan(filePath, qMax<qint64>(span, kWindowSize), AsyncReader::BlockSink(), progress, error);
+}
+
+// One pass over the file. With span > 0 checkpoints are recorded; with a
+// sink the output is handed over as it comes.
+bool GzipIndex::scan(const QString &filePath, qint64 span, const AsyncReader::BlockSink &sink,
+                     const Progress &progress, QString *error)
+{
+    if (error) error->clear();
+    path = filePath;
+    points.clear();
+    totalOut = 0;
+
+    const qint64 fileSize = QFileInfo(filePath).size();
+    Inflater inflater;
+    if (!inflater.init(kAutoHeader)) {
+        if (error) *error = "Cannot start zlib.";
+        return false;
+    }
+    z_stream &z = inflater.z;
+
+    // The last kWindowSize bytes of output stay in front of the free space,
+    // so a checkpoint can copy its window from here.
+    QByteArray buffer(kWindowSize + kOutputChunk, Qt::Uninitialized);
+    int have = 0;
+    qint64 totalIn = 0;
+    qint64 lastPoint = 0;
+    bool memberStart = true;
+    bool memberEnded = false;
+    bool sawHeader = false;
+    bool stopped = false;
+    bool trailing = false;
+    QString failure;
+
+    const bool ok = AsyncReader::streamFile(filePath, 0, -1, [&](const char *data, qint64 size) {
+        if (!sawHeader) {
+            sawHeader = true;
+            trailerSize = isGzipHeader(reinterpret_cast<const uchar *>(data), size) ? 8 : 4;
+        }
+        z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        z.avail_in = uInt(size);
+        for (;;) {
+            if (memberEnded) {
+                if (z.avail_in == 0) break;
+                inflateReset(&z);
+                memberEnded = false;
+                memberStart = true;
+            }
+            const qint64 inAtStart = totalIn;
+
+            if (have == buffer.size()) {
+                std::memmove(buffer.data(), buffer.constData() + have - kWindowSize, kWindowSize);
+                have = kWindowSize;
+            }
+            z.next_out = reinterpret_cast<Bytef *>(buffer.data() + have);
+            z.avail_out = uInt(buffer.size() - have);
+            const uInt inBefore = z.avail_in;
+            const uInt outBefore = z.avail_out;
+            const int ret = inflate(&z, span > 0 ? Z_BLOCK : Z_NO_FLUSH);
+            const int produced = int(outBefore - z.avail_out);
+            totalIn += inBefore - z.avail_in;
+
+            if (ret == Z_DATA_ERROR && memberStart && totalOut > 0) {
+                // Padding or other bytes after the last member, which gzip
+                // ignores as well.
+                trailing = true;
+                return false;
+            }
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                failure = QString("Cannot decompress %1: %2").arg(filePath, QString::fromLatin1(z.msg ? z.msg : "invalid data"));
+                return false;
+            }
+            if (memberStart && span > 0) {
+                Checkpoint point;
+                point.out = totalOut;
+                point.in = inAtStart;
+                point.header = true;
+                points.append(point);
+                lastPoint = totalOut;
+            }
+            memberStart = false;
+            if (produced > 0) {
+                if (sink && !sink(buffer.constData() + have, produced)) {
+                    stopped = true;
+                    return false;
+                }
+                have += produced;
+                totalOut += produced;
+            }
+            if (ret == Z_STREAM_END) {
+                memberEnded = true;
+                continue;
+            }
+
+            // Bit 7 of data_type: stopped at a block boundary; bit 6: the
+            // last block of the stream follows, nothing left to index.
+            if (span > 0 && (z.data_type & 128) && !(z.data_type & 64) && totalOut - lastPoint >= span) {
+                Checkpoint point;
+                point.out = totalOut;
+                point.in = totalIn;
+                point.bits = z.data_type & 7;
+                const int windowBytes = int(qMin<qint64>(kWindowSize, have));
+                point.window = QByteArray(buffer.constData() + have - windowBytes, windowBytes);
+                points.append(point);
+                lastPoint = totalOut;
+            }
+            if (z.avail_in == 0 && z.avail_out != 0) break;
+        }
+        if (progress && !progress(totalIn, fileSize)) {
+            stopped = true;
+            return false;
+        }
+        return true;
+    }, kScanBlock, error);
+
+    if (stopped) {
+        points.clear();
+        totalOut = 0;
+        return false;
+    }
+    if (!failure.isEmpty() || (!ok && !trailing)) {
+        if (error && !failure.isEmpty()) *error = failure;
+        points.clear();
+        totalOut = 0;
+        return false;
+    }
+    if (!memberEnded && !trailing) {
+        if (error) *error = QString("%1 is truncated or not compressed.").arg(filePath);
+        points.clear();
+        totalOut = 0;
+        return false;
+    }
+    return true;
+}
+
+QByteArray GzipIndex::read(qint64 offset, qint64 length, QString *error) const
+{
+    TRACE_SCOPE("GzipIndex::read");
+    if (error) error->clear();
+    if (points.isEmpty() || offset < 0 || offset >= totalOut || length <= 0) return QByteArray();
+    length = qMin(length, totalOut - offset);
+
+    // The last checkpoint at or before offset.
+    const auto after = std::upper_bound(points.cbegin(), points.cend(), offset,
+                                        [](qint64 value, const Checkpoint &p) { return value < p.out; });
+    const Checkpoint &point = *(after - 1);
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(point.in - (point.bits ? 1 : 0))) {
+        if (error) *error = "Cannot read " + path;
+        return QByteArray();
+    }
+
+    Inflater inflater;
+    if (!inflater.init(point.header ? kAutoHeader : kRawDeflate)) {
+        if (error) *error = "Cannot start zlib.";
+        return QByteArray();
+    }
+    z_stream &z = inflater.z;
+    bool raw = !point.header;
+    if (point.bits) {
+        char c;
+        if (!file.getChar(&c)) {
+            if (error) *error = "Cannot read " + path;
+            return QByteArray();
+        }
+        inflatePrime(&z, point.bits, uchar(c) >> (8 - point.bits));
+    }
+    if (!point.header) {
+        inflateSetDictionary(&z, reinterpret_cast<const Bytef *>(point.window.constData()),
+                             uInt(point.window.size()));
+    }
+
+    QByteArray input(int(kInputChunk), Qt::Uninitialized);
+    QByteArray discard(kOutputChunk, Qt::Uninitialized);
+    QByteArray result(int(length), Qt::Uninitialized);
+    qint64 skip = offset - point.out;
+    qint64 got = 0;
+    int trailerLeft = 0;
+    while (got < length) {
+        if (z.avail_in == 0) {
+            const qint64 n = file.read(input.data(), input.size());
+            if (n <= 0) {
+                if (error) *error = QString("%1 ended early.").arg(path);
+                return QByteArray();
+            }
+            z.next_in = reinterpret_cast<Bytef *>(input.data());
+            z.avail_in = uInt(n);
+        }
+        if (trailerLeft > 0) {
+            // A raw stream leaves the member's trailer unread; step over it
+            // before the next header.
+            const uInt step = uInt(qMin<qint64>(trailerLeft, z.avail_in));
+            z.next_in += step;
+            z.avail_in -= step;
+            trailerLeft -= int(step);
+            if (trailerLeft == 0) inflateReset2(&z, kAutoHeader);
+            continue;
+        }
+
+        const bool skipping = skip > 0;
+        if (skipping) {
+            z.next_out = reinterpret_cast<Bytef *>(discard.data());
+            z.avail_out = uInt(qMin<qint64>(skip, discard.size()));
+        } else {
+            z.next_out = reinterpret_cast<Bytef *>(result.data() + got);
+            z.avail_out = uInt(qMin<qint64>(length - got, UINT_MAX));
+        }
+        const uInt outBefore = z.avail_out;
+        const int ret = inflate(&z, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            if (error) *error = QString("Cannot decompress %1: %2").arg(path, QString::fromLatin1(z.msg ? z.msg : "invalid data"));
+            return QByteArray();
+        }
+        const qint64 produced = outBefore - z.avail_out;
+        if (skipping) skip -= produced;
+        else got += produced;
+
+        if (ret == Z_STREAM_END) {
+            if (raw) {
+                raw = false;
+                trailerLeft = trailerSize;
+            } else {
+                inflateReset(&z);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef GZIPINDEX_H
+#define GZIPINDEX_H
+
+#include "asyncreader.h"
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// Random access into gzip and zlib files without decompressing them to disk,
+// after zlib's zran example. One pass over the file records a checkpoint
+// every `span` bytes of output, at a deflate block boundary: the compressed
+// position, its bit offset, and the 32 KB of output before it that the next
+// block may refer back to. A read then inflates only from the nearest
+// checkpoint at or before the wanted offset. Concatenated members are
+// followed as one stream, the way gzip -d does.
+class GzipIndex
+{
+public:
+    static const qint64 defaultSpan = 4 * 1024 * 1024;
+
+    // Compressed bytes consumed so far and the size of the file; returning
+    // false cancels the build.
+    typedef std::function<bool(qint64 done, qint64 total)> Progress;
+
+    // Whether the file starts with a gzip or zlib header that inflates.
+    static bool isCompressedFile(const QString &path);
+
+    // Inflates the whole file front to back, handing the output to sink as
+    // it is produced. Returns false on errors (with error set) or when the
+    // sink stops the pass.
+    static bool inflateFile(const QString &path, const AsyncReader::BlockSink &sink,
+                            QString *error = nullptr);
+
+    bool build(const QString &path, qint64 span = defaultSpan, const Progress &progress = Progress(),
+               QString *error = nullptr);
+
+    bool isValid() const { return !points.isEmpty(); }
+    QString filePath() const { return path; }
+    // Uncompressed size.
+    qint64 size() const { return totalOut; }
+    int checkpointCount() const { return points.size(); }
+
+    // Up to length bytes of output from offset.
+    QByteArray read(qint64 offset, qint64 length, QString *error = nullptr) const;
+
+private:
+    struct Checkpoint {
+        qint64 out = 0;
+        qint64 in = 0;
+        int bits = 0;
+        // At the start of a gzip member or zlib stream: inflate from its
+        // header, no window needed.
+        bool header = false;
+        QByteArray window;
+    };
+
+    bool scan(const QString &filePath, qint64 span, const AsyncReader::BlockSink &sink,
+              const Progress &progress, QString *error);
+
+    QString path;
+    QVector<Checkpoint> points;
+    qint64 totalOut = 0;
+    // Bytes after the end of a member's deflate data: 8 for gzip, 4 for zlib.
+    int trailerSize = 8;
+};
+
+#endif
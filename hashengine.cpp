@@ -0,0 +1,539 @@
+#include "hashengine.h"
+#include "asyncreader.h"
+#include "trace.h"
+#include <QFile>
+#include <QStringList>
+#include <QtEndian>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HASHENGINE_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr qint64 kWindowSize = 64 * 1024 * 1024;
+constexpr qint64 kParallelThreshold = 1024 * 1024;
+constexpr qint64 kReadBlockSize = 8 * 1024 * 1024;
+
+std::atomic<bool> hardwareEnabled{ true };
+
+const quint32 kSha1Init[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+const quint32 kSha256Init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+alignas(16) const quint32 kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Slicing-by-8 tables for the reflected IEEE polynomial.
+struct CrcTables {
+    quint32 t[8][256];
+
+    CrcTables()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            t[0][i] = c;
+        }
+        for (int i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+const CrcTables &crcTables()
+{
+    static const CrcTables tables;
+    return tables;
+}
+
+// c is the inverted running CRC.
+quint32 crc32Portable(quint32 c, const uchar *p, qint64 size)
+{
+    const CrcTables &tab = crcTables();
+    while (size >= 8) {
+        quint32 lo;
+        quint32 hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+        lo = qFromLittleEndian(lo);
+        hi = qFromLittleEndian(hi);
+#endif
+        lo ^= c;
+        c = tab.t[7][lo & 0xFF] ^ tab.t[6][(lo >> 8) & 0xFF] ^ tab.t[5][(lo >> 16) & 0xFF] ^ tab.t[4][lo >> 24]
+            ^ tab.t[3][hi & 0xFF] ^ tab.t[2][(hi >> 8) & 0xFF] ^ tab.t[1][(hi >> 16) & 0xFF] ^ tab.t[0][hi >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        c = tab.t[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+    }
+    return c;
+}
+
+#ifdef HASHENGINE_X86
+
+struct CpuFeatures {
+    bool pclmul = false;
+    bool sse41 = false;
+    bool ssse3 = false;
+    bool sha = false;
+};
+
+const CpuFeatures &cpuFeatures()
+{
+    static const CpuFeatures features = []() {
+        CpuFeatures f;
+        unsigned a = 0, b = 0, c = 0, d = 0;
+        if (__get_cpuid(1, &a, &b, &c, &d)) {
+            f.pclmul = c & (1u << 1);
+            f.ssse3 = c & (1u << 9);
+            f.sse41 = c & (1u << 19);
+        }
+        if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+            f.sha = b & (1u << 29);
+        }
+        return f;
+    }();
+    return features;
+}
+
+__attribute__((target("pclmul,sse4.1")))
+inline __m128i foldClmul(__m128i acc, __m128i next, __m128i k)
+{
+    const __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+    const __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(hi, next), lo);
+}
+
+// Folds 64 bytes at a time with carry-less multiplies, then reduces to 32
+// bits with Barrett reduction (Intel's "Fast CRC Computation Using PCLMULQDQ").
+// size must be a multiple of 16 and at least 64; c is the inverted CRC.
+__attribute__((target("pclmul,sse4.1")))
+quint32 crc32Pclmul(quint32 c, const uchar *p, qint64 size)
+{
+    alignas(16) static const quint64 k1k2[2] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) static const quint64 k3k4[2] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) static const quint64 k5k0[2] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) static const quint64 poly[2] = { 0x01db710641, 0x01f7011641 };
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int(c)));
+    __m128i x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+    p += 64;
+    size -= 64;
+
+    while (size >= 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 48)));
+        p += 64;
+        size -= 64;
+    }
+
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+    x1 = foldClmul(x1, x2, x0);
+    x1 = foldClmul(x1, x3, x0);
+    x1 = foldClmul(x1, x4, x0);
+    while (size >= 16) {
+        x1 = foldClmul(x1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), x0);
+        p += 16;
+        size -= 16;
+    }
+
+    // 128 -> 64 bits.
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, x0, 0x00), x2);
+
+    // Barrett reduction to 32 bits.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return quint32(_mm_extract_epi32(x1, 1));
+}
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void sha256Compress(quint32 *state, const uchar *data, qint64 blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);     // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);          // CDGH
+
+    for (; blocks > 0; --blocks, data += 64) {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+        __m128i msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)), byteSwap);
+        }
+
+        // 16 groups of four rounds; the schedule for group i + 1 is
+        // finished while group i runs. Fully unrolled so msg[] stays in
+        // registers.
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; ++i) {
+            __m128i m = _mm_add_epi32(msg[i & 3], _mm_load_si128(reinterpret_cast<const __m128i *>(kSha256K + 4 * i)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+            if (i >= 3 && i < 15) {
+                const __m128i t = _mm_alignr_epi8(msg[i & 3], msg[(i - 1) & 3], 4);
+                msg[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(msg[(i + 1) & 3], t), msg[i & 3]);
+            }
+            m = _mm_shuffle_epi32(m, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, m);
+            if (i >= 1 && i < 13) {
+                msg[(i - 1) & 3] = _mm_sha256msg1_epu32(msg[(i - 1) & 3], msg[i & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);                // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);             // DCHG
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void sha1Compress(quint32 *state, const uchar *data, qint64 blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(int(state[4]), 0, 0, 0);
+
+    for (; blocks > 0; --blocks, data += 64) {
+        const __m128i abcdSave = abcd;
+        const __m128i e0Save = e0;
+        __m128i msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)), byteSwap);
+        }
+
+        // 20 groups of four rounds, alternating the two E registers.
+        __m128i e[2] = { _mm_add_epi32(e0, msg[0]), e0 };
+        e[1] = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e[0], 0);
+#pragma GCC unroll 20
+        for (int i = 1; i < 20; ++i) {
+            __m128i &current = e[i & 1];
+            __m128i &next = e[(i + 1) & 1];
+            current = _mm_sha1nexte_epu32(current, msg[i & 3]);
+            next = abcd;
+            if (i >= 3 && i < 19) {
+                msg[(i + 1) & 3] = _mm_sha1msg2_epu32(msg[(i + 1) & 3], msg[i & 3]);
+            }
+            switch (i / 5) {
+            case 0: abcd = _mm_sha1rnds4_epu32(abcd, current, 0); break;
+            case 1: abcd = _mm_sha1rnds4_epu32(abcd, current, 1); break;
+            case 2: abcd = _mm_sha1rnds4_epu32(abcd, current, 2); break;
+            default: abcd = _mm_sha1rnds4_epu32(abcd, current, 3); break;
+            }
+            if (i >= 1 && i < 17) {
+                msg[(i - 1) & 3] = _mm_sha1msg1_epu32(msg[(i - 1) & 3], msg[i & 3]);
+            }
+            if (i >= 2 && i < 18) {
+                msg[(i - 2) & 3] = _mm_xor_si128(msg[(i - 2) & 3], msg[i & 3]);
+            }
+        }
+
+        e0 = _mm_sha1nexte_epu32(e[0], e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = quint32(_mm_extract_epi32(e0, 3));
+}
+
+#endif
+
+// Runs every task, the first on the calling thread and the rest on their own
+// threads when there is enough data to make that worthwhile.
+void runAll(const std::vector<std::function<void()>> &tasks, qint64 size)
+{
+    if (tasks.size() < 2 || size < kParallelThreshold) {
+        for (const auto &task : tasks) task();
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < tasks.size(); ++i) threads.emplace_back(tasks[i]);
+    tasks.front()();
+    for (std::thread &t : threads) t.join();
+}
+
+}
+
+HashEngine::HashEngine(int algorithms)
+    : selected(algorithms & AllAlgorithms),
+      nativeSha(hasHardwareSha()),
+      md5(QCryptographicHash::Md5),
+      sha1(QCryptographicHash::Sha1),
+      sha256(QCryptographicHash::Sha256)
+{
+    std::memcpy(sha1Blocks.state, kSha1Init, sizeof(kSha1Init));
+    std::memcpy(sha256Blocks.state, kSha256Init, sizeof(kSha256Init));
+}
+
+void HashEngine::setHardwareEnabled(bool enabled)
+{
+    hardwareEnabled = enabled;
+}
+
+bool HashEngine::hasHardwareCrc32()
+{
+#ifdef HASHENGINE_X86
+    return hardwareEnabled && cpuFeatures().pclmul && cpuFeatures().sse41;
+#else
+    return false;
+#endif
+}
+
+bool HashEngine::hasHardwareSha()
+{
+#ifdef HASHENGINE_X86
+    return hardwareEnabled && cpuFeatures().sha && cpuFeatures().sse41 && cpuFeatures().ssse3;
+#else
+    return false;
+#endif
+}
+
+quint32 HashEngine::crc32(quint32 crc, const uchar *data, qint64 size)
+{
+    quint32 c = ~crc;
+#ifdef HASHENGINE_X86
+    if (size >= 64 && hasHardwareCrc32()) {
+        const qint64 folded = size & ~qint64(15);
+        c = crc32Pclmul(c, data, folded);
+        data += folded;
+        size -= folded;
+    }
+#endif
+    return ~crc32Portable(c, data, size);
+}
+
+void HashEngine::addSha(ShaBlocks &sha, bool isSha256, const uchar *data, qint64 size)
+{
+#ifdef HASHENGINE_X86
+    auto compress = isSha256 ? sha256Compress : sha1Compress;
+    sha.length += quint64(size);
+
+    if (sha.buffered > 0) {
+        const int take = int(qMin<qint64>(64 - sha.buffered, size));
+        std::memcpy(sha.buffer + sha.buffered, data, size_t(take));
+        sha.buffered += take;
+        data += take;
+        size -= take;
+        if (sha.buffered < 64) return;
+        compress(sha.state, sha.buffer, 1);
+        sha.buffered = 0;
+    }
+
+    if (size >= 64) {
+        compress(sha.state, data, size / 64);
+        data += size / 64 * 64;
+        size %= 64;
+    }
+
+    std::memcpy(sha.buffer, data, size_t(size));
+    sha.buffered = int(size);
+#else
+    Q_UNUSED(sha);
+    Q_UNUSED(isSha256);
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+#endif
+}
+
+QByteArray HashEngine::finishSha(ShaBlocks &sha, bool isSha256)
+{
+    const quint64 bits = sha.length * 8;
+    uchar tail[72] = { 0x80 };
+    const int padding = (sha.buffered < 56) ? (56 - sha.buffered) : (120 - sha.buffered);
+    for (int i = 0; i < 8; ++i) {
+        tail[padding + i] = uchar(bits >> (56 - 8 * i));
+    }
+    addSha(sha, isSha256, tail, padding + 8);
+
+    const int words = isSha256 ? 8 : 5;
+    QByteArray digest(words * 4, Qt::Uninitialized);
+    for (int i = 0; i < words; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            digest[i * 4 + k] = char(sha.state[i] >> (24 - 8 * k));
+        }
+    }
+    return digest;
+}
+
+void HashEngine::addData(const char *data, qint64 size)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    while (size > 0) {
+        const qint64 n = qMin(size, kWindowSize);
+        const QByteArray view = QByteArray::fromRawData(data, int(n));
+
+        std::vector<std::function<void()>> tasks;
+        if (selected & Crc32) tasks.emplace_back([&]() { crc = crc32(crc, bytes, n); });
+        if (selected & Md5) tasks.emplace_back([&]() { md5.addData(view); });
+        if (selected & Sha1) {
+            tasks.emplace_back([&]() {
+                if (nativeSha) addSha(sha1Blocks, false, bytes, n);
+                else sha1.addData(view);
+            });
+        }
+        if (selected & Sha256) {
+            tasks.emplace_back([&]() {
+                if (nativeSha) addSha(sha256Blocks, true, bytes, n);
+                else sha256.addData(view);
+            });
+        }
+        runAll(tasks, n);
+
+        data += n;
+        bytes += n;
+        size -= n;
+    }
+}
+
+QVector<HashDigest> HashEngine::results()
+{
+    QVector<HashDigest> digests;
+    if (selected & Crc32) {
+        QByteArray digest(4, Qt::Uninitialized);
+        for (int k = 0; k < 4; ++k) digest[k] = char(crc >> (24 - 8 * k));
+        digests.append({ algorithmName(Crc32), digest });
+    }
+    if (selected & Md5) {
+        digests.append({ algorithmName(Md5), md5.result() });
+    }
+    if (selected & Sha1) {
+        digests.append({ algorithmName(Sha1), nativeSha ? finishSha(sha1Blocks, false) : sha1.result() });
+    }
+    if (selected & Sha256) {
+        digests.append({ algorithmName(Sha256), nativeSha ? finishSha(sha256Blocks, true) : sha256.result() });
+    }
+    return digests;
+}
+
+QVector<HashDigest> HashEngine::hashBytes(const QByteArray &data, int algorithms, const Progress &progress)
+{
+    TRACE_SCOPE("HashEngine::hashBytes");
+    HashEngine engine(algorithms);
+    const qint64 total = data.size();
+    qint64 done = 0;
+    while (done < total) {
+        const qint64 n = qMin(kWindowSize, total - done);
+        engine.addData(data.constData() + done, n);
+        done += n;
+        if (progress && !progress(done, total)) return {};
+    }
+    return engine.results();
+}
+
+QVector<HashDigest> HashEngine::hashFile(const QString &path, int algorithms, qint64 offset, qint64 length,
+                                         const Progress &progress, QString *error)
+{
+    TRACE_SCOPE("HashEngine::hashFile");
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Cannot open file: " + path;
+        return {};
+    }
+
+    const qint64 size = file.size();
+    if (offset < 0 || offset > size) {
+        if (error) *error = "Offset is past the end of " + path;
+        return {};
+    }
+    length = (length < 0) ? size - offset : qMin(length, size - offset);
+
+    HashEngine engine(algorithms);
+    qint64 done = 0;
+    bool cancelled = false;
+    QString readError;
+    const bool ok = AsyncReader::streamFile(path, offset, length, [&](const char *data, qint64 n) {
+        engine.addData(data, n);
+        done += n;
+        if (progress && !progress(done, length)) {
+            cancelled = true;
+            return false;
+        }
+        return true;
+    }, kReadBlockSize, &readError);
+
+    if (cancelled) {
+        if (error) *error = "Cancelled";
+        return {};
+    }
+    if (!ok || done != length) {
+        if (error) *error = readError.isEmpty() ? "Cannot read file: " + path : readError;
+        return {};
+    }
+    return engine.results();
+}
+
+int HashEngine::parseAlgorithms(const QString &names)
+{
+    int algorithms = 0;
+    for (const QString &raw : names.split(',', Qt::SkipEmptyParts)) {
+        const QString name = raw.trimmed().toLower().remove('-');
+        if (name == "all") algorithms |= AllAlgorithms;
+        else if (name == "crc32" || name == "crc") algorithms |= Crc32;
+        else if (name == "md5") algorithms |= Md5;
+        else if (name == "sha1") algorithms |= Sha1;
+        else if (name == "sha256") algorithms |= Sha256;
+        else return 0;
+    }
+    return algorithms;
+}
+
+QString HashEngine::algorithmName(Algorithm algorithm)
+{
+    switch (algorithm) {
+    case Crc32: return "CRC32";
+    case Md5: return "MD5";
+    case Sha1: return "SHA-1";
+    case Sha256: return "SHA-256";
+    default: return QString();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef HASHENGINE_H
+#define HASHENGINE_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+struct HashDigest {
+    QString algorithm;
+    QByteArray digest;
+};
+
+// Streaming CRC32 / MD5 / SHA-1 / SHA-256 over any number of addData() calls.
+// CRC32 folds with PCLMULQDQ and SHA-1/SHA-256 use the SHA extensions when
+// the CPU has them (checked at run time); other CPUs and MD5 go through the
+// portable code and QCryptographicHash. Large blocks are hashed by every
+// selected algorithm in parallel, so asking for all four costs about as much
+// as the slowest one.
+class HashEngine
+{
+public:
+    enum Algorithm {
+        Crc32 = 0x1,
+        Md5 = 0x2,
+        Sha1 = 0x4,
+        Sha256 = 0x8,
+        AllAlgorithms = Crc32 | Md5 | Sha1 | Sha256
+    };
+
+    // Called with bytes done and total; returning false cancels.
+    typedef std::function<bool(qint64 done, qint64 total)> Progress;
+
+    explicit HashEngine(int algorithms = AllAlgorithms);
+
+    void addData(const char *data, qint64 size);
+    QVector<HashDigest> results();
+
+    // Hashes [offset, offset + length) of a file; length -1 means to the end.
+    // The next blocks are read (AsyncReader) while the current one is hashed.
+    static QVector<HashDigest> hashFile(const QString &path, int algorithms, qint64 offset = 0,
+                                        qint64 length = -1, const Progress &progress = Progress(),
+                                        QString *error = nullptr);
+    static QVector<HashDigest> hashBytes(const QByteArray &data, int algorithms,
+                                         const Progress &progress = Progress());
+
+    // "crc32,md5,sha1,sha256" or "all"; 0 when a name is unknown.
+    static int parseAlgorithms(const QString &names);
+    static QString algorithmName(Algorithm algorithm);
+
+    static quint32 crc32(quint32 crc, const uchar *data, qint64 size);
+    static bool hasHardwareCrc32();
+    static bool hasHardwareSha();
+    // Off makes both report false, so engines made afterwards take the
+    // portable paths; lets tests compare the two on one machine.
+    static void setHardwareEnabled(bool enabled);
+
+private:
+    HashEngine(const HashEngine &) = delete;
+    HashEngine &operator=(const HashEngine &) = delete;
+
+    // SHA-1 / SHA-256 block state for the SHA extension path.
+    struct ShaBlocks {
+        quint32 state[8];
+        uchar buffer[64];
+        int buffered = 0;
+        quint64 length = 0;
+    };
+
+    void addSha(ShaBlocks &sha, bool isSha256, const uchar *data, qint64 size);
+    QByteArray finishSha(ShaBlocks &sha, bool isSha256);
+
+    int selected;
+    bool nativeSha;
+    quint32 crc = 0;
+    QCryptographicHash md5;
+    QCryptographicHash sha1;
+    QCryptographicHash sha256;
+    ShaBlocks sha1Blocks;
+    ShaBlocks sha256Blocks;
+};
+
+#endif
@@ -1,5 +1,16 @@
 #include "home.h"
 #include "textconverter.h"
+#include "searchengine.h"
+#include "trace.h"
+#include "compareview.h"
+#include "entropyminimap.h"
+#include "hashengine.h"
+#include "runnabletask.h"
+#include "asyncreader.h"
+#include "byteregex.h"
+#include "exportwriter.h"
+#include "baseencoding.h"
+#include "gzipindex.h"
 #include <QSplitter>
 #include <QFileDialog>
 #include <QVBoxLayout>
@@ -19,9 +30,33 @@
 #include <QLabel>
 #include <QChar>
 #include <QStatusBar>
+#include <QDockWidget>
+#include <QPointer>
+#include <QThreadPool>
+#include <QHeaderView>
+#include <QCloseEvent>
+#include <QFileSystemWatcher>
+#include <QCoreApplication>
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QInputDialog>
+#include <QLocale>
+#include <QSaveFile>
+#include <QTextBlock>
+#include <algorithm>
+#include <climits>
 
 namespace {
 
+// The clipboard holds the whole text at once; larger exports go to a file.
+constexpr qint64 kClipboardLimit = 64 * 1024 * 1024;
+// Decompressed bytes a tab on a gzip or zlib file shows at a time.
+constexpr qint64 kCompressedWindow = 8 * 1024 * 1024;
+
+// View menu action for each EditorMode, in enum order.
+const char *const kModeActions[] = { "To Hex", "To Binary", "To Unicode", "To Text",
+                                     "To Base64", "To Base64 URL", "To Base32", "To Ascii85" };
+
 bool isValidHexQuery(const QString &query) {
     QString clean = query;
     clean.remove(QRegularExpression("\\s+"));
@@ -80,27 +115,6 @@ QString convertTextToTarget(const QString &text, TextType targetType) {
     }
 }
 
-QPair<int, QString> countOccurrencesInRecentFile(const QString &path, const QString &needleText) {
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return qMakePair(0, QString());
-    }
-
-    const QString content = QString::fromUtf8(file.readAll());
-    if (content.isEmpty() || needleText.isEmpty()) {
-        return qMakePair(0, QString());
-    }
-
-    int count = 0;
-    int pos = 0;
-    while ((pos = content.indexOf(needleText, pos, Qt::CaseInsensitive)) != -1) {
-        ++count;
-        pos += needleText.length();
-    }
-
-    return qMakePair(count, QFileInfo(path).fileName());
-}
-
 TextType detectSearchQueryType(const QString &query) {
     if (isValidUnicodeQuery(query)) {
         return TYPE_UNICODE;
@@ -137,6 +151,193 @@ int detectChunkSizeForEditor(const CodeEditor *editor) {
     return chunkSizeForType(TextAnalyzer::detectType(editor->toPlainText()));
 }
 
+// Length of data without a UTF-8 sequence cut off at its end.
+int completeUtf8Length(const QByteArray &data) {
+    for (int i = data.size() - 1; i >= 0 && i >= data.size() - 4; --i) {
+        const uchar b = uchar(data.at(i));
+        if ((b & 0xC0) == 0x80) continue;
+        if (b >= 0xC0) {
+            const int need = b >= 0xF0 ? 4 : (b >= 0xE0 ? 3 : 2);
+            if (i + need > data.size()) return i;
+        }
+        break;
+    }
+    return data.size();
+}
+
+// Appends at the end of the document without moving the user's cursor.
+void appendText(CodeEditor *editor, const QString &text) {
+    if (text.isEmpty()) return;
+    QTextCursor cursor(editor->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+}
+
+// Writes to a temporary file that replaces path only once everything is on
+// disk, so a failed save leaves the old file as it was.
+bool saveBytes(const QString &path, const QByteArray &bytes, QString *error) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// toPlainText() gives every block break as one "\n", "\r\n" included.
+inline bool isBlockBreak(ushort c) {
+    return c == '\n' || c == '\r' || c == 0x2029 || c == 0xFDD0 || c == 0xFDD1;
+}
+
+// The bytes behind a text pane after an edit. Only the characters between
+// the longest unchanged prefix and suffix are encoded again, so invalid UTF-8
+// shown as U+FFFD outside them keeps its original bytes. The edit is taken
+// to end at the cursor, which tells which of a run of equal characters it
+// touched. expectedUnits gets the length the result should decode to if no
+// bytes joined at the seams.
+QByteArray bytesAfterTextEdit(const QByteArray &old, const DecodedText &layout, const QString &edited,
+                              int cursor, qint64 *expectedUnits) {
+    const QString before = DecodedText::decode(old);
+    int first = 0;
+    int shown = 0;
+    while (first < before.size() && shown < edited.size() && shown < cursor) {
+        ushort c = before.at(first).unicode();
+        int width = 1;
+        if (isBlockBreak(c)) {
+            if (c == '\r' && first + 1 < before.size() && before.at(first + 1) == QLatin1Char('\n')) width = 2;
+            c = '\n';
+        }
+        if (c != edited.at(shown).unicode()) break;
+        first += width;
+        ++shown;
+    }
+    int last = before.size();
+    int shownEnd = edited.size();
+    while (last > first && shownEnd > qMax(shown, cursor)) {
+        ushort c = before.at(last - 1).unicode();
+        int width = 1;
+        if (isBlockBreak(c)) {
+            if (c == '\n' && last - 2 >= first && before.at(last - 2) == QLatin1Char('\r')) width = 2;
+            c = '\n';
+        }
+        if (c != edited.at(shownEnd - 1).unicode()) break;
+        last -= width;
+        --shownEnd;
+    }
+    // Never split a surrogate pair between the kept and the new bytes.
+    if (first > 0 && first < before.size() && before.at(first).isLowSurrogate()) {
+        --first;
+        --shown;
+    }
+    if (last < before.size() && before.at(last).isLowSurrogate()) {
+        ++last;
+        ++shownEnd;
+    }
+
+    *expectedUnits = before.size() - (last - first) + (shownEnd - shown);
+    const qint64 from = layout.byteOffset(first);
+    const qint64 to = layout.byteOffset(last);
+    return old.left(int(from)) + edited.mid(shown, shownEnd - shown).toUtf8() + old.mid(int(to));
+}
+
+// The same for the \uXXXX pane: every escape the edit touched is decoded
+// and encoded again, the rest keep their bytes.
+QByteArray bytesAfterUnicodeEdit(const QByteArray &old, const DecodedText &layout, const QString &edited,
+                                 int cursor) {
+    const QString decoded = DecodedText::decode(old);
+    const QString before = TextConverter::toUnicode(decoded);
+    const int common = qMin(before.size(), edited.size());
+    int prefix = 0;
+    while (prefix < qMin(common, cursor) && before.at(prefix) == edited.at(prefix)) ++prefix;
+    int suffix = 0;
+    const int suffixLimit = qMin(common - prefix, int(edited.size()) - cursor);
+    while (suffix < suffixLimit && before.at(before.size() - 1 - suffix) == edited.at(edited.size() - 1 - suffix)) {
+        ++suffix;
+    }
+
+    int firstUnit = prefix / 6;
+    int lastUnit = (before.size() - suffix + 5) / 6;
+    if (firstUnit > 0 && firstUnit < decoded.size() && decoded.at(firstUnit).isLowSurrogate()) --firstUnit;
+    if (lastUnit < decoded.size() && decoded.at(lastUnit).isLowSurrogate()) ++lastUnit;
+
+    const int shown = firstUnit * 6;
+    const int shownEnd = edited.size() - (before.size() - lastUnit * 6);
+    const QString text = TextConverter::fromUnicode(edited.mid(shown, shownEnd - shown));
+    return old.left(int(layout.byteOffset(firstUnit))) + text.toUtf8() + old.mid(int(layout.byteOffset(lastUnit)));
+}
+
+// The encoding shown by a Base64 / Base32 / Ascii85 pane.
+bool encodingForGrouping(CodeEditor::ByteGroupingMode grouping, BaseEncoding::Kind *kind) {
+    switch (grouping) {
+    case CodeEditor::GroupingBase64: *kind = BaseEncoding::Base64; return true;
+    case CodeEditor::GroupingBase64Url: *kind = BaseEncoding::Base64Url; return true;
+    case CodeEditor::GroupingBase32: *kind = BaseEncoding::Base32; return true;
+    case CodeEditor::GroupingAscii85: *kind = BaseEncoding::Ascii85; return true;
+    default: return false;
+    }
+}
+
+// Byte matches as ranges of text that is the UTF-8 decoding of the bytes,
+// each character taking `scale` columns (6 in the \uXXXX pane). One pass
+// over the text for all matches, which come in order.
+QVector<SearchMatch> textRangesForByteMatches(const QString &text, const QVector<ByteMatch> &matches, int scale) {
+    QVector<SearchMatch> ranges;
+    ranges.reserve(matches.size());
+    qint64 bytes = 0;
+    int i = 0;
+    auto unitAt = [&](qint64 offset) {
+        while (i < text.size()) {
+            const ushort c = text.at(i).unicode();
+            int width = 3;
+            int units = 1;
+            if (c < 0x80) width = 1;
+            else if (c < 0x800) width = 2;
+            else if (QChar::isHighSurrogate(c) && i + 1 < text.size() && QChar::isLowSurrogate(text.at(i + 1).unicode())) {
+                width = 4;
+                units = 2;
+            }
+            if (bytes + width > offset) break;
+            bytes += width;
+            i += units;
+        }
+        return i;
+    };
+
+    for (const ByteMatch &m : matches) {
+        const int start = unitAt(m.offset);
+        int end = unitAt(m.offset + m.length);
+        // A match ending inside a character still marks that character.
+        if (bytes < m.offset + m.length && end < text.size()) {
+            end += QChar::isHighSurrogate(text.at(end).unicode()) && end + 1 < text.size() ? 2 : 1;
+        }
+        ranges.append(SearchMatch{ start * scale, qMax(1, end - start) * scale });
+    }
+    return ranges;
+}
+
+// The same for panes with a fixed number of columns per byte ("XX " or
+// "XXXXXXXX "), leaving out the trailing separator.
+QVector<SearchMatch> columnRangesForByteMatches(const QVector<ByteMatch> &matches, int stride) {
+    QVector<SearchMatch> ranges;
+    ranges.reserve(matches.size());
+    for (const ByteMatch &m : matches) {
+        ranges.append(SearchMatch{ int(m.offset * stride), int(m.length * stride - 1) });
+    }
+    return ranges;
+}
+
+// Characters of an encoded view covering each match, whole groups included.
+QVector<SearchMatch> encodedRangesForByteMatches(const QVector<ByteMatch> &matches, BaseEncoding::Kind kind) {
+    QVector<SearchMatch> ranges;
+    ranges.reserve(matches.size());
+    for (const ByteMatch &m : matches) {
+        const qint64 first = BaseEncoding::charOffset(m.offset, kind);
+        const qint64 last = BaseEncoding::charOffset(m.offset + m.length, kind, true);
+        ranges.append(SearchMatch{ int(first), int(last - first) });
+    }
+    return ranges;
+}
+
 void alignSelectionToChunk(QTextCursor &cursor, int chunkSize, int docLength) {
     if (chunkSize <= 1 || !cursor.hasSelection()) {
         return;
@@ -169,11 +370,12 @@ void alignCursorToChunk(QTextCursor &cursor, int chunkSize, int docLength) {
 Home::Home(QWidget *parent) : QMainWindow(parent) {
     QSettings settings("MyCompany", "MyApplication");
     recentFiles = settings.value("history/recentFiles").toStringList();
-    model = new QFileSystemModel(this);
-    model->setRootPath("");
+    model = new FileTreeModel(this);
 
     tree = new QTreeView();
     tree->setModel(model);
+    tree->header()->setSectionResizeMode(FileTreeModel::NameColumn, QHeaderView::Stretch);
+    tree->header()->setStretchLastSection(false);
     tree->setAnimated(true);
     tree->setAlternatingRowColors(true);
     tree->setUniformRowHeights(true);
@@ -195,6 +397,16 @@ Home::Home(QWidget *parent) : QMainWindow(parent) {
     tabs->setTabsClosable(true);
     tabs->setDocumentMode(true);
     connect(tabs, &QTabWidget::tabCloseRequested, [=](int index){
+        stopFollowing(tabs->widget(index));
+        tabBytes.remove(tabs->widget(index));
+        tabText.remove(tabs->widget(index));
+        tabPaths.remove(tabs->widget(index));
+        tabAnnotations.remove(tabs->widget(index));
+        compressedTabs.remove(tabs->widget(index));
+        pendingTabs.remove(tabs->widget(index));
+        if (const std::shared_ptr<std::atomic<bool>> cancelled = tabCancelled.take(tabs->widget(index))) {
+            cancelled->store(true);
+        }
         tabs->removeTab(index);
         updateui();
     });
@@ -208,9 +420,31 @@ Home::Home(QWidget *parent) : QMainWindow(parent) {
     menuBarObj = new MenuBar(this);
     connect(menuBarObj, &MenuBar::triggered, this, &Home::menu);
 
+    dataInspector = new DataInspector(this);
+    inspectorDock = new QDockWidget("Data Inspector", this);
+    inspectorDock->setObjectName("dataInspectorDock");
+    inspectorDock->setWidget(dataInspector);
+    addDockWidget(Qt::RightDockWidgetArea, inspectorDock);
+    inspectorDock->hide();
+    connect(inspectorDock, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) updateDataInspector();
+    });
+
+    structView = new StructView(this);
+    structDock = new QDockWidget("Structure", this);
+    structDock->setObjectName("structureDock");
+    structDock->setWidget(structView);
+    addDockWidget(Qt::RightDockWidgetArea, structDock);
+    structDock->hide();
+    connect(structDock, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) updateStructureView();
+    });
+    connect(structView, &StructView::rangeSelected, this, [this](qint64 offset, qint64 length) {
+        selectByteRange(qobject_cast<QSplitter*>(tabs->currentWidget()), offset, offset + length);
+    });
+
     connect(tree, &QTreeView::doubleClicked, [=](const QModelIndex &index) {
-        QString path = model->filePath(index);
-        if (QFileInfo(path).isFile()) openFile(path);
+        if (!model->isDir(index)) openFile(model->filePath(index));
     });
     connect(tabs, &QTabWidget::currentChanged, this, &Home::onTabChanged);
 
@@ -227,6 +461,18 @@ Home::Home(QWidget *parent) : QMainWindow(parent) {
     searchInput->setPlaceholderText("Type to highlight matches...");
     searchLayout->addWidget(searchInput);
 
+    caseToggle = new QPushButton("Aa", searchBarWidget);
+    caseToggle->setCheckable(true);
+    caseToggle->setFixedWidth(32);
+    caseToggle->setToolTip("Match case");
+    searchLayout->addWidget(caseToggle);
+
+    regexToggle = new QPushButton(".*", searchBarWidget);
+    regexToggle->setCheckable(true);
+    regexToggle->setFixedWidth(32);
+    regexToggle->setToolTip("Regular expression over the file's bytes, e.g. PK\\x03\\x04 or \\x7FELF");
+    searchLayout->addWidget(regexToggle);
+
     QPushButton *prevSearchBtn = new QPushButton("▼", searchBarWidget);
     prevSearchBtn->setFixedWidth(28);
     searchLayout->addWidget(prevSearchBtn);
@@ -267,6 +513,15 @@ Home::Home(QWidget *parent) : QMainWindow(parent) {
         updateRecentSearchResults();
     });
 
+    connect(regexToggle, &QPushButton::toggled, this, [this]() {
+        applySearchToCurrentTab();
+    });
+
+    connect(caseToggle, &QPushButton::toggled, this, [this]() {
+        applySearchToCurrentTab();
+        updateRecentSearchResults();
+    });
+
     connect(prevSearchBtn, &QPushButton::clicked, this, [this]() {
         navigateSearchMatch(false);
     });
@@ -284,6 +539,174 @@ Home::Home(QWidget *parent) : QMainWindow(parent) {
     });
 
     updateui();
+    restoreSession();
+}
+
+void Home::closeEvent(QCloseEvent *event) {
+    saveSession();
+    QMainWindow::closeEvent(event);
+}
+
+void Home::saveSession() {
+    QSettings settings("MyCompany", "MyApplication");
+    settings.beginGroup("session");
+    settings.remove("");
+
+    int currentRow = 0;
+    int row = 0;
+    settings.beginWriteArray("tabs");
+    for (int i = 0; i < tabs->count(); ++i) {
+        QWidget *tab = tabs->widget(i);
+        SessionTab state;
+        if (pendingTabs.contains(tab)) {
+            state = pendingTabs.value(tab);
+        } else {
+            QSplitter *split = qobject_cast<QSplitter*>(tab);
+            if (!split || !tabPaths.contains(tab)) continue;
+            CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+            CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+            if (!leftEd || !rightEd) continue;
+
+            state.path = tabPaths.value(tab);
+            switch (rightEd->byteGroupingMode()) {
+            case CodeEditor::GroupingBinary: state.mode = ModeBinary; break;
+            case CodeEditor::GroupingUnicode: state.mode = ModeUnicode; break;
+            case CodeEditor::GroupingText: state.mode = ModeText; break;
+            case CodeEditor::GroupingBase64: state.mode = ModeBase64; break;
+            case CodeEditor::GroupingBase64Url: state.mode = ModeBase64Url; break;
+            case CodeEditor::GroupingBase32: state.mode = ModeBase32; break;
+            case CodeEditor::GroupingAscii85: state.mode = ModeAscii85; break;
+            case CodeEditor::GroupingHex:
+            default: state.mode = ModeHex; break;
+            }
+            state.leftCursorPos = leftEd->textCursor().position();
+            state.rightCursorPos = rightEd->textCursor().position();
+            state.leftScroll = leftEd->verticalScrollBar()->value();
+            state.rightScroll = rightEd->verticalScrollBar()->value();
+        }
+
+        if (i == tabs->currentIndex()) currentRow = row;
+        settings.setArrayIndex(row++);
+        settings.setValue("path", state.path);
+        settings.setValue("mode", int(state.mode));
+        settings.setValue("leftCursor", state.leftCursorPos);
+        settings.setValue("rightCursor", state.rightCursorPos);
+        settings.setValue("leftScroll", state.leftScroll);
+        settings.setValue("rightScroll", state.rightScroll);
+    }
+    settings.endArray();
+
+    settings.setValue("current", currentRow);
+    settings.setValue("searchQuery", searchBarWidget->isVisible() ? searchInput->text() : QString());
+    settings.endGroup();
+}
+
+void Home::restoreSession() {
+    TRACE_SCOPE("Home::restoreSession");
+    QSettings settings("MyCompany", "MyApplication");
+    settings.beginGroup("session");
+    const int savedCurrent = settings.value("current").toInt();
+    const QString query = settings.value("searchQuery").toString();
+
+    // Only placeholders are created here; no file is opened or read.
+    int current = 0;
+    const int count = settings.beginReadArray("tabs");
+    {
+        QSignalBlocker blocker(tabs);
+        for (int i = 0; i < count; ++i) {
+            settings.setArrayIndex(i);
+            SessionTab state;
+            state.path = settings.value("path").toString();
+            if (state.path.isEmpty() || !QFileInfo(state.path).isFile()) continue;
+            state.mode = EditorMode(qBound(int(ModeHex), settings.value("mode").toInt(), int(ModeAscii85)));
+            state.leftCursorPos = settings.value("leftCursor").toInt();
+            state.rightCursorPos = settings.value("rightCursor").toInt();
+            state.leftScroll = settings.value("leftScroll").toInt();
+            state.rightScroll = settings.value("rightScroll").toInt();
+
+            QSplitter *placeholder = new QSplitter(Qt::Horizontal);
+            pendingTabs.insert(placeholder, state);
+            const int index = tabs->addTab(placeholder, QFileInfo(state.path).fileName());
+            tabs->setTabToolTip(index, state.path);
+            if (i == savedCurrent) current = index;
+        }
+        if (tabs->count() > 0) tabs->setCurrentIndex(current);
+    }
+    settings.endArray();
+    settings.endGroup();
+
+    if (tabs->count() == 0) return;
+    updateui();
+
+    if (!query.isEmpty()) {
+        searchBarWidget->show();
+        searchInput->setText(query);
+    }
+
+    // The active tab is read once the window is on screen.
+    QTimer::singleShot(0, this, [this]() {
+        QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+        if (split && pendingTabs.contains(split)) loadPendingTab(split);
+    });
+}
+
+Home::~Home() {
+    for (const std::shared_ptr<std::atomic<bool>> &cancelled : qAsConst(tabCancelled)) {
+        cancelled->store(true);
+    }
+}
+
+std::shared_ptr<std::atomic<bool>> Home::tabCancelFlag(QWidget *split) {
+    std::shared_ptr<std::atomic<bool>> &cancelled = tabCancelled[split];
+    if (!cancelled) cancelled = std::make_shared<std::atomic<bool>>(false);
+    return cancelled;
+}
+
+void Home::loadPendingTab(QSplitter *split) {
+    TRACE_SCOPE("Home::loadPendingTab");
+    const SessionTab state = pendingTabs.take(split);
+
+    QString error;
+    const QByteArray data = readTabData(split, state.path, &error);
+    if (!error.isEmpty()) {
+        statusBar()->showMessage("Cannot open " + state.path, 5000);
+        tabs->removeTab(tabs->indexOf(split));
+        split->deleteLater();
+        updateui();
+        return;
+    }
+
+    currentFile = state.path;
+    populateFileTab(split, state.path, data);
+    if (compressedTabs.contains(split)) indexCompressedTab(split);
+    currentMode = ModeHex;
+
+    // Same path as picking the mode from the menu.
+    if (state.mode != ModeHex) {
+        menu(kModeActions[state.mode]);
+    }
+
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    {
+        QSignalBlocker b1(leftEd);
+        QSignalBlocker b2(rightEd);
+        QTextCursor tcL = leftEd->textCursor();
+        tcL.setPosition(qBound(0, state.leftCursorPos, leftEd->document()->characterCount() - 1));
+        leftEd->setTextCursor(tcL);
+        QTextCursor tcR = rightEd->textCursor();
+        tcR.setPosition(qBound(0, state.rightCursorPos, rightEd->document()->characterCount() - 1));
+        rightEd->setTextCursor(tcR);
+    }
+
+    // Scroll ranges are known only after the first layout pass.
+    QTimer::singleShot(0, split, [leftEd, rightEd, state]() {
+        leftEd->verticalScrollBar()->setValue(state.leftScroll);
+        rightEd->verticalScrollBar()->setValue(state.rightScroll);
+    });
+
+    updateui();
+    applySearchToCurrentTab();
 }
 
 void Home::applyEditorGrouping(CodeEditor *editor, EditorMode mode) {
@@ -301,6 +724,18 @@ void Home::applyEditorGrouping(CodeEditor *editor, EditorMode mode) {
     case ModeUnicode:
         editor->setByteGroupingMode(CodeEditor::GroupingUnicode);
         break;
+    case ModeBase64:
+        editor->setByteGroupingMode(CodeEditor::GroupingBase64);
+        break;
+    case ModeBase64Url:
+        editor->setByteGroupingMode(CodeEditor::GroupingBase64Url);
+        break;
+    case ModeBase32:
+        editor->setByteGroupingMode(CodeEditor::GroupingBase32);
+        break;
+    case ModeAscii85:
+        editor->setByteGroupingMode(CodeEditor::GroupingAscii85);
+        break;
     case ModeText:
     default:
         editor->setByteGroupingMode(CodeEditor::GroupingText);
@@ -309,31 +744,57 @@ void Home::applyEditorGrouping(CodeEditor *editor, EditorMode mode) {
 }
 
 void Home::openFile(const QString &path) {
-    QFile f(path);
+    TRACE_SCOPE("Home::openFile");
     int index = tabs->currentIndex();
     tabStates[index].filePath = path;
     addToHistory(path);
 
+    QSplitter *editorSplit = new QSplitter(Qt::Horizontal);
+    QString error;
+    const QByteArray data = readTabData(editorSplit, path, &error);
+    if (!error.isEmpty()) {
+        statusBar()->showMessage(error, 5000);
+        delete editorSplit;
+        return;
+    }
 
-    if (!f.open(QIODevice::ReadOnly)) return;
-
-    QByteArray data = f.readAll();
-    originalText = QString::fromUtf8(data);
     currentFile = path;
 
-    QSplitter *editorSplit = new QSplitter(Qt::Horizontal);
+    populateFileTab(editorSplit, path, data);
+    tabs->addTab(editorSplit, QFileInfo(path).fileName());
+    if (compressedTabs.contains(editorSplit)) indexCompressedTab(editorSplit);
+
+    updateui();
+    applySearchToCurrentTab();
+
+}
+
+void Home::populateFileTab(QSplitter *editorSplit, const QString &path, const QByteArray &data) {
     CodeEditor *leftEd = new CodeEditor();
     CodeEditor *rightEd = new CodeEditor();
 
     leftEd->setByteGroupingMode(CodeEditor::GroupingText);
     applyEditorGrouping(rightEd, ModeHex);
-
-    leftEd->setPlainText(originalText);
-    rightEd->setPlainText(TextConverter::toHex(originalText, 1));
+    tabBytes.insert(editorSplit, data);
+    tabPaths.insert(editorSplit, path);
+
+    {
+        TRACE_SCOPE("CodeEditor::setPlainText");
+        // The hex pane comes straight from the bytes; only the text pane
+        // decodes, so invalid UTF-8 is shown as U+FFFD but never saved.
+        leftEd->setPlainText(DecodedText::decode(data));
+        rightEd->setPlainText(QString::fromLatin1(TextConverter::bytesToHex(data, 1)));
+    }
 
     editorSplit->addWidget(leftEd);
     editorSplit->addWidget(rightEd);
-    tabs->addTab(editorSplit, QFileInfo(path).fileName());
+    // The profile of compressed bytes says nothing about the ones shown.
+    if (!compressedTabs.contains(editorSplit)) {
+        attachEntropyMinimap(editorSplit, rightEd, path);
+        loadAnnotations(editorSplit, path);
+    }
+    connect(leftEd, &CodeEditor::visibleRangeChanged, this, &Home::scheduleAnnotationUpdate);
+    connect(rightEd, &CodeEditor::visibleRangeChanged, this, &Home::scheduleAnnotationUpdate);
 
 
     connect(leftEd, &CodeEditor::cursorPositionChanged, this, &Home::onCursorChanged);
@@ -344,10 +805,143 @@ void Home::openFile(const QString &path) {
             rightEd->verticalScrollBar(), &QScrollBar::setValue);
     connect(rightEd->verticalScrollBar(), &QScrollBar::valueChanged,
             leftEd->verticalScrollBar(), &QScrollBar::setValue);
+}
 
-    updateui();
-    applySearchToCurrentTab();
+QByteArray Home::readTabData(QSplitter *split, const QString &path, QString *error) {
+    if (!GzipIndex::isCompressedFile(path)) {
+        return AsyncReader::readFile(path, error);
+    }
+
+    // Only the first window is inflated here; the index that reaches the
+    // rest is built in the background.
+    QByteArray data;
+    GzipIndex::inflateFile(path, [&data](const char *block, qint64 size) {
+        data.append(block, int(qMin<qint64>(size, kCompressedWindow - data.size())));
+        return data.size() < kCompressedWindow;
+    }, error);
+    if (!error->isEmpty()) return QByteArray();
+    compressedTabs.insert(split, CompressedTab());
+    return data;
+}
+
+void Home::indexCompressedTab(QSplitter *split) {
+    const QString path = tabPaths.value(split);
+    const QString name = QFileInfo(path).fileName();
+    tabs->setTabToolTip(tabs->indexOf(split), path + " (decompressed, read-only)");
+    statusBar()->showMessage("Indexing " + name + "...");
+
+    // Progress is posted at most once per percent. The worker only reads
+    // the cancel flag; guard and the tab are looked at back on this thread.
+    const QPointer<Home> guard(this);
+    const QPointer<QSplitter> tab(split);
+    const std::shared_ptr<std::atomic<bool>> cancelled = tabCancelFlag(split);
+    QThreadPool::globalInstance()->start(new RunnableTask([path, name, tab, guard, cancelled]() {
+        std::shared_ptr<GzipIndex> index = std::make_shared<GzipIndex>();
+        QString error;
+        int lastPercent = -1;
+        const bool built = index->build(path, GzipIndex::defaultSpan,
+                                        [guard, name, cancelled, &lastPercent](qint64 done, qint64 total) {
+            const int percent = total > 0 ? int(done * 100 / total) : 100;
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, cancelled, name, percent]() {
+                    if (!guard || cancelled->load()) return;
+                    guard->statusBar()->showMessage(QString("Indexing %1... %2%").arg(name).arg(percent));
+                }, Qt::QueuedConnection);
+            }
+            return !cancelled->load();
+        }, &error);
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, tab, cancelled, index, built, name, error]() {
+            if (!guard || !tab || cancelled->load()) return;
+            QSplitter *split = tab.data();
+            if (!guard->compressedTabs.contains(split)) return;
+            if (!built) {
+                guard->statusBar()->showMessage(error.isEmpty() ? "Indexing " + name + " stopped." : error, 8000);
+                return;
+            }
+            guard->compressedTabs[split].index = index;
+            guard->statusBar()->showMessage(QString("%1: %2 bytes decompressed, %3 seek points. Find > Go To Offset moves through it.")
+                                                .arg(name).arg(index->size()).arg(index->checkpointCount()),
+                                            8000);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void Home::showCompressedWindow(QSplitter *split, qint64 offset) {
+    const std::shared_ptr<const GzipIndex> index = compressedTabs.value(split).index;
+    if (!index) {
+        statusBar()->showMessage("Still indexing; only the first part can be shown yet.", 5000);
+        return;
+    }
+    if (offset >= index->size()) {
+        statusBar()->showMessage(QString("Offset is past the end (%1 bytes).").arg(index->size()), 5000);
+        return;
+    }
+
+    // Some context is kept before the offset.
+    const qint64 start = qMax<qint64>(0, qMin(offset - kCompressedWindow / 4, index->size() - kCompressedWindow));
+    statusBar()->showMessage("Decompressing...");
+    // A read queued behind other work is skipped once its tab is closed.
+    const QPointer<Home> guard(this);
+    const QPointer<QSplitter> tab(split);
+    const std::shared_ptr<std::atomic<bool>> cancelled = tabCancelFlag(split);
+    QThreadPool::globalInstance()->start(new RunnableTask([index, tab, cancelled, start, offset, guard]() {
+        if (cancelled->load()) return;
+        QString error;
+        const QByteArray data = index->read(start, kCompressedWindow, &error);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, tab, cancelled, start, offset, data, error]() {
+            if (!guard || !tab || cancelled->load()) return;
+            QSplitter *split = tab.data();
+            if (!guard->compressedTabs.contains(split) || guard->tabs->currentWidget() != split) return;
+            if (!error.isEmpty()) {
+                guard->statusBar()->showMessage(error, 8000);
+                return;
+            }
+            CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+            if (!leftEd) return;
+
+            guard->compressedTabs[split].windowOffset = start;
+            guard->tabBytes[split] = data;
+            guard->isInternalTextSync = true;
+            leftEd->setPlainText(DecodedText::decode(data));
+            guard->isInternalTextSync = false;
+            // The right pane is rebuilt from the new bytes in the tab's mode.
+            guard->menu(kModeActions[guard->tabStates[guard->tabs->currentIndex()].mode]);
+            guard->jumpToByteOffset(split, offset - start);
+            guard->statusBar()->showMessage(QString("Showing bytes 0x%1-0x%2 of %3")
+                                                .arg(start, 0, 16).arg(start + data.size() - 1, 0, 16)
+                                                .arg(guard->compressedTabs[split].index->size()),
+                                            5000);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void Home::goToOffset() {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split || !tabBytes.contains(split)) return;
+
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, "Go To Offset", "Byte offset (decimal, or hex with 0x):",
+                                               QLineEdit::Normal, QString(), &ok).trimmed();
+    if (!ok || text.isEmpty()) return;
+    const qint64 offset = text.startsWith("0x", Qt::CaseInsensitive) ? text.mid(2).toLongLong(&ok, 16)
+                                                                     : text.toLongLong(&ok, 10);
+    if (!ok || offset < 0) {
+        statusBar()->showMessage("Not a byte offset: " + text, 4000);
+        return;
+    }
 
+    if (compressedTabs.contains(split)) {
+        const qint64 windowOffset = compressedTabs.value(split).windowOffset;
+        if (offset < windowOffset || offset >= windowOffset + tabBytes.value(split).size()) {
+            showCompressedWindow(split, offset);
+            return;
+        }
+        jumpToByteOffset(split, offset - windowOffset);
+        return;
+    }
+    jumpToByteOffset(split, offset);
 }
 
 void Home::onCursorChanged() {
@@ -371,6 +965,7 @@ void Home::onCursorChanged() {
     }
 
     updateSearchStatus();
+    scheduleInspectorUpdate();
 }
 
 void Home::syncEditors(CodeEditor *source, CodeEditor *target) {
@@ -384,6 +979,32 @@ void Home::syncEditors(CodeEditor *source, CodeEditor *target) {
     QTextCursor sc = source->textCursor();
     QTextCursor tc = target->textCursor();
 
+    QSplitter *currentSplit = qobject_cast<QSplitter*>(tabs->currentWidget());
+    CodeEditor *encodedEd = currentSplit ? qobject_cast<CodeEditor*>(currentSplit->widget(1)) : nullptr;
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    if (encodedEd && encodingForGrouping(encodedEd->byteGroupingMode(), &kind)) {
+        // Characters map to bytes through whole groups, so a selection on
+        // either side covers every group its bytes touch.
+        const bool fromEncoded = (source == encodedEd);
+        const auto toTarget = [&](int pos, bool isEnd) -> int {
+            if (fromEncoded) {
+                const qint64 byte = (isEnd && pos > 0) ? BaseEncoding::byteOffset(pos - 1, kind) + 1
+                                                       : BaseEncoding::byteOffset(pos, kind);
+                return textPosition(currentSplit, target, byte);
+            }
+            return int(BaseEncoding::charOffset(textByteOffset(currentSplit, source, pos), kind, isEnd));
+        };
+        const int targetMaxPos = qMax(0, target->document()->characterCount() - 1);
+        if (sc.hasSelection()) {
+            tc.setPosition(qBound(0, toTarget(sc.selectionStart(), false), targetMaxPos));
+            tc.setPosition(qBound(0, toTarget(sc.selectionEnd(), true), targetMaxPos), QTextCursor::KeepAnchor);
+        } else {
+            tc.setPosition(qBound(0, toTarget(sc.position(), false), targetMaxPos));
+        }
+        target->setTextCursor(tc);
+        return;
+    }
+
     int factor = 3;
 
     if (activeMode == 1) factor = 9;
@@ -599,9 +1220,11 @@ void Home::onEditorTextChanged() {
     CodeEditor *target = (source == leftEd) ? rightEd : leftEd;
     syncTextEditors(source, target);
     applySearchToCurrentTab();
+    scheduleInspectorUpdate();
 }
 
 void Home::syncTextEditors(CodeEditor *source, CodeEditor *target) {
+    TRACE_SCOPE("Home::syncTextEditors");
     if (!source || !target) {
         return;
     }
@@ -617,56 +1240,69 @@ void Home::syncTextEditors(CodeEditor *source, CodeEditor *target) {
     }
 
     CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
     const bool sourceIsLeft = (source == leftEd);
 
     const EditorMode mode = tabStates[currentIndex].mode;
     if (mode == ModeText && !sourceIsLeft) {
         return;
     }
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    const bool encoded = rightEd && encodingForGrouping(rightEd->byteGroupingMode(), &kind);
 
     const QString sourceText = source->toPlainText();
+    const int sourcePos = source->textCursor().position();
 
-    QString converted;
+    // Panes that show decoded text only re-encode what the edit changed, so
+    // invalid UTF-8 elsewhere keeps its bytes; the others parse back whole.
+    const QByteArray old = tabBytes.value(split);
+    QByteArray bytes;
+    qint64 expectedUnits = -1;
     if (sourceIsLeft) {
-        switch (mode) {
-        case ModeHex:
-            converted = TextConverter::toHex(sourceText, 1);
-            break;
-        case ModeBinary:
-            converted = TextConverter::toBinary(sourceText);
-            break;
-        case ModeUnicode:
-            converted = TextConverter::toUnicode(sourceText);
-            break;
-        case ModeText:
-        default:
-            converted = sourceText;
-            break;
-        }
+        bytes = bytesAfterTextEdit(old, decodedText(split), sourceText, sourcePos, &expectedUnits);
+    } else if (encoded) {
+        bytes = BaseEncoding::decode(sourceText.toLatin1(), kind);
+    } else if (mode == ModeHex) {
+        bytes = TextConverter::hexToBytes(sourceText.toLatin1());
+    } else if (mode == ModeBinary) {
+        bytes = TextConverter::binaryToBytes(sourceText.toLatin1());
+    } else if (mode == ModeUnicode) {
+        bytes = bytesAfterUnicodeEdit(old, decodedText(split), sourceText, sourcePos);
+    } else {
+        return;
+    }
+    setTabBytes(split, bytes);
+
+    // Removing text between two invalid bytes can join them into a valid
+    // sequence, and a new line after a lone CR joins it into CRLF; the pane
+    // then shows them as one character or line break again.
+    if (sourceIsLeft && (decodedText(split).unitCount() != expectedUnits
+                         || decodedText(split).blockCount() != source->document()->blockCount())) {
+        isInternalTextSync = true;
+        source->setPlainText(DecodedText::decode(bytes));
+        QTextCursor cursor = source->textCursor();
+        cursor.setPosition(qBound(0, sourcePos, source->document()->characterCount() - 1));
+        source->setTextCursor(cursor);
+        isInternalTextSync = false;
+    }
+
+    QString converted;
+    if (!sourceIsLeft) {
+        converted = DecodedText::decode(bytes);
+    } else if (encoded) {
+        converted = QString::fromLatin1(BaseEncoding::encode(bytes, kind));
     } else {
         switch (mode) {
         case ModeHex:
-            converted = TextConverter::fromHex(sourceText);
+            converted = QString::fromLatin1(TextConverter::bytesToHex(bytes, 1));
             break;
         case ModeBinary:
-            converted = TextConverter::fromBinary(sourceText);
+            converted = QString::fromLatin1(TextConverter::bytesToBinary(bytes));
             break;
         case ModeUnicode:
-            converted = TextConverter::fromUnicode(sourceText);
-            break;
-        case ModeText: {
-            TextType type = TextAnalyzer::detectType(sourceText);
-            if (type == TYPE_HEX) {
-                converted = TextConverter::fromHex(sourceText);
-            } else if (type == TYPE_BINARY) {
-                converted = TextConverter::fromBinary(sourceText);
-            } else if (type == TYPE_UNICODE) {
-                converted = TextConverter::fromUnicode(sourceText);
-            } else {
-                converted = sourceText;
-            }
+            converted = TextConverter::toUnicode(DecodedText::decode(bytes));
             break;
-        }
+        case ModeText:
         default:
             converted = sourceText;
             break;
@@ -677,27 +1313,17 @@ void Home::syncTextEditors(CodeEditor *source, CodeEditor *target) {
         return;
     }
 
-    const int sourcePos = source->textCursor().position();
-    const QString sourceUtf8 = sourceText.left(sourcePos);
-    const int byteOffset = sourceUtf8.toUtf8().size();
+    const qint64 byteOffset = byteOffsetAt(split, source, source->textCursor().position());
 
     isInternalTextSync = true;
     QSignalBlocker blocker(target);
-    target->setPlainText(converted);
+    {
+        TRACE_SCOPE("CodeEditor::setPlainText");
+        target->setPlainText(converted);
+    }
 
     QTextCursor tc = target->textCursor();
-    const QString targetText = target->toPlainText();
-    int targetPos = 0;
-    int acc = 0;
-    while (targetPos < targetText.size()) {
-        const int chBytes = QString(targetText.at(targetPos)).toUtf8().size();
-        if (acc + chBytes > byteOffset) {
-            break;
-        }
-        acc += chBytes;
-        ++targetPos;
-    }
-    tc.setPosition(qBound(0, targetPos, target->document()->characterCount() - 1));
+    tc.setPosition(qBound(0, panePosition(split, target, byteOffset), target->document()->characterCount() - 1));
     target->setTextCursor(tc);
     isInternalTextSync = false;
 }
@@ -717,6 +1343,10 @@ void Home::menu(const QString &name){
         if (!f.isEmpty()) openFolder(f);
         return;
     }
+    else if (name == "Compare Files") {
+        compareFiles();
+        return;
+    }
     else if (name == "Exit") {
         this->close();
         return;
@@ -752,15 +1382,90 @@ void Home::menu(const QString &name){
         return;
     }
 
+    if (name == "Export Trace") {
+        if (!Trace::isEnabled()) {
+            QMessageBox::information(
+                this,
+                "Export Trace",
+                "Tracing is off. Start the editor with --trace <path> or set HEXEDITOR_TRACE=1."
+                );
+            return;
+        }
+
+        const QString f = QFileDialog::getSaveFileName(this, "Export Trace", "trace.json", "Chrome Trace (*.json)");
+        if (f.isEmpty()) return;
+        if (!Trace::exportChromeJson(f)) {
+            QMessageBox::warning(this, "Export Trace", "Cannot write trace file: " + f);
+        }
+        return;
+    }
+
+    if (name == "Data Inspector") {
+        inspectorDock->setVisible(!inspectorDock->isVisible());
+        return;
+    }
+    if (name == "Structure Template") {
+        structDock->setVisible(!structDock->isVisible());
+        return;
+    }
+
+    if (name == "Follow File") {
+        toggleFollow();
+        return;
+    }
+    if (name == "Go To Offset") {
+        goToOffset();
+        return;
+    }
+    if (name == "Checksums") {
+        showChecksums();
+        return;
+    }
+    if (name == "Copy As") {
+        exportSelection(true);
+        return;
+    }
+    if (name == "Export Selection") {
+        exportSelection(false);
+        return;
+    }
+    if (name == "Annotate Selection") {
+        annotateSelection();
+        return;
+    }
+    if (name == "Remove Annotation") {
+        removeAnnotation();
+        return;
+    }
+    if (name == "Next Annotation" || name == "Previous Annotation") {
+        jumpToAnnotation(name == "Next Annotation");
+        return;
+    }
+    if (name == "Import Annotations") {
+        importAnnotations();
+        return;
+    }
+
     if (name == "Help") {
         QMessageBox::information(
             this,
             "Help",
             "Welcome to Hex Editor!\n\n"
             "- Use File > Open File/Open Folder to load content.\n"
+            "- Use File > Compare Files to diff two files byte by byte.\n"
             "- Use Edit and Select to modify your text quickly.\n"
             "- Use Find > StartFind to search in current tab.\n"
-            "- Use View to convert text to Hex/Binary/Unicode/Text."
+            "- Use View to convert text to Hex/Binary/Unicode/Text.\n"
+            "- Use View > Checksums to hash the selection or the whole tab.\n"
+            "- Use Edit > Copy As / Export Selection for hex, C, Python, Go or base64 output.\n"
+            "- Use View > To Base64 / Base32 / Ascii85 to view and edit the bytes in those encodings.\n"
+            "- Use View > Follow File to show data appended to a growing file.\n"
+            "- Use View > Structure Template to decode the bytes with a template (ELF headers, PNG chunks, your own records); click a field to select its bytes.\n"
+            "- Use Edit > Annotate Selection to bookmark bytes with a label, F2 / Shift+F2 to move between them, and Import Annotations to load ranges from a scan.\n"
+            "- gzip and zlib files open decompressed and read-only, 8 MB at a time; use Find > Go To Offset to move through them.\n"
+            "- Open files, their view mode and positions are restored on the next start.\n"
+            "- Use the .* button in the search bar to search the file's bytes with a regular expression.\n"
+            "- Use the Aa button in the search bar to match case."
             );
         return;
     }
@@ -781,13 +1486,19 @@ void Home::menu(const QString &name){
     if (!ed) return;
 
     if (name == "Save") {
-        if (!currentFile.isEmpty()) {
-            QFile file(currentFile);
-            if (file.open(QIODevice::WriteOnly)) {
-                file.write(ed->toPlainText().toUtf8());
-                file.close();
-                originalText = ed->toPlainText();
+        if (compressedTabs.contains(split)) {
+            statusBar()->showMessage("Compressed files open read-only; Save As writes the bytes shown.", 5000);
+            return;
+        }
+        const QString path = tabPaths.value(split, currentFile);
+        if (!path.isEmpty()) {
+            QString error;
+            if (!saveBytes(path, tabBytes.value(split), &error)) {
+                QMessageBox::warning(this, "Save", "Cannot save " + path + ": " + error);
+                return;
             }
+            // Edits since the last save moved the annotations too.
+            saveAnnotations(split);
         }
     }
 
@@ -796,13 +1507,17 @@ void Home::menu(const QString &name){
         QString f = QFileDialog::getSaveFileName(this, "Save As");
         if (f.isEmpty()) return;
 
-        QFile file(f);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(ed->toPlainText().toUtf8());
-            file.close();
-
-            currentFile = f;
+        QString error;
+        if (!saveBytes(f, tabBytes.value(split), &error)) {
+            QMessageBox::warning(this, "Save As", "Cannot save " + f + ": " + error);
+            return;
         }
+
+        currentFile = f;
+        tabPaths.insert(split, f);
+        compressedTabs.remove(split);
+        saveAnnotations(split);
+        tabs->setTabText(tabs->indexOf(split), QFileInfo(f).fileName());
     }
     else if (name == "Undo") ed->undo();
     else if (name == "Redo") ed->redo();
@@ -835,12 +1550,14 @@ void Home::menu(const QString &name){
         if (!split) return;
         int index = tabs->currentIndex();
         tabStates[index].mode = ModeHex;
-        CodeEditor *textEd = qobject_cast<CodeEditor*>(split->widget(0));
         currentMode = ModeHex;
         saveCurrentTabState();
 
         CodeEditor *hexEd = qobject_cast<CodeEditor*>(split->widget(1));
-        hexEd->setPlainText(TextConverter::toHex(textEd->toPlainText(), 1));
+        // Built from the bytes, so nothing needs parsing back.
+        isInternalTextSync = true;
+        hexEd->setPlainText(QString::fromLatin1(TextConverter::bytesToHex(tabBytes.value(split), 1)));
+        isInternalTextSync = false;
         applyEditorGrouping(hexEd, ModeHex);
         applySearchToCurrentTab();
     }
@@ -856,11 +1573,13 @@ void Home::menu(const QString &name){
 
         if (textEd && hexEd) {
 
-            QString binaryText = TextConverter::toBinary(textEd->toPlainText());
+            QString binaryText = QString::fromLatin1(TextConverter::bytesToBinary(tabBytes.value(split)));
             currentMode = ModeBinary;
             saveCurrentTabState();
 
+            isInternalTextSync = true;
             hexEd->setPlainText(binaryText);
+            isInternalTextSync = false;
             applyEditorGrouping(hexEd, ModeBinary);
             applySearchToCurrentTab();
         }
@@ -874,11 +1593,16 @@ void Home::menu(const QString &name){
 
         if (textEd && hexEd) {
 
-            QString unicodeText = TextConverter::toUnicode(textEd->toPlainText());
+            // From the bytes, not the text pane: its line breaks are
+            // normalised and decoding the escapes back must not replace the
+            // bytes behind a U+FFFD.
+            QString unicodeText = TextConverter::toUnicode(DecodedText::decode(tabBytes.value(split)));
             currentMode = ModeUnicode;
             saveCurrentTabState();
 
+            isInternalTextSync = true;
             hexEd->setPlainText(unicodeText);
+            isInternalTextSync = false;
             applyEditorGrouping(hexEd, ModeUnicode);
             applySearchToCurrentTab();
         }
@@ -913,25 +1637,77 @@ void Home::menu(const QString &name){
 
             applySearchToCurrentTab();
         }
+    } else if (name == "To Base64" || name == "To Base64 URL" || name == "To Base32" || name == "To Ascii85") {
+        QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+        if (!split) return;
+        CodeEditor *hexEd = qobject_cast<CodeEditor*>(split->widget(1));
+        if (!hexEd) return;
+
+        const EditorMode mode = name == "To Base64" ? ModeBase64
+                              : name == "To Base64 URL" ? ModeBase64Url
+                              : name == "To Base32" ? ModeBase32 : ModeAscii85;
+        tabStates[tabs->currentIndex()].mode = mode;
+        currentMode = mode;
+        saveCurrentTabState();
+
+        applyEditorGrouping(hexEd, mode);
+        BaseEncoding::Kind kind = BaseEncoding::Base64;
+        encodingForGrouping(hexEd->byteGroupingMode(), &kind);
+        // Straight from the bytes, so nothing needs decoding back.
+        isInternalTextSync = true;
+        hexEd->setPlainText(QString::fromLatin1(BaseEncoding::encode(tabBytes.value(split), kind)));
+        isInternalTextSync = false;
+        applySearchToCurrentTab();
     }
 }
 
 void Home::openFolder(const QString &path) {
-    tree->setRootIndex(model->index(path));
+    model->setRootPath(path);
     updateRecentSearchResults();
 }
 
-void Home::addNewTab() {
+void Home::compareFiles() {
+    const QString first = QFileDialog::getOpenFileName(this, "Compare: first file");
+    if (first.isEmpty()) return;
+    const QString second = QFileDialog::getOpenFileName(this, "Compare: second file", QFileInfo(first).absolutePath());
+    if (second.isEmpty()) return;
+
+    statusBar()->showMessage("Comparing " + QFileInfo(first).fileName() + " and " + QFileInfo(second).fileName() + "...");
+
+    const QPointer<Home> guard(this);
+    QThreadPool::globalInstance()->start(new RunnableTask([first, second, guard]() {
+        const DiffResult result = BinaryDiff::compareFiles(first, second);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, first, second, result]() {
+            if (guard) guard->showComparison(first, second, result);
+        }, Qt::QueuedConnection);
+    }));
+}
 
-    QSplitter *editorSplit = new QSplitter(Qt::Horizontal);
-    CodeEditor *leftEd = new CodeEditor();
-    CodeEditor *rightEd = new CodeEditor();
+void Home::showComparison(const QString &pathA, const QString &pathB, const DiffResult &result) {
+    statusBar()->clearMessage();
+    if (!result.error.isEmpty()) {
+        QMessageBox::warning(this, "Compare Files", result.error);
+        return;
+    }
+
+    CompareView *view = new CompareView(pathA, pathB, result);
+    const int index = tabs->addTab(view, QFileInfo(pathA).fileName() + " <-> " + QFileInfo(pathB).fileName());
+    tabs->setCurrentIndex(index);
+    updateui();
+}
+
+void Home::addNewTab() {
+
+    QSplitter *editorSplit = new QSplitter(Qt::Horizontal);
+    CodeEditor *leftEd = new CodeEditor();
+    CodeEditor *rightEd = new CodeEditor();
 
     leftEd->setByteGroupingMode(CodeEditor::GroupingText);
     applyEditorGrouping(rightEd, ModeHex);
 
     editorSplit->addWidget(leftEd);
     editorSplit->addWidget(rightEd);
+    tabBytes.insert(editorSplit, QByteArray());
 
     tabs->addTab(editorSplit, "Untitled");
     tabs->setCurrentWidget(editorSplit);
@@ -946,6 +1722,8 @@ void Home::addNewTab() {
     connect(rightEd, &CodeEditor::selectionChanged, this, &Home::onCursorChanged);
 
     connect(rightEd, &CodeEditor::cursorPositionChanged, this, &Home::onCursorChanged);
+    connect(leftEd, &CodeEditor::visibleRangeChanged, this, &Home::scheduleAnnotationUpdate);
+    connect(rightEd, &CodeEditor::visibleRangeChanged, this, &Home::scheduleAnnotationUpdate);
 
 
 
@@ -990,6 +1768,10 @@ void Home::onTabChanged(int index) {
 
     QSplitter *split = qobject_cast<QSplitter*>(tabs->widget(index));
     if (!split) return;
+    if (pendingTabs.contains(split)) {
+        loadPendingTab(split);
+        return;
+    }
     CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
     CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
 
@@ -1017,6 +1799,8 @@ void Home::onTabChanged(int index) {
     }
 
     applySearchToCurrentTab();
+    scheduleInspectorUpdate();
+    scheduleAnnotationUpdate();
 }
 
 void Home::saveCurrentTabState() {
@@ -1116,6 +1900,7 @@ void Home::updateSearchStatus() {
 }
 
 void Home::updateRecentSearchResults() {
+    TRACE_SCOPE("Home::updateRecentSearchResults");
     if (!recentSearchResults || !searchInput) {
         return;
     }
@@ -1128,18 +1913,23 @@ void Home::updateRecentSearchResults() {
         return;
     }
 
+    QStringList paths;
     for (const QString &path : qAsConst(recentFiles)) {
-        if (!QFileInfo::exists(path)) {
-            continue;
+        if (QFileInfo::exists(path)) {
+            paths.append(path);
         }
+    }
 
-        const QPair<int, QString> matchInfo = countOccurrencesInRecentFile(path, query);
-        if (matchInfo.first <= 0) {
+    const QVector<int> counts = SearchEngine::countOccurrencesInFiles(paths, query, searchCaseSensitivity());
+    for (int i = 0; i < paths.size(); ++i) {
+        const QString &path = paths.at(i);
+        const int count = counts.at(i);
+        if (count <= 0) {
             continue;
         }
 
         QListWidgetItem *item = new QListWidgetItem(
-            QString("%1 (%2)").arg(matchInfo.second).arg(matchInfo.first),
+            QString("%1 (%2)").arg(QFileInfo(path).fileName()).arg(count),
             recentSearchResults
             );
         item->setData(Qt::UserRole, path);
@@ -1163,6 +1953,7 @@ void Home::openRecentSearchResult(QListWidgetItem *item) {
 }
 
 void Home::applySearchToCurrentTab() {
+    TRACE_SCOPE("Home::applySearchToCurrentTab");
     QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
     if (!split) return;
 
@@ -1178,6 +1969,13 @@ void Home::applySearchToCurrentTab() {
         return;
     }
 
+    leftEd->setSearchCaseSensitivity(searchCaseSensitivity());
+    rightEd->setSearchCaseSensitivity(searchCaseSensitivity());
+    if (regexToggle && regexToggle->isChecked()) {
+        applyRegexSearch(split, leftEd, rightEd, query);
+        updateSearchStatus();
+        return;
+    }
 
     const TextType queryType = detectSearchQueryType(query);
     QString queryAsText = convertQueryToText(query, queryType);
@@ -1197,9 +1995,874 @@ void Home::applySearchToCurrentTab() {
     if (rightType == TYPE_UNKNOWN) {
         rightQuery = query;
     }
+    // Encoded text is searched for as typed.
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    if (encodingForGrouping(rightEd->byteGroupingMode(), &kind)) {
+        rightQuery = query;
+    }
 
 
     leftEd->setSearchText(leftQuery);
     rightEd->setSearchText(rightQuery);
     updateSearchStatus();
 }
+
+Qt::CaseSensitivity Home::searchCaseSensitivity() const {
+    return (caseToggle && caseToggle->isChecked()) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+}
+
+void Home::applyRegexSearch(QSplitter *split, CodeEditor *leftEd, CodeEditor *rightEd, const QString &pattern) {
+    TRACE_SCOPE("Home::applyRegexSearch");
+    const ByteRegex regex(pattern.toUtf8(), searchCaseSensitivity() == Qt::CaseInsensitive);
+    if (!regex.isValid()) {
+        leftEd->setSearchText(QString());
+        rightEd->setSearchText(QString());
+        statusBar()->showMessage("Regex: " + regex.errorString(), 4000);
+        return;
+    }
+
+    // Matched on the bytes, then marked in both panes, so a match can span
+    // the separators of the hex and binary views.
+    const QVector<ByteMatch> found = regex.findAll(tabBytes.value(split));
+    leftEd->setSearchMatches(textRangesForByteMatches(leftEd->toPlainText(), found, 1));
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    if (encodingForGrouping(rightEd->byteGroupingMode(), &kind)) {
+        rightEd->setSearchMatches(encodedRangesForByteMatches(found, kind));
+        return;
+    }
+    switch (rightEd->byteGroupingMode()) {
+    case CodeEditor::GroupingHex:
+        rightEd->setSearchMatches(columnRangesForByteMatches(found, 3));
+        break;
+    case CodeEditor::GroupingBinary:
+        rightEd->setSearchMatches(columnRangesForByteMatches(found, 9));
+        break;
+    case CodeEditor::GroupingUnicode:
+        rightEd->setSearchMatches(textRangesForByteMatches(leftEd->toPlainText(), found, 6));
+        break;
+    case CodeEditor::GroupingText:
+    default:
+        rightEd->setSearchMatches(textRangesForByteMatches(rightEd->toPlainText(), found, 1));
+        break;
+    }
+}
+
+void Home::scheduleInspectorUpdate() {
+    const bool inspecting = inspectorDock && inspectorDock->isVisible();
+    const bool structure = structDock && structDock->isVisible();
+    if ((!inspecting && !structure) || inspectorUpdatePending) {
+        return;
+    }
+
+    // Cursor signals arrive in bursts while a selection is dragged; decode
+    // once per event loop pass, i.e. before the next frame is painted.
+    inspectorUpdatePending = true;
+    QTimer::singleShot(0, this, [this]() {
+        inspectorUpdatePending = false;
+        updateDataInspector();
+        updateStructureView();
+    });
+}
+
+void Home::updateDataInspector() {
+    if (!dataInspector) return;
+
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split) {
+        dataInspector->clear();
+        return;
+    }
+
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) {
+        dataInspector->clear();
+        return;
+    }
+
+    CodeEditor *editor = (lastActiveEditor == rightEd) ? rightEd : leftEd;
+    dataInspector->inspect(tabBytes.value(split), cursorByteOffset(split, editor));
+}
+
+void Home::updateStructureView() {
+    if (!structView || !structDock->isVisible()) return;
+
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    CodeEditor *leftEd = split ? qobject_cast<CodeEditor*>(split->widget(0)) : nullptr;
+    CodeEditor *rightEd = split ? qobject_cast<CodeEditor*>(split->widget(1)) : nullptr;
+    if (!leftEd || !rightEd) {
+        structView->clear();
+        return;
+    }
+
+    structView->setData(tabBytes.value(split));
+    // The start of a selection, so a field picked in the tree stays current.
+    CodeEditor *editor = (lastActiveEditor == rightEd) ? rightEd : leftEd;
+    structView->revealOffset(byteOffsetAt(split, editor, editor->textCursor().selectionStart()));
+}
+
+qint64 Home::cursorByteOffset(QSplitter *split, CodeEditor *editor) {
+    return byteOffsetAt(split, editor, editor->textCursor().position());
+}
+
+qint64 Home::byteOffsetAt(QSplitter *split, CodeEditor *editor, int pos) {
+    if (editor != split->widget(1)) {
+        return textByteOffset(split, editor, pos);
+    }
+
+    switch (tabStates[tabs->currentIndex()].mode) {
+    case ModeHex:
+        return pos / 3;
+    case ModeBinary:
+        return pos / 9;
+    case ModeUnicode:
+        // Six characters per unit of the decoded text, line breaks included.
+        return decodedText(split).byteOffset(pos / 6);
+    case ModeBase64:
+    case ModeBase64Url:
+    case ModeBase32:
+    case ModeAscii85: {
+        BaseEncoding::Kind kind = BaseEncoding::Base64;
+        encodingForGrouping(editor->byteGroupingMode(), &kind);
+        return BaseEncoding::byteOffset(pos, kind);
+    }
+    case ModeText:
+    default:
+        return textByteOffset(split, editor, pos);
+    }
+}
+
+// Inverse of byteOffsetAt: where the byte starts in the pane.
+int Home::panePosition(QSplitter *split, CodeEditor *editor, qint64 byte) {
+    if (editor != split->widget(1)) {
+        return textPosition(split, editor, byte);
+    }
+
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    if (encodingForGrouping(editor->byteGroupingMode(), &kind)) {
+        return int(BaseEncoding::charOffset(byte, kind));
+    }
+    switch (tabStates[tabs->indexOf(split)].mode) {
+    case ModeHex:
+        return int(byte * 3);
+    case ModeBinary:
+        return int(byte * 9);
+    case ModeUnicode:
+        return int(decodedText(split).unitAt(byte) * 6);
+    case ModeText:
+    default:
+        return textPosition(split, editor, byte);
+    }
+}
+
+const DecodedText &Home::decodedText(QWidget *split) {
+    DecodedText &text = tabText[split];
+    const QByteArray bytes = tabBytes.value(split);
+    if (!text.isBuiltFrom(bytes)) text = DecodedText(bytes);
+    return text;
+}
+
+// Positions in a pane showing the decoded bytes, mapped through the block the
+// document finds for them, so nothing before that block is looked at.
+qint64 Home::textByteOffset(QWidget *split, const CodeEditor *editor, int pos) {
+    const DecodedText &text = decodedText(split);
+    const QTextBlock block = editor->document()->findBlock(pos);
+    if (!block.isValid()) return tabBytes.value(split).size();
+    return text.byteOffset(text.blockStart(block.blockNumber()) + (pos - block.position()));
+}
+
+int Home::textPosition(QWidget *split, const CodeEditor *editor, qint64 byte) {
+    const DecodedText &text = decodedText(split);
+    const qint64 unit = text.unitAt(byte);
+    const int number = text.blockOf(unit);
+    const QTextBlock block = editor->document()->findBlockByNumber(number);
+    if (!block.isValid()) return qMax(0, editor->document()->characterCount() - 1);
+    return block.position() + int(qMin<qint64>(unit - text.blockStart(number), block.length() - 1));
+}
+
+void Home::selectedByteRange(QSplitter *split, CodeEditor *editor, qint64 *begin, qint64 *end) {
+    const QTextCursor cursor = editor->textCursor();
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    if (editor == split->widget(1) && encodingForGrouping(editor->byteGroupingMode(), &kind)) {
+        // The last selected character may share its group with later bytes.
+        *begin = BaseEncoding::byteOffset(cursor.selectionStart(), kind);
+        *end = cursor.hasSelection() ? qMax(*begin, BaseEncoding::byteOffset(cursor.selectionEnd() - 1, kind) + 1)
+                                     : *begin;
+        return;
+    }
+    int stride = 1;
+    if (editor == split->widget(1)) {
+        const EditorMode mode = tabStates[tabs->currentIndex()].mode;
+        stride = (mode == ModeHex) ? 3 : (mode == ModeBinary) ? 9 : (mode == ModeUnicode) ? 6 : 1;
+    }
+
+    // A partly selected token still counts as its whole byte.
+    *begin = byteOffsetAt(split, editor, cursor.selectionStart());
+    *end = qMax(*begin, byteOffsetAt(split, editor, cursor.selectionEnd() + stride - 1));
+}
+
+void Home::showChecksums() {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split) return;
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+
+    const QByteArray bytes = tabBytes.value(split);
+    CodeEditor *editor = (lastActiveEditor == rightEd) ? rightEd : leftEd;
+    QByteArray data = bytes;
+    QString scope = QString("Whole tab, %1 bytes").arg(bytes.size());
+    if (editor->textCursor().hasSelection()) {
+        qint64 begin = 0;
+        qint64 end = 0;
+        selectedByteRange(split, editor, &begin, &end);
+        end = qMin<qint64>(end, bytes.size());
+        begin = qMin(begin, end);
+        data = bytes.mid(int(begin), int(end - begin));
+        scope = QString("Selection 0x%1-0x%2, %3 bytes")
+                    .arg(begin, 0, 16).arg(qMax<qint64>(begin, end - 1), 0, 16).arg(end - begin);
+    }
+
+    statusBar()->showMessage("Hashing...");
+
+    // Progress is posted at most once per percent.
+    const QPointer<Home> guard(this);
+    const std::shared_ptr<std::atomic<bool>> cancelled = tabCancelFlag(split);
+    QThreadPool::globalInstance()->start(new RunnableTask([data, scope, guard, cancelled]() {
+        int lastPercent = -1;
+        const QVector<HashDigest> digests = HashEngine::hashBytes(data, HashEngine::AllAlgorithms,
+            [guard, cancelled, &lastPercent](qint64 done, qint64 total) {
+                const int percent = total > 0 ? int(done * 100 / total) : 100;
+                if (percent != lastPercent) {
+                    lastPercent = percent;
+                    QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, cancelled, percent]() {
+                        if (!guard || cancelled->load()) return;
+                        guard->statusBar()->showMessage(QString("Hashing... %1%").arg(percent));
+                    }, Qt::QueuedConnection);
+                }
+                return !cancelled->load();
+            });
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, cancelled, digests, scope]() {
+            if (!guard) return;
+            if (cancelled->load()) {
+                guard->statusBar()->clearMessage();
+                return;
+            }
+            guard->statusBar()->clearMessage();
+
+            QString text = scope + "\n\n";
+            for (const HashDigest &d : digests) {
+                text += d.algorithm + ":  " + QString::fromLatin1(d.digest.toHex()) + "\n";
+            }
+            QMessageBox box(QMessageBox::NoIcon, "Checksums", text, QMessageBox::Ok, guard);
+            box.setTextInteractionFlags(Qt::TextSelectableByMouse);
+            box.exec();
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void Home::exportSelection(bool toClipboard) {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split) return;
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+
+    const QByteArray bytes = tabBytes.value(split);
+    CodeEditor *editor = (lastActiveEditor == rightEd) ? rightEd : leftEd;
+    qint64 begin = 0;
+    qint64 end = bytes.size();
+    if (editor->textCursor().hasSelection()) {
+        selectedByteRange(split, editor, &begin, &end);
+        end = qMin<qint64>(end, bytes.size());
+        begin = qMin(begin, end);
+    }
+    if (begin == end) {
+        statusBar()->showMessage("Nothing to export", 3000);
+        return;
+    }
+
+    const QString title = toClipboard ? "Copy As" : "Export Selection";
+    bool ok = false;
+    const QString formatName = QInputDialog::getItem(this, title, "Format:", ExportWriter::formatNames(),
+                                                     QSettings().value("export/format", 0).toInt(), false, &ok);
+    if (!ok) return;
+    const int format = ExportWriter::parseFormat(formatName);
+    if (format < 0) return;
+    QSettings().setValue("export/format", format);
+
+    const qint64 outputSize = ExportWriter::outputSize(end - begin, ExportWriter::Format(format));
+    if (toClipboard && outputSize > kClipboardLimit) {
+        QMessageBox::information(this, title,
+                                 QString("The %1 output would be %2; use Edit > Export Selection to write it to a file.")
+                                     .arg(formatName, QLocale().formattedDataSize(outputSize)));
+        return;
+    }
+
+    QString path;
+    if (!toClipboard) {
+        path = QFileDialog::getSaveFileName(this, title);
+        if (path.isEmpty()) return;
+    }
+
+    statusBar()->showMessage("Exporting...");
+
+    // Progress is posted at most once per percent.
+    const QPointer<Home> guard(this);
+    const std::shared_ptr<std::atomic<bool>> cancelled = tabCancelFlag(split);
+    QThreadPool::globalInstance()->start(new RunnableTask([bytes, begin, end, format, formatName, path, guard,
+                                                           cancelled]() {
+        int lastPercent = -1;
+        const ExportWriter::Progress progress = [guard, cancelled, &lastPercent](qint64 done, qint64 total) {
+            const int percent = total > 0 ? int(done * 100 / total) : 100;
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, cancelled, percent]() {
+                    if (!guard || cancelled->load()) return;
+                    guard->statusBar()->showMessage(QString("Exporting... %1%").arg(percent));
+                }, Qt::QueuedConnection);
+            }
+            return !cancelled->load();
+        };
+
+        const char *data = bytes.constData() + begin;
+        const qint64 size = end - begin;
+        QByteArray text;
+        QString error;
+        if (path.isEmpty()) {
+            text = ExportWriter::toByteArray(data, size, ExportWriter::Format(format), progress);
+        } else {
+            QSaveFile file(path);
+            if (!file.open(QIODevice::WriteOnly)) {
+                error = file.errorString();
+            } else if (ExportWriter::write(data, size, ExportWriter::Format(format), &file, progress, &error)) {
+                if (!file.commit()) error = file.errorString();
+            }
+        }
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, cancelled, text, error, path, formatName,
+                                                                 size]() {
+            if (!guard) return;
+            if (cancelled->load()) {
+                guard->statusBar()->clearMessage();
+                return;
+            }
+            if (!error.isEmpty()) {
+                guard->statusBar()->clearMessage();
+                QMessageBox::warning(guard, "Export Selection", "Cannot export: " + error);
+                return;
+            }
+            if (path.isEmpty()) {
+                QGuiApplication::clipboard()->setText(QString::fromLatin1(text));
+            }
+            guard->statusBar()->showMessage(QString("%1 bytes %2 as %3")
+                                                .arg(size).arg(path.isEmpty() ? "copied" : "exported", formatName),
+                                            4000);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void Home::attachEntropyMinimap(QSplitter *split, CodeEditor *editor, const QString &path) {
+    EntropyMinimap *minimap = new EntropyMinimap();
+    editor->setMinimap(minimap);
+
+    connect(minimap, &EntropyMinimap::offsetRequested, this, [this, split](qint64 offset) {
+        jumpToByteOffset(split, offset);
+    });
+
+    auto updateVisibleRange = [editor, minimap]() {
+        const QScrollBar *bar = editor->verticalScrollBar();
+        const double total = bar->maximum() + bar->pageStep();
+        if (total <= 0) return;
+        minimap->setVisibleRange(bar->value() / total, (bar->value() + bar->pageStep()) / total);
+    };
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, minimap, updateVisibleRange);
+    connect(editor->verticalScrollBar(), &QScrollBar::rangeChanged, minimap, updateVisibleRange);
+
+    // Analysis maps the file and runs on all cores; the strip fills in when done.
+    const QPointer<EntropyMinimap> guard(minimap);
+    QThreadPool::globalInstance()->start(new RunnableTask([path, guard]() {
+        const EntropyProfile profile = EntropyAnalyzer::cachedAnalyzeFile(path);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, profile]() {
+            if (guard) guard->setProfile(profile);
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void Home::jumpToByteOffset(QSplitter *split, qint64 offset) {
+    CodeEditor *editor = selectByteRange(split, offset, offset);
+    if (!editor) return;
+    editor->setFocus();
+    editor->centerCursor();
+}
+
+// Selects bytes [begin, end) in the pane that shows them one to one (the
+// right one, or the left in text and Unicode mode) and mirrors it in the
+// other, without taking focus. Returns the pane used.
+CodeEditor *Home::selectByteRange(QSplitter *split, qint64 begin, qint64 end) {
+    if (!split) return nullptr;
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return nullptr;
+
+    const int index = tabs->indexOf(split);
+    const EditorMode mode = tabStates.contains(index) ? tabStates[index].mode : ModeHex;
+
+    CodeEditor *editor = rightEd;
+    qint64 from = 0;
+    qint64 to = 0;
+    if (mode == ModeHex || mode == ModeBinary) {
+        // Up to the last digit of the last byte, not the space after it.
+        const int width = (mode == ModeHex) ? 3 : 9;
+        from = begin * width;
+        to = end > begin ? end * width - 1 : from;
+    } else if (mode >= ModeBase64) {
+        BaseEncoding::Kind kind = BaseEncoding::Base64;
+        encodingForGrouping(rightEd->byteGroupingMode(), &kind);
+        from = BaseEncoding::charOffset(begin, kind);
+        to = end > begin ? BaseEncoding::charOffset(end, kind, true) : from;
+    } else {
+        editor = leftEd;
+        from = textPosition(split, leftEd, begin);
+        to = end > begin ? textPosition(split, leftEd, end) : from;
+    }
+
+    const int maxPos = qMax(0, editor->document()->characterCount() - 1);
+    QTextCursor cursor = editor->textCursor();
+    cursor.setPosition(int(qBound<qint64>(0, from, maxPos)));
+    cursor.setPosition(int(qBound<qint64>(0, to, maxPos)), QTextCursor::KeepAnchor);
+    editor->setTextCursor(cursor);
+    editor->ensureCursorVisible();
+    lastActiveEditor = editor;
+    if (tabStates.contains(index)) tabStates[index].lastSearchFromRight = (editor == rightEd);
+    syncEditors(editor, editor == leftEd ? rightEd : leftEd);
+    return editor;
+}
+
+// Stores an edited buffer and moves the tab's annotations with the edit. The
+// bytes between the common prefix and suffix count as overwritten in place;
+// only the change in length is an insertion or deletion, right after them.
+void Home::setTabBytes(QSplitter *split, const QByteArray &bytes) {
+    const std::shared_ptr<AnnotationTree> annotations = tabAnnotations.value(split);
+    if (annotations && !annotations->isEmpty()) {
+        const QByteArray old = tabBytes.value(split);
+        const int common = qMin(old.size(), bytes.size());
+        const int prefix = int(std::mismatch(old.constBegin(), old.constBegin() + common, bytes.constBegin()).first
+                               - old.constBegin());
+        const int suffix = int(std::mismatch(old.crbegin(), old.crbegin() + (common - prefix), bytes.crbegin()).first
+                               - old.crbegin());
+        const qint64 removed = old.size() - prefix - suffix;
+        const qint64 added = bytes.size() - prefix - suffix;
+        if (added > removed) annotations->insertBytes(prefix + removed, added - removed);
+        else annotations->removeBytes(prefix + added, removed - added);
+        scheduleAnnotationUpdate();
+    }
+    tabBytes[split] = bytes;
+}
+
+void Home::loadAnnotations(QSplitter *split, const QString &path) {
+    const QString sidecar = AnnotationTree::sidecarPath(path);
+    if (!QFileInfo::exists(sidecar)) return;
+
+    // An imported scan can hold millions of ranges; they are read off the
+    // UI thread and show up when done.
+    const QPointer<Home> guard(this);
+    QThreadPool::globalInstance()->start(new RunnableTask([split, path, sidecar, guard]() {
+        std::shared_ptr<AnnotationTree> loaded = std::make_shared<AnnotationTree>();
+        QString error;
+        const bool ok = loaded->addFromFile(sidecar, &error);
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, split, path, loaded, ok, error]() {
+            if (!guard || guard->tabPaths.value(split) != path) return;
+            if (!ok) {
+                guard->statusBar()->showMessage(error, 8000);
+                return;
+            }
+            // Ranges added while the file was read are kept.
+            if (const std::shared_ptr<AnnotationTree> added = guard->tabAnnotations.value(split)) {
+                added->forEach([&loaded](const AnnotationTree::Annotation &a) {
+                    loaded->add(a.start, a.end, a.label, a.color);
+                });
+            }
+            guard->tabAnnotations.insert(split, loaded);
+            guard->scheduleAnnotationUpdate();
+        }, Qt::QueuedConnection);
+    }));
+}
+
+void Home::saveAnnotations(QSplitter *split) {
+    const QString path = tabPaths.value(split);
+    const std::shared_ptr<AnnotationTree> annotations = tabAnnotations.value(split);
+    if (path.isEmpty() || !annotations || compressedTabs.contains(split)) return;
+    QString error;
+    if (!annotations->saveToFile(AnnotationTree::sidecarPath(path), &error)) {
+        statusBar()->showMessage("Annotations not saved: " + error, 8000);
+    }
+}
+
+void Home::annotateSelection() {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split) return;
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+    if (compressedTabs.contains(split)) {
+        statusBar()->showMessage("Compressed files open read-only; annotations are not kept for them.", 5000);
+        return;
+    }
+
+    // Without a selection, the byte at the cursor: a bookmark.
+    CodeEditor *editor = (lastActiveEditor == rightEd) ? rightEd : leftEd;
+    qint64 begin = 0;
+    qint64 end = 0;
+    selectedByteRange(split, editor, &begin, &end);
+    const qint64 size = tabBytes.value(split).size();
+    begin = qMin(begin, qMax<qint64>(0, size - 1));
+    end = qBound(begin + 1, end, qMax(begin + 1, size));
+
+    bool ok = false;
+    const QString label = QInputDialog::getText(this, "Annotate Selection",
+                                                QString("Label for 0x%1 - 0x%2:")
+                                                    .arg(QString::number(begin, 16).toUpper(),
+                                                         QString::number(end - 1, 16).toUpper()),
+                                                QLineEdit::Normal, QString(), &ok);
+    if (!ok) return;
+
+    std::shared_ptr<AnnotationTree> &annotations = tabAnnotations[split];
+    if (!annotations) annotations = std::make_shared<AnnotationTree>();
+    annotations->add(begin, end, label);
+    saveAnnotations(split);
+    updateAnnotations();
+}
+
+void Home::removeAnnotation() {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    const std::shared_ptr<AnnotationTree> annotations = tabAnnotations.value(split);
+    if (!split || !annotations) return;
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+
+    // The innermost range around the cursor, i.e. the one starting last.
+    CodeEditor *editor = (lastActiveEditor == rightEd) ? rightEd : leftEd;
+    const qint64 offset = cursorByteOffset(split, editor);
+    const QVector<AnnotationTree::Annotation> found = annotations->overlapping(offset, offset + 1);
+    if (found.isEmpty()) {
+        statusBar()->showMessage("No annotation at the cursor", 3000);
+        return;
+    }
+    annotations->remove(found.last().id);
+    saveAnnotations(split);
+    updateAnnotations();
+}
+
+void Home::jumpToAnnotation(bool forward) {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    const std::shared_ptr<AnnotationTree> annotations = tabAnnotations.value(split);
+    if (!split || !annotations || annotations->isEmpty()) {
+        statusBar()->showMessage("No annotations in this tab", 3000);
+        return;
+    }
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+
+    CodeEditor *editor = (lastActiveEditor == rightEd) ? rightEd : leftEd;
+    qint64 begin = 0;
+    qint64 end = 0;
+    selectedByteRange(split, editor, &begin, &end);
+    // Wraps around at either end of the file.
+    AnnotationTree::Annotation target = forward ? annotations->next(begin) : annotations->previous(begin);
+    if (target.id < 0) target = forward ? annotations->next(-1) : annotations->previous(LLONG_MAX);
+    if (target.id < 0) return;
+
+    editor = selectByteRange(split, target.start, target.end);
+    if (editor) editor->centerCursor();
+    statusBar()->showMessage(QString("0x%1: %2").arg(QString::number(target.start, 16).toUpper(),
+                                                     target.label.isEmpty() ? QString("bookmark") : target.label),
+                             4000);
+}
+
+void Home::importAnnotations() {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split) return;
+    if (compressedTabs.contains(split)) {
+        statusBar()->showMessage("Compressed files open read-only; annotations are not kept for them.", 5000);
+        return;
+    }
+    const QString path = QFileDialog::getOpenFileName(this, "Import Annotations", QString(),
+                                                      "Annotations (*.annotations *.tsv *.txt);;All files (*)");
+    if (path.isEmpty()) return;
+
+    std::shared_ptr<AnnotationTree> &annotations = tabAnnotations[split];
+    if (!annotations) annotations = std::make_shared<AnnotationTree>();
+    const int before = annotations->count();
+    QString error;
+    const bool ok = annotations->addFromFile(path, &error);
+    statusBar()->showMessage(ok ? QString("Imported %1 annotations").arg(annotations->count() - before) : error, 6000);
+    saveAnnotations(split);
+    updateAnnotations();
+}
+
+void Home::scheduleAnnotationUpdate() {
+    if (annotationUpdatePending) return;
+    // Scrolling and edits report the visible range several times a frame.
+    annotationUpdatePending = true;
+    QTimer::singleShot(0, this, [this]() {
+        annotationUpdatePending = false;
+        updateAnnotations();
+    });
+}
+
+// Paints the current tab's annotations that are on screen, in the pane that
+// shows the bytes one to one (the one selectByteRange uses).
+void Home::updateAnnotations() {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split) return;
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+
+    const std::shared_ptr<AnnotationTree> annotations = tabAnnotations.value(split);
+    if (!annotations || annotations->isEmpty()) {
+        leftEd->setAnnotations(QVector<CodeEditor::Annotation>());
+        rightEd->setAnnotations(QVector<CodeEditor::Annotation>());
+        return;
+    }
+
+    const int index = tabs->indexOf(split);
+    const EditorMode mode = tabStates.contains(index) ? tabStates[index].mode : ModeHex;
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    const bool encoded = mode >= ModeBase64 && encodingForGrouping(rightEd->byteGroupingMode(), &kind);
+    const bool columns = mode == ModeHex || mode == ModeBinary;
+    CodeEditor *editor = (columns || encoded) ? rightEd : leftEd;
+    (editor == rightEd ? leftEd : rightEd)->setAnnotations(QVector<CodeEditor::Annotation>());
+
+    int from = 0;
+    int to = 0;
+    editor->visibleRange(&from, &to);
+    const int width = (mode == ModeHex) ? 3 : 9;
+    qint64 begin = 0;
+    qint64 end = 0;
+    if (columns) {
+        begin = from / width;
+        end = to / width + 1;
+    } else if (encoded) {
+        // Past the group the last visible character belongs to.
+        begin = BaseEncoding::byteOffset(from, kind);
+        end = BaseEncoding::byteOffset(to, kind) + 8;
+    } else {
+        // Mapped through the cached layout, so scrolling never reads the
+        // document back.
+        begin = textByteOffset(split, leftEd, from);
+        end = textByteOffset(split, leftEd, to);
+    }
+
+    // Clipped to the screen, so a range over the whole file stays cheap.
+    const QVector<AnnotationTree::Annotation> found = annotations->overlapping(begin, end);
+    QVector<ByteMatch> clipped;
+    clipped.reserve(found.size());
+    for (const AnnotationTree::Annotation &a : found) {
+        const qint64 first = qMax(a.start, begin);
+        clipped.append(ByteMatch{ first, qMin(a.end, end) - first });
+    }
+
+    QVector<SearchMatch> ranges;
+    if (columns) {
+        ranges = columnRangesForByteMatches(clipped, width);
+    } else if (encoded) {
+        ranges = encodedRangesForByteMatches(clipped, kind);
+    } else {
+        ranges.reserve(clipped.size());
+        for (const ByteMatch &m : qAsConst(clipped)) {
+            const int start = textPosition(split, leftEd, m.offset);
+            const int stop = textPosition(split, leftEd, m.offset + m.length);
+            ranges.append(SearchMatch{ start, qMax(1, stop - start) });
+        }
+    }
+
+    QVector<CodeEditor::Annotation> painted;
+    painted.reserve(ranges.size());
+    for (int i = 0; i < ranges.size(); ++i) {
+        const quint32 rgb = found.at(i).color;
+        const QColor color = rgb ? QColor::fromRgb(rgb) : QColor(0x3a, 0x6e, 0xa5);
+        painted.append(CodeEditor::Annotation{ ranges.at(i).start, ranges.at(i).length, color, found.at(i).label });
+    }
+    editor->setAnnotations(painted);
+}
+
+void Home::toggleFollow() {
+    QSplitter *split = qobject_cast<QSplitter*>(tabs->currentWidget());
+    if (!split || !tabPaths.contains(split)) {
+        statusBar()->showMessage("Follow File needs a tab opened from a file.", 5000);
+        return;
+    }
+
+    if (compressedTabs.contains(split)) {
+        statusBar()->showMessage("Follow File does not work on compressed files.", 5000);
+        return;
+    }
+
+    const QString name = QFileInfo(tabPaths.value(split)).fileName();
+    if (followedTabs.contains(split)) {
+        stopFollowing(split);
+        statusBar()->showMessage("Stopped following " + name, 5000);
+        return;
+    }
+
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+
+    if (!tailWatcher) {
+        tailWatcher = new QFileSystemWatcher(this);
+        tailTimer = new QTimer(this);
+        tailTimer->setSingleShot(true);
+        tailTimer->setInterval(100);
+
+        // Writers append in bursts; collect change notifications for a moment
+        // and read each file once.
+        connect(tailWatcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+            changedTailPaths.insert(path);
+            if (!tailTimer->isActive()) tailTimer->start();
+        });
+        connect(tailTimer, &QTimer::timeout, this, [this]() {
+            const QSet<QString> paths = changedTailPaths;
+            changedTailPaths.clear();
+            const QList<QWidget *> followed = followedTabs.keys();
+            for (QWidget *tab : followed) {
+                if (!paths.contains(tabPaths.value(tab))) continue;
+                readAppendedData(qobject_cast<QSplitter*>(tab));
+            }
+        });
+    }
+
+    // The panes mirror the file while following, so edits and their undo
+    // history are switched off.
+    for (CodeEditor *editor : { leftEd, rightEd }) {
+        editor->setReadOnly(true);
+        editor->document()->setUndoRedoEnabled(false);
+    }
+
+    TailState state;
+    state.size = tabBytes.value(split).size();
+    followedTabs.insert(split, state);
+    tailWatcher->addPath(tabPaths.value(split));
+    statusBar()->showMessage("Following " + name, 5000);
+    readAppendedData(split);
+}
+
+void Home::stopFollowing(QWidget *tab) {
+    if (!followedTabs.remove(tab)) return;
+
+    QSplitter *split = qobject_cast<QSplitter*>(tab);
+    for (int i = 0; split && i < 2; ++i) {
+        if (CodeEditor *editor = qobject_cast<CodeEditor*>(split->widget(i))) {
+            editor->setReadOnly(false);
+            editor->document()->setUndoRedoEnabled(true);
+        }
+    }
+
+    const QString path = tabPaths.value(tab);
+    for (auto it = followedTabs.constBegin(); it != followedTabs.constEnd(); ++it) {
+        if (tabPaths.value(it.key()) == path) return;
+    }
+    tailWatcher->removePath(path);
+}
+
+void Home::readAppendedData(QSplitter *split) {
+    TRACE_SCOPE("Home::readAppendedData");
+    if (!split || !followedTabs.contains(split)) return;
+    CodeEditor *leftEd = qobject_cast<CodeEditor*>(split->widget(0));
+    CodeEditor *rightEd = qobject_cast<CodeEditor*>(split->widget(1));
+    if (!leftEd || !rightEd) return;
+
+    const QString path = tabPaths.value(split);
+    TailState &state = followedTabs[split];
+
+    // Editors and log rotation can replace the file, which drops it from the
+    // watcher.
+    if (!tailWatcher->files().contains(path) && QFileInfo::exists(path)) {
+        tailWatcher->addPath(path);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QByteArray &bytes = tabBytes[split];
+    const bool truncated = file.size() < state.size;
+    if (truncated) {
+        state.size = 0;
+        state.utf8Carry.clear();
+    }
+    QByteArray delta;
+    if (file.size() > state.size && file.seek(state.size)) {
+        delta = file.read(file.size() - state.size);
+    }
+    if (delta.isEmpty() && !truncated) return;
+    state.size += delta.size();
+
+    QByteArray pending = state.utf8Carry + delta;
+    int complete = completeUtf8Length(pending);
+    // A CR may be the first half of a CRLF, which the text pane shows as one
+    // line break; it waits for the next byte like a cut-off sequence does.
+    if (complete > 0 && pending.at(complete - 1) == '\r') --complete;
+    state.utf8Carry = pending.mid(complete);
+    pending.truncate(complete);
+    const QString text = DecodedText::decode(pending);
+
+    // Only the new bytes are converted; existing text is left in place.
+    const bool hadBytes = !truncated && !bytes.isEmpty();
+    QString converted;
+    // Encoded views re-encode the last, padded group of the old bytes too.
+    int encodedFrom = -1;
+    BaseEncoding::Kind kind = BaseEncoding::Base64;
+    if (encodingForGrouping(rightEd->byteGroupingMode(), &kind)) {
+        const int keep = hadBytes ? bytes.size() - bytes.size() % BaseEncoding::groupBytes(kind) : 0;
+        encodedFrom = int(BaseEncoding::charOffset(keep, kind));
+        converted = QString::fromLatin1(BaseEncoding::encode(hadBytes ? bytes.mid(keep) + delta : delta, kind));
+    } else {
+        switch (rightEd->byteGroupingMode()) {
+        case CodeEditor::GroupingBinary:
+            converted = QString::fromLatin1((hadBytes ? QByteArray(" ") : QByteArray()) + TextConverter::bytesToBinary(delta));
+            break;
+        case CodeEditor::GroupingUnicode:
+            converted = TextConverter::toUnicode(text);
+            break;
+        case CodeEditor::GroupingText:
+            converted = text;
+            break;
+        case CodeEditor::GroupingHex:
+        default:
+            converted = QString::fromLatin1((hadBytes ? QByteArray(" ") : QByteArray()) + TextConverter::bytesToHex(delta, 1));
+            break;
+        }
+    }
+
+    isInternalTextSync = true;
+    if (truncated) {
+        bytes = delta;
+        leftEd->setPlainText(text);
+        rightEd->setPlainText(converted);
+    } else {
+        bytes.append(delta);
+        appendText(leftEd, text);
+        if (encodedFrom >= 0) {
+            QTextCursor tail(rightEd->document());
+            tail.setPosition(qMin(encodedFrom, rightEd->document()->characterCount() - 1));
+            tail.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+            tail.removeSelectedText();
+        }
+        appendText(rightEd, converted);
+    }
+    isInternalTextSync = false;
+
+    for (CodeEditor *editor : { leftEd, rightEd }) {
+        editor->refreshSearchHighlights();
+        editor->verticalScrollBar()->setValue(editor->verticalScrollBar()->maximum());
+    }
+    if (split == tabs->currentWidget()) {
+        updateSearchStatus();
+        scheduleInspectorUpdate();
+    }
+}
@@ -3,20 +3,36 @@
 
 #include <QMainWindow>
 #include <QTabWidget>
-#include <QFileSystemModel>
 #include <QTreeView>
 #include <QLineEdit>
 #include <QWidget>
 #include <QListWidget>
+#include <QDockWidget>
+#include <QHash>
+#include <QSet>
+#include "annotationtree.h"
+#include "binarydiff.h"
 #include "codeeditor.h"
+#include "datainspector.h"
+#include "decodedtext.h"
+#include "filetreemodel.h"
 #include "menubar.h"
+#include "structview.h"
 #include "textanalyzer.h"
 #include "QLabel"
+#include <atomic>
+#include <memory>
+
+class QPushButton;
+class QSplitter;
+class QFileSystemWatcher;
+class QTimer;
+class GzipIndex;
 
 
 class Home : public QMainWindow {
     Q_OBJECT
-    enum EditorMode { ModeHex, ModeBinary, ModeUnicode,ModeText };
+    enum EditorMode { ModeHex, ModeBinary, ModeUnicode,ModeText, ModeBase64, ModeBase64Url, ModeBase32, ModeAscii85 };
     EditorMode currentMode = ModeHex;
     EditorMode lastMode;
 
@@ -30,8 +46,38 @@ class Home : public QMainWindow {
         QString filePath;
         bool lastSearchFromRight = false;
     };
+
+    // A tab restored from the last session. It stays an empty splitter until
+    // it is first activated, when the file is read and this state applied.
+    struct SessionTab {
+        QString path;
+        EditorMode mode = ModeHex;
+        int leftCursorPos = 0;
+        int rightCursorPos = 0;
+        int leftScroll = 0;
+        int rightScroll = 0;
+    };
+
+    // A tab in follow mode: how much of the file it shows, and the start of
+    // a UTF-8 sequence cut off by the last read.
+    struct TailState {
+        qint64 size = 0;
+        QByteArray utf8Carry;
+    };
+
+    // A tab on a gzip or zlib file holds one window of the decompressed
+    // bytes, starting at windowOffset. The index, once built in the
+    // background, lets any other window be read.
+    struct CompressedTab {
+        std::shared_ptr<const GzipIndex> index;
+        qint64 windowOffset = 0;
+    };
 public:
     Home(QWidget *parent = nullptr);
+    ~Home() override;
+
+protected:
+    void closeEvent(QCloseEvent *event) override;
 
 private slots:
     void menu(const QString &name);
@@ -49,7 +95,20 @@ private:
     void updateui();
     void addNewTab();
     void openFile(const QString &path);
+    void populateFileTab(QSplitter *editorSplit, const QString &path, const QByteArray &data);
+    QByteArray readTabData(QSplitter *split, const QString &path, QString *error);
+    void indexCompressedTab(QSplitter *split);
+    void showCompressedWindow(QSplitter *split, qint64 offset);
+    void goToOffset();
+    void saveSession();
+    void restoreSession();
+    void loadPendingTab(QSplitter *split);
+    void toggleFollow();
+    void stopFollowing(QWidget *tab);
+    void readAppendedData(QSplitter *split);
     void openFolder(const QString &path);
+    void compareFiles();
+    void showComparison(const QString &pathA, const QString &pathB, const DiffResult &result);
     int calculateDisplayPosition(const QString &text, int bytePos);
     int calculateByteOffset(const QString &text, int cursorPos);
 
@@ -60,22 +119,74 @@ private:
     void applyEditorGrouping(CodeEditor *editor, EditorMode mode);
 
     void applySearchToCurrentTab();
+    void applyRegexSearch(QSplitter *split, CodeEditor *leftEd, CodeEditor *rightEd, const QString &pattern);
+    Qt::CaseSensitivity searchCaseSensitivity() const;
     void updateRecentSearchResults();
     void openRecentSearchResult(QListWidgetItem *item);
     void showSearchBar();
     void updateSearchStatus();
     void navigateSearchMatch(bool forward);
+    void scheduleInspectorUpdate();
+    void updateDataInspector();
+    void updateStructureView();
+    qint64 cursorByteOffset(QSplitter *split, CodeEditor *editor);
+    qint64 byteOffsetAt(QSplitter *split, CodeEditor *editor, int pos);
+    int panePosition(QSplitter *split, CodeEditor *editor, qint64 byte);
+    const DecodedText &decodedText(QWidget *split);
+    qint64 textByteOffset(QWidget *split, const CodeEditor *editor, int pos);
+    int textPosition(QWidget *split, const CodeEditor *editor, qint64 byte);
+    void selectedByteRange(QSplitter *split, CodeEditor *editor, qint64 *begin, qint64 *end);
+    void showChecksums();
+    void exportSelection(bool toClipboard);
+    void jumpToByteOffset(QSplitter *split, qint64 offset);
+    CodeEditor *selectByteRange(QSplitter *split, qint64 begin, qint64 end);
+    void attachEntropyMinimap(QSplitter *split, CodeEditor *editor, const QString &path);
+    void setTabBytes(QSplitter *split, const QByteArray &bytes);
+    void loadAnnotations(QSplitter *split, const QString &path);
+    void saveAnnotations(QSplitter *split);
+    void annotateSelection();
+    void removeAnnotation();
+    void jumpToAnnotation(bool forward);
+    void importAnnotations();
+    void scheduleAnnotationUpdate();
+    void updateAnnotations();
     QLineEdit *searchInput = nullptr;
+    QPushButton *regexToggle = nullptr;
+    QPushButton *caseToggle = nullptr;
     QWidget *searchBarWidget = nullptr;
     QLabel *searchStatusLabel = nullptr;
     QListWidget *recentSearchResults = nullptr;
+    DataInspector *dataInspector = nullptr;
+    QDockWidget *inspectorDock = nullptr;
+    bool inspectorUpdatePending = false;
+    StructView *structView = nullptr;
+    QDockWidget *structDock = nullptr;
+
+    // Raw bytes of each tab, keyed by the tab's editor splitter.
+    QHash<QWidget *, QByteArray> tabBytes;
+    // Layout of the text each tab's bytes decode to, rebuilt once they change.
+    QHash<QWidget *, DecodedText> tabText;
+    // File behind each tab, and restored tabs not loaded yet.
+    QHash<QWidget *, QString> tabPaths;
+    QHash<QWidget *, SessionTab> pendingTabs;
+    QHash<QWidget *, TailState> followedTabs;
+    QHash<QWidget *, CompressedTab> compressedTabs;
+    // Bookmarks and annotations of each tab, kept next to its file.
+    QHash<QWidget *, std::shared_ptr<AnnotationTree>> tabAnnotations;
+    bool annotationUpdatePending = false;
+    // Set when a tab closes, or the window goes away, to stop the background
+    // jobs working for it. Each job holds its own reference.
+    QHash<QWidget *, std::shared_ptr<std::atomic<bool>>> tabCancelled;
+    std::shared_ptr<std::atomic<bool>> tabCancelFlag(QWidget *split);
+    QFileSystemWatcher *tailWatcher = nullptr;
+    QTimer *tailTimer = nullptr;
+    QSet<QString> changedTailPaths;
 
 
     QTabWidget *tabs;
     QTreeView *tree;
-    QFileSystemModel *model;
+    FileTreeModel *model;
     QString currentFile;
-    QString originalText;
     QStringList recentFiles;
     MenuBar *menuBarObj;
     bool isInternalTextSync = false;
@@ -1,216 +1,29 @@
-
-
 #include <QApplication>
-#include <QCommandLineOption>
 #include <QCommandLineParser>
-#include <QFile>
+#include <QCoreApplication>
 #include <QStyleFactory>
-#include <QTextStream>
 #include <QScreen>
 #include <QIcon>
 #include "home.h"
-#include "textconverter.h"
-
-namespace {
-
-QString readInput(const QString &text, const QString &inputFile, QTextStream &err)
-{
-    if (!text.isEmpty()) {
-        return text;
-    }
-
-    if (!inputFile.isEmpty()) {
-        QFile file(inputFile);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            err << "Cannot open input file: " << inputFile << Qt::endl;
-            return {};
-        }
-
-        return QString::fromUtf8(file.readAll());
-    }
-
-    return {};
-}
-
-bool writeOutput(const QString &outputPath, const QString &content, QTextStream &out, QTextStream &err)
-{
-    if (outputPath.isEmpty()) {
-        out << content << Qt::endl;
-        return true;
-    }
-
-    QFile file(outputPath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-        err << "Cannot write output file: " << outputPath << Qt::endl;
-        return false;
-    }
-
-    file.write(content.toUtf8());
-    out << "Saved output to: " << outputPath << Qt::endl;
-    return true;
-}
+#include "terminalmode.h"
 
-QString convertText(const QString &input, const QString &to, const QString &from)
+int main(int argc, char *argv[])
 {
-    if (to == "hex") {
-        return TextConverter::toHex(input, 1);
-    }
-
-    if (to == "binary") {
-        return TextConverter::toBinary(input);
-    }
-
-    if (to == "unicode") {
-        return TextConverter::toUnicode(input);
+    // Scripted conversions never touch a widget, so they skip the GUI platform
+    // plugin and style setup entirely.
+    if (TerminalMode::isRequested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        QCommandLineParser parser;
+        TerminalMode::setupParser(parser);
+        parser.process(app);
+        return TerminalMode::run(parser);
     }
 
-    if (to == "text") {
-        return TextConverter::toText(input, from);
-    }
-
-    return {};
-}
-
-int runTerminalMode(const QCommandLineParser &parser)
-{
-    QTextStream out(stdout);
-    QTextStream err(stderr);
-
-    const QString command = parser.value("command").trimmed().toLower();
-    if (command.isEmpty()) {
-        err << "Missing --command. Use convert or add." << Qt::endl;
-        return 1;
-    }
-
-    if (command == "convert") {
-        const QString to = parser.value("to").trimmed().toLower();
-        const QString from = parser.value("from").trimmed().toLower();
-
-        if (to.isEmpty()) {
-            err << "Missing --to for convert command. Use: hex, binary, unicode, text." << Qt::endl;
-            return 1;
-        }
-
-        if (to == "text" && from.isEmpty()) {
-            err << "When --to text is selected, --from must be one of: hex, binary, unicode." << Qt::endl;
-            return 1;
-        }
-
-        const QString input = readInput(parser.value("text"), parser.value("input-file"), err);
-        if (input.isEmpty() && parser.value("text").isEmpty() && parser.value("input-file").isEmpty()) {
-            err << "No input provided. Use --text or --input-file." << Qt::endl;
-            return 1;
-        }
-
-        const QString output = convertText(input, to, from);
-        if (output.isEmpty() && !input.isEmpty()) {
-            err << "Unsupported conversion target: " << to << Qt::endl;
-            return 1;
-        }
-
-        return writeOutput(parser.value("output"), output, out, err) ? 0 : 1;
-    }
-
-    if (command == "add") {
-        const QString textValue = parser.value("text");
-        const QString filePath = parser.value("input-file");
-
-        if (textValue.isEmpty() && filePath.isEmpty()) {
-            err << "Add command needs --text or --input-file." << Qt::endl;
-            return 1;
-        }
-
-        QString payload;
-        if (!textValue.isEmpty()) {
-            payload += textValue;
-        }
-
-        if (!filePath.isEmpty()) {
-            QFile file(filePath);
-            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                err << "Cannot open file for add command: " << filePath << Qt::endl;
-                return 1;
-            }
-
-            if (!payload.isEmpty()) {
-                payload += "\n";
-            }
-            payload += QString::fromUtf8(file.readAll());
-        }
-
-        const QString outputPath = parser.value("output");
-        if (outputPath.isEmpty()) {
-            out << payload << Qt::endl;
-            return 0;
-        }
-
-        QFile outputFile(outputPath);
-        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append)) {
-            err << "Cannot append to output file: " << outputPath << Qt::endl;
-            return 1;
-        }
-
-        outputFile.write(payload.toUtf8());
-        outputFile.write("\n");
-        out << "Added content to: " << outputPath << Qt::endl;
-        return 0;
-    }
-
-    err << "Unsupported command: " << command << ". Supported commands: convert, add." << Qt::endl;
-    return 1;
-}
-
-}
-
-int main(int argc, char *argv[])
-{
     QApplication app(argc, argv);
     QCommandLineParser parser;
-
-    parser.setApplicationDescription("Hex Editor GUI + Terminal mode");
-    parser.addHelpOption();
-
-    QCommandLineOption terminalModeOption(
-        "terminal",
-        "Run in terminal mode without opening GUI.");
-    QCommandLineOption commandOption(
-        "command",
-        "Terminal command name: convert | add.",
-        "command");
-    QCommandLineOption textOption(
-        "text",
-        "Inline text input.",
-        "text");
-    QCommandLineOption inputFileOption(
-        "input-file",
-        "Read input from file.",
-        "path");
-    QCommandLineOption outputOption(
-        "output",
-        "Write output to file. For add command this file is appended.",
-        "path");
-    QCommandLineOption toOption(
-        "to",
-        "Convert destination type: hex | binary | unicode | text.",
-        "type");
-    QCommandLineOption fromOption(
-        "from",
-        "Source type when using --to text: hex | binary | unicode.",
-        "type");
-
-    parser.addOption(terminalModeOption);
-    parser.addOption(commandOption);
-    parser.addOption(textOption);
-    parser.addOption(inputFileOption);
-    parser.addOption(outputOption);
-    parser.addOption(toOption);
-    parser.addOption(fromOption);
-
+    TerminalMode::setupParser(parser);
     parser.process(app);
-
-    if (parser.isSet(terminalModeOption)) {
-        return runTerminalMode(parser);
-    }
+    TerminalMode::initTrace(parser);
 
     app.setStyle(QStyleFactory::create("Fusion"));
     app.setStyleSheet(
@@ -334,6 +147,8 @@ int main(int argc, char *argv[])
     w.move(x, y);
     w.show();
 
-    return app.exec();
+    const int code = app.exec();
+    TerminalMode::finishTrace(parser);
+    return code;
 }
 
@@ -28,6 +28,9 @@ MenuBar::MenuBar(QMainWindow *parent) : QObject(parent)
     QAction *openFolderAct = file->addAction("Open Folder");
     openFolderAct->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_O));
 
+    QAction *compareAct = file->addAction("Compare Files");
+    compareAct->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_D));
+
     QAction *saveAct = file->addAction("Save");
     saveAct->setShortcut(QKeySequence::Save);
 
@@ -49,6 +52,7 @@ MenuBar::MenuBar(QMainWindow *parent) : QObject(parent)
     connect(newAct, &QAction::triggered, this, &MenuBar::onAction);
     connect(openAct, &QAction::triggered, this, &MenuBar::onAction);
     connect(openFolderAct, &QAction::triggered, this, &MenuBar::onAction);
+    connect(compareAct, &QAction::triggered, this, &MenuBar::onAction);
     connect(exitAct, &QAction::triggered, this, &MenuBar::onAction);
 
     QMenu *edit = bar->addMenu("Edit");
@@ -63,6 +67,34 @@ MenuBar::MenuBar(QMainWindow *parent) : QObject(parent)
         connect(a,&QAction::triggered,this,&MenuBar::onAction);
     }
 
+    edit->addSeparator();
+    QAction *copyAsAct = edit->addAction("Copy As");
+    copyAsAct->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_C));
+    connect(copyAsAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *exportSelectionAct = edit->addAction("Export Selection");
+    connect(exportSelectionAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    edit->addSeparator();
+    QAction *annotateAct = edit->addAction("Annotate Selection");
+    annotateAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_B));
+    connect(annotateAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *removeAnnotationAct = edit->addAction("Remove Annotation");
+    removeAnnotationAct->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_B));
+    connect(removeAnnotationAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *nextAnnotationAct = edit->addAction("Next Annotation");
+    nextAnnotationAct->setShortcut(QKeySequence(Qt::Key_F2));
+    connect(nextAnnotationAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *previousAnnotationAct = edit->addAction("Previous Annotation");
+    previousAnnotationAct->setShortcut(QKeySequence(Qt::SHIFT | Qt::Key_F2));
+    connect(previousAnnotationAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *importAnnotationsAct = edit->addAction("Import Annotations");
+    connect(importAnnotationsAct, &QAction::triggered, this, &MenuBar::onAction);
+
     QMenu *select = bar->addMenu("Select");
     QStringList selects = {"SelectAll","SelectLine","SelectWord"};
     for(const QString &s : selects){
@@ -77,6 +109,9 @@ MenuBar::MenuBar(QMainWindow *parent) : QObject(parent)
     QAction *startFindAct = find->addAction("StartFind");
     startFindAct->setShortcut(QKeySequence::Find);
     connect(startFindAct, &QAction::triggered, this, &MenuBar::onAction);
+    QAction *goToOffsetAct = find->addAction("Go To Offset");
+    goToOffsetAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_G));
+    connect(goToOffsetAct, &QAction::triggered, this, &MenuBar::onAction);
 
 
     QMenu *view = bar->addMenu("View");
@@ -84,7 +119,11 @@ MenuBar::MenuBar(QMainWindow *parent) : QObject(parent)
         "To Binary",
         "To Hex",
         "To Unicode",
-        "To Text"
+        "To Text",
+        "To Base64",
+        "To Base64 URL",
+        "To Base32",
+        "To Ascii85"
 
     };
 
@@ -97,11 +136,31 @@ MenuBar::MenuBar(QMainWindow *parent) : QObject(parent)
         connect(a, &QAction::triggered, this, &MenuBar::onAction);
     }
 
+    view->addSeparator();
+    QAction *inspectorAct = view->addAction("Data Inspector");
+    inspectorAct->setShortcut(QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_I));
+    connect(inspectorAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *structureAct = view->addAction("Structure Template");
+    structureAct->setShortcut(QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_S));
+    connect(structureAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *followAct = view->addAction("Follow File");
+    followAct->setShortcut(QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_F));
+    connect(followAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *checksumsAct = view->addAction("Checksums");
+    checksumsAct->setShortcut(QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_K));
+    connect(checksumsAct, &QAction::triggered, this, &MenuBar::onAction);
+
 
     QMenu *help = bar->addMenu("Help");
     QAction *helpAct = help->addAction("Help");
     helpAct->setShortcut(QKeySequence::HelpContents);
     connect(helpAct, &QAction::triggered, this, &MenuBar::onAction);
+
+    QAction *exportTraceAct = help->addAction("Export Trace");
+    connect(exportTraceAct, &QAction::triggered, this, &MenuBar::onAction);
 }
 
 void MenuBar::onAction()
@@ -0,0 +1,20 @@
+#ifndef RUNNABLETASK_H
+#define RUNNABLETASK_H
+
+#include <QRunnable>
+#include <functional>
+#include <utility>
+
+// QRunnable around a callable, for QThreadPool::start() on Qt versions that
+// lack QRunnable::create().
+class RunnableTask : public QRunnable
+{
+public:
+    explicit RunnableTask(std::function<void()> body) : body(std::move(body)) {}
+    void run() override { body(); }
+
+private:
+    std::function<void()> body;
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include "searchengine.h"
+#include "asyncreader.h"
+#include "gzipindex.h"
+#include "trace.h"
+#include <QFile>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline quint16 foldUnit(quint16 unit, bool foldCase)
+{
+    if (unit < 0x80) {
+        return (foldCase && unit >= 'A' && unit <= 'Z') ? quint16(unit + 0x20) : unit;
+    }
+    switch (unit) {
+    case 0x06CC:
+        return 0x064A;
+    case 0x06A9:
+        return 0x0643;
+    case 0x0629:
+        return 0x0647;
+    case 0x0622:
+    case 0x0623:
+    case 0x0625:
+        return 0x0627;
+    }
+    // Halves of a pair are left alone; simple case folding keeps the rest of
+    // the BMP inside the BMP.
+    if (!foldCase || QChar::isSurrogate(unit)) return unit;
+    return quint16(QChar::toCaseFolded(unit));
+}
+
+void foldUnits(const quint16 *in, quint16 *out, qsizetype size, bool foldCase)
+{
+    qsizetype i = 0;
+#ifdef __SSE2__
+    // Runs of ASCII, the bulk of most text, fold eight units at a time.
+    const __m128i nonAscii = _mm_set1_epi16(short(0xFF80));
+    const __m128i beforeA = _mm_set1_epi16('A' - 1);
+    const __m128i afterZ = _mm_set1_epi16('Z' + 1);
+    const __m128i caseBit = _mm_set1_epi16(foldCase ? 0x20 : 0);
+    const __m128i zero = _mm_setzero_si128();
+    for (; size - i >= 8; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, nonAscii), zero)) != 0xFFFF) {
+            for (qsizetype j = i; j < i + 8; ++j) out[j] = foldUnit(in[j], foldCase);
+            continue;
+        }
+        const __m128i upper = _mm_and_si128(_mm_cmpgt_epi16(v, beforeA), _mm_cmplt_epi16(v, afterZ));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_or_si128(v, _mm_and_si128(upper, caseBit)));
+    }
+#endif
+    for (; i < size; ++i) out[i] = foldUnit(in[i], foldCase);
+}
+
+// Non-overlapping occurrences of needle in hay at or after from. Candidates
+// must match the needle's first and last unit, which rules out nearly every
+// position before the middle is compared.
+void findUnits(const quint16 *hay, qsizetype size, const quint16 *needle, qsizetype length, qsizetype from,
+               QVector<SearchMatch> &found)
+{
+    const qsizetype lastStart = size - length;
+    const quint16 first = needle[0];
+    const quint16 last = needle[length - 1];
+    const size_t middleBytes = length > 2 ? size_t(length - 2) * sizeof(quint16) : 0;
+    qsizetype next = from;
+    qsizetype i = from;
+#ifdef __SSE2__
+    const __m128i firstV = _mm_set1_epi16(short(first));
+    const __m128i lastV = _mm_set1_epi16(short(last));
+    for (; lastStart - i >= 7; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + length - 1));
+        uint mask = uint(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, firstV), _mm_cmpeq_epi16(b, lastV))));
+        while (mask) {
+            // Two mask bits per unit.
+            const uint bit = qCountTrailingZeroBits(mask);
+            mask &= ~(3u << bit);
+            const qsizetype pos = i + bit / 2;
+            if (pos < next) continue;
+            if (middleBytes == 0 || std::memcmp(hay + pos + 1, needle + 1, middleBytes) == 0) {
+                found.append(SearchMatch{ int(pos), int(length) });
+                next = pos + length;
+            }
+        }
+        if (next > i + 8) i = next - 8;
+    }
+    i = qMax(i, next);
+#endif
+    while (i <= lastStart) {
+        if (hay[i] == first && hay[i + length - 1] == last
+            && (middleBytes == 0 || std::memcmp(hay + i + 1, needle + 1, middleBytes) == 0)) {
+            found.append(SearchMatch{ int(i), int(length) });
+            i += length;
+        } else {
+            ++i;
+        }
+    }
+}
+
+inline uchar foldAscii(uchar byte)
+{
+    return (byte >= 'A' && byte <= 'Z') ? uchar(byte | 0x20) : byte;
+}
+
+bool equalBytes(const uchar *a, const uchar *b, qint64 size, bool foldCase)
+{
+    if (!foldCase) return std::memcmp(a, b, size_t(size)) == 0;
+    for (qint64 i = 0; i < size; ++i) {
+        if (foldAscii(a[i]) != foldAscii(b[i])) return false;
+    }
+    return true;
+}
+
+// Non-overlapping occurrences of needle in hay. Like findUnits(), candidates
+// are filtered on the needle's first and last byte sixteen positions at a
+// time; with foldCase a letter is compared with its 0x20 bit set on both
+// sides, which lets a few punctuation bytes through to the full compare.
+// With resume, also gives where a search of more data following hay should
+// pick up: after the last match, or where a match could still begin.
+qint64 countBytes(const uchar *hay, qint64 size, const uchar *needle, qint64 length, bool foldCase,
+                  qint64 *resume = nullptr)
+{
+    if (resume) *resume = 0;
+    if (length == 0 || size < length) return 0;
+    const auto caseBit = [foldCase](uchar byte) -> uchar {
+        return (foldCase && foldAscii(byte) >= 'a' && foldAscii(byte) <= 'z') ? 0x20 : 0;
+    };
+    const uchar firstBit = caseBit(needle[0]);
+    const uchar lastBit = caseBit(needle[length - 1]);
+    const uchar first = needle[0] | firstBit;
+    const uchar last = needle[length - 1] | lastBit;
+    const qint64 lastStart = size - length;
+    qint64 count = 0;
+    qint64 next = 0;
+    qint64 i = 0;
+#ifdef __SSE2__
+    const __m128i firstV = _mm_set1_epi8(char(first));
+    const __m128i lastV = _mm_set1_epi8(char(last));
+    const __m128i firstBitV = _mm_set1_epi8(char(firstBit));
+    const __m128i lastBitV = _mm_set1_epi8(char(lastBit));
+    for (; lastStart - i >= 15; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + length - 1));
+        uint mask = uint(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(a, firstBitV), firstV),
+                                                         _mm_cmpeq_epi8(_mm_or_si128(b, lastBitV), lastV))));
+        while (mask) {
+            const qint64 pos = i + qCountTrailingZeroBits(mask);
+            mask &= mask - 1;
+            if (pos < next) continue;
+            if (equalBytes(hay + pos, needle, length, foldCase)) {
+                ++count;
+                next = pos + length;
+            }
+        }
+        if (next > i + 16) i = next - 16;
+    }
+    i = qMax(i, next);
+#endif
+    while (i <= lastStart) {
+        if ((hay[i] | firstBit) == first && (hay[i + length - 1] | lastBit) == last
+            && equalBytes(hay + i, needle, length, foldCase)) {
+            ++count;
+            i += length;
+            next = i;
+        } else {
+            ++i;
+        }
+    }
+    if (resume) *resume = qMax(next, lastStart + 1);
+    return count;
+}
+
+// Length of data without a UTF-8 sequence cut off at its end.
+int completeUtf8Length(const char *data, int size)
+{
+    for (int i = size - 1; i >= 0 && i >= size - 4; --i) {
+        const uchar b = uchar(data[i]);
+        if ((b & 0xC0) == 0x80) continue;
+        if (b >= 0xC0) {
+            const int need = b >= 0xF0 ? 4 : (b >= 0xE0 ? 3 : 2);
+            if (i + need > size) return i;
+        }
+        break;
+    }
+    return size;
+}
+
+// countOccurrences() over the decompressed contents of a gzip or zlib file,
+// counted while it inflates. Only the tail of each piece that could still
+// start a match is carried into the next one.
+qint64 countInCompressedFile(const QString &path, const QString &needle, Qt::CaseSensitivity cs)
+{
+    const QByteArray bytes = needle.toUtf8();
+    const bool ascii = std::all_of(bytes.cbegin(), bytes.cend(), [](char c) { return uchar(c) < 0x80; });
+    const bool decode = cs == Qt::CaseInsensitive && !ascii;
+    qint64 count = 0;
+    QByteArray carry;
+    QString textCarry;
+    GzipIndex::inflateFile(path, [&](const char *data, qint64 size) {
+        QByteArray piece = carry;
+        piece.append(data, int(size));
+        if (decode) {
+            const int complete = completeUtf8Length(piece.constData(), piece.size());
+            const QString text = textCarry + QString::fromUtf8(piece.constData(), complete);
+            carry = piece.mid(complete);
+            int pos = 0;
+            int next = 0;
+            while ((pos = text.indexOf(needle, pos, cs)) != -1) {
+                ++count;
+                pos += needle.size();
+                next = pos;
+            }
+            textCarry = text.mid(qMax(next, text.size() - needle.size() + 1));
+        } else {
+            qint64 resume = 0;
+            count += countBytes(reinterpret_cast<const uchar *>(piece.constData()), piece.size(),
+                                reinterpret_cast<const uchar *>(bytes.constData()), bytes.size(),
+                                cs == Qt::CaseInsensitive, &resume);
+            carry = piece.mid(int(resume));
+        }
+        return true;
+    });
+    return count;
+}
+
+}
+
+QString SearchEngine::foldForSearch(const QString &text, Qt::CaseSensitivity cs)
+{
+    TRACE_SCOPE("SearchEngine::foldForSearch");
+    QString folded(text.size(), Qt::Uninitialized);
+    foldUnits(reinterpret_cast<const quint16 *>(text.constData()), reinterpret_cast<quint16 *>(folded.data()),
+              text.size(), cs == Qt::CaseInsensitive);
+    return folded;
+}
+
+QVector<SearchMatch> SearchEngine::findAll(const QString &haystack, const QString &query, Qt::CaseSensitivity cs)
+{
+    if (query.isEmpty() || haystack.isEmpty()) {
+        return QVector<SearchMatch>();
+    }
+    return findAllFolded(foldForSearch(haystack, cs), foldForSearch(query, cs));
+}
+
+QVector<SearchMatch> SearchEngine::findAllFolded(const QString &foldedHaystack, const QString &foldedQuery, int from)
+{
+    TRACE_SCOPE("SearchEngine::findAll");
+    QVector<SearchMatch> matches;
+    from = qMax(0, from);
+    if (foldedQuery.isEmpty() || foldedHaystack.size() - from < foldedQuery.size()) {
+        return matches;
+    }
+
+    // Room for a screenful of matches up front, never more than can fit.
+    matches.reserve(int(qMin<qsizetype>(256, (foldedHaystack.size() - from) / foldedQuery.size() + 1)));
+    findUnits(reinterpret_cast<const quint16 *>(foldedHaystack.constData()), foldedHaystack.size(),
+              reinterpret_cast<const quint16 *>(foldedQuery.constData()), foldedQuery.size(), from, matches);
+    return matches;
+}
+
+int SearchEngine::countOccurrences(const QString &haystack, const QString &needle, Qt::CaseSensitivity cs)
+{
+    if (haystack.isEmpty() || needle.isEmpty()) {
+        return 0;
+    }
+
+    int count = 0;
+    int pos = 0;
+    while ((pos = haystack.indexOf(needle, pos, cs)) != -1) {
+        ++count;
+        pos += needle.length();
+    }
+    return count;
+}
+
+int SearchEngine::countOccurrences(const QByteArray &utf8, const QString &needle, Qt::CaseSensitivity cs)
+{
+    TRACE_SCOPE("SearchEngine::countOccurrences");
+    if (utf8.isEmpty() || needle.isEmpty()) {
+        return 0;
+    }
+
+    const QByteArray bytes = needle.toUtf8();
+    const bool ascii = std::all_of(bytes.cbegin(), bytes.cend(), [](char c) { return uchar(c) < 0x80; });
+    if (cs == Qt::CaseInsensitive && !ascii) {
+        return countOccurrences(QString::fromUtf8(utf8), needle, cs);
+    }
+    return int(countBytes(reinterpret_cast<const uchar *>(utf8.constData()), utf8.size(),
+                          reinterpret_cast<const uchar *>(bytes.constData()), bytes.size(),
+                          cs == Qt::CaseInsensitive));
+}
+
+int SearchEngine::countOccurrencesInFile(const QString &path, const QString &needle, Qt::CaseSensitivity cs)
+{
+    TRACE_SCOPE("SearchEngine::countOccurrencesInFile");
+    if (needle.isEmpty()) {
+        return 0;
+    }
+    if (GzipIndex::isCompressedFile(path)) {
+        return int(countInCompressedFile(path, needle, cs));
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    return countOccurrences(file.readAll(), needle, cs);
+}
+
+QVector<int> SearchEngine::countOccurrencesInFiles(const QStringList &paths, const QString &needle,
+                                                   Qt::CaseSensitivity cs)
+{
+    TRACE_SCOPE("SearchEngine::countOccurrencesInFiles");
+    QVector<int> counts(paths.size(), 0);
+    if (needle.isEmpty()) {
+        return counts;
+    }
+
+    // Compressed files are counted as they inflate instead of read whole.
+    QStringList plain;
+    QVector<int> plainIndex;
+    for (int i = 0; i < paths.size(); ++i) {
+        if (GzipIndex::isCompressedFile(paths.at(i))) {
+            counts[i] = int(countInCompressedFile(paths.at(i), needle, cs));
+        } else {
+            plain.append(paths.at(i));
+            plainIndex.append(i);
+        }
+    }
+    const QVector<ReadResult> files = AsyncReader::readFiles(plain);
+    for (int i = 0; i < files.size(); ++i) {
+        if (files.at(i).error.isEmpty()) {
+            counts[plainIndex.at(i)] = countOccurrences(files.at(i).data, needle, cs);
+        }
+    }
+    return counts;
+}
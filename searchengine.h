@@ -0,0 +1,45 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct SearchMatch {
+    int start = 0;
+    int length = 0;
+};
+
+class SearchEngine
+{
+public:
+    // Folds the Persian/Arabic letter variants a search treats as equal (Yeh,
+    // Kaf, Heh/Teh Marbuta, the Alef forms) and, unless cs is CaseSensitive,
+    // case. Every UTF-16 unit folds to exactly one unit, so offsets into the
+    // folded text are offsets into the original.
+    static QString foldForSearch(const QString &text, Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+    // Variant-insensitive, non-overlapping matches.
+    static QVector<SearchMatch> findAll(const QString &haystack, const QString &query,
+                                        Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+    // findAll() for a haystack and query already run through foldForSearch(),
+    // starting at from. Lets a caller keep the folded text between searches.
+    static QVector<SearchMatch> findAllFolded(const QString &foldedHaystack, const QString &foldedQuery,
+                                              int from = 0);
+    static int countOccurrences(const QString &haystack, const QString &needle,
+                                Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+    // Counts in UTF-8 bytes without decoding them. ASCII needles, and any
+    // needle matched case-sensitively, are compared byte for byte with ASCII
+    // case folded in the compare loop; only a caseless non-ASCII needle needs
+    // the text decoded for full Unicode folding.
+    static int countOccurrences(const QByteArray &utf8, const QString &needle,
+                                Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+    // gzip and zlib files are counted in their decompressed contents,
+    // streamed through inflate rather than decompressed whole.
+    static int countOccurrencesInFile(const QString &path, const QString &needle,
+                                      Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+    // One count per path, with the files read concurrently.
+    static QVector<int> countOccurrencesInFiles(const QStringList &paths, const QString &needle,
+                                                Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "streamconverter.h"
+#include "textconverter.h"
+
+StreamConverter::StreamConverter(const QString &to, const QString &from)
+{
+    BaseEncoding::Kind encoding;
+    if (to == "hex") kind = ToHex;
+    else if (to == "binary") kind = ToBinary;
+    else if (to == "unicode") kind = ToUnicode;
+    else if (BaseEncoding::parseKind(to, &encoding)) {
+        kind = ToBase;
+        baseEncoder.reset(new BaseEncoder(encoding));
+    } else if (to == "text") {
+        if (from == "hex") kind = FromHex;
+        else if (from == "binary") kind = FromBinary;
+        else if (from == "unicode") kind = FromUnicode;
+        else if (BaseEncoding::parseKind(from, &encoding)) {
+            kind = FromBase;
+            baseDecoder.reset(new BaseDecoder(encoding));
+        } else kind = Passthrough;
+    }
+}
+
+bool StreamConverter::isValid() const
+{
+    return kind != Invalid;
+}
+
+QByteArray StreamConverter::separated(const QByteArray &encoded)
+{
+    if (encoded.isEmpty()) {
+        return encoded;
+    }
+
+    if (!wroteAny) {
+        wroteAny = true;
+        return encoded;
+    }
+    return ' ' + encoded;
+}
+
+QByteArray StreamConverter::takeCompleteUtf8(const QByteArray &chunk, bool final)
+{
+    // Without a carry the chunk is shared, not copied.
+    QByteArray data = carry.isEmpty() ? chunk : carry + chunk;
+    carry.clear();
+    if (final) {
+        return data;
+    }
+
+    int cut = data.size();
+    for (int i = data.size() - 1; i >= 0 && i >= data.size() - 4; --i) {
+        const unsigned char b = static_cast<unsigned char>(data[i]);
+        if ((b & 0xC0) == 0x80) {
+            continue;
+        }
+        if (b >= 0xC0) {
+            const int need = b >= 0xF0 ? 4 : (b >= 0xE0 ? 3 : 2);
+            if (i + need > data.size()) {
+                cut = i;
+            }
+        }
+        break;
+    }
+
+    carry = data.mid(cut);
+    data.truncate(cut);
+    return data;
+}
+
+QByteArray StreamConverter::decodeUnicode(bool final)
+{
+    // An escape cut off at the end of the chunk stays pending for the next one.
+    QString out(pendingText.size(), Qt::Uninitialized);
+    int consumed = 0;
+    out.truncate(TextConverter::unescapeUnicode(pendingText.constData(), pendingText.size(),
+                                                out.data(), final, &consumed));
+    pendingText.remove(0, consumed);
+    return out.toUtf8();
+}
+
+QByteArray StreamConverter::feed(const QByteArray &chunk)
+{
+    switch (kind) {
+    case ToHex:
+        return separated(TextConverter::bytesToHex(chunk, 1, &error));
+    case ToBinary:
+        return separated(TextConverter::bytesToBinary(chunk, &error));
+    case ToUnicode:
+        return TextConverter::toUnicode(QString::fromUtf8(takeCompleteUtf8(chunk, false)), &error).toLatin1();
+    case ToBase:
+        return baseEncoder->feed(chunk.constData(), chunk.size(), &error);
+    case FromBase:
+        return baseDecoder->feed(chunk.constData(), chunk.size(), &error);
+    case FromHex: {
+        QByteArray digits = carry;
+        digits.reserve(carry.size() + chunk.size());
+        for (char c : chunk) {
+            if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f')) {
+                digits += c;
+            }
+        }
+        carry.clear();
+        if (digits.size() % 2) {
+            carry = digits.right(1);
+            digits.chop(1);
+        }
+        return TextConverter::hexToBytes(digits);
+    }
+    case FromBinary: {
+        QByteArray data = carry + chunk;
+        carry.clear();
+        int cut = data.size();
+        while (cut > 0) {
+            const char c = data.at(cut - 1);
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t') break;
+            --cut;
+        }
+        carry = data.mid(cut);
+        data.truncate(cut);
+        return TextConverter::binaryToBytes(data);
+    }
+    case FromUnicode:
+        pendingText += QString::fromUtf8(takeCompleteUtf8(chunk, false));
+        return decodeUnicode(false);
+    case Passthrough:
+        return chunk;
+    case Invalid:
+    default:
+        return QByteArray();
+    }
+}
+
+QByteArray StreamConverter::finish()
+{
+    QByteArray rest;
+    switch (kind) {
+    case ToUnicode:
+        rest = TextConverter::toUnicode(QString::fromUtf8(takeCompleteUtf8(QByteArray(), true)), &error).toLatin1();
+        break;
+    case ToBase:
+        rest = baseEncoder->finish();
+        break;
+    case FromBase:
+        rest = baseDecoder->finish();
+        break;
+    case FromHex:
+        rest = TextConverter::hexToBytes(carry);
+        break;
+    case FromBinary:
+        rest = TextConverter::binaryToBytes(carry);
+        break;
+    case FromUnicode:
+        pendingText += QString::fromUtf8(takeCompleteUtf8(QByteArray(), true));
+        rest = decodeUnicode(true);
+        break;
+    default:
+        break;
+    }
+
+    carry.clear();
+    pendingText.clear();
+    return rest;
+}
@@ -0,0 +1,43 @@
+#ifndef STREAMCONVERTER_H
+#define STREAMCONVERTER_H
+
+#include "baseencoding.h"
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+// Chunked version of the terminal "convert" command. Input is fed in pieces of
+// any size; state that straddles a chunk boundary (a split UTF-8 sequence, an
+// odd hex nibble, half a binary token or \u escape, a partial Base64/Base32/
+// Ascii85 group) is carried to the next feed(), so the concatenated output
+// equals converting the whole input.
+class StreamConverter
+{
+public:
+    StreamConverter(const QString &to, const QString &from);
+
+    bool isValid() const;
+    // Set when a chunk, or the rest flushed by finish(), was too large to
+    // convert in one piece; that output is empty.
+    QString errorString() const { return error; }
+    QByteArray feed(const QByteArray &chunk);
+    QByteArray finish();
+
+private:
+    enum Kind { Invalid, ToHex, ToBinary, ToUnicode, ToBase, FromHex, FromBinary, FromUnicode, FromBase,
+                Passthrough };
+
+    QByteArray takeCompleteUtf8(const QByteArray &chunk, bool final);
+    QByteArray decodeUnicode(bool final);
+    QByteArray separated(const QByteArray &encoded);
+
+    Kind kind = Invalid;
+    QByteArray carry;
+    QString pendingText;
+    QString error;
+    bool wroteAny = false;
+    std::unique_ptr<BaseEncoder> baseEncoder;
+    std::unique_ptr<BaseDecoder> baseDecoder;
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include "structmodel.h"
+#include <QBrush>
+#include <QColor>
+#include <climits>
+#include <vector>
+
+namespace {
+
+constexpr int kFetchBatch = 256;
+
+QString hexOffset(qint64 offset)
+{
+    return "0x" + QString::number(offset, 16).toUpper();
+}
+
+}
+
+StructModel::StructModel(QObject *parent) : QAbstractItemModel(parent)
+{
+}
+
+StructModel::~StructModel() = default;
+
+void StructModel::setTree(std::unique_ptr<StructTree> tree)
+{
+    beginResetModel();
+    rowLists.clear();
+    fetched.clear();
+    structTree = std::move(tree);
+    endResetModel();
+}
+
+StructModel::Rows *StructModel::rowsOf(StructNode *node, int group) const
+{
+    std::unique_ptr<Rows> &rows = rowLists[std::make_pair(node, group)];
+    if (!rows) rows.reset(new Rows{ node, group });
+    return rows.get();
+}
+
+bool StructModel::isGrouped(const StructNode *node) const
+{
+    return node->hasFixedStride() && node->childCount() > groupSize;
+}
+
+// The rows under index: a group row holds elements, any other row its
+// node's children.
+StructModel::Rows *StructModel::childRows(const QModelIndex &index) const
+{
+    if (!index.isValid()) return rowsOf(nullptr, -1);
+    const Rows *rows = static_cast<const Rows *>(index.internalPointer());
+    if (rows->node && rows->group < 0 && isGrouped(rows->node)) return rowsOf(rows->node, index.row());
+    return rowsOf(node(index), -1);
+}
+
+StructNode *StructModel::node(const QModelIndex &index) const
+{
+    if (!index.isValid() || !structTree) return nullptr;
+    const Rows *rows = static_cast<const Rows *>(index.internalPointer());
+    if (!rows->node) return structTree->root();
+    if (rows->group >= 0) return rows->node->child(rows->group * groupSize + index.row());
+    if (isGrouped(rows->node)) return nullptr;
+    return rows->node->child(index.row());
+}
+
+bool StructModel::range(const QModelIndex &index, qint64 *offset, qint64 *size) const
+{
+    if (StructNode *n = node(index)) {
+        if (!n->sizeKnown()) return false;
+        *offset = n->offset();
+        *size = n->size();
+        return true;
+    }
+    if (!index.isValid()) return false;
+    const Rows *rows = static_cast<const Rows *>(index.internalPointer());
+    const int first = index.row() * groupSize;
+    const int last = qMin(first + groupSize, rows->node->childCount()) - 1;
+    StructNode *a = rows->node->child(first);
+    StructNode *b = rows->node->child(last);
+    if (!a || !b) return false;
+    *offset = a->offset();
+    *size = b->offset() + b->size() - a->offset();
+    return true;
+}
+
+int StructModel::visibleRows(const Rows *rows) const
+{
+    if (!structTree) return 0;
+    if (!rows->node) return 1;
+    StructNode *n = rows->node;
+    if (rows->group >= 0) return qMin(groupSize, n->childCount() - rows->group * groupSize);
+    if (isGrouped(n)) return (n->childCount() + groupSize - 1) / groupSize;
+    if (n->kind() == StructNode::Array && !n->hasFixedStride()) return qMin(fetched.value(n), n->childCount());
+    return n->childCount();
+}
+
+QModelIndex StructModel::indexOf(StructNode *target)
+{
+    if (!target || !structTree) return QModelIndex();
+    std::vector<StructNode *> chain;
+    for (StructNode *n = target; n; n = n->parent()) chain.push_back(n);
+
+    QModelIndex index;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        StructNode *n = *it;
+        StructNode *up = n->parent();
+        if (!up) {
+            index = this->index(0, 0);
+            continue;
+        }
+        if (isGrouped(up)) {
+            index = this->index(n->row() / groupSize, 0, index);
+            index = this->index(n->row() % groupSize, 0, index);
+            continue;
+        }
+        if (up->kind() == StructNode::Array && !up->hasFixedStride()) {
+            const int shown = fetched.value(up);
+            if (n->row() >= shown) {
+                beginInsertRows(index, shown, n->row());
+                fetched[up] = n->row() + 1;
+                endInsertRows();
+            }
+        }
+        index = this->index(n->row(), 0, index);
+    }
+    return index;
+}
+
+QModelIndex StructModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.column() > 0) return QModelIndex();
+    Rows *rows = childRows(parent);
+    if (row < 0 || row >= visibleRows(rows) || column < 0 || column >= ColumnCount) return QModelIndex();
+    return createIndex(row, column, rows);
+}
+
+QModelIndex StructModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid()) return QModelIndex();
+    const Rows *rows = static_cast<const Rows *>(index.internalPointer());
+    if (!rows->node) return QModelIndex();
+    if (rows->group >= 0) return createIndex(rows->group, 0, rowsOf(rows->node, -1));
+
+    StructNode *n = rows->node;
+    StructNode *up = n->parent();
+    if (!up) return createIndex(0, 0, rowsOf(nullptr, -1));
+    if (isGrouped(up)) return createIndex(n->row() % groupSize, 0, rowsOf(up, n->row() / groupSize));
+    return createIndex(n->row(), 0, rowsOf(up, -1));
+}
+
+int StructModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) return 0;
+    return visibleRows(childRows(parent));
+}
+
+int StructModel::columnCount(const QModelIndex &) const
+{
+    return ColumnCount;
+}
+
+// Answered from the template, without making the node.
+bool StructModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) return bool(structTree);
+    if (parent.column() > 0) return false;
+    const Rows *rows = static_cast<const Rows *>(parent.internalPointer());
+    if (!rows->node) return true;
+    if (rows->group < 0 && isGrouped(rows->node)) return true;
+    const int row = rows->group >= 0 ? rows->group * groupSize + parent.row() : parent.row();
+    const StructNode::Kind kind = rows->node->childKind(row);
+    return kind == StructNode::Struct || kind == StructNode::Array;
+}
+
+bool StructModel::canFetchMore(const QModelIndex &parent) const
+{
+    StructNode *n = node(parent);
+    if (!n || n->kind() != StructNode::Array || n->hasFixedStride()) return false;
+    return fetched.value(n) < n->childCount() || n->canFetchMore();
+}
+
+void StructModel::fetchMore(const QModelIndex &parent)
+{
+    StructNode *n = node(parent);
+    if (!n) return;
+    const int shown = fetched.value(n);
+    if (shown + kFetchBatch > n->childCount()) n->fetchMore(kFetchBatch);
+    const int rows = int(qMin<qint64>(qint64(shown) + kFetchBatch, n->childCount()));
+    if (rows <= shown) return;
+    beginInsertRows(parent, shown, rows - 1);
+    fetched[n] = rows;
+    endInsertRows();
+}
+
+QVariant StructModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) return QVariant();
+    StructNode *n = node(index);
+
+    if (role == Qt::TextAlignmentRole && (index.column() == OffsetColumn || index.column() == SizeColumn)) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role == Qt::ForegroundRole && index.column() == ValueColumn && n && n->hasProblem()) {
+        return QBrush(QColor(0xC0, 0x30, 0x30));
+    }
+    if (role == Qt::ToolTipRole && index.column() == ValueColumn && n) return n->value();
+    if (role != Qt::DisplayRole) return QVariant();
+
+    if (!n) {
+        // A group of elements.
+        const Rows *rows = static_cast<const Rows *>(index.internalPointer());
+        const int first = index.row() * groupSize;
+        const int last = qMin(first + groupSize, rows->node->childCount()) - 1;
+        qint64 offset = 0;
+        qint64 size = 0;
+        switch (index.column()) {
+        case NameColumn:
+            return QString("[%1 .. %2]").arg(first).arg(last);
+        case OffsetColumn:
+        case SizeColumn:
+            if (!range(index, &offset, &size)) return QString();
+            return index.column() == OffsetColumn ? hexOffset(offset) : QString::number(size);
+        }
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case NameColumn:
+        return n->name();
+    case TypeColumn:
+        return n->typeName();
+    case OffsetColumn:
+        return hexOffset(n->offset());
+    case SizeColumn:
+        return n->sizeKnown() ? QString::number(n->size()) : QString();
+    case ValueColumn:
+        return n->value();
+    }
+    return QVariant();
+}
+
+QVariant StructModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    switch (section) {
+    case NameColumn: return QString("Name");
+    case TypeColumn: return QString("Type");
+    case OffsetColumn: return QString("Offset");
+    case SizeColumn: return QString("Size");
+    case ValueColumn: return QString("Value");
+    }
+    return QVariant();
+}
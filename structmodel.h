@@ -0,0 +1,67 @@
+#ifndef STRUCTMODEL_H
+#define STRUCTMODEL_H
+
+#include "structtemplate.h"
+#include <QAbstractItemModel>
+#include <QHash>
+#include <map>
+#include <memory>
+
+// Field tree of a StructTree. Rows are made as the view asks for them, so a
+// collapsed array costs nothing. Arrays of fixed-size elements longer than
+// groupSize are split into rows of groupSize elements each, and arrays of
+// variable-size elements grow a batch at a time as the view scrolls; a view
+// never lays out millions of rows at once.
+class StructModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum Column { NameColumn, TypeColumn, OffsetColumn, SizeColumn, ValueColumn, ColumnCount };
+
+    static constexpr int groupSize = 10000;
+
+    explicit StructModel(QObject *parent = nullptr);
+    ~StructModel() override;
+
+    void setTree(std::unique_ptr<StructTree> tree);
+    StructTree *tree() const { return structTree.get(); }
+
+    // Null for the rows that group elements of a long array.
+    StructNode *node(const QModelIndex &index) const;
+    // Byte range an index covers, group rows included; false when the
+    // size is not known without walking a long array.
+    bool range(const QModelIndex &index, qint64 *offset, qint64 *size) const;
+    // Shows enough rows of variable-size arrays for node to have one.
+    QModelIndex indexOf(StructNode *node);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    // What the rows under one parent are: the children of node (the tree's
+    // root alone when node is null), or the elements of one group of node.
+    struct Rows {
+        StructNode *node;
+        int group;
+    };
+
+    Rows *rowsOf(StructNode *node, int group) const;
+    Rows *childRows(const QModelIndex &index) const;
+    bool isGrouped(const StructNode *node) const;
+    int visibleRows(const Rows *rows) const;
+
+    std::unique_ptr<StructTree> structTree;
+    // Handed out as internal pointers, so they live as long as the tree.
+    mutable std::map<std::pair<StructNode *, int>, std::unique_ptr<Rows>> rowLists;
+    // Rows shown so far of arrays of variable-size elements.
+    QHash<const StructNode *, int> fetched;
+};
+
+#endif
@@ -0,0 +1,1062 @@
+#include "structtemplate.h"
+#include "bytedecoders.h"
+#include <algorithm>
+#include <climits>
+#include <functional>
+
+struct StructTemplate::Expr {
+    enum Op { Constant, Name, Negate, Add, Subtract, Multiply, Divide, Modulo };
+    Op op = Constant;
+    qint64 number = 0;
+    QStringList path;
+    std::shared_ptr<Expr> lhs;
+    std::shared_ptr<Expr> rhs;
+};
+
+struct StructTemplate::Field {
+    enum Kind { Number, Text, Bytes, Struct };
+    QString name;
+    // As written, e.g. "u32be" or "Chunk".
+    QString typeName;
+    int line = 0;
+    Kind kind = Number;
+    int width = 1;
+    bool isSigned = false;
+    bool isFloat = false;
+    bool bigEndian = false;
+    int structIndex = -1;
+    // [n] or [*] was given: the element count of an array of numbers or
+    // structs, the length of char and bytes.
+    bool sized = false;
+    bool toEnd = false;
+    std::shared_ptr<Expr> count;
+    std::shared_ptr<Expr> at;
+
+    bool isArray() const { return sized && (kind == Number || kind == Struct); }
+};
+
+struct StructTemplate::Struct {
+    QString name;
+    std::vector<Field> fields;
+    // When no field's size or count depends on the data.
+    qint64 fixedSize = -1;
+};
+
+namespace {
+
+// Deeper than any real format nests; stops templates whose structs contain
+// themselves through an offset or a count from recursing through the data.
+constexpr int kMaxDepth = 64;
+constexpr int kMaxTextChars = 256;
+constexpr int kMaxPreviewBytes = 16;
+constexpr int kWalkBatch = 256;
+
+// Counts and offsets come from the data, so results that do not fit in 64
+// bits are refused rather than wrapped, and LLONG_MIN / -1 never reaches the
+// CPU.
+bool applyOperator(StructTemplate::Expr::Op op, qint64 lhs, qint64 rhs, qint64 *value, QString *why)
+{
+    using Expr = StructTemplate::Expr;
+    if ((op == Expr::Divide || op == Expr::Modulo) && rhs == 0) {
+        *why = "division by zero";
+        return false;
+    }
+    bool fits = true;
+    switch (op) {
+    case Expr::Add:
+        fits = rhs > 0 ? lhs <= LLONG_MAX - rhs : lhs >= LLONG_MIN - rhs;
+        if (fits) *value = lhs + rhs;
+        break;
+    case Expr::Subtract:
+        fits = rhs < 0 ? lhs <= LLONG_MAX + rhs : lhs >= LLONG_MIN + rhs;
+        if (fits) *value = lhs - rhs;
+        break;
+    case Expr::Multiply: {
+        const bool negative = (lhs < 0) != (rhs < 0);
+        const quint64 a = lhs < 0 ? 0 - quint64(lhs) : quint64(lhs);
+        const quint64 b = rhs < 0 ? 0 - quint64(rhs) : quint64(rhs);
+        const quint64 limit = quint64(LLONG_MAX) + (negative ? 1 : 0);
+        fits = a == 0 || b <= limit / a;
+        if (fits) *value = negative && a * b != 0 ? -qint64(a * b - 1) - 1 : qint64(a * b);
+        break;
+    }
+    case Expr::Divide:
+    case Expr::Modulo:
+        fits = lhs != LLONG_MIN || rhs != -1;
+        if (fits) *value = op == Expr::Divide ? lhs / rhs : lhs % rhs;
+        break;
+    default:
+        *why = "unknown operator";
+        return false;
+    }
+    if (!fits) *why = "arithmetic overflow";
+    return fits;
+}
+
+// Offsets and sizes are never negative; their sums stop at LLONG_MAX, which
+// lies past the end of any data.
+qint64 saturatingAdd(qint64 a, qint64 b)
+{
+    return b > 0 && a > LLONG_MAX - b ? LLONG_MAX : a + b;
+}
+
+struct Token {
+    enum Type { Ident, Number, Symbol, End };
+    Type type = End;
+    QString text;
+    qint64 number = 0;
+    int line = 0;
+};
+
+struct NumberType {
+    const char *name;
+    int width;
+    bool isSigned;
+    bool isFloat;
+};
+
+const NumberType kNumberTypes[] = {
+    { "u8", 1, false, false }, { "u16", 2, false, false }, { "u32", 4, false, false }, { "u64", 8, false, false },
+    { "i8", 1, true, false }, { "i16", 2, true, false }, { "i32", 4, true, false }, { "i64", 8, true, false },
+    { "f32", 4, true, true }, { "f64", 8, true, true },
+};
+
+const NumberType *numberType(const QString &name)
+{
+    for (const NumberType &type : kNumberTypes) {
+        if (name == QLatin1String(type.name)) return &type;
+    }
+    return nullptr;
+}
+
+bool isIdentStart(QChar c)
+{
+    return c.isLetter() || c == '_';
+}
+
+bool isIdentChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == '_' || c == '.';
+}
+
+using StructExpr = StructTemplate::Expr;
+
+class Parser
+{
+public:
+    explicit Parser(const QString &source)
+    {
+        int line = 1;
+        int i = 0;
+        while (i < source.size()) {
+            const QChar c = source.at(i);
+            if (c == '\n') {
+                ++line;
+                ++i;
+            } else if (c.isSpace()) {
+                ++i;
+            } else if (c == '#') {
+                while (i < source.size() && source.at(i) != '\n') ++i;
+            } else if (isIdentStart(c)) {
+                Token token;
+                token.type = Token::Ident;
+                token.line = line;
+                const int start = i;
+                while (i < source.size() && isIdentChar(source.at(i))) ++i;
+                token.text = source.mid(start, i - start);
+                tokens.push_back(token);
+            } else if (c.isDigit()) {
+                Token token;
+                token.type = Token::Number;
+                token.line = line;
+                const int start = i;
+                while (i < source.size() && source.at(i).isLetterOrNumber()) ++i;
+                token.text = source.mid(start, i - start);
+                bool ok = false;
+                token.number = token.text.startsWith("0x", Qt::CaseInsensitive) ? token.text.mid(2).toLongLong(&ok, 16)
+                                                                                 : token.text.toLongLong(&ok, 10);
+                if (!ok && error.isEmpty()) error = QString("Line %1: bad number %2").arg(line).arg(token.text);
+                tokens.push_back(token);
+            } else {
+                Token token;
+                token.type = Token::Symbol;
+                token.text = c;
+                token.line = line;
+                tokens.push_back(token);
+                ++i;
+            }
+        }
+        Token end;
+        end.line = line;
+        tokens.push_back(end);
+    }
+
+    QString error;
+
+    const Token &peek() const { return tokens[pos]; }
+    bool atEnd() const { return peek().type == Token::End; }
+    Token take()
+    {
+        const Token token = tokens[pos];
+        if (pos + 1 < tokens.size()) ++pos;
+        return token;
+    }
+
+    bool fail(const QString &message)
+    {
+        if (error.isEmpty()) error = QString("Line %1: %2").arg(peek().line).arg(message);
+        return false;
+    }
+
+    bool accept(char symbol)
+    {
+        if (peek().type != Token::Symbol || peek().text.at(0) != QLatin1Char(symbol)) return false;
+        take();
+        return true;
+    }
+
+    bool expect(char symbol)
+    {
+        return accept(symbol) || fail(QString("expected '%1'").arg(QChar::fromLatin1(symbol)));
+    }
+
+    bool ident(QString *text, const char *what)
+    {
+        if (peek().type != Token::Ident) return fail(QString("expected %1").arg(QString::fromLatin1(what)));
+        *text = take().text;
+        return true;
+    }
+
+    // expression := term (('+' | '-') term)*
+    std::shared_ptr<StructExpr> expression()
+    {
+        std::shared_ptr<StructExpr> lhs = term();
+        while (lhs) {
+            StructExpr::Op op;
+            if (accept('+')) op = StructExpr::Add;
+            else if (accept('-')) op = StructExpr::Subtract;
+            else break;
+            lhs = binary(op, lhs, term());
+        }
+        return lhs;
+    }
+
+private:
+    std::shared_ptr<StructExpr> binary(StructExpr::Op op, const std::shared_ptr<StructExpr> &lhs,
+                                       const std::shared_ptr<StructExpr> &rhs)
+    {
+        if (!rhs) return nullptr;
+        auto expr = std::make_shared<StructExpr>();
+        expr->op = op;
+        expr->lhs = lhs;
+        expr->rhs = rhs;
+        return expr;
+    }
+
+    // term := unary (('*' | '/' | '%') unary)*
+    std::shared_ptr<StructExpr> term()
+    {
+        std::shared_ptr<StructExpr> lhs = unary();
+        while (lhs) {
+            StructExpr::Op op;
+            if (accept('*')) op = StructExpr::Multiply;
+            else if (accept('/')) op = StructExpr::Divide;
+            else if (accept('%')) op = StructExpr::Modulo;
+            else break;
+            lhs = binary(op, lhs, unary());
+        }
+        return lhs;
+    }
+
+    std::shared_ptr<StructExpr> unary()
+    {
+        if (accept('-')) {
+            std::shared_ptr<StructExpr> operand = unary();
+            if (!operand) return nullptr;
+            auto expr = std::make_shared<StructExpr>();
+            expr->op = StructExpr::Negate;
+            expr->lhs = operand;
+            return expr;
+        }
+        if (accept('(')) {
+            std::shared_ptr<StructExpr> inner = expression();
+            if (!inner || !expect(')')) return nullptr;
+            return inner;
+        }
+        auto expr = std::make_shared<StructExpr>();
+        if (peek().type == Token::Number) {
+            expr->number = take().number;
+        } else if (peek().type == Token::Ident) {
+            expr->op = StructExpr::Name;
+            expr->path = take().text.split('.', Qt::SkipEmptyParts);
+        } else {
+            fail("expected a number or a field name");
+            return nullptr;
+        }
+        return expr;
+    }
+
+    std::vector<Token> tokens;
+    size_t pos = 0;
+};
+
+bool constantValue(const StructExpr &expr, qint64 *value)
+{
+    qint64 lhs = 0;
+    qint64 rhs = 0;
+    QString why;
+    switch (expr.op) {
+    case StructExpr::Constant:
+        *value = expr.number;
+        return true;
+    case StructExpr::Name:
+        return false;
+    case StructExpr::Negate:
+        return constantValue(*expr.lhs, &lhs) && applyOperator(StructExpr::Subtract, 0, lhs, value, &why);
+    default:
+        break;
+    }
+    if (!constantValue(*expr.lhs, &lhs) || !constantValue(*expr.rhs, &rhs)) return false;
+    return applyOperator(expr.op, lhs, rhs, value, &why);
+}
+
+template <Endian E>
+quint64 loadUnsigned(const uchar *p, int width)
+{
+    using ByteDecoderDetail::load;
+    switch (width) {
+    case 1: return load<quint8, E>(p);
+    case 2: return load<quint16, E>(p);
+    case 4: return load<quint32, E>(p);
+    default: return load<quint64, E>(p);
+    }
+}
+
+template <Endian E>
+double loadFloat(const uchar *p, int width)
+{
+    using ByteDecoderDetail::load;
+    return width == 4 ? double(load<float, E>(p)) : load<double, E>(p);
+}
+
+quint64 loadRaw(const uchar *p, const StructTemplate::Field &field)
+{
+    return field.bigEndian ? loadUnsigned<Endian::Big>(p, field.width) : loadUnsigned<Endian::Little>(p, field.width);
+}
+
+qint64 signExtend(quint64 raw, int width)
+{
+    if (width >= 8) return qint64(raw);
+    const int shift = 64 - width * 8;
+    return qint64(raw << shift) >> shift;
+}
+
+QString pastEnd()
+{
+    return QStringLiteral("past the end of the data");
+}
+
+}
+
+StructTemplate::StructTemplate() = default;
+StructTemplate::~StructTemplate() = default;
+
+const StructTemplate::Struct &StructTemplate::root() const
+{
+    return structs[size_t(rootIndex)];
+}
+
+const StructTemplate::Struct &StructTemplate::structAt(int index) const
+{
+    return structs[size_t(index)];
+}
+
+std::shared_ptr<const StructTemplate> StructTemplate::parse(const QString &source, QString *error)
+{
+    if (error) error->clear();
+    Parser in(source);
+    std::shared_ptr<StructTemplate> result(new StructTemplate);
+    bool bigEndian = false;
+    QString rootName;
+    int rootLine = 0;
+
+    auto failed = [&]() {
+        if (error) *error = in.error;
+        return std::shared_ptr<const StructTemplate>();
+    };
+
+    while (in.error.isEmpty() && !in.atEnd()) {
+        if (in.accept(';')) continue;
+        QString word;
+        if (!in.ident(&word, "struct, endian or root")) break;
+        if (word == "endian") {
+            QString order;
+            if (!in.ident(&order, "little or big")) break;
+            if (order == "little") bigEndian = false;
+            else if (order == "big") bigEndian = true;
+            else in.fail(QString("expected little or big, not %1").arg(order));
+        } else if (word == "root") {
+            rootLine = in.peek().line;
+            in.ident(&rootName, "a struct name");
+        } else if (word == "struct") {
+            Struct def;
+            if (!in.ident(&def.name, "a struct name")) break;
+            for (const Struct &other : result->structs) {
+                if (other.name == def.name) in.fail(QString("struct %1 is declared twice").arg(def.name));
+            }
+            if (!in.expect('{')) break;
+            while (in.error.isEmpty() && !in.accept('}')) {
+                if (in.atEnd()) {
+                    in.fail(QString("struct %1 has no closing }").arg(def.name));
+                    break;
+                }
+                if (in.accept(';')) continue;
+                Field field;
+                field.line = in.peek().line;
+                field.bigEndian = bigEndian;
+                if (!in.ident(&field.typeName, "a field type")) break;
+                if (in.accept('[')) {
+                    field.sized = true;
+                    if (in.accept('*')) field.toEnd = true;
+                    else if (!(field.count = in.expression())) break;
+                    if (!in.expect(']')) break;
+                }
+                if (!in.ident(&field.name, "a field name")) break;
+                if (field.name.contains('.')) {
+                    in.fail(QString("field name %1 has a dot").arg(field.name));
+                    break;
+                }
+                for (const Field &other : def.fields) {
+                    if (other.name == field.name) in.fail(QString("%1.%2 is declared twice").arg(def.name, field.name));
+                }
+                if (in.accept('@') && !(field.at = in.expression())) break;
+                def.fields.push_back(field);
+            }
+            result->structs.push_back(def);
+        } else {
+            in.fail(QString("expected struct, endian or root, not %1").arg(word));
+        }
+    }
+    if (!in.error.isEmpty()) return failed();
+    if (result->structs.empty()) {
+        if (error) *error = "The template declares no struct.";
+        return nullptr;
+    }
+
+    auto structIndex = [&](const QString &name) {
+        for (size_t i = 0; i < result->structs.size(); ++i) {
+            if (result->structs[i].name == name) return int(i);
+        }
+        return -1;
+    };
+
+    // Types may name structs declared further down, so they are resolved once
+    // everything is read.
+    for (Struct &def : result->structs) {
+        for (Field &field : def.fields) {
+            QString base = field.typeName;
+            if ((field.structIndex = structIndex(base)) >= 0) {
+                field.kind = Field::Struct;
+                continue;
+            }
+            if ((base.endsWith("le") || base.endsWith("be")) && numberType(base.left(base.size() - 2))) {
+                field.bigEndian = base.endsWith("be");
+                base.chop(2);
+            }
+            if (const NumberType *type = numberType(base)) {
+                field.kind = Field::Number;
+                field.width = type->width;
+                field.isSigned = type->isSigned;
+                field.isFloat = type->isFloat;
+            } else if (base == "char") {
+                field.kind = Field::Text;
+            } else if (base == "bytes") {
+                field.kind = Field::Bytes;
+            } else {
+                if (error) *error = QString("Line %1: unknown type %2").arg(field.line).arg(field.typeName);
+                return nullptr;
+            }
+        }
+    }
+
+    if (!rootName.isEmpty()) {
+        result->rootIndex = structIndex(rootName);
+        if (result->rootIndex < 0) {
+            if (error) *error = QString("Line %1: unknown struct %2").arg(rootLine).arg(rootName);
+            return nullptr;
+        }
+    }
+
+    // Fixed sizes, bottom up. A struct reached again while its own size is
+    // being worked out contains itself; that only ends when the data decides
+    // how many times (a [*] array or a count read from a field).
+    std::vector<int> state(result->structs.size(), 0);
+    QString cycle;
+    std::function<qint64(int)> fixedSize = [&](int index) -> qint64 {
+        Struct &def = result->structs[size_t(index)];
+        if (state[size_t(index)] == 2) return def.fixedSize;
+        if (state[size_t(index)] == 1) return -2;
+        state[size_t(index)] = 1;
+        qint64 total = 0;
+        bool fixed = true;
+        for (const Field &field : def.fields) {
+            if (field.at) continue;
+            qint64 count = 1;
+            const bool constantCount = !field.sized || (!field.toEnd && constantValue(*field.count, &count));
+            if (!constantCount) fixed = false;
+            qint64 elementSize = field.kind == Field::Number ? field.width : 1;
+            if (field.kind == Field::Struct) {
+                elementSize = fixedSize(field.structIndex);
+                if (elementSize == -2 && constantCount && count > 0 && cycle.isEmpty()) {
+                    cycle = QString("Line %1: struct %2 contains itself").arg(field.line).arg(result->structs[size_t(field.structIndex)].name);
+                }
+                if (elementSize < 0) fixed = false;
+            }
+            // A constant size too large for 64 bits is left to the nodes,
+            // which report it.
+            QString why;
+            qint64 fieldSize = 0;
+            if (fixed && (!applyOperator(StructExpr::Multiply, elementSize, qMax<qint64>(count, 0), &fieldSize, &why)
+                          || !applyOperator(StructExpr::Add, total, fieldSize, &total, &why))) {
+                fixed = false;
+            }
+        }
+        state[size_t(index)] = 2;
+        def.fixedSize = fixed ? total : -1;
+        return def.fixedSize;
+    };
+    for (size_t i = 0; i < result->structs.size(); ++i) fixedSize(int(i));
+    if (!cycle.isEmpty()) {
+        if (error) *error = cycle;
+        return nullptr;
+    }
+    return result;
+}
+
+StructNode::StructNode(StructTree *tree, StructNode *parent, int row, const StructTemplate::Field *field,
+                       bool element, qint64 offset)
+    : tree(tree), parentNode(parent), rowInParent(row), depth(parent ? parent->depth + 1 : 0),
+      field(field), element(element), cachedOffset(offset)
+{
+    if (!field) {
+        def = &tree->structTemplate().root();
+        nodeKind = Struct;
+        return;
+    }
+    if (field->isArray() && !element) {
+        nodeKind = Array;
+        return;
+    }
+    switch (field->kind) {
+    case StructTemplate::Field::Number: nodeKind = Number; break;
+    case StructTemplate::Field::Text: nodeKind = Text; break;
+    case StructTemplate::Field::Bytes: nodeKind = Bytes; break;
+    case StructTemplate::Field::Struct:
+        nodeKind = Struct;
+        def = &tree->structTemplate().structAt(field->structIndex);
+        break;
+    }
+}
+
+StructNode::~StructNode() = default;
+
+bool StructNode::isSequential() const
+{
+    return field && !element && !field->at;
+}
+
+bool StructNode::sizeKnown() const
+{
+    if (cachedSize >= 0) return true;
+    switch (nodeKind) {
+    case Array:
+        return elementStride() >= 0 || walkDone;
+    case Struct:
+        if (def->fixedSize >= 0) return true;
+        makeFields();
+        for (const auto &node : fields) {
+            if (node->isSequential() && !node->sizeKnown()) return false;
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+QString StructNode::name() const
+{
+    if (!field) return def->name;
+    if (element) return QString("[%1]").arg(rowInParent);
+    return field->name;
+}
+
+QString StructNode::typeName() const
+{
+    if (!field) return def->name;
+    if (element) return field->typeName;
+    switch (nodeKind) {
+    case Array:
+        if (elementStride() < 0 && field->toEnd && !walkDone) return field->typeName + "[*]";
+        return QString("%1[%2]").arg(field->typeName).arg(elementCount());
+    case Text:
+    case Bytes:
+        if (!field->sized) return field->typeName;
+        return QString("%1[%2]").arg(field->typeName).arg(size());
+    default:
+        return field->typeName;
+    }
+}
+
+const StructNode *StructNode::scope() const
+{
+    const StructNode *node = parentNode;
+    while (node && node->nodeKind != Struct) node = node->parentNode;
+    return node;
+}
+
+qint64 StructNode::offset() const
+{
+    if (cachedOffset >= 0) return cachedOffset;
+    const qint64 limit = tree->data().size();
+    if (offsetBusy) {
+        problem = "offset depends on itself";
+        return limit;
+    }
+    offsetBusy = true;
+    qint64 result = parentNode->offset();
+    if (field->at) {
+        QString why;
+        if (!scope()->evaluate(*field->at, &result, &why)) {
+            problem = why;
+            result = limit;
+        } else if (result < 0) {
+            problem = QString("offset %1 is negative").arg(result);
+            result = limit;
+        }
+    } else {
+        for (int r = rowInParent - 1; r >= 0; --r) {
+            const StructNode *sibling = parentNode->fields[size_t(r)].get();
+            if (sibling->isSequential()) {
+                result = saturatingAdd(sibling->offset(), sibling->size());
+                break;
+            }
+        }
+    }
+    offsetBusy = false;
+    cachedOffset = result;
+    return result;
+}
+
+qint64 StructNode::size() const
+{
+    if (cachedSize >= 0) return cachedSize;
+    if (sizeBusy) {
+        problem = "size depends on itself";
+        return 0;
+    }
+    sizeBusy = true;
+    qint64 result = 0;
+    switch (nodeKind) {
+    case Number:
+        result = field->width;
+        break;
+    case Text:
+    case Bytes:
+        if (!field->sized) {
+            result = 1;
+        } else if (field->toEnd) {
+            result = qMax<qint64>(0, tree->data().size() - offset());
+        } else {
+            QString why;
+            if (!scope()->evaluate(*field->count, &result, &why)) {
+                problem = why;
+                result = 0;
+            } else if (result < 0) {
+                problem = QString("length %1 is negative").arg(result);
+                result = 0;
+            }
+        }
+        break;
+    case Struct:
+        if (def->fixedSize >= 0) {
+            result = def->fixedSize;
+        } else {
+            makeFields();
+            const qint64 start = offset();
+            qint64 end = start;
+            for (auto it = fields.rbegin(); it != fields.rend(); ++it) {
+                if ((*it)->isSequential()) {
+                    end = saturatingAdd((*it)->offset(), (*it)->size());
+                    break;
+                }
+            }
+            result = qMax<qint64>(0, end - start);
+        }
+        break;
+    case Array: {
+        const qint64 stride = elementStride();
+        QString why;
+        if (stride >= 0) {
+            if (!applyOperator(StructTemplate::Expr::Multiply, elementCount(), stride, &result, &why)) {
+                problem = QString("%1 elements of %2 bytes do not fit in 64 bits").arg(elementCount()).arg(stride);
+                result = LLONG_MAX;
+            }
+        } else {
+            walk(LLONG_MAX);
+            result = (elementEnds.empty() ? offset() : elementEnds.back()) - offset();
+        }
+        break;
+    }
+    }
+    sizeBusy = false;
+    cachedSize = result;
+    return result;
+}
+
+qint64 StructNode::elementStride() const
+{
+    if (field->kind == StructTemplate::Field::Struct) {
+        return tree->structTemplate().structAt(field->structIndex).fixedSize;
+    }
+    return field->width;
+}
+
+// The number of elements the template asks for, which may run past the data.
+qint64 StructNode::elementCount() const
+{
+    if (cachedCount >= 0) return cachedCount;
+    if (countBusy) {
+        problem = "count depends on itself";
+        return 0;
+    }
+    countBusy = true;
+    qint64 result = 0;
+    const qint64 stride = elementStride();
+    if (field->toEnd) {
+        if (stride > 0) {
+            result = qMax<qint64>(0, tree->data().size() - offset()) / stride;
+        } else if (stride == 0) {
+            problem = "elements of [*] have no size";
+        } else {
+            walk(LLONG_MAX);
+            result = qint64(elementEnds.size());
+        }
+    } else {
+        QString why;
+        if (!scope()->evaluate(*field->count, &result, &why)) {
+            problem = why;
+            result = 0;
+        } else if (result < 0) {
+            problem = QString("count %1 is negative").arg(result);
+            result = 0;
+        }
+    }
+    countBusy = false;
+    cachedCount = result;
+    return result;
+}
+
+qint64 StructNode::elementOffset(qint64 index) const
+{
+    const qint64 stride = elementStride();
+    if (stride >= 0) return saturatingAdd(offset(), index * stride);
+    walk(index);
+    if (index == 0) return offset();
+    return elementEnds[size_t(qMin<qint64>(index, qint64(elementEnds.size())) - 1)];
+}
+
+// Measures elements of variable size until count are known, the template's
+// count is reached or the data ends. Elements are made only for the
+// measurement, unless the view already made them.
+void StructNode::walk(qint64 count) const
+{
+    if (walkDone) return;
+    count = qMin<qint64>(count, INT_MAX);
+    const qint64 limit = tree->data().size();
+    const qint64 wanted = field->toEnd ? -1 : elementCount();
+    qint64 at = elementEnds.empty() ? offset() : elementEnds.back();
+    while (qint64(elementEnds.size()) < count) {
+        const qint64 index = qint64(elementEnds.size());
+        if (wanted >= 0 && index >= wanted) {
+            walkDone = true;
+            break;
+        }
+        if (at >= limit) {
+            if (wanted >= 0) problem = QString("only %1 of %2 elements are inside the data").arg(index).arg(wanted);
+            walkDone = true;
+            break;
+        }
+        qint64 elementSize;
+        auto made = elements.find(index);
+        if (made != elements.end()) {
+            elementSize = made->second->size();
+        } else {
+            StructNode probe(tree, const_cast<StructNode *>(this), int(index), field, true, at);
+            elementSize = probe.size();
+        }
+        if (elementSize <= 0) {
+            problem = QString("element %1 has no size").arg(index);
+            walkDone = true;
+            break;
+        }
+        at = saturatingAdd(at, elementSize);
+        elementEnds.push_back(at);
+    }
+}
+
+void StructNode::makeFields() const
+{
+    if (nodeKind != Struct || !fields.empty() || def->fields.empty()) return;
+    if (depth >= kMaxDepth) {
+        problem = "nested too deeply";
+        return;
+    }
+    fields.reserve(def->fields.size());
+    for (size_t i = 0; i < def->fields.size(); ++i) {
+        fields.emplace_back(new StructNode(tree, const_cast<StructNode *>(this), int(i), &def->fields[i], false, -1));
+    }
+}
+
+const StructNode *StructNode::fieldNamed(const QString &fieldName) const
+{
+    makeFields();
+    for (const auto &node : fields) {
+        if (node->field->name == fieldName) return node.get();
+    }
+    return nullptr;
+}
+
+bool StructNode::evaluate(const StructTemplate::Expr &expr, qint64 *value, QString *why) const
+{
+    using Expr = StructTemplate::Expr;
+    qint64 lhs = 0;
+    qint64 rhs = 0;
+    switch (expr.op) {
+    case Expr::Constant:
+        *value = expr.number;
+        return true;
+    case Expr::Name:
+        return lookup(expr.path, value, why);
+    case Expr::Negate:
+        return evaluate(*expr.lhs, &lhs, why) && applyOperator(Expr::Subtract, 0, lhs, value, why);
+    default:
+        break;
+    }
+    if (!evaluate(*expr.lhs, &lhs, why) || !evaluate(*expr.rhs, &rhs, why)) return false;
+    return applyOperator(expr.op, lhs, rhs, value, why);
+}
+
+// The first name is looked for in this struct, then in each enclosing one.
+bool StructNode::lookup(const QStringList &path, qint64 *value, QString *why) const
+{
+    for (const StructNode *node = this; node; node = node->parentNode) {
+        if (node->nodeKind != Struct) continue;
+        const StructNode *found = node->fieldNamed(path.first());
+        if (!found) continue;
+        for (int i = 1; found && i < path.size(); ++i) {
+            found = found->nodeKind == Struct ? found->fieldNamed(path.at(i)) : nullptr;
+        }
+        if (!found) break;
+        return found->numberValue(value, why);
+    }
+    *why = QString("no field %1").arg(path.join('.'));
+    return false;
+}
+
+bool StructNode::numberValue(qint64 *value, QString *why) const
+{
+    if (nodeKind != Number) {
+        *why = QString("%1 is not a number").arg(name());
+        return false;
+    }
+    const qint64 at = offset();
+    if (at > tree->data().size() - field->width) {
+        *why = QString("%1 is %2").arg(name(), pastEnd());
+        return false;
+    }
+    const uchar *p = reinterpret_cast<const uchar *>(tree->data().constData()) + at;
+    if (field->isFloat) {
+        const double v = field->bigEndian ? loadFloat<Endian::Big>(p, field->width)
+                                          : loadFloat<Endian::Little>(p, field->width);
+        *value = qint64(qBound(-9.0e18, v, 9.0e18));
+    } else {
+        const quint64 raw = loadRaw(p, *field);
+        *value = field->isSigned ? signExtend(raw, field->width) : qint64(raw);
+    }
+    return true;
+}
+
+QString StructNode::value() const
+{
+    const QByteArray &data = tree->data();
+    const qint64 at = offset();
+    QString text;
+    switch (nodeKind) {
+    case Struct:
+        if (at >= data.size() && def->fixedSize != 0) return pastEnd();
+        return problem;
+    case Array:
+        return problem;
+    case Number: {
+        if (!problem.isEmpty()) return problem;
+        if (at > data.size() - field->width) return pastEnd();
+        const uchar *p = reinterpret_cast<const uchar *>(data.constData()) + at;
+        if (field->isFloat) {
+            const double v = field->bigEndian ? loadFloat<Endian::Big>(p, field->width)
+                                              : loadFloat<Endian::Little>(p, field->width);
+            return QString::number(v, 'g', field->width == 4 ? 9 : 17);
+        }
+        const quint64 raw = loadRaw(p, *field);
+        const QString hex = "0x" + QString("%1").arg(raw, field->width * 2, 16, QChar('0')).toUpper();
+        if (field->isSigned) return QString("%1 (%2)").arg(signExtend(raw, field->width)).arg(hex);
+        return QString("%1 (%2)").arg(raw).arg(hex);
+    }
+    case Text:
+    case Bytes: {
+        const qint64 length = size();
+        if (!problem.isEmpty()) return problem;
+        if (length == 0) return QString();
+        if (at >= data.size()) return pastEnd();
+        const qint64 available = qMin(length, data.size() - at);
+        const int limit = nodeKind == Text ? kMaxTextChars : kMaxPreviewBytes;
+        const int shown = int(qMin<qint64>(available, limit));
+        const char *p = data.constData() + at;
+        if (nodeKind == Text) {
+            text.reserve(shown + 2);
+            text += '"';
+            for (int i = 0; i < shown; ++i) {
+                const uchar c = uchar(p[i]);
+                text += (c >= 0x20 && c < 0x7F) ? QChar(c) : QChar('.');
+            }
+            text += '"';
+        } else {
+            text = QString::fromLatin1(QByteArray(p, shown).toHex(' ').toUpper());
+        }
+        if (shown < available) text += QStringLiteral(" ...");
+        if (available < length) text += QString(" (%1)").arg(pastEnd());
+        return text;
+    }
+    }
+    return text;
+}
+
+int StructNode::childCount() const
+{
+    if (nodeKind == Struct) {
+        makeFields();
+        return int(fields.size());
+    }
+    if (nodeKind != Array) return 0;
+    const qint64 stride = elementStride();
+    if (stride < 0) return int(elementEnds.size());
+    // Elements that start inside the data; a count read from garbage does
+    // not get a billion rows.
+    const qint64 count = elementCount();
+    const qint64 room = qMax<qint64>(0, tree->data().size() - offset());
+    const qint64 inside = stride > 0 ? room / stride + (room % stride != 0) : qMin<qint64>(count, 1);
+    if (count > inside && problem.isEmpty()) {
+        problem = QString("only %1 of %2 elements are inside the data").arg(inside).arg(count);
+    }
+    return int(qMin<qint64>(qMin(count, inside), INT_MAX));
+}
+
+StructNode::Kind StructNode::childKind(int row) const
+{
+    if (nodeKind == Struct) {
+        makeFields();
+        return row >= 0 && size_t(row) < fields.size() ? fields[size_t(row)]->nodeKind : Number;
+    }
+    return field && field->kind == StructTemplate::Field::Struct ? Struct : Number;
+}
+
+StructNode *StructNode::child(int row)
+{
+    if (row < 0 || row >= childCount()) return nullptr;
+    if (nodeKind == Struct) return fields[size_t(row)].get();
+    auto made = elements.find(row);
+    if (made != elements.end()) return made->second.get();
+    const qint64 at = elementOffset(row);
+    StructNode *node = new StructNode(tree, this, row, field, true, at);
+    elements.emplace(row, std::unique_ptr<StructNode>(node));
+    return node;
+}
+
+bool StructNode::hasFixedStride() const
+{
+    return nodeKind == Array && elementStride() >= 0;
+}
+
+bool StructNode::canFetchMore() const
+{
+    return nodeKind == Array && elementStride() < 0 && !walkDone;
+}
+
+void StructNode::fetchMore(int count)
+{
+    if (canFetchMore()) walk(qint64(elementEnds.size()) + count);
+}
+
+StructNode *StructNode::nodeAt(qint64 target)
+{
+    // Fields placed with @ may lie outside their struct, so the root answers
+    // for all of the data.
+    const qint64 end = field ? saturatingAdd(offset(), size()) : tree->data().size();
+    if (target < offset() || target >= end) return nullptr;
+    // Arrays of variable-size elements are walked only up to the target.
+    auto covers = [target](StructNode *f) {
+        if (f->nodeKind == Array && f->elementStride() < 0 && !f->walkDone) {
+            if (target < f->offset()) return false;
+            while (!f->walkDone && (f->elementEnds.empty() || f->elementEnds.back() <= target)) {
+                f->walk(qint64(f->elementEnds.size()) + kWalkBatch);
+            }
+            if (!f->walkDone) return true;
+        }
+        return target >= f->offset() && target < saturatingAdd(f->offset(), f->size());
+    };
+    StructNode *node = this;
+    for (;;) {
+        StructNode *next = nullptr;
+        if (node->nodeKind == Struct) {
+            node->makeFields();
+            StructNode *placed = nullptr;
+            bool passed = false;
+            for (const auto &candidate : node->fields) {
+                StructNode *f = candidate.get();
+                if (!f->isSequential()) {
+                    if (!placed && covers(f)) placed = f;
+                    continue;
+                }
+                if (passed || next) continue;
+                if (f->offset() > target) {
+                    passed = true;
+                    continue;
+                }
+                if (covers(f)) next = f;
+            }
+            if (!next) next = placed;
+        } else if (node->nodeKind == Array) {
+            const qint64 stride = node->elementStride();
+            const qint64 start = node->offset();
+            qint64 row = -1;
+            if (target < start) {
+                row = -1;
+            } else if (stride > 0) {
+                row = (target - start) / stride;
+            } else if (stride < 0) {
+                while (!node->walkDone && (node->elementEnds.empty() || node->elementEnds.back() <= target)) {
+                    node->walk(qint64(node->elementEnds.size()) + kWalkBatch);
+                }
+                row = std::upper_bound(node->elementEnds.begin(), node->elementEnds.end(), target) - node->elementEnds.begin();
+            }
+            if (row >= 0 && row < node->childCount()) next = node->child(int(row));
+        }
+        if (!next) return node;
+        node = next;
+    }
+}
+
+StructTree::StructTree(const std::shared_ptr<const StructTemplate> &tmpl, const QByteArray &data)
+    : tmpl(tmpl), bytes(data)
+{
+    rootNode.reset(new StructNode(this, nullptr, 0, nullptr, false, 0));
+}
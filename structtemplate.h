@@ -0,0 +1,160 @@
+#ifndef STRUCTTEMPLATE_H
+#define STRUCTTEMPLATE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// A binary layout written as a small declarative template, e.g.
+//
+//     endian big
+//     struct Png {
+//         bytes[8] signature
+//         Chunk[*] chunks
+//     }
+//     struct Chunk {
+//         u32 length
+//         char[4] type
+//         bytes[length] data
+//         u32 crc
+//     }
+//
+// Field types are u8 u16 u32 u64 i8 i16 i32 i64 f32 f64 (le or be appended
+// overrides the endian line), char[n] for text, bytes[n] for raw data, and
+// struct names, which may be used before they are declared. T[n] is an array
+// of n elements; n may refer to fields decoded before it, those of enclosing
+// structs included, and a.b reaches into a nested struct. + - * / % and
+// parentheses are allowed. T[*] repeats to the end of the data. "@ expr" after
+// a name puts the field at that absolute offset instead of after the one
+// before it. The first struct is the root unless a "root Name" line says
+// otherwise. # starts a comment.
+class StructTemplate
+{
+public:
+    struct Expr;
+    struct Field;
+    struct Struct;
+
+    ~StructTemplate();
+
+    // Null on syntax errors, with error saying where.
+    static std::shared_ptr<const StructTemplate> parse(const QString &source, QString *error);
+
+    const Struct &root() const;
+    const Struct &structAt(int index) const;
+
+private:
+    StructTemplate();
+
+    std::vector<Struct> structs;
+    int rootIndex = 0;
+};
+
+class StructTree;
+
+// One decoded field. Nodes are made the first time they are asked for, and
+// only what a caller looks at is decoded. Arrays whose elements all have one
+// size hand out element i at offset + i * stride without building the ones
+// before it. Arrays of variable-size elements are walked as far as needed;
+// the walk keeps element boundaries, not elements.
+class StructNode
+{
+public:
+    enum Kind { Struct, Array, Number, Text, Bytes };
+
+    ~StructNode();
+
+    Kind kind() const { return nodeKind; }
+    QString name() const;
+    QString typeName() const;
+    qint64 offset() const;
+    qint64 size() const;
+    // Whether size() can answer without walking an array of variable-size
+    // elements to its end.
+    bool sizeKnown() const;
+    // Decoded value, or what went wrong (past the end of the data, a count
+    // that refers to itself, ...).
+    QString value() const;
+    bool hasProblem() const { return !problem.isEmpty(); }
+
+    StructNode *parent() const { return parentNode; }
+    int row() const { return rowInParent; }
+
+    // Fields of a struct; elements of an array, for variable-size elements
+    // only those walked so far. childKind() answers without making the child.
+    int childCount() const;
+    StructNode *child(int row);
+    Kind childKind(int row) const;
+    // Arrays whose elements all have one size know their length up front.
+    bool hasFixedStride() const;
+    bool canFetchMore() const;
+    void fetchMore(int count);
+
+    // Deepest node covering offset, made on the way down, or null.
+    StructNode *nodeAt(qint64 offset);
+
+private:
+    friend class StructTree;
+
+    StructNode(StructTree *tree, StructNode *parent, int row, const StructTemplate::Field *field,
+               bool element, qint64 offset);
+
+    void makeFields() const;
+    const StructNode *fieldNamed(const QString &name) const;
+    const StructNode *scope() const;
+    bool evaluate(const StructTemplate::Expr &expr, qint64 *value, QString *why) const;
+    bool lookup(const QStringList &path, qint64 *value, QString *why) const;
+    bool numberValue(qint64 *value, QString *why) const;
+    qint64 elementCount() const;
+    qint64 elementStride() const;
+    qint64 elementOffset(qint64 index) const;
+    void walk(qint64 count) const;
+    bool isSequential() const;
+
+    StructTree *tree;
+    StructNode *parentNode;
+    int rowInParent;
+    int depth;
+    const StructTemplate::Field *field;
+    const StructTemplate::Struct *def = nullptr;
+    Kind nodeKind = Struct;
+    bool element;
+
+    mutable qint64 cachedOffset = -1;
+    mutable qint64 cachedSize = -1;
+    mutable qint64 cachedCount = -1;
+    // Set while the matching value is worked out, to catch a template whose
+    // counts or offsets refer to themselves.
+    mutable bool offsetBusy = false;
+    mutable bool sizeBusy = false;
+    mutable bool countBusy = false;
+    mutable QString problem;
+
+    mutable std::vector<std::unique_ptr<StructNode>> fields;
+    mutable std::unordered_map<qint64, std::unique_ptr<StructNode>> elements;
+    // Variable-size elements: the end of each element walked so far.
+    mutable std::vector<qint64> elementEnds;
+    mutable bool walkDone = false;
+};
+
+// Data seen through a template. Holds its own copy of the bytes (shared, not
+// duplicated), so it stays valid while the tab is edited.
+class StructTree
+{
+public:
+    StructTree(const std::shared_ptr<const StructTemplate> &tmpl, const QByteArray &data);
+
+    StructNode *root() const { return rootNode.get(); }
+    const QByteArray &data() const { return bytes; }
+    const StructTemplate &structTemplate() const { return *tmpl; }
+
+private:
+    std::shared_ptr<const StructTemplate> tmpl;
+    QByteArray bytes;
+    std::unique_ptr<StructNode> rootNode;
+};
+
+#endif
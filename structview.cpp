@@ -0,0 +1,127 @@
+#include "structview.h"
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QSettings>
+#include <QVBoxLayout>
+
+StructView::StructView(QWidget *parent) : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(4, 4, 4, 4);
+
+    QHBoxLayout *top = new QHBoxLayout();
+    loadButton = new QPushButton("Load Template...", this);
+    statusLabel = new QLabel("No template", this);
+    statusLabel->setObjectName("structStatusLabel");
+    statusLabel->setWordWrap(true);
+    top->addWidget(loadButton);
+    top->addWidget(statusLabel, 1);
+    layout->addLayout(top);
+
+    model = new StructModel(this);
+    view = new QTreeView(this);
+    view->setModel(model);
+    view->setUniformRowHeights(true);
+    view->setAlternatingRowColors(true);
+    view->header()->setSectionResizeMode(QHeaderView::Interactive);
+    view->header()->setStretchLastSection(true);
+    layout->addWidget(view);
+
+    connect(loadButton, &QPushButton::clicked, this, &StructView::chooseTemplate);
+    connect(view->selectionModel(), &QItemSelectionModel::currentChanged, this,
+            [this](const QModelIndex &current) { onCurrentChanged(current); });
+
+    QSettings settings("MyCompany", "MyApplication");
+    const QString saved = settings.value("structure/template").toString();
+    if (!saved.isEmpty()) loadTemplate(saved);
+}
+
+void StructView::chooseTemplate()
+{
+    const QString path = QFileDialog::getOpenFileName(this, "Load Structure Template",
+                                                      QFileInfo(templatePath).absolutePath(),
+                                                      "Templates (*.tpl *.txt);;All files (*)");
+    if (path.isEmpty()) return;
+    if (loadTemplate(path)) {
+        QSettings settings("MyCompany", "MyApplication");
+        settings.setValue("structure/template", path);
+    }
+}
+
+bool StructView::loadTemplate(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        statusLabel->setText("Cannot read " + path);
+        return false;
+    }
+    QString error;
+    std::shared_ptr<const StructTemplate> parsed = StructTemplate::parse(QString::fromUtf8(file.readAll()), &error);
+    if (!parsed) {
+        statusLabel->setText(QFileInfo(path).fileName() + ": " + error);
+        return false;
+    }
+    structTemplate = parsed;
+    templatePath = path;
+    statusLabel->setText(QFileInfo(path).fileName());
+    rebuild();
+    return true;
+}
+
+void StructView::setData(const QByteArray &data)
+{
+    // Any edit detaches the tab's buffer, so the same pointer and size
+    // means the same bytes.
+    if (hasData && data.constData() == bytes.constData() && data.size() == bytes.size()) return;
+    bytes = data;
+    hasData = true;
+    rebuild();
+}
+
+void StructView::clear()
+{
+    bytes.clear();
+    hasData = false;
+    model->setTree(nullptr);
+}
+
+void StructView::rebuild()
+{
+    if (!structTemplate || !hasData) {
+        model->setTree(nullptr);
+        return;
+    }
+    model->setTree(std::unique_ptr<StructTree>(new StructTree(structTemplate, bytes)));
+    view->expand(model->index(0, 0));
+    view->resizeColumnToContents(StructModel::NameColumn);
+}
+
+void StructView::revealOffset(qint64 offset)
+{
+    StructTree *tree = model->tree();
+    if (!tree || offset < 0 || offset >= tree->data().size()) return;
+
+    qint64 start = 0;
+    qint64 size = 0;
+    if (model->range(view->currentIndex(), &start, &size) && offset >= start && offset < start + size) return;
+
+    StructNode *node = tree->root()->nodeAt(offset);
+    if (!node) return;
+    const QModelIndex index = model->indexOf(node);
+    revealing = true;
+    view->setCurrentIndex(index);
+    view->scrollTo(index);
+    revealing = false;
+}
+
+void StructView::onCurrentChanged(const QModelIndex &index)
+{
+    if (revealing) return;
+    qint64 offset = 0;
+    qint64 size = 0;
+    if (model->range(index, &offset, &size)) emit rangeSelected(offset, size);
+}
@@ -0,0 +1,49 @@
+#ifndef STRUCTVIEW_H
+#define STRUCTVIEW_H
+
+#include "structmodel.h"
+#include <QByteArray>
+#include <QLabel>
+#include <QTreeView>
+#include <QWidget>
+
+class QPushButton;
+
+// Dock contents for structure templates: the template file in use, and the
+// current tab's bytes as a field tree. The last template loaded is opened
+// again on the next start.
+class StructView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit StructView(QWidget *parent = nullptr);
+
+    bool loadTemplate(const QString &path);
+    // Rebuilds the tree only when data is a different buffer from last time.
+    void setData(const QByteArray &data);
+    void clear();
+    // Selects the deepest field covering offset, unless the current row
+    // already covers it.
+    void revealOffset(qint64 offset);
+
+signals:
+    // The user picked a row covering these bytes.
+    void rangeSelected(qint64 offset, qint64 length);
+
+private:
+    void chooseTemplate();
+    void rebuild();
+    void onCurrentChanged(const QModelIndex &index);
+
+    QPushButton *loadButton;
+    QLabel *statusLabel;
+    QTreeView *view;
+    StructModel *model;
+    std::shared_ptr<const StructTemplate> structTemplate;
+    QString templatePath;
+    QByteArray bytes;
+    bool hasData = false;
+    bool revealing = false;
+};
+
+#endif
@@ -0,0 +1,802 @@
+#include "terminalmode.h"
+#include <QCommandLineOption>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include "asyncreader.h"
+#include "batchconverter.h"
+#include "byteregex.h"
+#include "conversionserver.h"
+#include "gzipindex.h"
+#include "hashengine.h"
+#include "textconverter.h"
+#include "trace.h"
+
+namespace {
+
+QByteArray readInput(const QString &text, const QString &inputFile, QTextStream &err)
+{
+    if (!text.isEmpty()) {
+        return text.toUtf8();
+    }
+
+    if (!inputFile.isEmpty()) {
+        QFile file(inputFile);
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "Cannot open input file: " << inputFile << Qt::endl;
+            return {};
+        }
+
+        return file.readAll();
+    }
+
+    return {};
+}
+
+bool writeOutput(const QString &outputPath, const QString &content, QTextStream &out, QTextStream &err)
+{
+    if (outputPath.isEmpty()) {
+        out << content << Qt::endl;
+        return true;
+    }
+
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        err << "Cannot write output file: " << outputPath << Qt::endl;
+        return false;
+    }
+
+    file.write(content.toUtf8());
+    out << "Saved output to: " << outputPath << Qt::endl;
+    return true;
+}
+
+// Converted bytes go out untouched, so results of --to text from hex or
+// binary can be arbitrary binary data. Only textual results get a newline
+// after them on stdout; decoded bytes are piped on exactly as they are.
+bool writeOutputBytes(const QString &outputPath, const QByteArray &content, bool textual, QTextStream &out,
+                      QTextStream &err)
+{
+    if (outputPath.isEmpty()) {
+        out.flush();
+        QFile console;
+        if (!console.open(stdout, QIODevice::WriteOnly)) {
+            err << "Cannot write to stdout." << Qt::endl;
+            return false;
+        }
+        if (console.write(content) != content.size() || (textual && console.write("\n") != 1)) {
+            err << "Cannot write to stdout: " << console.errorString() << Qt::endl;
+            return false;
+        }
+        return true;
+    }
+
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err << "Cannot write output file: " << outputPath << Qt::endl;
+        return false;
+    }
+
+    if (file.write(content) != content.size() || !file.flush()) {
+        err << "Cannot write output file: " << outputPath << ": " << file.errorString() << Qt::endl;
+        return false;
+    }
+    out << "Saved output to: " << outputPath << Qt::endl;
+    return true;
+}
+
+QString traceExportPath(const QCommandLineParser &parser)
+{
+    const QString path = parser.value("trace");
+    return path.isEmpty() ? Trace::environmentExportPath() : path;
+}
+
+void exportTrace(const QString &path)
+{
+    if (path.isEmpty() || !Trace::isEnabled()) {
+        return;
+    }
+
+    if (!Trace::exportChromeJson(path)) {
+        QTextStream(stderr) << "Cannot write trace file: " << path << Qt::endl;
+    }
+}
+
+bool isBatchRequest(const QCommandLineParser &parser)
+{
+    return parser.values("input-file").size() > 1
+           || parser.isSet("input-dir")
+           || parser.isSet("input-list");
+}
+
+int runBatchConvert(const QCommandLineParser &parser, const QString &to, const QString &from,
+                    QTextStream &out, QTextStream &err)
+{
+    const QString outputDir = parser.value("output-dir");
+    const QString outputTemplate = parser.value("output-template");
+    if (outputDir.isEmpty() && outputTemplate.isEmpty()) {
+        err << "Batch conversion needs --output-dir or --output-template." << Qt::endl;
+        return 1;
+    }
+
+    QString error;
+    QStringList subdirs;
+    const QStringList inputs = BatchConverter::collectInputs(
+        parser.values("input-file"), parser.values("input-dir"), parser.value("input-list"),
+        parser.isSet("recursive"), &subdirs, &error);
+    if (!error.isEmpty()) {
+        err << error << Qt::endl;
+        return 1;
+    }
+    if (inputs.isEmpty()) {
+        err << "No input files found." << Qt::endl;
+        return 1;
+    }
+
+    QVector<BatchJob> jobs;
+    jobs.reserve(inputs.size());
+    for (int i = 0; i < inputs.size(); ++i) {
+        jobs.append({ inputs.at(i), BatchConverter::outputPathFor(outputTemplate, outputDir, inputs.at(i),
+                                                                  subdirs.at(i), to, i) });
+    }
+    const QString duplicate = BatchConverter::duplicateOutput(jobs);
+    if (!duplicate.isEmpty()) {
+        err << "More than one input would be written to " << duplicate
+            << "; use an --output-template with {dir} or {index}." << Qt::endl;
+        return 1;
+    }
+
+    BatchConverter converter(to, from);
+    if (parser.isSet("jobs")) {
+        converter.setMaxJobs(parser.value("jobs").toInt());
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<BatchResult> results = converter.run(jobs);
+    const double seconds = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+
+    int failed = 0;
+    qint64 bytesIn = 0;
+    qint64 bytesOut = 0;
+    for (const BatchResult &r : results) {
+        bytesIn += r.bytesIn;
+        bytesOut += r.bytesOut;
+        if (!r.ok) {
+            ++failed;
+            err << "FAILED " << r.inputPath << ": " << r.error << Qt::endl;
+        }
+    }
+
+    const double mbIn = bytesIn / (1024.0 * 1024.0);
+    out << "Converted " << (results.size() - failed) << " of " << results.size() << " files"
+        << " (" << failed << " failed) in " << QString::number(seconds, 'f', 2) << " s" << Qt::endl;
+    out << "Read " << QString::number(mbIn, 'f', 2) << " MB, wrote "
+        << QString::number(bytesOut / (1024.0 * 1024.0), 'f', 2) << " MB, "
+        << QString::number(mbIn / seconds, 'f', 2) << " MB/s, "
+        << QString::number(results.size() / seconds, 'f', 1) << " files/s" << Qt::endl;
+
+    return failed == 0 ? 0 : 1;
+}
+
+int runServer(const QCommandLineParser &parser, QTextStream &out, QTextStream &err)
+{
+    ConversionServer server;
+    if (parser.isSet("threads")) {
+        server.setThreadCount(parser.value("threads").toInt());
+    }
+    if (parser.isSet("max-in-flight")) {
+        server.setMaxInFlight(parser.value("max-in-flight").toInt());
+    }
+
+    const QString name = parser.value("serve");
+    if (!server.listen(name)) {
+        err << "Cannot listen on " << name << ": " << server.errorString() << Qt::endl;
+        return 1;
+    }
+
+    out << "Serving on " << name << Qt::endl;
+    return QCoreApplication::exec();
+}
+
+QByteArray readResponseLine(QLocalSocket &socket)
+{
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(-1)) {
+            return QByteArray();
+        }
+    }
+    return socket.readLine();
+}
+
+QJsonObject requestFromOptions(const QCommandLineParser &parser)
+{
+    QJsonObject request;
+    request["id"] = 1;
+    request["op"] = parser.value("command").trimmed().toLower();
+    request["to"] = parser.value("to").trimmed().toLower();
+    request["from"] = parser.value("from").trimmed().toLower();
+    if (parser.isSet("query")) {
+        request["query"] = parser.value("query");
+    }
+
+    // The server reads files itself, so only the path crosses the socket.
+    if (parser.isSet("text")) {
+        request["text"] = parser.value("text");
+    } else if (parser.isSet("input-file")) {
+        request["path"] = QFileInfo(parser.value("input-file")).absoluteFilePath();
+    }
+    return request;
+}
+
+int runClient(const QCommandLineParser &parser, QTextStream &out, QTextStream &err)
+{
+    QLocalSocket socket;
+    socket.connectToServer(parser.value("connect"));
+    if (!socket.waitForConnected(5000)) {
+        err << "Cannot connect to " << parser.value("connect") << ": " << socket.errorString() << Qt::endl;
+        return 1;
+    }
+
+    if (parser.isSet("command")) {
+        socket.write(QJsonDocument(requestFromOptions(parser)).toJson(QJsonDocument::Compact) + '\n');
+        const QByteArray line = readResponseLine(socket);
+        const QJsonObject response = QJsonDocument::fromJson(line).object();
+        if (!response.value("ok").toBool()) {
+            err << (line.isEmpty() ? QString("Connection closed by server.") : response.value("error").toString()) << Qt::endl;
+            return 1;
+        }
+
+        if (response.contains("result")) {
+            return writeOutput(parser.value("output"), response.value("result").toString(), out, err) ? 0 : 1;
+        }
+        out << line.trimmed() << Qt::endl;
+        return 0;
+    }
+
+    // Without --command, stdin is a stream of JSON-lines requests. Up to a
+    // window of requests is kept in flight; responses are printed as they come.
+    const int window = 64;
+    int outstanding = 0;
+    QFile input;
+    input.open(stdin, QIODevice::ReadOnly);
+    while (!input.atEnd()) {
+        const QByteArray line = input.readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        socket.write(line + '\n');
+        ++outstanding;
+        while (outstanding >= window) {
+            const QByteArray response = readResponseLine(socket);
+            if (response.isEmpty()) return 1;
+            out << response.trimmed() << Qt::endl;
+            --outstanding;
+        }
+    }
+
+    socket.flush();
+    while (outstanding > 0) {
+        const QByteArray response = readResponseLine(socket);
+        if (response.isEmpty()) return 1;
+        out << response.trimmed() << Qt::endl;
+        --outstanding;
+    }
+    return 0;
+}
+
+qint64 parseOffset(const QString &value, bool *ok)
+{
+    // Accepts decimal or 0x-prefixed hex.
+    return value.trimmed().toLongLong(ok, 0);
+}
+
+QString formatDigests(const QVector<HashDigest> &digests, const QString &name)
+{
+    QString lines;
+    for (const HashDigest &d : digests) {
+        lines += QString("%1 (%2) = %3\n").arg(d.algorithm, name, QString::fromLatin1(d.digest.toHex()));
+    }
+    return lines;
+}
+
+int runHash(const QCommandLineParser &parser, QTextStream &out, QTextStream &err)
+{
+    const int algorithms = parser.isSet("algorithms")
+                               ? HashEngine::parseAlgorithms(parser.value("algorithms"))
+                               : int(HashEngine::AllAlgorithms);
+    if (algorithms == 0) {
+        err << "Unknown --algorithms. Use a comma separated list of crc32, md5, sha1, sha256 or all." << Qt::endl;
+        return 1;
+    }
+
+    bool ok = true;
+    const qint64 offset = parser.isSet("offset") ? parseOffset(parser.value("offset"), &ok) : 0;
+    if (!ok || offset < 0) {
+        err << "Invalid --offset." << Qt::endl;
+        return 1;
+    }
+    const qint64 length = parser.isSet("length") ? parseOffset(parser.value("length"), &ok) : -1;
+    if (!ok || (parser.isSet("length") && length < 0)) {
+        err << "Invalid --length." << Qt::endl;
+        return 1;
+    }
+
+    QString report;
+    const QStringList files = parser.values("input-file");
+    if (!files.isEmpty()) {
+        for (const QString &path : files) {
+            QString error;
+            const QVector<HashDigest> digests = HashEngine::hashFile(path, algorithms, offset, length,
+                                                                     HashEngine::Progress(), &error);
+            if (!error.isEmpty()) {
+                err << error << Qt::endl;
+                return 1;
+            }
+            report += formatDigests(digests, path);
+        }
+    } else if (parser.isSet("text")) {
+        const QByteArray bytes = parser.value("text").toUtf8().mid(int(qMin<qint64>(offset, INT_MAX)),
+                                                                   int(qMin<qint64>(length, INT_MAX)));
+        report = formatDigests(HashEngine::hashBytes(bytes, algorithms), "text");
+    } else {
+        // Stream stdin so piped images are never held in memory.
+        QFile input;
+        if (!input.open(stdin, QIODevice::ReadOnly)) {
+            err << "Cannot read stdin." << Qt::endl;
+            return 1;
+        }
+
+        HashEngine engine(algorithms);
+        qint64 skipped = 0;
+        qint64 remaining = length;
+        while (remaining != 0) {
+            QByteArray chunk = input.read(1024 * 1024);
+            if (chunk.isEmpty()) break;
+            if (skipped < offset) {
+                const int skip = int(qMin<qint64>(offset - skipped, chunk.size()));
+                skipped += skip;
+                chunk.remove(0, skip);
+            }
+            if (remaining > 0 && chunk.size() > remaining) chunk.truncate(int(remaining));
+            engine.addData(chunk.constData(), chunk.size());
+            if (remaining > 0) remaining -= chunk.size();
+        }
+        report = formatDigests(engine.results(), "-");
+    }
+
+    report.chop(1);
+    return writeOutput(parser.value("output"), report, out, err) ? 0 : 1;
+}
+
+// Match offsets are into data; base is what data's first byte is at in the
+// input.
+QString formatMatches(const QString &name, const char *data, const QVector<ByteMatch> &matches, qint64 base = 0)
+{
+    const int previewBytes = 32;
+    QString lines;
+    for (const ByteMatch &m : matches) {
+        const QByteArray bytes = QByteArray::fromRawData(data + m.offset, int(qMin<qint64>(m.length, previewBytes)));
+        lines += QString("%1:0x%2:%3%4\n").arg(name).arg(base + m.offset, 8, 16, QLatin1Char('0'))
+                     .arg(QString::fromLatin1(bytes.toHex(' ')), m.length > previewBytes ? "..." : "");
+    }
+    return lines;
+}
+
+// grep over the decompressed contents of a gzip or zlib file, searched in
+// slices as it inflates. The last kGrepOverlap bytes of a slice wait for the
+// next one, so a match of up to that length is found whole wherever it falls.
+constexpr qint64 kGrepSlice = 16 * 1024 * 1024;
+constexpr qint64 kGrepOverlap = 64 * 1024;
+
+bool grepCompressedFile(const QString &path, const ByteRegex &regex, int maxCount, QString *report, bool *matched,
+                        QString *error)
+{
+    QByteArray window;
+    qint64 base = 0;
+    int found = 0;
+    auto searchWindow = [&](bool last) {
+        const qint64 limit = last ? window.size() : window.size() - kGrepOverlap;
+        const QVector<ByteMatch> matches = regex.findAll(window, maxCount < 0 ? -1 : maxCount - found);
+        QVector<ByteMatch> accepted;
+        qint64 keepFrom = limit;
+        for (const ByteMatch &m : matches) {
+            if (m.offset >= limit) break;
+            accepted.append(m);
+            keepFrom = qMax(keepFrom, m.offset + m.length);
+        }
+        *report += formatMatches(path, window.constData(), accepted, base);
+        *matched = *matched || !accepted.isEmpty();
+        found += accepted.size();
+        window.remove(0, int(keepFrom));
+        base += keepFrom;
+        return maxCount < 0 || found < maxCount;
+    };
+
+    const bool completed = GzipIndex::inflateFile(path, [&](const char *data, qint64 size) {
+        window.append(data, int(size));
+        return window.size() < kGrepSlice + kGrepOverlap || searchWindow(false);
+    }, error);
+    if (!error->isEmpty()) return false;
+    if (completed) searchWindow(true);
+    return true;
+}
+
+// One line per match, "name:0xOFFSET:hex bytes". Files are mapped and
+// searched in parallel slices; gzip and zlib files are searched in their
+// decompressed contents. The exit status follows grep: 0 when
+// something matched, 1 when nothing did, 2 on errors.
+int runGrep(const QCommandLineParser &parser, QTextStream &out, QTextStream &err)
+{
+    const QString pattern = parser.value("query");
+    if (pattern.isEmpty()) {
+        err << "Grep command needs --query with a byte pattern." << Qt::endl;
+        return 2;
+    }
+    const ByteRegex regex(pattern.toUtf8(), parser.isSet("ignore-case"));
+    if (!regex.isValid()) {
+        err << "Invalid --query: " << regex.errorString() << Qt::endl;
+        return 2;
+    }
+
+    bool ok = true;
+    const int maxCount = parser.isSet("max-count") ? parser.value("max-count").toInt(&ok) : -1;
+    if (!ok || (parser.isSet("max-count") && maxCount <= 0)) {
+        err << "Invalid --max-count." << Qt::endl;
+        return 2;
+    }
+
+    QString report;
+    bool matched = false;
+    bool failed = false;
+    const QStringList files = parser.values("input-file");
+    if (!files.isEmpty()) {
+        for (const QString &path : files) {
+            if (GzipIndex::isCompressedFile(path)) {
+                QString error;
+                if (!grepCompressedFile(path, regex, maxCount, &report, &matched, &error)) {
+                    err << error << Qt::endl;
+                    failed = true;
+                }
+                continue;
+            }
+
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly)) {
+                err << "Cannot open file: " << path << Qt::endl;
+                failed = true;
+                continue;
+            }
+
+            const qint64 size = file.size();
+            if (uchar *mapped = (size > 0) ? file.map(0, size) : nullptr) {
+                const char *data = reinterpret_cast<const char *>(mapped);
+                const QVector<ByteMatch> matches = regex.findAll(data, size, maxCount);
+                matched = matched || !matches.isEmpty();
+                report += formatMatches(path, data, matches);
+                file.unmap(mapped);
+                continue;
+            }
+
+            // Pipes and filesystems that cannot be mapped.
+            QString error;
+            const QByteArray data = AsyncReader::readFile(path, &error);
+            if (!error.isEmpty()) {
+                err << error << Qt::endl;
+                failed = true;
+                continue;
+            }
+            const QVector<ByteMatch> matches = regex.findAll(data, maxCount);
+            matched = matched || !matches.isEmpty();
+            report += formatMatches(path, data.constData(), matches);
+        }
+    } else {
+        QByteArray data;
+        QString name = "text";
+        if (parser.isSet("text")) {
+            data = parser.value("text").toUtf8();
+        } else {
+            QFile input;
+            if (!input.open(stdin, QIODevice::ReadOnly)) {
+                err << "Cannot read stdin." << Qt::endl;
+                return 2;
+            }
+            data = input.readAll();
+            name = "-";
+        }
+        const QVector<ByteMatch> matches = regex.findAll(data, maxCount);
+        matched = !matches.isEmpty();
+        report = formatMatches(name, data.constData(), matches);
+    }
+
+    report.chop(1);
+    if (!report.isEmpty() && !writeOutput(parser.value("output"), report, out, err)) return 2;
+    if (failed) return 2;
+    return matched ? 0 : 1;
+}
+
+int runCommand(const QCommandLineParser &parser)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.isSet("serve")) {
+        return runServer(parser, out, err);
+    }
+
+    if (parser.isSet("connect")) {
+        return runClient(parser, out, err);
+    }
+
+    const QString command = parser.value("command").trimmed().toLower();
+    if (command.isEmpty()) {
+        err << "Missing --command. Use convert, add, hash or grep." << Qt::endl;
+        return 1;
+    }
+
+    if (command == "convert") {
+        const QString to = parser.value("to").trimmed().toLower();
+        const QString from = parser.value("from").trimmed().toLower();
+
+        if (to.isEmpty()) {
+            err << "Missing --to for convert command. Use: hex, binary, unicode, base64, base64url, base32, ascii85, text."
+                << Qt::endl;
+            return 1;
+        }
+
+        if (to == "text" && from.isEmpty()) {
+            err << "When --to text is selected, --from must be one of: hex, binary, unicode, base64, base64url, base32, ascii85."
+                << Qt::endl;
+            return 1;
+        }
+
+        if (isBatchRequest(parser)) {
+            return runBatchConvert(parser, to, from, out, err);
+        }
+
+        const QByteArray input = readInput(parser.value("text"), parser.value("input-file"), err);
+        if (input.isEmpty() && parser.value("text").isEmpty() && parser.value("input-file").isEmpty()) {
+            err << "No input provided. Use --text or --input-file." << Qt::endl;
+            return 1;
+        }
+
+        QString error;
+        const QByteArray output = TextConverter::convertBytes(input, to, from, &error);
+        if (!error.isEmpty()) {
+            err << error << Qt::endl;
+            return 1;
+        }
+        if (output.isEmpty() && !input.isEmpty()) {
+            err << "Unsupported conversion target: " << to << Qt::endl;
+            return 1;
+        }
+
+        return writeOutputBytes(parser.value("output"), output, to != "text", out, err) ? 0 : 1;
+    }
+
+    if (command == "add") {
+        const QString textValue = parser.value("text");
+        const QString filePath = parser.value("input-file");
+
+        if (textValue.isEmpty() && filePath.isEmpty()) {
+            err << "Add command needs --text or --input-file." << Qt::endl;
+            return 1;
+        }
+
+        QString payload;
+        if (!textValue.isEmpty()) {
+            payload += textValue;
+        }
+
+        if (!filePath.isEmpty()) {
+            QFile file(filePath);
+            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                err << "Cannot open file for add command: " << filePath << Qt::endl;
+                return 1;
+            }
+
+            if (!payload.isEmpty()) {
+                payload += "\n";
+            }
+            payload += QString::fromUtf8(file.readAll());
+        }
+
+        const QString outputPath = parser.value("output");
+        if (outputPath.isEmpty()) {
+            out << payload << Qt::endl;
+            return 0;
+        }
+
+        QFile outputFile(outputPath);
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append)) {
+            err << "Cannot append to output file: " << outputPath << Qt::endl;
+            return 1;
+        }
+
+        outputFile.write(payload.toUtf8());
+        outputFile.write("\n");
+        out << "Added content to: " << outputPath << Qt::endl;
+        return 0;
+    }
+
+    if (command == "hash") {
+        return runHash(parser, out, err);
+    }
+
+    if (command == "grep") {
+        return runGrep(parser, out, err);
+    }
+
+    err << "Unsupported command: " << command << ". Supported commands: convert, add, hash, grep." << Qt::endl;
+    return 1;
+}
+
+}
+
+bool TerminalMode::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        for (const char *flag : { "terminal", "serve", "connect" }) {
+            const char *arg = argv[i];
+            while (*arg == '-') ++arg;
+            if (arg != argv[i] && std::strncmp(arg, flag, std::strlen(flag)) == 0
+                && (arg[std::strlen(flag)] == '\0' || arg[std::strlen(flag)] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TerminalMode::setupParser(QCommandLineParser &parser)
+{
+    parser.setApplicationDescription("Hex Editor GUI + Terminal mode");
+    parser.addHelpOption();
+
+    QCommandLineOption terminalModeOption(
+        "terminal",
+        "Run in terminal mode without opening GUI.");
+    QCommandLineOption commandOption(
+        "command",
+        "Terminal command name: convert | add | hash | grep.",
+        "command");
+    QCommandLineOption textOption(
+        "text",
+        "Inline text input.",
+        "text");
+    QCommandLineOption inputFileOption(
+        "input-file",
+        "Read input from file. Repeat to convert several files in one batch.",
+        "path");
+    QCommandLineOption inputDirOption(
+        "input-dir",
+        "Batch convert every file in a directory.",
+        "dir");
+    QCommandLineOption inputListOption(
+        "input-list",
+        "Batch convert the files listed in a text file, one path per line.",
+        "path");
+    QCommandLineOption recursiveOption(
+        "recursive",
+        "With --input-dir, also convert files in subdirectories.");
+    QCommandLineOption outputDirOption(
+        "output-dir",
+        "Batch output directory. Files found under --input-dir keep their subdirectory here.",
+        "dir");
+    QCommandLineOption outputTemplateOption(
+        "output-template",
+        "Batch output file name: {file} {name} {ext} {dir} {to} {index}. Default {file}.{to}.",
+        "template");
+    QCommandLineOption jobsOption(
+        "jobs",
+        "Number of files converted concurrently in batch mode.",
+        "count");
+    QCommandLineOption outputOption(
+        "output",
+        "Write output to file. For add command this file is appended.",
+        "path");
+    QCommandLineOption toOption(
+        "to",
+        "Convert destination type: hex | binary | unicode | base64 | base64url | base32 | ascii85 | text.",
+        "type");
+    QCommandLineOption fromOption(
+        "from",
+        "Source type when using --to text: hex | binary | unicode | base64 | base64url | base32 | ascii85.",
+        "type");
+    QCommandLineOption queryOption(
+        "query",
+        "Search text for the search and scan requests sent with --connect, or the byte regex for grep.",
+        "text");
+    QCommandLineOption serveOption(
+        "serve",
+        "Run the conversion/search daemon on a local socket (name or path).",
+        "socket");
+    QCommandLineOption connectOption(
+        "connect",
+        "Send the request to a running --serve daemon. Without --command, JSON lines are read from stdin.",
+        "socket");
+    QCommandLineOption threadsOption(
+        "threads",
+        "Worker threads for --serve.",
+        "count");
+    QCommandLineOption maxInFlightOption(
+        "max-in-flight",
+        "Requests queued by --serve before it stops reading from clients.",
+        "count");
+    QCommandLineOption algorithmsOption(
+        "algorithms",
+        "Hash command algorithms: crc32,md5,sha1,sha256 or all (default).",
+        "list");
+    QCommandLineOption offsetOption(
+        "offset",
+        "Hash command: first byte to hash (decimal or 0x hex).",
+        "bytes");
+    QCommandLineOption lengthOption(
+        "length",
+        "Hash command: number of bytes to hash. Default is to the end.",
+        "bytes");
+    QCommandLineOption ignoreCaseOption(
+        "ignore-case",
+        "Grep command: match ASCII letters regardless of case.");
+    QCommandLineOption maxCountOption(
+        "max-count",
+        "Grep command: stop after this many matches per input.",
+        "count");
+    QCommandLineOption traceOption(
+        "trace",
+        "Record hot-path trace events and write them as Chrome trace JSON to path on exit.",
+        "path");
+
+    parser.addOption(terminalModeOption);
+    parser.addOption(commandOption);
+    parser.addOption(textOption);
+    parser.addOption(inputFileOption);
+    parser.addOption(inputDirOption);
+    parser.addOption(inputListOption);
+    parser.addOption(recursiveOption);
+    parser.addOption(outputDirOption);
+    parser.addOption(outputTemplateOption);
+    parser.addOption(jobsOption);
+    parser.addOption(outputOption);
+    parser.addOption(toOption);
+    parser.addOption(fromOption);
+    parser.addOption(queryOption);
+    parser.addOption(serveOption);
+    parser.addOption(connectOption);
+    parser.addOption(threadsOption);
+    parser.addOption(maxInFlightOption);
+    parser.addOption(algorithmsOption);
+    parser.addOption(offsetOption);
+    parser.addOption(lengthOption);
+    parser.addOption(ignoreCaseOption);
+    parser.addOption(maxCountOption);
+    parser.addOption(traceOption);
+}
+
+void TerminalMode::initTrace(const QCommandLineParser &parser)
+{
+    Trace::initFromEnvironment();
+    if (parser.isSet("trace")) {
+        Trace::setEnabled(true);
+    }
+}
+
+void TerminalMode::finishTrace(const QCommandLineParser &parser)
+{
+    exportTrace(traceExportPath(parser));
+}
+
+int TerminalMode::run(const QCommandLineParser &parser)
+{
+    initTrace(parser);
+    const int code = runCommand(parser);
+    finishTrace(parser);
+    return code;
+}
@@ -0,0 +1,16 @@
+#ifndef TERMINALMODE_H
+#define TERMINALMODE_H
+
+#include <QCommandLineParser>
+
+class TerminalMode
+{
+public:
+    static bool isRequested(int argc, char *argv[]);
+    static void setupParser(QCommandLineParser &parser);
+    static void initTrace(const QCommandLineParser &parser);
+    static void finishTrace(const QCommandLineParser &parser);
+    static int run(const QCommandLineParser &parser);
+};
+
+#endif
@@ -0,0 +1,254 @@
+#include "annotationtree.h"
+#include <QTemporaryDir>
+#include <QtTest>
+#include <map>
+#include <random>
+
+namespace {
+
+struct Range {
+    qint64 start;
+    qint64 end;
+};
+
+// The same edits applied to a plain map, one range at a time.
+void insertInModel(std::map<int, Range> *model, qint64 offset, qint64 length)
+{
+    for (auto &entry : *model) {
+        Range &r = entry.second;
+        if (r.start >= offset) {
+            r.start += length;
+            r.end += length;
+        } else if (r.end > offset) {
+            r.end += length;
+        }
+    }
+}
+
+void removeFromModel(std::map<int, Range> *model, qint64 offset, qint64 length)
+{
+    const auto map = [&](qint64 x) { return x <= offset ? x : x >= offset + length ? x - length : offset; };
+    for (auto it = model->begin(); it != model->end();) {
+        it->second.start = map(it->second.start);
+        it->second.end = map(it->second.end);
+        if (it->second.start == it->second.end) it = model->erase(it);
+        else ++it;
+    }
+}
+
+}
+
+class TestAnnotationTree : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void addNormalisesRanges();
+    void overlappingIsHalfOpen();
+    void nextAndPrevious();
+    void insertShiftsAndGrows();
+    void removeShrinksAndDrops();
+    void removeAfterPendingShift();
+    void randomEditsMatchModel();
+    void saveAndLoadRoundTrip();
+};
+
+void TestAnnotationTree::addNormalisesRanges()
+{
+    AnnotationTree tree;
+    const int swapped = tree.add(20, 10);
+    const int empty = tree.add(5, 5);
+    const int negative = tree.add(-4, 3);
+
+    QCOMPARE(tree.annotation(swapped).start, qint64(10));
+    QCOMPARE(tree.annotation(swapped).end, qint64(20));
+    QCOMPARE(tree.annotation(empty).end, qint64(6));
+    QCOMPARE(tree.annotation(negative).start, qint64(0));
+    QCOMPARE(tree.count(), 3);
+    QCOMPARE(tree.annotation(99).id, -1);
+}
+
+void TestAnnotationTree::overlappingIsHalfOpen()
+{
+    AnnotationTree tree;
+    tree.add(10, 20, "a");
+    tree.add(20, 30, "b");
+    tree.add(0, 100, "c");
+
+    QVector<AnnotationTree::Annotation> found = tree.overlapping(20, 21);
+    QCOMPARE(int(found.size()), 2);
+    QCOMPARE(found.at(0).label, QString("c"));
+    QCOMPARE(found.at(1).label, QString("b"));
+
+    found = tree.overlapping(19, 20);
+    QCOMPARE(int(found.size()), 2);
+    QCOMPARE(found.at(1).label, QString("a"));
+
+    QVERIFY(tree.overlapping(15, 15).isEmpty());
+    QVERIFY(tree.overlapping(100, 200).isEmpty());
+}
+
+void TestAnnotationTree::nextAndPrevious()
+{
+    AnnotationTree tree;
+    tree.add(10, 12);
+    tree.add(30, 31);
+
+    QCOMPARE(tree.next(0).start, qint64(10));
+    QCOMPARE(tree.next(10).start, qint64(30));
+    QCOMPARE(tree.next(30).id, -1);
+    QCOMPARE(tree.previous(30).start, qint64(10));
+    QCOMPARE(tree.previous(31).start, qint64(30));
+    QCOMPARE(tree.previous(10).id, -1);
+}
+
+void TestAnnotationTree::insertShiftsAndGrows()
+{
+    AnnotationTree tree;
+    const int before = tree.add(10, 20);
+    const int at = tree.add(20, 30);
+    const int after = tree.add(40, 50);
+
+    tree.insertBytes(20, 5);
+    QCOMPARE(tree.annotation(before).end, qint64(20));
+    QCOMPARE(tree.annotation(at).start, qint64(25));
+    QCOMPARE(tree.annotation(at).end, qint64(35));
+    QCOMPARE(tree.annotation(after).start, qint64(45));
+
+    tree.insertBytes(15, 3);
+    QCOMPARE(tree.annotation(before).start, qint64(10));
+    QCOMPARE(tree.annotation(before).end, qint64(23));
+    QCOMPARE(tree.annotation(after).end, qint64(58));
+}
+
+void TestAnnotationTree::removeShrinksAndDrops()
+{
+    AnnotationTree tree;
+    const int across = tree.add(10, 20);
+    const int inside = tree.add(16, 18);
+    const int tail = tree.add(20, 30);
+    const int after = tree.add(40, 50);
+
+    tree.removeBytes(15, 10);
+    QCOMPARE(tree.count(), 3);
+    QCOMPARE(tree.annotation(inside).id, -1);
+    QCOMPARE(tree.annotation(across).end, qint64(15));
+    QCOMPARE(tree.annotation(tail).start, qint64(15));
+    QCOMPARE(tree.annotation(tail).end, qint64(20));
+    QCOMPARE(tree.annotation(after).start, qint64(30));
+    QCOMPARE(tree.annotation(after).end, qint64(40));
+
+    // The freed id is handed out again.
+    QCOMPARE(tree.add(1, 2), inside);
+}
+
+void TestAnnotationTree::removeAfterPendingShift()
+{
+    AnnotationTree tree;
+    QVector<int> ids;
+    for (int i = 0; i < 64; ++i) ids.append(tree.add(i * 10, i * 10 + 5));
+    tree.insertBytes(200, 1000);
+
+    QVERIFY(tree.remove(ids.at(40)));
+    QVERIFY(!tree.remove(ids.at(40)));
+    QCOMPARE(tree.count(), 63);
+    QCOMPARE(tree.annotation(ids.at(41)).start, qint64(1410));
+    QCOMPARE(tree.annotation(ids.at(19)).start, qint64(190));
+
+    qint64 last = -1;
+    int seen = 0;
+    tree.forEach([&](const AnnotationTree::Annotation &a) {
+        QVERIFY(a.start > last);
+        last = a.start;
+        ++seen;
+    });
+    QCOMPARE(seen, 63);
+}
+
+void TestAnnotationTree::randomEditsMatchModel()
+{
+    std::mt19937 rng(7);
+    AnnotationTree tree;
+    std::map<int, Range> model;
+
+    for (int round = 0; round < 4000; ++round) {
+        const int op = int(rng() % 6);
+        if (op <= 1 || model.size() < 16) {
+            const qint64 start = rng() % 10000;
+            const qint64 end = start + 1 + rng() % 400;
+            const int id = tree.add(start, end);
+            QVERIFY(model.find(id) == model.end());
+            model[id] = Range{ start, end };
+        } else if (op == 2) {
+            auto it = model.begin();
+            std::advance(it, rng() % model.size());
+            QVERIFY(tree.remove(it->first));
+            model.erase(it);
+        } else if (op == 3) {
+            const qint64 offset = rng() % 10000;
+            const qint64 length = 1 + rng() % 200;
+            tree.insertBytes(offset, length);
+            insertInModel(&model, offset, length);
+        } else if (op == 4) {
+            const qint64 offset = rng() % 10000;
+            const qint64 length = 1 + rng() % 200;
+            tree.removeBytes(offset, length);
+            removeFromModel(&model, offset, length);
+        } else {
+            const qint64 begin = rng() % 12000;
+            const qint64 end = begin + 1 + rng() % 300;
+            const QVector<AnnotationTree::Annotation> found = tree.overlapping(begin, end);
+            int expected = 0;
+            for (const auto &entry : model) {
+                if (entry.second.start < end && entry.second.end > begin) ++expected;
+            }
+            QCOMPARE(int(found.size()), expected);
+            for (int i = 0; i < found.size(); ++i) {
+                const Range &r = model.at(found.at(i).id);
+                QCOMPARE(found.at(i).start, r.start);
+                QCOMPARE(found.at(i).end, r.end);
+                if (i > 0) QVERIFY(found.at(i - 1).start <= found.at(i).start);
+            }
+        }
+    }
+
+    QCOMPARE(tree.count(), int(model.size()));
+    for (const auto &entry : model) {
+        const AnnotationTree::Annotation a = tree.annotation(entry.first);
+        QCOMPARE(a.start, entry.second.start);
+        QCOMPARE(a.end, entry.second.end);
+    }
+}
+
+void TestAnnotationTree::saveAndLoadRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = AnnotationTree::sidecarPath(dir.filePath("data.bin"));
+
+    AnnotationTree tree;
+    tree.add(0x10, 0x20, "tab\there\\", 0x3A6EA5);
+    tree.add(5, 6, "line\nbreak");
+    tree.add(1000, 4000);
+    QString error;
+    QVERIFY2(tree.saveToFile(path, &error), qPrintable(error));
+
+    AnnotationTree loaded;
+    QVERIFY2(loaded.addFromFile(path, &error), qPrintable(error));
+    QVector<AnnotationTree::Annotation> all = loaded.overlapping(0, 5000);
+    QCOMPARE(int(all.size()), 3);
+    QCOMPARE(all.at(0).label, QString("line\nbreak"));
+    QCOMPARE(all.at(1).start, qint64(0x10));
+    QCOMPARE(all.at(1).end, qint64(0x20));
+    QCOMPARE(all.at(1).color, quint32(0x3A6EA5));
+    QCOMPARE(all.at(1).label, QString("tab\there\\"));
+    QCOMPARE(all.at(2).label, QString());
+
+    // An empty tree removes the sidecar instead of writing a header only.
+    QVERIFY(AnnotationTree().saveToFile(path, &error));
+    QVERIFY(!QFile::exists(path));
+}
+
+QTEST_APPLESS_MAIN(TestAnnotationTree)
+
+#include "tst_annotationtree.moc"
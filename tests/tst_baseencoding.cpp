@@ -0,0 +1,196 @@
+#include "baseencoding.h"
+#include <QtTest>
+#include <random>
+
+Q_DECLARE_METATYPE(BaseEncoding::Kind)
+
+namespace {
+
+const BaseEncoding::Kind kKinds[] = { BaseEncoding::Base64, BaseEncoding::Base64Url, BaseEncoding::Base32,
+                                      BaseEncoding::Ascii85 };
+
+QByteArray randomBytes(int size, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) data[i] = char(rng());
+    return data;
+}
+
+QByteArray encodeInChunks(const QByteArray &data, BaseEncoding::Kind kind, int chunk)
+{
+    BaseEncoder encoder(kind);
+    QByteArray out;
+    for (int pos = 0; pos < data.size(); pos += chunk) {
+        out += encoder.feed(data.constData() + pos, qMin(chunk, int(data.size()) - pos));
+    }
+    return out + encoder.finish();
+}
+
+QByteArray decodeInChunks(const QByteArray &text, BaseEncoding::Kind kind, int chunk)
+{
+    BaseDecoder decoder(kind);
+    QByteArray out;
+    for (int pos = 0; pos < text.size(); pos += chunk) {
+        out += decoder.feed(text.constData() + pos, qMin(chunk, int(text.size()) - pos));
+    }
+    return out + decoder.finish();
+}
+
+}
+
+class TestBaseEncoding : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void knownVectors_data();
+    void knownVectors();
+    void roundTripsEveryLength();
+    void chunksMatchOneShot();
+    void decoderSkipsNoise_data();
+    void decoderSkipsNoise();
+    void offsetsAgreeWithEncoding();
+    void parsesKindNames();
+};
+
+void TestBaseEncoding::knownVectors_data()
+{
+    QTest::addColumn<BaseEncoding::Kind>("kind");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QByteArray>("encoded");
+
+    // RFC 4648 section 10, and the usual Ascii85 examples.
+    QTest::newRow("base64 empty") << BaseEncoding::Base64 << QByteArray() << QByteArray();
+    QTest::newRow("base64 f") << BaseEncoding::Base64 << QByteArray("f") << QByteArray("Zg==");
+    QTest::newRow("base64 fo") << BaseEncoding::Base64 << QByteArray("fo") << QByteArray("Zm8=");
+    QTest::newRow("base64 foobar") << BaseEncoding::Base64 << QByteArray("foobar") << QByteArray("Zm9vYmFy");
+    QTest::newRow("base64 high bits") << BaseEncoding::Base64 << QByteArray("\xfb\xff\xfe") << QByteArray("+//+");
+    QTest::newRow("base64url high bits") << BaseEncoding::Base64Url << QByteArray("\xfb\xff\xfe")
+                                         << QByteArray("-__-");
+    QTest::newRow("base32 f") << BaseEncoding::Base32 << QByteArray("f") << QByteArray("MY======");
+    QTest::newRow("base32 foob") << BaseEncoding::Base32 << QByteArray("foob") << QByteArray("MZXW6YQ=");
+    QTest::newRow("base32 foobar") << BaseEncoding::Base32 << QByteArray("foobar") << QByteArray("MZXW6YTBOI======");
+    QTest::newRow("ascii85 Man") << BaseEncoding::Ascii85 << QByteArray("Man ") << QByteArray("9jqo^");
+    QTest::newRow("ascii85 short") << BaseEncoding::Ascii85 << QByteArray("Ma") << QByteArray("9jn");
+    QTest::newRow("ascii85 zeros") << BaseEncoding::Ascii85 << QByteArray(4, '\0') << QByteArray("!!!!!");
+    QTest::newRow("ascii85 ones") << BaseEncoding::Ascii85 << QByteArray(4, '\xff') << QByteArray("s8W-!");
+}
+
+void TestBaseEncoding::knownVectors()
+{
+    QFETCH(BaseEncoding::Kind, kind);
+    QFETCH(QByteArray, data);
+    QFETCH(QByteArray, encoded);
+
+    QCOMPARE(BaseEncoding::encode(data, kind), encoded);
+    QCOMPARE(BaseEncoding::decode(encoded, kind), data);
+}
+
+// Lengths around the 12-byte / 16-character SSSE3 blocks, so every tail
+// after the vector loop is covered.
+void TestBaseEncoding::roundTripsEveryLength()
+{
+    for (const BaseEncoding::Kind kind : kKinds) {
+        for (int length = 0; length <= 64; ++length) {
+            const QByteArray data = randomBytes(length, quint32(length));
+            const QByteArray encoded = BaseEncoding::encode(data, kind);
+            QCOMPARE(qint64(encoded.size()), BaseEncoding::encodedSize(length, kind));
+            QCOMPARE(BaseEncoding::decode(encoded, kind), data);
+        }
+    }
+}
+
+void TestBaseEncoding::chunksMatchOneShot()
+{
+    const QByteArray data = randomBytes(1000, 9);
+    for (const BaseEncoding::Kind kind : kKinds) {
+        const QByteArray encoded = BaseEncoding::encode(data, kind);
+        for (const int chunk : { 1, 2, 3, 4, 5, 7, 13, 16, 17, 1000 }) {
+            QCOMPARE(encodeInChunks(data, kind, chunk), encoded);
+            QCOMPARE(decodeInChunks(encoded, kind, chunk), data);
+        }
+    }
+}
+
+void TestBaseEncoding::decoderSkipsNoise_data()
+{
+    QTest::addColumn<BaseEncoding::Kind>("kind");
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<QByteArray>("expected");
+
+    const QByteArray data = randomBytes(100, 10);
+    QByteArray lines;
+    const QByteArray base64 = BaseEncoding::encode(data, BaseEncoding::Base64);
+    for (int i = 0; i < base64.size(); i += 20) lines += base64.mid(i, 20) + "\r\n";
+    QTest::newRow("base64 lines") << BaseEncoding::Base64 << lines << data;
+    QTest::newRow("base64 spaces in blocks") << BaseEncoding::Base64 << QByteArray("Zm9v YmFy Zm9v YmFy Zm9v YmFy")
+                                             << QByteArray("foobarfoobarfoobar");
+    QTest::newRow("base64 url alphabet") << BaseEncoding::Base64 << QByteArray("-__-") << QByteArray("\xfb\xff\xfe");
+    QTest::newRow("base64url standard alphabet") << BaseEncoding::Base64Url << QByteArray("+//+")
+                                                 << QByteArray("\xfb\xff\xfe");
+    QTest::newRow("base64 unpadded") << BaseEncoding::Base64 << QByteArray("Zm8") << QByteArray("fo");
+    QTest::newRow("base32 lowercase") << BaseEncoding::Base32 << QByteArray("mzxw6ytboi======")
+                                      << QByteArray("foobar");
+    QTest::newRow("ascii85 delimiters") << BaseEncoding::Ascii85 << QByteArray("  <~9jqo^~>") << QByteArray("Man ");
+    QTest::newRow("ascii85 z") << BaseEncoding::Ascii85 << QByteArray("<~z9jqo^z~>")
+                               << QByteArray(4, '\0') + "Man " + QByteArray(4, '\0');
+    QTest::newRow("ascii85 after end") << BaseEncoding::Ascii85 << QByteArray("9jqo^~>9jqo^") << QByteArray("Man ");
+    QTest::newRow("ascii85 line breaks") << BaseEncoding::Ascii85 << QByteArray("9jq\no^\n9j\nn") << QByteArray("Man Ma");
+    QTest::newRow("ascii85 lone angle") << BaseEncoding::Ascii85 << QByteArray("<") << QByteArray();
+}
+
+void TestBaseEncoding::decoderSkipsNoise()
+{
+    QFETCH(BaseEncoding::Kind, kind);
+    QFETCH(QByteArray, text);
+    QFETCH(QByteArray, expected);
+
+    QCOMPARE(BaseEncoding::decode(text, kind), expected);
+    QCOMPARE(decodeInChunks(text, kind, 1), expected);
+}
+
+void TestBaseEncoding::offsetsAgreeWithEncoding()
+{
+    for (const BaseEncoding::Kind kind : kKinds) {
+        const int group = BaseEncoding::groupBytes(kind);
+        const int chars = BaseEncoding::groupChars(kind);
+        for (qint64 byte = 0; byte <= 4 * group; ++byte) {
+            // The unpadded characters of byte bytes end where the rounded-up
+            // offset says.
+            QByteArray encoded = BaseEncoding::encode(QByteArray(int(byte), 'x'), kind);
+            while (encoded.endsWith('=')) encoded.chop(1);
+            QCOMPARE(BaseEncoding::charOffset(byte, kind, true), qint64(encoded.size()));
+
+            const qint64 first = BaseEncoding::charOffset(byte, kind);
+            QVERIFY(BaseEncoding::byteOffset(first, kind) <= byte);
+            QVERIFY(first <= BaseEncoding::charOffset(byte, kind, true));
+            if (byte % group == 0) {
+                QCOMPARE(first, byte / group * chars);
+                QCOMPARE(BaseEncoding::byteOffset(first, kind), byte);
+            }
+        }
+        for (qint64 c = 0; c <= 4 * chars; ++c) {
+            QVERIFY(BaseEncoding::charOffset(BaseEncoding::byteOffset(c, kind), kind) <= c);
+        }
+    }
+}
+
+void TestBaseEncoding::parsesKindNames()
+{
+    for (const BaseEncoding::Kind kind : kKinds) {
+        BaseEncoding::Kind parsed = BaseEncoding::Base64;
+        QVERIFY(BaseEncoding::parseKind(BaseEncoding::kindName(kind), &parsed));
+        QCOMPARE(parsed, kind);
+    }
+
+    BaseEncoding::Kind parsed = BaseEncoding::Base64;
+    QVERIFY(BaseEncoding::parseKind(" Base85 ", &parsed));
+    QCOMPARE(parsed, BaseEncoding::Ascii85);
+    QVERIFY(!BaseEncoding::parseKind("base16", &parsed));
+    QCOMPARE(parsed, BaseEncoding::Ascii85);
+}
+
+QTEST_APPLESS_MAIN(TestBaseEncoding)
+
+#include "tst_baseencoding.moc"
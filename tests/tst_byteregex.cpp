@@ -0,0 +1,150 @@
+#include "byteregex.h"
+#include <QtTest>
+#include <climits>
+#include <random>
+
+namespace {
+
+// Enough for several parallel slices on any machine with more than one core.
+constexpr int kParallelSize = 24 * 1024 * 1024;
+
+QByteArray randomBytes(int size, const QByteArray &alphabet, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) data[i] = alphabet.at(int(rng() % uint(alphabet.size())));
+    return data;
+}
+
+QString describe(const QVector<ByteMatch> &matches)
+{
+    QStringList parts;
+    for (const ByteMatch &m : matches) parts << QString("%1+%2").arg(m.offset).arg(m.length);
+    return parts.join(' ');
+}
+
+}
+
+class TestByteRegex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matches_data();
+    void matches();
+    void rejectsBadPatterns_data();
+    void rejectsBadPatterns();
+    void stopsAtMaxMatches();
+    void parallelSlicesAgreeWithOneScan_data();
+    void parallelSlicesAgreeWithOneScan();
+    void matchSpanningEverySlice();
+};
+
+void TestByteRegex::matches_data()
+{
+    QTest::addColumn<QByteArray>("pattern");
+    QTest::addColumn<bool>("caseInsensitive");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("literal") << QByteArray("ab+") << false << QByteArray("xabbbyab") << QString("1+4 6+2");
+    QTest::newRow("hex escapes") << QByteArray("\\x00\\xFF") << false << QByteArray("a\x00\xff\xff", 4) << QString("1+2");
+    QTest::newRow("case") << QByteArray("abc") << true << QByteArray("xABcx") << QString("1+3");
+    QTest::newRow("dot takes newline") << QByteArray("a.b") << false << QByteArray("a\nb") << QString("0+3");
+    QTest::newRow("lazy") << QByteArray("a.*?b") << false << QByteArray("aXbYb") << QString("0+3");
+    QTest::newRow("greedy") << QByteArray("a.*b") << false << QByteArray("aXbYb") << QString("0+5");
+    QTest::newRow("leftmost first") << QByteArray("ab|abc") << false << QByteArray("abc") << QString("0+2");
+    QTest::newRow("counted") << QByteArray("a{2,3}") << false << QByteArray("aaaaaaa") << QString("0+3 3+3");
+    QTest::newRow("digits") << QByteArray("\\d+") << false << QByteArray("ab123c45") << QString("2+3 6+2");
+    QTest::newRow("class") << QByteArray("[^a-c]+") << false << QByteArray("abXYcZ") << QString("2+2 5+1");
+    QTest::newRow("none") << QByteArray("zz") << false << QByteArray("abc") << QString("");
+}
+
+void TestByteRegex::matches()
+{
+    QFETCH(QByteArray, pattern);
+    QFETCH(bool, caseInsensitive);
+    QFETCH(QByteArray, data);
+    QFETCH(QString, expected);
+
+    const ByteRegex regex(pattern, caseInsensitive);
+    QVERIFY2(regex.isValid(), qPrintable(regex.errorString()));
+    QCOMPARE(describe(regex.findAll(data)), expected);
+}
+
+void TestByteRegex::rejectsBadPatterns_data()
+{
+    QTest::addColumn<QByteArray>("pattern");
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("matches empty") << QByteArray("a*");
+    QTest::newRow("unclosed group") << QByteArray("(ab");
+    QTest::newRow("unclosed class") << QByteArray("[ab");
+    QTest::newRow("repeat too large") << QByteArray("a{5000}");
+}
+
+void TestByteRegex::rejectsBadPatterns()
+{
+    QFETCH(QByteArray, pattern);
+    const ByteRegex regex(pattern);
+    QVERIFY(!regex.isValid());
+    QVERIFY(!regex.errorString().isEmpty());
+    QVERIFY(regex.findAll(QByteArray("aaa")).isEmpty());
+}
+
+void TestByteRegex::stopsAtMaxMatches()
+{
+    const ByteRegex regex("a");
+    QCOMPARE(int(regex.findAll(QByteArray("aaaa"), 2).size()), 2);
+    QVERIFY(regex.findAll(QByteArray("aaaa"), 0).isEmpty());
+}
+
+// A match limit keeps findAll on one thread, which gives the reference.
+void TestByteRegex::parallelSlicesAgreeWithOneScan_data()
+{
+    QTest::addColumn<QByteArray>("pattern");
+    QTest::addColumn<bool>("caseInsensitive");
+    QTest::addColumn<QByteArray>("alphabet");
+
+    QTest::newRow("short matches") << QByteArray("a[ac]*b") << false << QByteArray("abc");
+    QTest::newRow("lazy") << QByteArray("q.*?q") << false << QByteArray("qrstuvwxyz");
+    QTest::newRow("counted") << QByteArray("ab{2,5}c") << true << QByteArray("aAbBcC");
+    // y is rare, so most matches run for thousands of bytes.
+    QTest::newRow("long matches") << QByteArray("x[^y]*y") << false
+                                  << QByteArray("abcdefghijklmnopqrstuvwx").repeated(400) + "y";
+}
+
+void TestByteRegex::parallelSlicesAgreeWithOneScan()
+{
+    QFETCH(QByteArray, pattern);
+    QFETCH(bool, caseInsensitive);
+    QFETCH(QByteArray, alphabet);
+
+    const ByteRegex regex(pattern, caseInsensitive);
+    QVERIFY2(regex.isValid(), qPrintable(regex.errorString()));
+    const QByteArray data = randomBytes(kParallelSize, alphabet, 11);
+
+    const QVector<ByteMatch> parallel = regex.findAll(data);
+    const QVector<ByteMatch> single = regex.findAll(data, INT_MAX);
+    QVERIFY(!single.isEmpty());
+    QCOMPARE(parallel.size(), single.size());
+    for (int i = 0; i < single.size(); ++i) {
+        QCOMPARE(parallel.at(i).offset, single.at(i).offset);
+        QCOMPARE(parallel.at(i).length, single.at(i).length);
+    }
+}
+
+void TestByteRegex::matchSpanningEverySlice()
+{
+    QByteArray data = randomBytes(kParallelSize, "abc", 12);
+    data[0] = 'S';
+    data[data.size() - 1] = 'E';
+
+    const QVector<ByteMatch> found = ByteRegex("S[^E]*E").findAll(data);
+    QCOMPARE(int(found.size()), 1);
+    QCOMPARE(found.at(0).offset, qint64(0));
+    QCOMPARE(found.at(0).length, qint64(data.size()));
+}
+
+QTEST_APPLESS_MAIN(TestByteRegex)
+
+#include "tst_byteregex.moc"
@@ -0,0 +1,222 @@
+#include "gzipindex.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <cstring>
+#include <random>
+
+#ifdef HEXEDITOR_QT_ZLIB
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr int kGzipWindowBits = 15 + 16;
+constexpr int kZlibWindowBits = 15;
+constexpr qint64 kSpan = 64 * 1024;
+
+// Text with runs of random bytes, so deflate emits many blocks of mixed
+// sizes.
+QByteArray sampleData(int size, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    QByteArray data;
+    data.reserve(size + 256);
+    while (data.size() < size) {
+        if (rng() % 8 == 0) {
+            for (int i = 0; i < 64; ++i) data.append(char(rng()));
+        } else {
+            data.append("line " + QByteArray::number(data.size()) + " of fairly compressible text\n");
+        }
+    }
+    data.resize(size);
+    return data;
+}
+
+QByteArray compress(const QByteArray &data, int windowBits)
+{
+    z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+    }
+    QByteArray out(int(deflateBound(&z, uLong(data.size()))), Qt::Uninitialized);
+    z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    z.avail_in = uInt(data.size());
+    z.next_out = reinterpret_cast<Bytef *>(out.data());
+    z.avail_out = uInt(out.size());
+    const int ret = deflate(&z, Z_FINISH);
+    out.resize(int(z.total_out));
+    deflateEnd(&z);
+    return ret == Z_STREAM_END ? out : QByteArray();
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+}
+
+class TestGzipIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsMatchAtEveryOffset_data();
+    void readsMatchAtEveryOffset();
+    void readAcrossMembers();
+    void clampsReadsToTheEnd();
+    void inflateFileStreamsEverything();
+    void detectsCompressedFiles();
+    void rejectsTruncatedFiles();
+    void progressCancelsTheBuild();
+
+private:
+    QTemporaryDir dir;
+};
+
+void TestGzipIndex::readsMatchAtEveryOffset_data()
+{
+    QTest::addColumn<int>("windowBits");
+    QTest::newRow("gzip") << kGzipWindowBits;
+    QTest::newRow("zlib") << kZlibWindowBits;
+}
+
+void TestGzipIndex::readsMatchAtEveryOffset()
+{
+    QFETCH(int, windowBits);
+    const QByteArray data = sampleData(2 * 1024 * 1024, 1);
+    const QString path = dir.filePath("single");
+    QVERIFY(writeFile(path, compress(data, windowBits)));
+
+    GzipIndex index;
+    QString error;
+    QVERIFY2(index.build(path, kSpan, GzipIndex::Progress(), &error), qPrintable(error));
+    QCOMPARE(index.size(), qint64(data.size()));
+    // One checkpoint per member header plus the ones at block boundaries.
+    QVERIFY(index.checkpointCount() > 2);
+
+    // Offsets step by a little less than the span, so reads start just
+    // before, on and after checkpoints and cross several of them.
+    for (qint64 offset = 0; offset < data.size(); offset += kSpan - 4093) {
+        const QByteArray got = index.read(offset, 3 * kSpan, &error);
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+        QCOMPARE(got, data.mid(int(offset), int(3 * kSpan)));
+    }
+    QCOMPARE(index.read(0, data.size()), data);
+}
+
+void TestGzipIndex::readAcrossMembers()
+{
+    const QByteArray first = sampleData(300 * 1024, 2);
+    const QByteArray second = sampleData(200 * 1024, 3);
+    // Zero padding after the last member is ignored, as gzip -d does.
+    const QString path = dir.filePath("members.gz");
+    QVERIFY(writeFile(path, compress(first, kGzipWindowBits) + compress(second, kGzipWindowBits)
+                      + QByteArray(512, '\0')));
+
+    GzipIndex index;
+    QString error;
+    QVERIFY2(index.build(path, kSpan, GzipIndex::Progress(), &error), qPrintable(error));
+    const QByteArray data = first + second;
+    QCOMPARE(index.size(), qint64(data.size()));
+
+    const qint64 seam = first.size();
+    for (const qint64 offset : { seam - 100000, seam - 1, seam, seam + 1 }) {
+        QCOMPARE(index.read(offset, 150000, &error), data.mid(int(offset), 150000));
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+    }
+}
+
+void TestGzipIndex::clampsReadsToTheEnd()
+{
+    const QByteArray data = sampleData(100 * 1024, 4);
+    const QString path = dir.filePath("short.gz");
+    QVERIFY(writeFile(path, compress(data, kGzipWindowBits)));
+
+    GzipIndex index;
+    QVERIFY(index.build(path, kSpan));
+    QCOMPARE(index.read(data.size() - 10, 100), data.right(10));
+    QVERIFY(index.read(data.size(), 1).isEmpty());
+    QVERIFY(index.read(-1, 10).isEmpty());
+    QVERIFY(index.read(0, 0).isEmpty());
+}
+
+void TestGzipIndex::inflateFileStreamsEverything()
+{
+    const QByteArray data = sampleData(700 * 1024, 5);
+    const QString path = dir.filePath("stream.gz");
+    QVERIFY(writeFile(path, compress(data, kGzipWindowBits)));
+
+    QByteArray out;
+    QString error;
+    QVERIFY2(GzipIndex::inflateFile(path, [&](const char *chunk, qint64 size) {
+        out.append(chunk, int(size));
+        return true;
+    }, &error), qPrintable(error));
+    QCOMPARE(out, data);
+
+    // A sink that stops ends the pass early.
+    int calls = 0;
+    QVERIFY(!GzipIndex::inflateFile(path, [&](const char *, qint64) { return ++calls < 2; }));
+    QCOMPARE(calls, 2);
+}
+
+void TestGzipIndex::detectsCompressedFiles()
+{
+    const QByteArray data = sampleData(10 * 1024, 6);
+    const QString gzip = dir.filePath("detect.gz");
+    const QString zlib = dir.filePath("detect.z");
+    const QString plain = dir.filePath("detect.txt");
+    QVERIFY(writeFile(gzip, compress(data, kGzipWindowBits)));
+    QVERIFY(writeFile(zlib, compress(data, kZlibWindowBits)));
+    QVERIFY(writeFile(plain, data));
+
+    QVERIFY(GzipIndex::isCompressedFile(gzip));
+    QVERIFY(GzipIndex::isCompressedFile(zlib));
+    QVERIFY(!GzipIndex::isCompressedFile(plain));
+    // A zlib-looking header followed by garbage.
+    QVERIFY(writeFile(plain, QByteArray("\x78\x9c", 2) + QByteArray(64, '\xff')));
+    QVERIFY(!GzipIndex::isCompressedFile(plain));
+}
+
+void TestGzipIndex::rejectsTruncatedFiles()
+{
+    const QByteArray compressed = compress(sampleData(200 * 1024, 7), kGzipWindowBits);
+    const QString path = dir.filePath("truncated.gz");
+    QVERIFY(writeFile(path, compressed.left(compressed.size() / 2)));
+
+    GzipIndex index;
+    QString error;
+    QVERIFY(!index.build(path, kSpan, GzipIndex::Progress(), &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!index.isValid());
+    QCOMPARE(index.size(), qint64(0));
+}
+
+void TestGzipIndex::progressCancelsTheBuild()
+{
+    const QByteArray data = sampleData(3 * 1024 * 1024, 8);
+    const QString path = dir.filePath("cancel.gz");
+    const QByteArray compressed = compress(data, kGzipWindowBits);
+    QVERIFY(writeFile(path, compressed));
+
+    GzipIndex index;
+    qint64 lastDone = -1;
+    QVERIFY(index.build(path, kSpan, [&](qint64 done, qint64 total) {
+        lastDone = done;
+        return total == compressed.size();
+    }));
+    QCOMPARE(lastDone, qint64(compressed.size()));
+
+    QVERIFY(!index.build(path, kSpan, [](qint64, qint64) { return false; }));
+    QVERIFY(!index.isValid());
+}
+
+QTEST_APPLESS_MAIN(TestGzipIndex)
+
+#include "tst_gzipindex.moc"
@@ -0,0 +1,124 @@
+#include "hashengine.h"
+#include <QtTest>
+#include <random>
+
+namespace {
+
+QByteArray pattern(int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) data[i] = char(i * 7 + i / 256);
+    return data;
+}
+
+QStringList hexDigests(const QVector<HashDigest> &digests)
+{
+    QStringList hex;
+    for (const HashDigest &d : digests) hex << d.algorithm + ' ' + QString::fromLatin1(d.digest.toHex());
+    return hex;
+}
+
+// Fed in pieces of 1 to 130 bytes, so the SHA block buffer fills from every
+// position.
+QVector<HashDigest> hashInPieces(const QByteArray &data)
+{
+    HashEngine engine;
+    std::mt19937 rng(3);
+    for (int pos = 0; pos < data.size();) {
+        const int n = qMin(int(1 + rng() % 130), int(data.size()) - pos);
+        engine.addData(data.constData() + pos, n);
+        pos += n;
+    }
+    return engine.results();
+}
+
+}
+
+// Every case runs twice: with the PCLMULQDQ and SHA extension paths when the
+// CPU has them, and with the portable code.
+class TestHashEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void knownAnswers_data();
+    void knownAnswers();
+    void crc32MatchesPortableAtEveryLength();
+};
+
+void TestHashEngine::cleanup()
+{
+    HashEngine::setHardwareEnabled(true);
+}
+
+void TestHashEngine::knownAnswers_data()
+{
+    QTest::addColumn<bool>("hardware");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QStringList>("expected");
+
+    const QByteArray two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    for (const bool hardware : { true, false }) {
+        const char *path = hardware ? "dispatched" : "portable";
+        QTest::addRow("%s empty", path) << hardware << QByteArray() << QStringList{
+            "CRC32 00000000", "MD5 d41d8cd98f00b204e9800998ecf8427e",
+            "SHA-1 da39a3ee5e6b4b0d3255bfef95601890afd80709",
+            "SHA-256 e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" };
+        QTest::addRow("%s abc", path) << hardware << QByteArray("abc") << QStringList{
+            "CRC32 352441c2", "MD5 900150983cd24fb0d6963f7d28e17f72",
+            "SHA-1 a9993e364706816aba3e25717850c26c9cd0d89d",
+            "SHA-256 ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" };
+        QTest::addRow("%s two blocks", path) << hardware << two << QStringList{
+            "CRC32 171a3f5f", "MD5 8215ef0796a20bcaaae116d3876c664a",
+            "SHA-1 84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+            "SHA-256 248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" };
+        QTest::addRow("%s 1 MiB", path) << hardware << pattern(1024 * 1024) << QStringList{
+            "CRC32 a2dcf263", "MD5 85bfb9943e6f0cb09f0f52679e9eac2b",
+            "SHA-1 a7ccc30ac12dc8d83d6f612100bc4fc6ed0c5a12",
+            "SHA-256 1f8647d4cd2f7594c35c413e582e01089c00929dd4239eddd5ded3d40f325d53" };
+    }
+}
+
+void TestHashEngine::knownAnswers()
+{
+    QFETCH(bool, hardware);
+    QFETCH(QByteArray, data);
+    QFETCH(QStringList, expected);
+
+    HashEngine::setHardwareEnabled(hardware);
+    if (!hardware) {
+        QVERIFY(!HashEngine::hasHardwareCrc32());
+        QVERIFY(!HashEngine::hasHardwareSha());
+    }
+    QCOMPARE(hexDigests(HashEngine::hashBytes(data, HashEngine::AllAlgorithms)), expected);
+    QCOMPARE(hexDigests(hashInPieces(data)), expected);
+}
+
+// The folding loop takes 16-byte multiples of 64 bytes or more; lengths and
+// start offsets around that cover every tail the portable code finishes.
+void TestHashEngine::crc32MatchesPortableAtEveryLength()
+{
+    if (!HashEngine::hasHardwareCrc32()) QSKIP("CPU without PCLMULQDQ");
+    const QByteArray data = pattern(4096);
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    for (int start = 0; start < 16; ++start) {
+        for (int length = 0; length <= 300; ++length) {
+            HashEngine::setHardwareEnabled(true);
+            const quint32 dispatched = HashEngine::crc32(0, bytes + start, length);
+            HashEngine::setHardwareEnabled(false);
+            const quint32 portable = HashEngine::crc32(0, bytes + start, length);
+            if (dispatched != portable) {
+                QFAIL(qPrintable(QString("start %1, length %2: %3 != %4").arg(start).arg(length)
+                                     .arg(dispatched, 8, 16, QChar('0')).arg(portable, 8, 16, QChar('0'))));
+            }
+        }
+    }
+    HashEngine::setHardwareEnabled(true);
+    QCOMPARE(HashEngine::crc32(HashEngine::crc32(0, bytes, 1000), bytes + 1000, 3096),
+             HashEngine::crc32(0, bytes, 4096));
+}
+
+QTEST_APPLESS_MAIN(TestHashEngine)
+
+#include "tst_hashengine.moc"
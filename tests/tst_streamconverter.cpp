@@ -0,0 +1,150 @@
+#include "streamconverter.h"
+#include "textconverter.h"
+#include <QtTest>
+#include <random>
+
+namespace {
+
+// Every byte value, then random ones.
+QByteArray sampleBytes()
+{
+    QByteArray data;
+    for (int i = 0; i < 256; ++i) data.append(char(i));
+    std::mt19937 rng(3);
+    for (int i = 0; i < 5000; ++i) data.append(char(rng()));
+    return data;
+}
+
+// One- to four-byte UTF-8 sequences, so chunks split every kind.
+QByteArray sampleText()
+{
+    QByteArray line = "plain ASCII, \xC3\xA9 \xC3\xBC, \xE2\x82\xAC \xE2\x9C\x93, \xF0\x9F\x98\x80 \xF0\x9F\x8E\x89 "
+                      "and a \\ backslash\n";
+    return line.repeated(40) + "end";
+}
+
+// Feeds data in pieces of chunk bytes, or of pseudo-random sizes for 0.
+QByteArray convertInChunks(const QString &to, const QString &from, const QByteArray &data, int chunk)
+{
+    StreamConverter converter(to, from);
+    std::mt19937 rng(11);
+    QByteArray out;
+    for (int pos = 0; pos < data.size();) {
+        const int size = chunk > 0 ? chunk : int(1 + rng() % 17);
+        out += converter.feed(data.mid(pos, size));
+        pos += size;
+    }
+    out += converter.finish();
+    return out;
+}
+
+}
+
+class TestStreamConverter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void chunksMatchWholeInput_data();
+    void chunksMatchWholeInput();
+    void oddHexMatchesFromHex_data();
+    void oddHexMatchesFromHex();
+    void rejectsUnknownFormats();
+    void emptyInputGivesNothing();
+};
+
+void TestStreamConverter::chunksMatchWholeInput_data()
+{
+    QTest::addColumn<QString>("to");
+    QTest::addColumn<QString>("from");
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<QByteArray>("expected");
+
+    const QByteArray bytes = sampleBytes();
+    const QByteArray text = sampleText();
+    for (const char *format : { "hex", "binary", "base64", "base64url", "base32", "ascii85" }) {
+        const QByteArray encoded = TextConverter::convertBytes(bytes, format);
+        QTest::addRow("to %s", format) << QString(format) << QString() << bytes << encoded;
+        QTest::addRow("from %s", format) << QString("text") << QString(format) << encoded << bytes;
+    }
+
+    QByteArray hexLines = TextConverter::convertBytes(bytes, "hex");
+    hexLines.replace(' ', '\n');
+    QTest::newRow("from hex lines") << QString("text") << QString("hex") << hexLines << bytes;
+
+    QByteArray base64Lines;
+    const QByteArray base64 = TextConverter::convertBytes(bytes, "base64");
+    for (int i = 0; i < base64.size(); i += 76) base64Lines += base64.mid(i, 76) + "\r\n";
+    QTest::newRow("from base64 lines") << QString("text") << QString("base64") << base64Lines << bytes;
+
+    QTest::newRow("to unicode") << QString("unicode") << QString() << text
+                                << TextConverter::convertBytes(text, "unicode");
+    // Long escapes, an unpaired surrogate and a backslash that starts none.
+    QTest::newRow("from unicode") << QString("text") << QString("unicode")
+                                  << TextConverter::convertBytes(text, "unicode") + "\\U0001F600 \\ud800x \\ plain"
+                                  << text + "\xF0\x9F\x98\x80 \xEF\xBF\xBDx \\ plain";
+    QTest::newRow("passthrough") << QString("text") << QString() << bytes << bytes;
+}
+
+void TestStreamConverter::chunksMatchWholeInput()
+{
+    QFETCH(QString, to);
+    QFETCH(QString, from);
+    QFETCH(QByteArray, input);
+    QFETCH(QByteArray, expected);
+
+    QCOMPARE(TextConverter::convertBytes(input, to, from), expected);
+    for (const int chunk : { 1, 2, 3, 5, 7, 13, 64, 4096, 0 }) {
+        QCOMPARE(convertInChunks(to, from, input, chunk), expected);
+    }
+}
+
+void TestStreamConverter::oddHexMatchesFromHex_data()
+{
+    QTest::addColumn<QByteArray>("input");
+
+    QTest::newRow("one digit") << QByteArray("a");
+    QTest::newRow("trailing digit") << QByteArray("41 62 6");
+    QTest::newRow("split pairs") << QByteArray("4 16 26 3");
+    QTest::newRow("noise between") << QByteArray("\n41\nzz6g2\n7");
+
+    std::mt19937 rng(13);
+    QByteArray digits;
+    for (int i = 0; i < 4001; ++i) {
+        digits.append("0123456789abcdefABCDEF"[rng() % 22]);
+        if (rng() % 7 == 0) digits.append(rng() % 2 ? ' ' : '\n');
+    }
+    QTest::newRow("random") << digits;
+}
+
+// Chunks end anywhere, also between the digits of a pair; the last, unpaired
+// digit comes out as a byte of its own as it does for the whole text.
+void TestStreamConverter::oddHexMatchesFromHex()
+{
+    QFETCH(QByteArray, input);
+
+    const QString whole = TextConverter::fromHex(QString::fromLatin1(input));
+    for (const int chunk : { 1, 2, 3, 5, 64, 0 }) {
+        QCOMPARE(QString::fromUtf8(convertInChunks("text", "hex", input, chunk)), whole);
+    }
+}
+
+void TestStreamConverter::rejectsUnknownFormats()
+{
+    QVERIFY(!StreamConverter("octal", QString()).isValid());
+    QVERIFY(StreamConverter("text", QString()).isValid());
+    QVERIFY(StreamConverter("text", "base32").isValid());
+}
+
+void TestStreamConverter::emptyInputGivesNothing()
+{
+    for (const char *format : { "hex", "binary", "unicode", "base64", "ascii85" }) {
+        StreamConverter converter(format, QString());
+        QVERIFY(converter.feed(QByteArray()).isEmpty());
+        QVERIFY(converter.finish().isEmpty());
+    }
+}
+
+QTEST_APPLESS_MAIN(TestStreamConverter)
+
+#include "tst_streamconverter.moc"
@@ -0,0 +1,154 @@
+#include "structtemplate.h"
+#include <QtTest>
+#include <climits>
+
+namespace {
+
+QByteArray le64(qint64 value)
+{
+    QByteArray bytes(8, '\0');
+    for (int i = 0; i < 8; ++i) bytes[i] = char(quint64(value) >> (8 * i));
+    return bytes;
+}
+
+std::shared_ptr<const StructTemplate> parse(const QString &source)
+{
+    QString error;
+    std::shared_ptr<const StructTemplate> tmpl = StructTemplate::parse(source, &error);
+    if (!tmpl) qWarning("%s", qPrintable(error));
+    return tmpl;
+}
+
+}
+
+class TestStructTemplate : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void decodesFixedLayout();
+    void countArithmetic_data();
+    void countArithmetic();
+    void offsetOverflowIsAProblem();
+    void arraySizeOverflowIsAProblem();
+    void constantOverflowIsAProblem();
+};
+
+void TestStructTemplate::decodesFixedLayout()
+{
+    const auto tmpl = parse("struct File { u32 count; Rec[count] records }\n"
+                            "struct Rec { u16 id; u8 flags; u8 pad }");
+    QVERIFY(tmpl);
+    StructTree tree(tmpl, QByteArray("\x02\x00\x00\x00\x01\x00\x07\x00\x02\x00\x09\x00", 12));
+
+    StructNode *records = tree.root()->child(1);
+    QVERIFY(records->hasFixedStride());
+    QCOMPARE(records->childCount(), 2);
+    QCOMPARE(records->size(), qint64(8));
+    StructNode *second = records->child(1);
+    QCOMPARE(second->offset(), qint64(8));
+    QCOMPARE(second->child(1)->value(), QString("9 (0x09)"));
+    QCOMPARE(tree.root()->nodeAt(10), second->child(1));
+}
+
+// Operands read from the file may be anything; results that do not fit in
+// 64 bits, LLONG_MIN / -1 in particular, are reported instead of computed.
+void TestStructTemplate::countArithmetic_data()
+{
+    QTest::addColumn<QString>("count");
+    QTest::addColumn<qint64>("a");
+    QTest::addColumn<qint64>("b");
+    QTest::addColumn<qint64>("size");
+    QTest::addColumn<QString>("problem");
+
+    const QString overflow("arithmetic overflow");
+    QTest::newRow("product") << QString("a * b") << qint64(3) << qint64(4) << qint64(12) << QString();
+    QTest::newRow("negative operands") << QString("a / b + a % b") << qint64(-7) << qint64(-2) << qint64(2)
+                                       << QString();
+    QTest::newRow("remainder of -1") << QString("a % b") << qint64(5) << qint64(-1) << qint64(0) << QString();
+    QTest::newRow("min / -1") << QString("a / b") << qint64(LLONG_MIN) << qint64(-1) << qint64(0) << overflow;
+    QTest::newRow("min % -1") << QString("a % b") << qint64(LLONG_MIN) << qint64(-1) << qint64(0) << overflow;
+    QTest::newRow("divide by zero") << QString("a / b") << qint64(1) << qint64(0) << qint64(0)
+                                    << QString("division by zero");
+    QTest::newRow("modulo zero") << QString("a % b") << qint64(1) << qint64(0) << qint64(0)
+                                 << QString("division by zero");
+    QTest::newRow("sum") << QString("a + b") << qint64(LLONG_MAX) << qint64(1) << qint64(0) << overflow;
+    QTest::newRow("difference") << QString("a - b") << qint64(LLONG_MIN) << qint64(1) << qint64(0) << overflow;
+    QTest::newRow("large product") << QString("a * b") << qint64(Q_INT64_C(1) << 62) << qint64(4) << qint64(0)
+                                   << overflow;
+    QTest::newRow("negative product") << QString("a * b") << qint64(Q_INT64_C(1) << 62) << qint64(-3) << qint64(0)
+                                      << overflow;
+    QTest::newRow("negation") << QString("-a") << qint64(LLONG_MIN) << qint64(0) << qint64(0) << overflow;
+    QTest::newRow("smallest product") << QString("-(a * b)") << qint64(Q_INT64_C(1) << 62) << qint64(-2)
+                                      << qint64(0) << overflow;
+}
+
+void TestStructTemplate::countArithmetic()
+{
+    QFETCH(QString, count);
+    QFETCH(qint64, a);
+    QFETCH(qint64, b);
+    QFETCH(qint64, size);
+    QFETCH(QString, problem);
+
+    const auto tmpl = parse(QString("struct S { i64 a; i64 b; bytes[%1] data; u8 after }").arg(count));
+    QVERIFY(tmpl);
+    StructTree tree(tmpl, le64(a) + le64(b) + QByteArray(64, 'x'));
+    StructNode *data = tree.root()->child(2);
+
+    QCOMPARE(data->size(), size);
+    QCOMPARE(data->hasProblem(), !problem.isEmpty());
+    if (!problem.isEmpty()) QCOMPARE(data->value(), problem);
+    QCOMPARE(tree.root()->child(3)->offset(), 16 + size);
+}
+
+void TestStructTemplate::offsetOverflowIsAProblem()
+{
+    const auto tmpl = parse("struct S { i64 a; i64 b; u8 sum @ a + b; u8 far @ a; bytes[4] tail @ a }");
+    QVERIFY(tmpl);
+    StructTree tree(tmpl, le64(LLONG_MAX) + le64(1));
+
+    StructNode *sum = tree.root()->child(2);
+    QCOMPARE(sum->value(), QString("arithmetic overflow"));
+    // Reading past the end must not add the width to the offset.
+    StructNode *far = tree.root()->child(3);
+    QCOMPARE(far->offset(), qint64(LLONG_MAX));
+    QCOMPARE(far->value(), QString("past the end of the data"));
+    QCOMPARE(tree.root()->child(4)->value(), QString("past the end of the data"));
+    QCOMPARE(tree.root()->nodeAt(8), tree.root()->child(1));
+}
+
+// Sizes and offsets that follow an array too large for 64 bits stop at
+// LLONG_MAX instead of wrapping back into the data.
+void TestStructTemplate::arraySizeOverflowIsAProblem()
+{
+    const auto tmpl = parse("struct S { i64 count; u32[count] items; u8 after }");
+    QVERIFY(tmpl);
+    StructTree tree(tmpl, le64(Q_INT64_C(1) << 62) + QByteArray(8, 'x'));
+
+    StructNode *items = tree.root()->child(1);
+    QCOMPARE(items->size(), qint64(LLONG_MAX));
+    QVERIFY(items->hasProblem());
+    QCOMPARE(items->childCount(), 2);
+    QCOMPARE(items->child(1)->offset(), qint64(12));
+    QCOMPARE(tree.root()->child(2)->offset(), qint64(LLONG_MAX));
+    QCOMPARE(tree.root()->child(2)->value(), QString("past the end of the data"));
+    QCOMPARE(tree.root()->nodeAt(13), items->child(1));
+}
+
+void TestStructTemplate::constantOverflowIsAProblem()
+{
+    const auto tmpl = parse("struct S { u8 a; Big[4] bigs }\n"
+                            "struct Big { bytes[4611686018427387904] data }");
+    QVERIFY(tmpl);
+    StructTree tree(tmpl, QByteArray(16, 'x'));
+
+    StructNode *bigs = tree.root()->child(1);
+    QCOMPARE(bigs->size(), qint64(LLONG_MAX));
+    QVERIFY(bigs->hasProblem());
+    QCOMPARE(bigs->child(0)->size(), Q_INT64_C(4611686018427387904));
+}
+
+QTEST_APPLESS_MAIN(TestStructTemplate)
+
+#include "tst_structtemplate.moc"
@@ -0,0 +1,144 @@
+#include "textconverter.h"
+#include <QtTest>
+#include <random>
+
+namespace {
+
+QString escape(const QString &text)
+{
+    QString out(text.size() * 6, Qt::Uninitialized);
+    TextConverter::escapeUnicode(text.constData(), text.size(), out.data());
+    return out;
+}
+
+QString unescape(const QString &text, bool final = true, int *consumed = nullptr)
+{
+    QString out(text.size(), Qt::Uninitialized);
+    int read = 0;
+    out.truncate(TextConverter::unescapeUnicode(text.constData(), int(text.size()), out.data(), final, &read));
+    if (consumed) *consumed = read;
+    return out;
+}
+
+}
+
+class TestTextConverter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void escapesEveryUnit();
+    void roundTripsEveryLength();
+    void unescapes_data();
+    void unescapes();
+    void waitsForCutEscapes_data();
+    void waitsForCutEscapes();
+};
+
+void TestTextConverter::escapesEveryUnit()
+{
+    QString all(0x10000, Qt::Uninitialized);
+    for (int u = 0; u < 0x10000; ++u) all[u] = QChar(ushort(u));
+
+    const QString escaped = escape(all);
+    QCOMPARE(int(escaped.size()), 0x10000 * 6);
+    for (int u = 0; u < 0x10000; ++u) {
+        const QString expected = QString("\\u%1").arg(u, 4, 16, QLatin1Char('0'));
+        if (escaped.mid(u * 6, 6) != expected) QFAIL(qPrintable("wrong escape for " + expected));
+    }
+
+    QString bmp;
+    for (int u = 0; u < 0x10000; ++u) {
+        if (u < 0xD800 || u > 0xDFFF) bmp += QChar(ushort(u));
+    }
+    QCOMPARE(unescape(escape(bmp)), bmp);
+
+    // Unpaired surrogates come back as U+FFFD.
+    for (int u = 0xD800; u <= 0xDFFF; ++u) {
+        if (unescape(escape(QString(QChar(ushort(u))))) != QString(QChar(0xFFFD))) {
+            QFAIL(qPrintable(QString("unpaired %1 kept").arg(u, 0, 16)));
+        }
+    }
+}
+
+// Lengths around the eight-unit vector width, with surrogate pairs that may
+// straddle a vector.
+void TestTextConverter::roundTripsEveryLength()
+{
+    std::mt19937 rng(5);
+    for (int length = 0; length <= 40; ++length) {
+        QString text;
+        while (text.size() < length) {
+            if (rng() % 5 == 0 && text.size() + 2 <= length) {
+                text += QChar(ushort(0xD800 + rng() % 0x400));
+                text += QChar(ushort(0xDC00 + rng() % 0x400));
+            } else {
+                ushort u = ushort(rng());
+                if (u >= 0xD800 && u <= 0xDFFF) u = '\\';
+                text += QChar(u);
+            }
+        }
+        QCOMPARE(unescape(escape(text)), text);
+        QCOMPARE(TextConverter::fromUnicode(TextConverter::toUnicode(text)), text);
+    }
+}
+
+void TestTextConverter::unescapes_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<QString>("expected");
+
+    const QString grinning = QString::fromUtf8("\xF0\x9F\x98\x80");
+    const QChar replacement(0xFFFD);
+    QTest::newRow("basic") << QString("\\u0041") << QString("A");
+    QTest::newRow("upper-case digits") << QString("\\u00e9\\u00C9") << QString::fromUtf8("\xC3\xA9\xC3\x89");
+    QTest::newRow("pair") << QString("\\ud83d\\ude00") << grinning;
+    QTest::newRow("long form") << QString("\\U0001F600") << grinning;
+    QTest::newRow("lone high") << QString("\\ud83dx") << QString(replacement) + "x";
+    QTest::newRow("lone low") << QString("\\ude00") << QString(replacement);
+    QTest::newRow("long form surrogate") << QString("\\U0000D800") << QString(replacement);
+    QTest::newRow("past U+10FFFF") << QString("\\U00110000") << QString("\\U00110000");
+    QTest::newRow("bad digit") << QString("\\u12g4") << QString("\\u12g4");
+    QTest::newRow("other escape") << QString("\\x41") << QString("\\x41");
+    QTest::newRow("trailing backslash") << QString("a\\") << QString("a\\");
+    QTest::newRow("short") << QString("\\u41") << QString("\\u41");
+    QTest::newRow("long literal runs") << QString("abcdefghijk\\u0041lmnopqrstuvwxyz\\u0042")
+                                       << QString("abcdefghijkAlmnopqrstuvwxyzB");
+}
+
+void TestTextConverter::unescapes()
+{
+    QFETCH(QString, input);
+    QFETCH(QString, expected);
+    QCOMPARE(unescape(input), expected);
+}
+
+void TestTextConverter::waitsForCutEscapes_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<QString>("written");
+    QTest::addColumn<int>("consumed");
+
+    QTest::newRow("cut digits") << QString("ab\\u00") << QString("ab") << 2;
+    QTest::newRow("cut long form") << QString("ab\\U0001F6") << QString("ab") << 2;
+    QTest::newRow("backslash at end") << QString("a\\") << QString("a") << 1;
+    QTest::newRow("high surrogate at end") << QString("\\ud83d") << QString() << 0;
+    QTest::newRow("cut low surrogate") << QString("\\ud83d\\ude") << QString() << 0;
+    QTest::newRow("high then text") << QString("\\ud83dx") << QString(QChar(0xFFFD)) + "x" << 7;
+    QTest::newRow("not an escape") << QString("\\x") << QString("\\x") << 2;
+}
+
+void TestTextConverter::waitsForCutEscapes()
+{
+    QFETCH(QString, input);
+    QFETCH(QString, written);
+    QFETCH(int, consumed);
+
+    int read = -1;
+    QCOMPARE(unescape(input, false, &read), written);
+    QCOMPARE(read, consumed);
+}
+
+QTEST_APPLESS_MAIN(TestTextConverter)
+
+#include "tst_textconverter.moc"
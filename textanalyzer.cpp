@@ -1,27 +1,60 @@
 #include "textanalyzer.h"
-#include <QRegularExpression>
+#include "trace.h"
 
+namespace {
+
+// \s in the patterns this replaces: ASCII whitespace only.
+inline bool isPatternSpace(ushort c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool isHexDigit(ushort c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+}
+
+// One pass over the trimmed range, without copying it or compiling the
+// ^[01\s]+$ and ^[0-9A-Fa-f\s]+$ expressions on every call.
 TextType TextAnalyzer::detectType(const QString &text)
 {
-    QString t = text.trimmed();
+    TRACE_SCOPE("TextAnalyzer::detectType");
+    const QChar *begin = text.constData();
+    const QChar *end = begin + text.size();
+    while (begin < end && begin->isSpace()) ++begin;
+    while (end > begin && (end - 1)->isSpace()) --end;
+    if (begin == end) {
+        return TYPE_UNKNOWN;
+    }
 
+    bool binary = true;
+    bool hex = true;
+    bool escape = false;
+    for (const QChar *p = begin; p < end; ++p) {
+        const ushort c = p->unicode();
+        if (isPatternSpace(c)) continue;
+        if (c != '0' && c != '1') binary = false;
+        if (!isHexDigit(c)) {
+            hex = false;
+            if (c == '\\' && p + 1 < end && p[1].unicode() == 'u') {
+                escape = true;
+                break;
+            }
+        }
+    }
 
-    if(QRegularExpression("^[01\\s]+$").match(t).hasMatch())
+    if (binary)
         return TYPE_BINARY;
 
-
-    if(QRegularExpression("^[0-9A-Fa-f\\s]+$").match(t).hasMatch())
+    if (hex)
         return TYPE_HEX;
 
-
-    if(t.contains("\\u"))
+    if (escape)
         return TYPE_UNICODE;
 
-
-    if(!t.isEmpty())
-        return TYPE_TEXT;
-
-    return TYPE_UNKNOWN;
+    return TYPE_TEXT;
 }
 
 QString TextAnalyzer::typeName(TextType type)
@@ -1,67 +1,390 @@
 #include "textconverter.h"
+#include "baseencoding.h"
+#include "trace.h"
 #include <QChar>
 #include <QStringList>
+#include <QtAlgorithms>
 #include <QByteArray>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
+namespace {
 
+typedef decltype(QByteArray().size()) ByteCount;
 
-QString TextConverter::toBinary(const QString &text) {
-    QString result;
-    QByteArray data = text.toUtf8();
-    for (unsigned char c : data) {
-        result += QString("%1 ").arg(c, 8, 2, QLatin1Char('0'));
+// Longest result a QByteArray (unitSize 1) or QString (unitSize 2) can hold,
+// leaving room for the container header. Sizes are worked out in 64 bits and
+// checked against this before anything is allocated.
+constexpr qint64 maxResultSize(int unitSize) {
+    return (qint64(std::numeric_limits<ByteCount>::max()) - 64) / unitSize;
+}
+
+bool fitsResult(qint64 size, int unitSize, QString *error) {
+    if (size <= maxResultSize(unitSize)) return true;
+    if (error) *error = QString("Output of %1 bytes is too large to hold in memory; convert in chunks instead.")
+                            .arg(size * unitSize);
+    return false;
+}
+
+inline bool isAsciiSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+// Hex digit value of an ASCII character, -1 for anything else.
+struct HexTable {
+    signed char value[128];
+
+    HexTable() {
+        std::memset(value, -1, sizeof(value));
+        for (int i = 0; i < 10; ++i) value['0' + i] = char(i);
+        for (int i = 0; i < 6; ++i) {
+            value['a' + i] = char(10 + i);
+            value['A' + i] = char(10 + i);
+        }
     }
-    return result.trimmed();
+};
+
+const HexTable hexTable;
+
+// The eight '0'/'1' characters of every byte, most significant bit first, in
+// memory order so one 64-bit store writes a whole group.
+struct BinaryTable {
+    char digits[256][8];
+
+    BinaryTable() {
+        for (int b = 0; b < 256; ++b) {
+            for (int bit = 0; bit < 8; ++bit) {
+                digits[b][bit] = ((b >> (7 - bit)) & 1) ? '1' : '0';
+            }
+        }
+    }
+};
+
+const BinaryTable binaryTable;
+
+// Decodes eight '0'/'1' characters into a byte; false if any is something
+// else. After subtracting '0' each character is bit 0 of its byte, and the
+// multiply gathers those eight bits into the top byte, first character
+// highest.
+inline bool parseBinaryGroup(const char *p, uchar *value) {
+    const quint64 word = qFromLittleEndian<quint64>(p);
+    if ((word & 0xFEFEFEFEFEFEFEFEull) != 0x3030303030303030ull) return false;
+    *value = uchar(((word - 0x3030303030303030ull) * 0x8040201008040201ull) >> 56);
+    return true;
 }
 
-QString TextConverter::fromBinary(const QString &binary) {
-    QString result;
-    QStringList list = binary.split(" ", Qt::SkipEmptyParts);
-    QByteArray data;
-    for (const QString &b : list) {
-        bool ok;
-        data.append(static_cast<char>(b.toUInt(&ok, 2)));
+// Parses exactly `digits` hex digits; -1 when any of them is not hex.
+inline qint64 parseHexDigits(const ushort *p, int digits) {
+    qint64 value = 0;
+    for (int i = 0; i < digits; ++i) {
+        const ushort c = p[i];
+        const int d = c < 128 ? hexTable.value[c] : -1;
+        if (d < 0) return -1;
+        value = (value << 4) | d;
     }
-    return QString::fromUtf8(data);
+    return value;
 }
 
-QString TextConverter::toHex(const QString &text, int bytesPerGroup) {
-    QString result;
-    QByteArray data = text.toUtf8();
-    for (int i = 0; i < data.size(); ++i) {
-        result += QString("%1").arg(static_cast<unsigned char>(data[i]), 2, 16, QChar('0')).toUpper();
-        if ((i + 1) % bytesPerGroup == 0) result += " ";
+// True when p[0, available) could still grow into a complete escape, i.e. the
+// input was cut in the middle of one.
+bool isEscapePrefix(const ushort *p, int available) {
+    if (available < 1 || p[0] != '\\') return false;
+    if (available < 2) return true;
+    if (p[1] != 'u' && p[1] != 'U') return false;
+    const int digits = (p[1] == 'u') ? 4 : 8;
+    const int present = qMin(available - 2, digits);
+    return parseHexDigits(p + 2, present) >= 0 && present < digits;
+}
+
+inline bool isHighSurrogate(qint64 u) { return u >= 0xD800 && u <= 0xDBFF; }
+inline bool isLowSurrogate(qint64 u) { return u >= 0xDC00 && u <= 0xDFFF; }
+
+}
+
+QByteArray TextConverter::bytesToBinary(const QByteArray &data, QString *error) {
+    TRACE_SCOPE("TextConverter::bytesToBinary");
+    QByteArray result;
+    if (data.isEmpty()) return result;
+
+    const qint64 n = data.size();
+    if (!fitsResult(n * 9 - 1, 1, error)) return result;
+    result.resize(ByteCount(n * 9 - 1));
+    const uchar *in = reinterpret_cast<const uchar *>(data.constData());
+    char *out = result.data();
+    for (qint64 i = 0; i < n - 1; ++i) {
+        std::memcpy(out, binaryTable.digits[in[i]], 8);
+        out[8] = ' ';
+        out += 9;
     }
-    return result.trimmed();
+    std::memcpy(out, binaryTable.digits[in[n - 1]], 8);
+    return result;
 }
 
-QString TextConverter::fromHex(const QString &hex) {
-    QString clean = hex;
-    clean.remove(' ').remove('\n');
+QByteArray TextConverter::binaryToBytes(const QByteArray &binary) {
+    TRACE_SCOPE("TextConverter::binaryToBytes");
+    QByteArray data(binary.size() / 2 + 1, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(data.data());
+
+    const char *p = binary.constData();
+    const char *end = p + binary.size();
+    while (p < end) {
+        while (p < end && isAsciiSpace(*p)) ++p;
+        if (p == end) break;
+
+        // Eight digits and a separator is what bytesToBinary writes; decode
+        // and validate those in one step.
+        if (end - p >= 8 && (end - p == 8 || isAsciiSpace(p[8])) && parseBinaryGroup(p, out)) {
+            ++out;
+            p += 8;
+            continue;
+        }
 
-    return QString::fromUtf8(QByteArray::fromHex(clean.toUtf8()));
+        // Same result as QString::toUInt(&ok, 2) per token: anything that is
+        // not a valid 32-bit binary number becomes 0, longer values truncate.
+        quint64 value = 0;
+        bool ok = true;
+        int digits = 0;
+        while (p < end && !isAsciiSpace(*p)) {
+            if (*p == '0' || *p == '1') value = (value << 1) | quint64(*p - '0');
+            else ok = false;
+            if (++digits > 32) ok = false;
+            ++p;
+        }
+        *out++ = uchar(ok ? value : 0);
+    }
+    data.truncate(int(out - reinterpret_cast<uchar *>(data.data())));
+    return data;
 }
 
-QString TextConverter::toUnicode(const QString &text) {
-    QString result;
-    for (QChar c : text) {
-        result += QString("\\u%1").arg(static_cast<ushort>(c.unicode()), 4, 16, QChar('0'));
+QByteArray TextConverter::bytesToHex(const QByteArray &data, int bytesPerGroup, QString *error) {
+    TRACE_SCOPE("TextConverter::bytesToHex");
+    static const char digits[] = "0123456789ABCDEF";
+    QByteArray result;
+    if (data.isEmpty()) return result;
+    if (bytesPerGroup < 1) bytesPerGroup = 1;
+
+    const qint64 n = data.size();
+    const qint64 groups = (n + bytesPerGroup - 1) / bytesPerGroup;
+    if (!fitsResult(n * 2 + groups - 1, 1, error)) return result;
+    result.resize(ByteCount(n * 2 + groups - 1));
+    char *out = result.data();
+    for (qint64 i = 0; i < n; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        *out++ = digits[c >> 4];
+        *out++ = digits[c & 0x0F];
+        if ((i + 1) % bytesPerGroup == 0 && i + 1 < n) *out++ = ' ';
     }
     return result;
 }
 
-QString TextConverter::fromUnicode(const QString &unicode) {
-    QString result;
-
-    QStringList parts = unicode.split("\\u", Qt::SkipEmptyParts);
-    for (const QString &p : parts) {
-        bool ok;
-        ushort code = static_cast<ushort>(p.left(4).toUInt(&ok, 16));
-        if (ok) result += QChar(code);
-        if (p.length() > 4) {
-            result += p.mid(4);
+// QByteArray::fromHex pairs digits from the end, so an odd digit anywhere
+// shifts every byte before it and a chunked decoder could not know how to
+// pair until the input ends. Pairing from the start gives the same bytes for
+// even counts and lets StreamConverter match this exactly.
+QByteArray TextConverter::hexToBytes(const QByteArray &hex) {
+    TRACE_SCOPE("TextConverter::hexToBytes");
+    QByteArray result(hex.size() / 2 + 1, Qt::Uninitialized);
+    char *out = result.data();
+    int high = -1;
+    for (const char ch : hex) {
+        const uchar c = uchar(ch);
+        const int d = c < 128 ? hexTable.value[c] : -1;
+        if (d < 0) continue;
+        if (high < 0) {
+            high = d;
+        } else {
+            *out++ = char(high << 4 | d);
+            high = -1;
+        }
+    }
+    if (high >= 0) *out++ = char(high);
+    result.truncate(ByteCount(out - result.constData()));
+    return result;
+}
+
+QByteArray TextConverter::convertBytes(const QByteArray &data, const QString &to, const QString &from,
+                                       QString *error) {
+    TRACE_SCOPE("TextConverter::convertBytes");
+    BaseEncoding::Kind encoding;
+    if (to == "hex") return bytesToHex(data, 1, error);
+    if (to == "binary") return bytesToBinary(data, error);
+    if (to == "unicode") return toUnicode(QString::fromUtf8(data), error).toLatin1();
+    if (BaseEncoding::parseKind(to, &encoding)) return BaseEncoding::encode(data, encoding, error);
+    if (to == "text") {
+        if (from == "hex") return hexToBytes(data);
+        if (from == "binary") return binaryToBytes(data);
+        if (from == "unicode") return fromUnicode(QString::fromUtf8(data)).toUtf8();
+        if (BaseEncoding::parseKind(from, &encoding)) return BaseEncoding::decode(data, encoding, error);
+        return data;
+    }
+    return QByteArray();
+}
+
+QString TextConverter::toBinary(const QString &text) {
+    TRACE_SCOPE("TextConverter::toBinary");
+    return QString::fromLatin1(bytesToBinary(text.toUtf8()));
+}
+
+QString TextConverter::fromBinary(const QString &binary) {
+    TRACE_SCOPE("TextConverter::fromBinary");
+    return QString::fromUtf8(binaryToBytes(binary.toLatin1()));
+}
+
+QString TextConverter::toHex(const QString &text, int bytesPerGroup) {
+    TRACE_SCOPE("TextConverter::toHex");
+    return QString::fromLatin1(bytesToHex(text.toUtf8(), bytesPerGroup));
+}
+
+QString TextConverter::fromHex(const QString &hex) {
+    TRACE_SCOPE("TextConverter::fromHex");
+    return QString::fromUtf8(hexToBytes(hex.toLatin1()));
+}
+
+void TextConverter::escapeUnicode(const QChar *in, qsizetype size, QChar *out) {
+    const ushort *src = reinterpret_cast<const ushort *>(in);
+    ushort *dst = reinterpret_cast<ushort *>(out);
+    qsizetype i = 0;
+
+#ifdef __SSE2__
+    // Eight units at a time: the four nibbles of every unit are turned into
+    // hex digits in parallel, then each unit is stored as "\u" + 4 digits.
+    const __m128i mask = _mm_set1_epi16(0x0F);
+    const __m128i nine = _mm_set1_epi16(9);
+    const __m128i zero = _mm_set1_epi16('0');
+    const __m128i letterGap = _mm_set1_epi16('a' - '0' - 10);
+    const quint32 prefix = quint32('\\') | (quint32('u') << 16);
+    for (; size - i >= 8; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i n[4] = {
+            _mm_and_si128(_mm_srli_epi16(v, 12), mask),
+            _mm_and_si128(_mm_srli_epi16(v, 8), mask),
+            _mm_and_si128(_mm_srli_epi16(v, 4), mask),
+            _mm_and_si128(v, mask)
+        };
+        for (__m128i &d : n) {
+            d = _mm_add_epi16(_mm_add_epi16(d, zero), _mm_and_si128(_mm_cmpgt_epi16(d, nine), letterGap));
+        }
+
+        // Interleave to [d3 d2 d1 d0] per unit, two units per register.
+        const __m128i hiLo = _mm_unpacklo_epi16(n[0], n[1]);
+        const __m128i hiHi = _mm_unpackhi_epi16(n[0], n[1]);
+        const __m128i loLo = _mm_unpacklo_epi16(n[2], n[3]);
+        const __m128i loHi = _mm_unpackhi_epi16(n[2], n[3]);
+        const __m128i units[4] = {
+            _mm_unpacklo_epi32(hiLo, loLo), _mm_unpackhi_epi32(hiLo, loLo),
+            _mm_unpacklo_epi32(hiHi, loHi), _mm_unpackhi_epi32(hiHi, loHi)
+        };
+        for (int k = 0; k < 4; ++k) {
+            std::memcpy(dst, &prefix, 4);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 2), units[k]);
+            std::memcpy(dst + 6, &prefix, 4);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 8), _mm_unpackhi_epi64(units[k], units[k]));
+            dst += 12;
         }
     }
+#endif
+
+    static const char digits[] = "0123456789abcdef";
+    for (; i < size; ++i) {
+        const ushort c = src[i];
+        *dst++ = '\\';
+        *dst++ = 'u';
+        *dst++ = ushort(digits[c >> 12]);
+        *dst++ = ushort(digits[(c >> 8) & 0x0F]);
+        *dst++ = ushort(digits[(c >> 4) & 0x0F]);
+        *dst++ = ushort(digits[c & 0x0F]);
+    }
+}
+
+int TextConverter::unescapeUnicode(const QChar *in, int size, QChar *out, bool final, int *consumed) {
+    const ushort *p = reinterpret_cast<const ushort *>(in);
+    const ushort *end = p + size;
+    ushort *dst = reinterpret_cast<ushort *>(out);
+    ushort *const dstBegin = dst;
+
+    while (p < end) {
+        // Copy the literal run up to the next backslash.
+#ifdef __SSE2__
+        const __m128i backslash = _mm_set1_epi16('\\');
+        while (end - p >= 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            const int hits = _mm_movemask_epi8(_mm_cmpeq_epi16(v, backslash));
+            if (hits) {
+                const int run = qCountTrailingZeroBits(uint(hits)) / 2;
+                for (int k = 0; k < run; ++k) dst[k] = p[k];
+                dst += run;
+                p += run;
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v);
+            dst += 8;
+            p += 8;
+        }
+#endif
+        while (p < end && *p != '\\') *dst++ = *p++;
+        if (p == end) break;
+
+        const int available = int(end - p);
+        if (!final && isEscapePrefix(p, available)) break;
+
+        if (available >= 6 && p[1] == 'u') {
+            const qint64 unit = parseHexDigits(p + 2, 4);
+            if (unit >= 0) {
+                if (isHighSurrogate(unit)) {
+                    if (!final && available < 12 && (available == 6 || isEscapePrefix(p + 6, available - 6))) break;
+                    const qint64 low = (available >= 12 && p[6] == '\\' && p[7] == 'u') ? parseHexDigits(p + 8, 4) : -1;
+                    if (isLowSurrogate(low)) {
+                        *dst++ = ushort(unit);
+                        *dst++ = ushort(low);
+                        p += 12;
+                        continue;
+                    }
+                    *dst++ = 0xFFFD;
+                } else {
+                    *dst++ = isLowSurrogate(unit) ? 0xFFFD : ushort(unit);
+                }
+                p += 6;
+                continue;
+            }
+        } else if (available >= 10 && p[1] == 'U') {
+            const qint64 code = parseHexDigits(p + 2, 8);
+            if (code >= 0 && code <= 0x10FFFF) {
+                if (code >= 0x10000) {
+                    *dst++ = ushort(0xD800 + ((code - 0x10000) >> 10));
+                    *dst++ = ushort(0xDC00 + ((code - 0x10000) & 0x3FF));
+                } else {
+                    *dst++ = (isHighSurrogate(code) || isLowSurrogate(code)) ? 0xFFFD : ushort(code);
+                }
+                p += 10;
+                continue;
+            }
+        }
+
+        // Not an escape: keep the backslash as text.
+        *dst++ = *p++;
+    }
+
+    *consumed = int(p - reinterpret_cast<const ushort *>(in));
+    return int(dst - dstBegin);
+}
+
+QString TextConverter::toUnicode(const QString &text, QString *error) {
+    TRACE_SCOPE("TextConverter::toUnicode");
+    if (!fitsResult(qint64(text.size()) * 6, 2, error)) return QString();
+    QString result(ByteCount(qint64(text.size()) * 6), Qt::Uninitialized);
+    escapeUnicode(text.constData(), text.size(), result.data());
+    return result;
+}
+
+QString TextConverter::fromUnicode(const QString &unicode) {
+    TRACE_SCOPE("TextConverter::fromUnicode");
+    QString result(unicode.size(), Qt::Uninitialized);
+    int consumed = 0;
+    result.truncate(unescapeUnicode(unicode.constData(), unicode.size(), result.data(), true, &consumed));
     return result;
 }
 
@@ -69,5 +392,7 @@ QString TextConverter::toText(const QString &text, const QString &format) {
     if (format == "hex") return fromHex(text);
     if (format == "binary") return fromBinary(text);
     if (format == "unicode") return fromUnicode(text);
+    BaseEncoding::Kind encoding;
+    if (BaseEncoding::parseKind(format, &encoding)) return QString::fromUtf8(BaseEncoding::decode(text.toLatin1(), encoding));
     return text;
 }
@@ -1,20 +1,45 @@
 #ifndef TEXTCONVERTER_H
 #define TEXTCONVERTER_H
 
+#include <QByteArray>
 #include <QString>
 
 
 class TextConverter {
 public:
-
+    // Converters that take an error set it and return nothing when the
+    // result would not fit in one QByteArray or QString.
     static QString toBinary(const QString &text);
     static QString fromBinary(const QString &binary);
     static QString toHex(const QString &text, int bytesPerGroup = 1);
     static QString fromHex(const QString &hex);
-    static QString toUnicode(const QString &text);
+    static QString toUnicode(const QString &text, QString *error = nullptr);
     static QString fromUnicode(const QString &unicode);
     static QString toText(const QString &text, const QString &format);
 
+    static QByteArray bytesToBinary(const QByteArray &data, QString *error = nullptr);
+    static QByteArray binaryToBytes(const QByteArray &binary);
+    static QByteArray bytesToHex(const QByteArray &data, int bytesPerGroup = 1, QString *error = nullptr);
+    // Skips anything that is not a hex digit and pairs digits from the start;
+    // a last unpaired digit is a byte of its own.
+    static QByteArray hexToBytes(const QByteArray &hex);
+    // Byte-level counterpart of the QString API: "hex", "binary", "unicode",
+    // "base64", "base64url", "base32", "ascii85", or "text" with `from`
+    // naming the input format. Only unicode decodes the data as UTF-8, so
+    // arbitrary bytes survive a round trip through the others.
+    static QByteArray convertBytes(const QByteArray &data, const QString &to, const QString &from = QString(),
+                                   QString *error = nullptr);
+
+    // \uXXXX per UTF-16 unit; writes exactly size * 6 characters to out.
+    // Characters outside the BMP come out as their surrogate pair.
+    static void escapeUnicode(const QChar *in, qsizetype size, QChar *out);
+    // Decodes \uXXXX (pairs are joined) and \UXXXXXXXX escapes from in into
+    // out, which needs room for size characters; other text is copied as is
+    // and unpaired surrogates become U+FFFD. Unless final, stops before an
+    // escape that may continue past the end. Returns characters written and
+    // sets *consumed to characters read.
+    static int unescapeUnicode(const QChar *in, int size, QChar *out, bool final, int *consumed);
+
 private:
 
 
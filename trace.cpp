@@ -0,0 +1,190 @@
+#include "trace.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QtGlobal>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::enabled{false};
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+};
+
+// The fields are atomic so an export can read a slot while its thread is
+// overwriting it; the reader drops slots the writer may have reached.
+struct TraceSlot {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<qint64> startNs{0};
+    std::atomic<qint64> durationNs{0};
+};
+
+constexpr quint64 kRingCapacity = 1 << 16;
+
+// head only ever grows and is written by the owning thread alone. clear()
+// moves clearedAt up to it instead, so it never races with record().
+// threadId and clearedAt change only under registryMutex.
+struct ThreadBuffer {
+    quint64 threadId = 0;
+    std::atomic<quint64> head{0};
+    std::atomic<quint64> clearedAt{0};
+    TraceSlot events[kRingCapacity];
+};
+
+// Buffers outlive their threads so the events of a finished thread are still
+// exported. When a thread exits its buffer goes on the free list and the next
+// new thread takes it over, so there are never more buffers than threads that
+// recorded at the same time.
+std::mutex registryMutex;
+std::vector<ThreadBuffer *> registry;
+std::vector<ThreadBuffer *> freeBuffers;
+std::atomic<quint64> nextThreadId{1};
+
+struct BufferLease {
+    ThreadBuffer *buffer = nullptr;
+
+    ~BufferLease()
+    {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        freeBuffers.push_back(buffer);
+    }
+};
+
+ThreadBuffer *threadBuffer()
+{
+    thread_local BufferLease lease;
+    if (!lease.buffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (freeBuffers.empty()) {
+            lease.buffer = new ThreadBuffer;
+            registry.push_back(lease.buffer);
+        } else {
+            lease.buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+            lease.buffer->clearedAt.store(lease.buffer->head.load(std::memory_order_relaxed),
+                                          std::memory_order_relaxed);
+        }
+        lease.buffer->threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    }
+    return lease.buffer;
+}
+
+void appendEscaped(QByteArray &out, const char *text)
+{
+    for (const char *p = text; *p; ++p) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        out += *p;
+    }
+}
+
+}
+
+void Trace::setEnabled(bool on)
+{
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+void Trace::initFromEnvironment()
+{
+    if (!qEnvironmentVariableIsEmpty("HEXEDITOR_TRACE")) {
+        setEnabled(true);
+    }
+}
+
+QString Trace::environmentExportPath()
+{
+    const QString value = qEnvironmentVariable("HEXEDITOR_TRACE");
+    if (value.isEmpty() || value == "1") {
+        return QString();
+    }
+    return value;
+}
+
+qint64 Trace::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::record(const char *name, qint64 startNs, qint64 durationNs)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    const quint64 slot = buffer->head.load(std::memory_order_relaxed);
+    // Pairs with the fence in exportChromeJson: a reader that sees any of
+    // the stores below also sees head at slot, and so knows to drop it.
+    std::atomic_thread_fence(std::memory_order_release);
+    TraceSlot &event = buffer->events[slot & (kRingCapacity - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.durationNs.store(durationNs, std::memory_order_relaxed);
+    buffer->head.store(slot + 1, std::memory_order_release);
+}
+
+bool Trace::exportChromeJson(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<TraceEvent> events;
+    for (ThreadBuffer *buffer : registry) {
+        // Copy the ring, then drop whatever its thread may have overwritten
+        // while it was being copied.
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        const quint64 cleared = buffer->clearedAt.load(std::memory_order_relaxed);
+        const quint64 begin = qMax(cleared, head > kRingCapacity ? head - kRingCapacity : 0);
+        events.clear();
+        for (quint64 i = begin; i < head; ++i) {
+            const TraceSlot &slot = buffer->events[i & (kRingCapacity - 1)];
+            events.push_back({ slot.name.load(std::memory_order_relaxed),
+                               slot.startNs.load(std::memory_order_relaxed),
+                               slot.durationNs.load(std::memory_order_relaxed) });
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const quint64 after = buffer->head.load(std::memory_order_relaxed);
+        const quint64 skip = after >= begin + kRingCapacity ? after - kRingCapacity + 1 - begin : 0;
+
+        for (size_t i = qMin<quint64>(skip, events.size()); i < events.size(); ++i) {
+            const TraceEvent &e = events[i];
+            if (!e.name) continue;
+
+            if (!first) out += ',';
+            first = false;
+            out += "{\"ph\":\"X\",\"name\":\"";
+            appendEscaped(out, e.name);
+            out += "\",\"pid\":" + QByteArray::number(pid);
+            out += ",\"tid\":" + QByteArray::number(buffer->threadId);
+            out += ",\"ts\":" + QByteArray::number(e.startNs / 1000.0, 'f', 3);
+            out += ",\"dur\":" + QByteArray::number(e.durationNs / 1000.0, 'f', 3);
+            out += '}';
+
+            if (out.size() > (1 << 20)) {
+                file.write(out);
+                out.clear();
+            }
+        }
+    }
+    out += "]}\n";
+    file.write(out);
+    return true;
+}
+
+void Trace::clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (ThreadBuffer *buffer : registry) {
+        buffer->clearedAt.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
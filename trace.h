@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+
+// Scoped hot-path tracing. Events go into a fixed size ring buffer owned by the
+// recording thread, so recording never takes a lock; only the first event on a
+// new thread takes a buffer, reusing one a finished thread left behind. Export
+// and clear may run while other threads are still recording. When tracing is
+// disabled a TRACE_SCOPE costs one relaxed atomic load.
+class Trace
+{
+public:
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on);
+
+    // HEXEDITOR_TRACE=1 enables tracing, any other non-empty value is also
+    // taken as the path the trace is written to when the process exits.
+    static void initFromEnvironment();
+    static QString environmentExportPath();
+
+    static qint64 nowNs();
+    static void record(const char *name, qint64 startNs, qint64 durationNs);
+
+    static bool exportChromeJson(const QString &path);
+    static void clear();
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : name(Trace::isEnabled() ? name : nullptr), start(this->name ? Trace::nowNs() : 0) {}
+    ~TraceScope()
+    {
+        if (name) Trace::record(name, start, Trace::nowNs() - start);
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    qint64 start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#endif